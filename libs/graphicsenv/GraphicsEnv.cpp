@@ -697,6 +697,32 @@ void GraphicsEnv::nativeToggleAngleAsSystemDriver(bool enabled) {
     gpuService->toggleAngleAsSystemDriver(enabled);
 }
 
+std::unique_ptr<SharedBlobStore> GraphicsEnv::getSharedBlobStore(const std::string& buildId) {
+    ATRACE_CALL();
+    const sp<IGpuService> gpuService = getGpuService();
+    if (!gpuService) {
+        return nullptr;
+    }
+
+    base::unique_fd store = gpuService->getSharedBlobStore();
+    if (!store.ok()) {
+        return nullptr;
+    }
+    return SharedBlobStore::map(std::move(store), buildId);
+}
+
+void GraphicsEnv::reportBlobCacheUsage(const SharedBlobUsage& usage) {
+    ATRACE_CALL();
+    if (usage.lookups == 0 && usage.candidates.empty()) {
+        return;
+    }
+
+    const sp<IGpuService> gpuService = getGpuService();
+    if (gpuService) {
+        gpuService->reportBlobCacheUsage(usage);
+    }
+}
+
 bool GraphicsEnv::shouldUseSystemAngle() {
     return mShouldUseSystemAngle;
 }
@@ -728,6 +754,14 @@ const std::string& GraphicsEnv::getLayerPaths() {
     return mLayerPaths;
 }
 
+void GraphicsEnv::setLayerCacheFilename(const std::string& filename) {
+    mLayerCacheFilename = filename;
+}
+
+const std::string& GraphicsEnv::getLayerCacheFilename() {
+    return mLayerCacheFilename;
+}
+
 const std::string& GraphicsEnv::getDebugLayers() {
     return mDebugLayers;
 }
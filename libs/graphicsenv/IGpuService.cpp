@@ -119,6 +119,39 @@ public:
         }
         return driverPath;
     }
+
+    base::unique_fd getSharedBlobStore() override {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGpuService::getInterfaceDescriptor());
+
+        status_t error = remote()->transact(BnGpuService::GET_SHARED_BLOB_STORE, data, &reply);
+        bool hasStore = false;
+        if (error == OK) {
+            error = reply.readBool(&hasStore);
+        }
+        base::unique_fd store;
+        if (error == OK && hasStore) {
+            error = reply.readUniqueFileDescriptor(&store);
+        }
+        return store;
+    }
+
+    void reportBlobCacheUsage(const SharedBlobUsage& usage) override {
+        Parcel data, reply;
+        data.writeInterfaceToken(IGpuService::getInterfaceDescriptor());
+
+        data.writeUint64(usage.lookups);
+        data.writeUint64(usage.localHits);
+        data.writeUint64(usage.sharedHits);
+        data.writeUint32(static_cast<uint32_t>(usage.candidates.size()));
+        for (const SharedBlobEntry& entry : usage.candidates) {
+            data.writeByteVector(entry.key);
+            data.writeByteVector(entry.value);
+        }
+
+        remote()->transact(BnGpuService::REPORT_BLOB_CACHE_USAGE, data, &reply,
+                           IBinder::FLAG_ONEWAY);
+    }
 };
 
 IMPLEMENT_META_INTERFACE(GpuService, "android.graphicsenv.IGpuService");
@@ -271,6 +304,36 @@ status_t BnGpuService::onTransact(uint32_t code, const Parcel& data, Parcel* rep
             toggleAngleAsSystemDriver(enableAngleAsSystemDriver);
             return OK;
         }
+        case GET_SHARED_BLOB_STORE: {
+            CHECK_INTERFACE(IGpuService, data, reply);
+
+            base::unique_fd store = getSharedBlobStore();
+            if ((status = reply->writeBool(store.ok())) != OK) return status;
+            if (!store.ok()) return OK;
+            return reply->writeUniqueFileDescriptor(store);
+        }
+        case REPORT_BLOB_CACHE_USAGE: {
+            CHECK_INTERFACE(IGpuService, data, reply);
+
+            SharedBlobUsage usage;
+            if ((status = data.readUint64(&usage.lookups)) != OK) return status;
+            if ((status = data.readUint64(&usage.localHits)) != OK) return status;
+            if ((status = data.readUint64(&usage.sharedHits)) != OK) return status;
+
+            uint32_t candidateCount;
+            if ((status = data.readUint32(&candidateCount)) != OK) return status;
+            // Each candidate takes at least two length fields, so this bounds the reservation.
+            if (candidateCount > data.dataAvail() / (2 * sizeof(int32_t))) return BAD_VALUE;
+
+            usage.candidates.resize(candidateCount);
+            for (SharedBlobEntry& entry : usage.candidates) {
+                if ((status = data.readByteVector(&entry.key)) != OK) return status;
+                if ((status = data.readByteVector(&entry.value)) != OK) return status;
+            }
+
+            reportBlobCacheUsage(usage);
+            return OK;
+        }
         default:
             return BBinder::onTransact(code, data, reply, flags);
     }
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "SharedBlobStore"
+
+#include <graphicsenv/SharedBlobStore.h>
+
+#include <android-base/file.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <map>
+
+namespace android {
+
+namespace {
+
+constexpr uint32_t kSharedBlobStoreMagic = ('S' << 24) + ('B' << 16) + ('S' << 8) + '$';
+constexpr uint32_t kSharedBlobStoreVersion = 1;
+constexpr size_t kMaxBuildIdSize = 96;
+
+size_t nextPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+struct SharedBlobStore::Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t entryCount;
+    uint64_t size;
+    char buildId[kMaxBuildIdSize];
+};
+
+// An empty slot has a keySize of 0.
+struct SharedBlobStore::Slot {
+    uint64_t keyHash;
+    uint32_t keyOffset;
+    uint32_t keySize;
+    uint32_t valueOffset;
+    uint32_t valueSize;
+};
+
+uint64_t SharedBlobStore::hashBlob(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+bool SharedBlobStore::write(int fd, const std::string& buildId,
+                            const std::vector<SharedBlobEntry>& entries) {
+    if (buildId.size() >= kMaxBuildIdSize) {
+        ALOGE("Build id %s is too long", buildId.c_str());
+        return false;
+    }
+
+    // Keep the table at most half full, so misses stop probing early.
+    const size_t slotCount = nextPowerOfTwo(std::max<size_t>(entries.size() * 2, 1));
+    std::vector<uint8_t> buffer(sizeof(Header) + slotCount * sizeof(Slot));
+    std::vector<Slot> slots(slotCount);
+    // Offsets of the values written so far, by hash, so identical values are stored once.
+    std::multimap<uint64_t, uint32_t> valueOffsets;
+    uint32_t entryCount = 0;
+
+    for (const SharedBlobEntry& entry : entries) {
+        if (entry.key.empty() || entry.value.empty()) {
+            continue;
+        }
+
+        Slot slot;
+        slot.keyHash = hashBlob(entry.key.data(), entry.key.size());
+        slot.keySize = entry.key.size();
+        slot.valueSize = entry.value.size();
+        slot.keyOffset = buffer.size();
+        buffer.insert(buffer.end(), entry.key.begin(), entry.key.end());
+
+        const uint64_t valueHash = hashBlob(entry.value.data(), entry.value.size());
+        bool deduplicated = false;
+        for (auto [it, end] = valueOffsets.equal_range(valueHash); it != end; ++it) {
+            if (memcmp(buffer.data() + it->second, entry.value.data(), entry.value.size()) == 0) {
+                slot.valueOffset = it->second;
+                deduplicated = true;
+                break;
+            }
+        }
+        if (!deduplicated) {
+            slot.valueOffset = buffer.size();
+            valueOffsets.emplace(valueHash, slot.valueOffset);
+            buffer.insert(buffer.end(), entry.value.begin(), entry.value.end());
+        }
+
+        if (buffer.size() > UINT32_MAX) {
+            ALOGE("Shared blob store is too large");
+            return false;
+        }
+
+        size_t index = slot.keyHash & (slotCount - 1);
+        while (slots[index].keySize != 0) {
+            index = (index + 1) & (slotCount - 1);
+        }
+        slots[index] = slot;
+        entryCount++;
+    }
+
+    Header header = {};
+    header.magic = kSharedBlobStoreMagic;
+    header.version = kSharedBlobStoreVersion;
+    header.slotCount = slotCount;
+    header.entryCount = entryCount;
+    header.size = buffer.size();
+    memcpy(header.buildId, buildId.c_str(), buildId.size());
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), slots.data(), slotCount * sizeof(Slot));
+
+    if (!base::WriteFully(fd, buffer.data(), buffer.size())) {
+        ALOGE("Failed to write shared blob store: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<SharedBlobStore> SharedBlobStore::map(base::unique_fd fd,
+                                                      const std::string& buildId) {
+    if (!fd.ok()) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd.get(), &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ALOGE("Shared blob store is truncated");
+        return nullptr;
+    }
+
+    const size_t size = st.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (data == MAP_FAILED) {
+        ALOGE("Failed to map shared blob store: %s", strerror(errno));
+        return nullptr;
+    }
+    // The mapping stays valid after fd is closed.
+    std::unique_ptr<SharedBlobStore> store(
+            new SharedBlobStore(static_cast<const uint8_t*>(data), size));
+
+    Header header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != kSharedBlobStoreMagic || header.version != kSharedBlobStoreVersion ||
+        header.size != size || header.slotCount == 0 ||
+        (header.slotCount & (header.slotCount - 1)) != 0 ||
+        header.slotCount > (size - sizeof(Header)) / sizeof(Slot)) {
+        ALOGE("Shared blob store is invalid");
+        return nullptr;
+    }
+    if (strncmp(header.buildId, buildId.c_str(), kMaxBuildIdSize) != 0) {
+        ALOGV("Shared blob store was written for another build");
+        return nullptr;
+    }
+    return store;
+}
+
+SharedBlobStore::SharedBlobStore(const uint8_t* data, size_t size) : mData(data), mSize(size) {}
+
+SharedBlobStore::~SharedBlobStore() {
+    munmap(const_cast<uint8_t*>(mData), mSize);
+}
+
+const SharedBlobStore::Slot* SharedBlobStore::findSlot(const void* key, size_t keySize) const {
+    const Header* header = reinterpret_cast<const Header*>(mData);
+    const Slot* slots = reinterpret_cast<const Slot*>(mData + sizeof(Header));
+    const uint32_t mask = header->slotCount - 1;
+    const uint64_t keyHash = hashBlob(key, keySize);
+
+    for (uint32_t i = 0, index = keyHash & mask; i <= mask; i++, index = (index + 1) & mask) {
+        const Slot& slot = slots[index];
+        if (slot.keySize == 0) {
+            return nullptr;
+        }
+        if (slot.keyHash != keyHash || slot.keySize != keySize) {
+            continue;
+        }
+        if (static_cast<uint64_t>(slot.keyOffset) + slot.keySize > mSize ||
+            static_cast<uint64_t>(slot.valueOffset) + slot.valueSize > mSize) {
+            ALOGE("Shared blob store slot %u is out of bounds", index);
+            return nullptr;
+        }
+        if (memcmp(mData + slot.keyOffset, key, keySize) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+size_t SharedBlobStore::get(const void* key, size_t keySize, void* value,
+                            size_t valueSize) const {
+    const Slot* slot = findSlot(key, keySize);
+    if (slot == nullptr) {
+        return 0;
+    }
+    if (slot->valueSize <= valueSize) {
+        memcpy(value, mData + slot->valueOffset, slot->valueSize);
+    }
+    return slot->valueSize;
+}
+
+bool SharedBlobStore::contains(const void* key, size_t keySize) const {
+    return findSlot(key, keySize) != nullptr;
+}
+
+size_t SharedBlobStore::getEntryCount() const {
+    return reinterpret_cast<const Header*>(mData)->entryCount;
+}
+
+SharedBlobStoreClient::SharedBlobStoreClient(std::unique_ptr<SharedBlobStore> store)
+      : mStore(std::move(store)) {}
+
+size_t SharedBlobStoreClient::get(const void* key, size_t keySize, void* value, size_t valueSize,
+                                  size_t localSize) {
+    // A call whose buffer can't hold the value only queries its size, and is followed by
+    // another lookup that fetches the value, so only that one is counted.
+    if (localSize > 0) {
+        if (localSize > valueSize || value == nullptr) {
+            return localSize;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mUsage.lookups++;
+        mUsage.localHits++;
+
+        // Only entries read back by the app are worth sharing, and their value is at hand once
+        // it was copied to the caller.
+        if (mUsage.candidates.size() >= kMaxCandidates ||
+            mCandidateBytes + keySize + localSize > kMaxCandidateBytes) {
+            return localSize;
+        }
+        if (mStore && mStore->contains(key, keySize)) {
+            return localSize;
+        }
+        if (!mReportedKeys.insert(SharedBlobStore::hashBlob(key, keySize)).second) {
+            return localSize;
+        }
+
+        const uint8_t* keyBytes = static_cast<const uint8_t*>(key);
+        const uint8_t* valueBytes = static_cast<const uint8_t*>(value);
+        mUsage.candidates.push_back({std::vector<uint8_t>(keyBytes, keyBytes + keySize),
+                                     std::vector<uint8_t>(valueBytes, valueBytes + localSize)});
+        mCandidateBytes += keySize + localSize;
+        return localSize;
+    }
+
+    // The store is immutable, so it is read without the lock.
+    const size_t sharedSize = mStore ? mStore->get(key, keySize, value, valueSize) : 0;
+    if (sharedSize > valueSize || (sharedSize > 0 && value == nullptr)) {
+        return sharedSize;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mUsage.lookups++;
+    if (sharedSize > 0) {
+        mUsage.sharedHits++;
+    }
+    return sharedSize;
+}
+
+SharedBlobUsage SharedBlobStoreClient::takeUsage() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    SharedBlobUsage usage = std::move(mUsage);
+    mUsage = SharedBlobUsage();
+    mCandidateBytes = 0;
+    return usage;
+}
+
+bool SharedBlobStoreClient::shouldReport() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsage.candidates.size() >= kMaxCandidates ||
+            mCandidateBytes >= kMaxCandidateBytes / 2;
+}
+
+} // namespace android
@@ -18,7 +18,9 @@
 #define ANDROID_UI_GRAPHICS_ENV_H 1
 
 #include <graphicsenv/GpuStatsInfo.h>
+#include <graphicsenv/SharedBlobStore.h>
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -125,6 +127,15 @@ public:
     bool shouldUseSystemAngle();
     bool shouldUseNativeDriver();
 
+    /*
+     * Apis for the shared blob cache
+     */
+    // Map the blob store GpuService shares between apps. Returns nullptr if GpuService doesn't
+    // share one yet or if it was written for another build.
+    std::unique_ptr<SharedBlobStore> getSharedBlobStore(const std::string& buildId);
+    // Report blob cache usage and the entries the app could share to GpuService.
+    void reportBlobCacheUsage(const SharedBlobUsage& usage);
+
     /*
      * Apis for debug layer
      */
@@ -134,6 +145,10 @@ public:
     NativeLoaderNamespace* getAppNamespace();
     // Get additional layer search paths.
     const std::string& getLayerPaths();
+    // Set the file in which the layers found in the search paths are cached across processes.
+    void setLayerCacheFilename(const std::string& filename);
+    // Get the layer cache file, empty if layers aren't cached.
+    const std::string& getLayerCacheFilename();
     // Set the Vulkan debug layers.
     void setDebugLayers(const std::string& layers);
     // Set the GL debug layers.
@@ -205,6 +220,8 @@ private:
     std::string mDebugLayersGLES;
     // Additional debug layers search path.
     std::string mLayerPaths;
+    // File caching the layers found in the search paths.
+    std::string mLayerCacheFilename;
     // This App's namespace to open native libraries.
     NativeLoaderNamespace* mAppNamespace = nullptr;
 };
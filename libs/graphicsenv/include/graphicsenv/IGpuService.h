@@ -16,9 +16,11 @@
 
 #pragma once
 
+#include <android-base/unique_fd.h>
 #include <binder/IInterface.h>
 #include <cutils/compiler.h>
 #include <graphicsenv/GpuStatsInfo.h>
+#include <graphicsenv/SharedBlobStore.h>
 
 #include <vector>
 
@@ -55,6 +57,11 @@ public:
 
     // sets ANGLE as system GLES driver if enabled==true by setting persist.graphics.egl to true.
     virtual void toggleAngleAsSystemDriver(bool enabled) = 0;
+
+    // getter for the blob store shared between apps, returns an invalid fd when there is none.
+    virtual base::unique_fd getSharedBlobStore() = 0;
+    // report blob cache usage and entries to share from GraphicsEnvironment.
+    virtual void reportBlobCacheUsage(const SharedBlobUsage& usage) = 0;
 };
 
 class BnGpuService : public BnInterface<IGpuService> {
@@ -67,6 +74,8 @@ public:
         TOGGLE_ANGLE_AS_SYSTEM_DRIVER,
         SET_TARGET_STATS_ARRAY,
         ADD_VULKAN_ENGINE_NAME,
+        GET_SHARED_BLOB_STORE,
+        REPORT_BLOB_CACHE_USAGE,
         // Always append new enum to the end.
     };
 
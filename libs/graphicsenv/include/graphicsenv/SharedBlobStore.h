@@ -0,0 +1,130 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace android {
+
+/*
+ * A blob cache key/value pair.
+ */
+struct SharedBlobEntry {
+    std::vector<uint8_t> key;
+    std::vector<uint8_t> value;
+};
+
+/*
+ * Blob cache usage that an app reports to GpuService. This class is intended to be a data
+ * container, and is parceled by IGpuService.
+ */
+struct SharedBlobUsage {
+    // Number of lookups, and how many of them were served by the app's own cache or by the shared
+    // store.
+    uint64_t lookups = 0;
+    uint64_t localHits = 0;
+    uint64_t sharedHits = 0;
+    // Entries that the app read back from its own cache and that the shared store doesn't hold.
+    std::vector<SharedBlobEntry> candidates;
+};
+
+/*
+ * A read-only store of blob cache entries that GpuService shares between apps.
+ *
+ * The store is a single buffer: a header, an open-addressed table of slots indexed by a hash of
+ * the key, and the key and value bytes. It is content-addressed, so entries with identical values
+ * share the value bytes. GpuService writes it into a sealed memfd that apps map read-only, and
+ * every offset is checked before use.
+ */
+class SharedBlobStore {
+public:
+    // FNV-1a, which is stable across processes and builds.
+    static uint64_t hashBlob(const void* data, size_t size);
+
+    // Writes a store holding entries to fd. The keys of entries must be distinct.
+    static bool write(int fd, const std::string& buildId,
+                      const std::vector<SharedBlobEntry>& entries);
+
+    // Maps the store in fd read-only. Returns nullptr if fd doesn't hold a valid store written for
+    // buildId.
+    static std::unique_ptr<SharedBlobStore> map(base::unique_fd fd, const std::string& buildId);
+
+    ~SharedBlobStore();
+
+    // Same contract as BlobCache::get.
+    size_t get(const void* key, size_t keySize, void* value, size_t valueSize) const;
+    bool contains(const void* key, size_t keySize) const;
+
+    size_t getEntryCount() const;
+    size_t getSize() const { return mSize; }
+
+private:
+    struct Header;
+    struct Slot;
+
+    SharedBlobStore(const uint8_t* data, size_t size);
+
+    const Slot* findSlot(const void* key, size_t keySize) const;
+
+    const uint8_t* const mData;
+    const size_t mSize;
+};
+
+/*
+ * The app side of the shared store. It serves lookups that miss the app's own cache from the
+ * shared store, and collects the usage the app reports to GpuService.
+ */
+class SharedBlobStoreClient {
+public:
+    // store may be null when GpuService doesn't share a store yet, in which case the client only
+    // collects usage.
+    explicit SharedBlobStoreClient(std::unique_ptr<SharedBlobStore> store);
+
+    // Called with the result of a lookup in the app's own cache. Returns the size of the value
+    // found in the app's cache or in the shared store, with the same contract as BlobCache::get.
+    size_t get(const void* key, size_t keySize, void* value, size_t valueSize, size_t localSize);
+
+    // Returns the usage collected since the last call.
+    SharedBlobUsage takeUsage();
+
+    // Whether enough candidates were collected that the usage should be reported now.
+    bool shouldReport() const;
+
+private:
+    // Bounds on the candidates in one report, which is a oneway binder call that shares the
+    // process's async transaction buffer with every other oneway call.
+    static constexpr size_t kMaxCandidates = 64;
+    static constexpr size_t kMaxCandidateBytes = 64 * 1024;
+
+    const std::unique_ptr<SharedBlobStore> mStore;
+
+    mutable std::mutex mMutex;
+    SharedBlobUsage mUsage GUARDED_BY(mMutex);
+    size_t mCandidateBytes GUARDED_BY(mMutex) = 0;
+    // Hashes of the keys already reported, so each entry is reported once per process.
+    std::unordered_set<uint64_t> mReportedKeys GUARDED_BY(mMutex);
+};
+
+} // namespace android
@@ -224,6 +224,9 @@ BLASTBufferQueue::BLASTBufferQueue(const std::string& name, bool updateDestinati
     mCurrentMaxAcquiredBufferCount = mMaxAcquiredBuffers;
     mNumAcquired = 0;
     mNumFrameAvailable = 0;
+    for (auto& dequeueWait : mDequeueWaits) {
+        dequeueWait = -1;
+    }
 
     TransactionCompletedListener::getInstance()->addQueueStallListener(
             [&](const std::string& reason) {
@@ -412,6 +415,9 @@ void BLASTBufferQueue::transactionCallback(nsecs_t /*latchTime*/, const sp<Fence
                 // Update frametime stamps if the frame was latched and presented, indicated by a
                 // valid latch time.
                 if (stat.latchTime > 0) {
+                    mFramePacingStats.onFrameLatched(stat.frameEventStats.frameNumber,
+                                                     stat.latchTime);
+                    mPacingLastLatchedFrameNumber = stat.frameEventStats.frameNumber;
                     mBufferItemConsumer
                             ->updateFrameTimestamps(stat.frameEventStats.frameNumber,
                                                     stat.frameEventStats.previousFrameNumber,
@@ -542,6 +548,7 @@ void BLASTBufferQueue::releaseBuffer(const ReleaseCallbackId& callbackId,
         return;
     }
     mNumAcquired--;
+    mFramePacingStats.onFrameReleased(callbackId.framenumber, systemTime());
     BBQ_TRACE("frame=%" PRIu64, callbackId.framenumber);
     BQA_LOGV("released %s", callbackId.to_string().c_str());
     mBufferItemConsumer->releaseBuffer(it->second, releaseFence);
@@ -625,6 +632,7 @@ status_t BLASTBufferQueue::acquireNextBufferLocked(
 
     mNumAcquired++;
     mLastAcquiredFrameNumber = bufferItem.mFrameNumber;
+    mFramePacingStats.onFrameAcquired(bufferItem.mFrameNumber, systemTime());
     ReleaseCallbackId releaseCallbackId(buffer->getId(), mLastAcquiredFrameNumber);
     mSubmitted[releaseCallbackId] = bufferItem;
 
@@ -634,6 +642,11 @@ status_t BLASTBufferQueue::acquireNextBufferLocked(
     // if producer disconnected before, notify SurfaceFlinger
     if (needsDisconnect) {
         t->notifyProducerDisconnect(mSurfaceControl);
+        // The new producer restarts the frame numbers, so the records of the old producer would
+        // be matched with the wrong frames.
+        mFramePacingStats.clear();
+        mPacingLastAppliedFrameNumber = 0;
+        mPacingLastLatchedFrameNumber = 0;
     }
 
     // Only update mSize for destination bounds if the incoming buffer matches the requested size.
@@ -729,6 +742,10 @@ status_t BLASTBufferQueue::acquireNextBufferLocked(
         t->setBufferHasBarrier(mSurfaceControl, mLastAppliedFrameNumber);
         mAppliedLastTransaction = false;
     }
+    mFramePacingStats.onFrameApplied(bufferItem.mFrameNumber, systemTime(),
+                                     mPacingLastAppliedFrameNumber >
+                                             mPacingLastLatchedFrameNumber);
+    mPacingLastAppliedFrameNumber = bufferItem.mFrameNumber;
 
     BQA_LOGV("acquireNextBufferLocked size=%dx%d mFrameNumber=%" PRIu64
              " applyTransaction=%s mTimestamp=%" PRId64 "%s mPendingTransactions.size=%d"
@@ -761,13 +778,23 @@ void BLASTBufferQueue::acquireAndReleaseBuffer() {
     mBufferItemConsumer->releaseBuffer(bufferItem, bufferItem.mFence);
 }
 
+nsecs_t BLASTBufferQueue::takeDequeueWait(const BufferItem& item) {
+    return item.mSlot >= 0 && item.mSlot < BufferQueueDefs::NUM_BUFFER_SLOTS
+            ? mDequeueWaits[item.mSlot].exchange(-1)
+            : -1;
+}
+
 void BLASTBufferQueue::onFrameAvailable(const BufferItem& item) {
     std::function<void(SurfaceComposerClient::Transaction*)> prevCallback = nullptr;
     SurfaceComposerClient::Transaction* prevTransaction = nullptr;
+    // onFrameAvailable is called by queueBuffer, so this is when the frame was queued.
+    const nsecs_t queueTime = systemTime();
+    const nsecs_t dequeueWait = takeDequeueWait(item);
 
     {
         UNIQUE_LOCK_WITH_ASSERTION(mMutex);
         BBQ_TRACE();
+        mFramePacingStats.onFrameQueued(item.mFrameNumber, queueTime, dequeueWait);
         bool waitForTransactionCallback = !mSyncedFrameNumbers.empty();
 
         const bool syncTransactionSet = mTransactionReadyCallback != nullptr;
@@ -854,6 +881,39 @@ void BLASTBufferQueue::onFrameAvailable(const BufferItem& item) {
     }
 }
 
+void BLASTBufferQueue::onFramesAvailable(const std::vector<BufferItem>& items) {
+    // onFramesAvailable is called by queueBuffers, so this is when the frames were queued.
+    const nsecs_t queueTime = systemTime();
+    {
+        UNIQUE_LOCK_WITH_ASSERTION(mMutex);
+        // Without a sync in progress, each frame is acquired as it would be by onFrameAvailable,
+        // but under a single acquisition of the lock.
+        if (mTransactionReadyCallback == nullptr && mSyncedFrameNumbers.empty()) {
+            BBQ_TRACE();
+            for (const BufferItem& item : items) {
+                mFramePacingStats.onFrameQueued(item.mFrameNumber, queueTime,
+                                                takeDequeueWait(item));
+                mNumFrameAvailable++;
+                ATRACE_INT(mQueuedBufferTrace.c_str(),
+                           mNumFrameAvailable + mNumAcquired - mPendingRelease.size());
+                BQA_LOGV("onFramesAvailable framenumber=%" PRIu64, item.mFrameNumber);
+                acquireNextBufferLocked(std::nullopt);
+            }
+            return;
+        }
+    }
+
+    // Syncs take their frame one at a time.
+    for (const BufferItem& item : items) {
+        onFrameAvailable(item);
+    }
+}
+
+gui::FramePacingStats::Summary BLASTBufferQueue::getFramePacingStats() const {
+    std::lock_guard _lock{mMutex};
+    return mFramePacingStats.getSummary();
+}
+
 void BLASTBufferQueue::onFrameReplaced(const BufferItem& item) {
     BQA_LOGV("onFrameReplaced framenumber=%" PRIu64, item.mFrameNumber);
     // Do nothing since we are not storing unacquired buffer items locally.
@@ -1185,6 +1245,22 @@ public:
           : BufferQueueProducer(core, false /* consumerIsSurfaceFlinger*/),
             mBLASTBufferQueue(bbq) {}
 
+    status_t dequeueBuffer(int* outSlot, sp<Fence>* outFence, uint32_t width, uint32_t height,
+                           PixelFormat format, uint64_t usage, uint64_t* outBufferAge,
+                           FrameEventHistoryDelta* outTimestamps) override {
+        const nsecs_t start = systemTime();
+        const status_t result =
+                BufferQueueProducer::dequeueBuffer(outSlot, outFence, width, height, format, usage,
+                                                   outBufferAge, outTimestamps);
+        if (result < 0) {
+            return result;
+        }
+        if (sp<BLASTBufferQueue> bbq = mBLASTBufferQueue.promote()) {
+            bbq->mDequeueWaits[*outSlot] = systemTime() - start;
+        }
+        return result;
+    }
+
     status_t connect(const sp<IProducerListener>& listener, int api, bool producerControlledByApp,
                      QueueBufferOutput* output) override {
         if (!listener) {
@@ -1243,20 +1319,15 @@ public:
         UnlockGuard unlockGuard{bufferQueueLock};
 
         ATRACE_FORMAT("waiting for free buffer");
-        ReleaseCallbackId id;
-        sp<Fence> fence;
-        uint32_t maxAcquiredBufferCount;
-        status_t status =
-                bbq->mBufferReleaseReader->readBlocking(id, fence, maxAcquiredBufferCount, timeout);
+        std::vector<gui::BufferReleaseChannel::Message> releases;
+        status_t status = bbq->mBufferReleaseReader->readBlocking(releases, timeout);
         if (status == TIMED_OUT) {
             return TIMED_OUT;
-        } else if (status != OK) {
-            // Waiting was interrupted or an error occurred. BufferQueueProducer will check if we
-            // have a free buffer and call this method again if not.
-            return OK;
         }
 
-        bbq->releaseBufferCallback(id, fence, maxAcquiredBufferCount);
+        // If waiting was interrupted or an error occurred, BufferQueueProducer will check if we
+        // have a free buffer and call this method again if not.
+        bbq->releaseBufferCallbacks(releases);
         return OK;
     }
 #endif
@@ -1366,16 +1437,24 @@ void BLASTBufferQueue::updateBufferReleaseProducer() {
 
 void BLASTBufferQueue::drainBufferReleaseConsumer() {
     ATRACE_CALL();
-    while (true) {
-        ReleaseCallbackId id;
-        sp<Fence> fence;
-        uint32_t maxAcquiredBufferCount;
-        status_t status =
-                mBufferReleaseConsumer->readReleaseFence(id, fence, maxAcquiredBufferCount);
-        if (status != OK) {
-            return;
-        }
-        releaseBufferCallback(id, fence, maxAcquiredBufferCount);
+    // Read without holding mMutex, so that the app's render thread is only blocked for as long
+    // as it takes to apply the releases.
+    std::vector<gui::BufferReleaseChannel::Message> releases;
+    mBufferReleaseConsumer->readReleaseFences(releases);
+    releaseBufferCallbacks(releases);
+}
+
+void BLASTBufferQueue::releaseBufferCallbacks(
+        const std::vector<gui::BufferReleaseChannel::Message>& releases) {
+    if (releases.empty()) {
+        return;
+    }
+
+    std::lock_guard _lock{mMutex};
+    BBQ_TRACE("releases=%zu", releases.size());
+    for (const auto& release : releases) {
+        releaseBufferCallbackLocked(release.releaseCallbackId, release.releaseFence,
+                                    release.maxAcquiredBufferCount, false /* fakeRelease */);
     }
 }
 
@@ -1412,10 +1491,8 @@ BLASTBufferQueue::BufferReleaseReader::BufferReleaseReader(BLASTBufferQueue& bbq
                         errno, strerror(errno));
 }
 
-status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId& outId,
-                                                             sp<Fence>& outFence,
-                                                             uint32_t& outMaxAcquiredBufferCount,
-                                                             nsecs_t timeout) {
+status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(
+        std::vector<gui::BufferReleaseChannel::Message>& outMessages, nsecs_t timeout) {
     // TODO(b/363290953) epoll_wait only has millisecond timeout precision. If timeout is less than
     // 1ms, then we round timeout up to 1ms. Otherwise, we round timeout to the nearest
     // millisecond. Once epoll_pwait2 can be used in libgui, we can specify timeout with nanosecond
@@ -1455,8 +1532,7 @@ status_t BLASTBufferQueue::BufferReleaseReader::readBlocking(ReleaseCallbackId&
         return WOULD_BLOCK;
     }
 
-    return mBbq.mBufferReleaseConsumer->readReleaseFence(outId, outFence,
-                                                         outMaxAcquiredBufferCount);
+    return mBbq.mBufferReleaseConsumer->readReleaseFences(outMessages);
 }
 
 void BLASTBufferQueue::BufferReleaseReader::interruptBlockingRead() {
@@ -67,6 +67,14 @@ void BufferQueue::ProxyConsumerListener::onFrameAvailable(
     }
 }
 
+void BufferQueue::ProxyConsumerListener::onFramesAvailable(
+        const std::vector<BufferItem>& items) {
+    sp<ConsumerListener> listener(mConsumerListener.promote());
+    if (listener != nullptr) {
+        listener->onFramesAvailable(items);
+    }
+}
+
 void BufferQueue::ProxyConsumerListener::onFrameReplaced(
         const BufferItem& item) {
     sp<ConsumerListener> listener(mConsumerListener.promote());
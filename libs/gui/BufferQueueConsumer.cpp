@@ -74,6 +74,12 @@ namespace android {
 
 ConsumerListener::~ConsumerListener() = default;
 
+void ConsumerListener::onFramesAvailable(const std::vector<BufferItem>& items) {
+    for (const BufferItem& item : items) {
+        onFrameAvailable(item);
+    }
+}
+
 BufferQueueConsumer::BufferQueueConsumer(const sp<BufferQueueCore>& core) :
     mCore(core),
     mSlots(core->mSlots),
@@ -419,12 +425,10 @@ status_t BufferQueueConsumer::attachBuffer(int* outSlot,
         // Find a free slot to put the buffer into
         int found = BufferQueueCore::INVALID_BUFFER_SLOT;
         if (!mCore->mFreeSlots.empty()) {
-            auto slot = mCore->mFreeSlots.begin();
-            found = *slot;
-            mCore->mFreeSlots.erase(slot);
+            found = mCore->mFreeSlots.takeFirst();
         } else if (!mCore->mFreeBuffers.empty()) {
             found = mCore->mFreeBuffers.front();
-            mCore->mFreeBuffers.remove(found);
+            mCore->mFreeBuffers.pop_front();
         }
         if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
             BQ_LOGE("attachBuffer: could not find free buffer slot");
@@ -549,6 +553,12 @@ status_t BufferQueueConsumer::releaseBuffer(int slot, uint64_t frameNumber,
         if (!mSlots[slot].mBufferState.isShared()) {
             mCore->mActiveBuffers.erase(slot);
             mCore->mFreeBuffers.push_back(slot);
+
+            // A buffer that was in use when the geometry or format changed
+            // can be replaced now, before the producer dequeues it.
+            if (mCore->isSlotStaleLocked(slot)) {
+                mCore->requestPreallocationLocked();
+            }
         }
 
         if (mCore->mBufferReleasedCbEnabled) {
@@ -603,23 +613,28 @@ status_t BufferQueueConsumer::disconnect() {
 
     BQ_LOGV("disconnect");
 
-    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
 
-    if (mCore->mConsumerListener == nullptr) {
-        BQ_LOGE("disconnect: no consumer is connected");
-        return BAD_VALUE;
-    }
+        if (mCore->mConsumerListener == nullptr) {
+            BQ_LOGE("disconnect: no consumer is connected");
+            return BAD_VALUE;
+        }
 
-    mCore->mIsAbandoned = true;
-    mCore->mConsumerListener = nullptr;
-    mCore->mQueue.clear();
-    mCore->freeAllBuffersLocked();
-    mCore->mSharedBufferSlot = BufferQueueCore::INVALID_BUFFER_SLOT;
+        mCore->mIsAbandoned = true;
+        mCore->mConsumerListener = nullptr;
+        mCore->mQueue.clear();
+        mCore->freeAllBuffersLocked();
+        mCore->mSharedBufferSlot = BufferQueueCore::INVALID_BUFFER_SLOT;
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
-    mCore->notifyBufferReleased();
+        mCore->notifyBufferReleased();
 #else
-    mCore->mDequeueCondition.notify_all();
+        mCore->mDequeueCondition.notify_all();
 #endif
+    } // Autolock scope
+
+    // The preallocation pass returns once it sees that the BufferQueue is abandoned.
+    mCore->stopPreallocationThread();
     return NO_ERROR;
 }
 
@@ -674,8 +689,12 @@ status_t BufferQueueConsumer::setDefaultBufferSize(uint32_t width,
     BQ_LOGV("setDefaultBufferSize: width=%u height=%u", width, height);
 
     std::lock_guard<std::mutex> lock(mCore->mMutex);
+    const bool changed = mCore->mDefaultWidth != width || mCore->mDefaultHeight != height;
     mCore->mDefaultWidth = width;
     mCore->mDefaultHeight = height;
+    if (changed) {
+        mCore->requestPreallocationLocked();
+    }
     return NO_ERROR;
 }
 
@@ -798,7 +817,11 @@ status_t BufferQueueConsumer::setDefaultBufferFormat(PixelFormat defaultFormat)
     ATRACE_CALL();
     BQ_LOGV("setDefaultBufferFormat: %u", defaultFormat);
     std::lock_guard<std::mutex> lock(mCore->mMutex);
+    const bool changed = mCore->mDefaultBufferFormat != defaultFormat;
     mCore->mDefaultBufferFormat = defaultFormat;
+    if (changed) {
+        mCore->requestPreallocationLocked();
+    }
     return NO_ERROR;
 }
 
@@ -815,7 +838,11 @@ status_t BufferQueueConsumer::setConsumerUsageBits(uint64_t usage) {
     ATRACE_CALL();
     BQ_LOGV("setConsumerUsageBits: %#" PRIx64, usage);
     std::lock_guard<std::mutex> lock(mCore->mMutex);
+    const bool changed = mCore->mConsumerUsageBits != usage;
     mCore->mConsumerUsageBits = usage;
+    if (changed) {
+        mCore->requestPreallocationLocked();
+    }
     return NO_ERROR;
 }
 
@@ -28,10 +28,13 @@
 
 #include <inttypes.h>
 
+#include <thread>
+
 #include <cutils/atomic.h>
 
 #include <gui/BufferItem.h>
 #include <gui/BufferQueueCore.h>
+#include <gui/BufferQueueProducer.h>
 #include <gui/IConsumerListener.h>
 #include <gui/IProducerListener.h>
 #include <private/gui/ComposerService.h>
@@ -142,7 +145,9 @@ BufferQueueCore::BufferQueueCore()
     }
 }
 
-BufferQueueCore::~BufferQueueCore() {}
+BufferQueueCore::~BufferQueueCore() {
+    stopPreallocationThread();
+}
 
 void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const {
     std::lock_guard<std::mutex> lock(mMutex);
@@ -160,6 +165,10 @@ void BufferQueueCore::dumpState(const String8& prefix, String8* outResult) const
                             mTransformHint, mFrameCounter);
     outResult->appendFormat("%s  mTransformHintInUse=%02x mAutoPrerotation=%d\n", prefix.c_str(),
                             mTransformHintInUse, mAutoPrerotation);
+    outResult->appendFormat("%s  sync-allocations=%" PRIu64 " preallocated=%" PRIu64
+                            " allocation-wait=%.3fms\n",
+                            prefix.c_str(), mSyncAllocationCount, mPreallocatedBufferCount,
+                            static_cast<double>(mAllocationWaitTime) / 1e6);
 
     outResult->appendFormat("%sFIFO(%zu):\n", prefix.c_str(), mQueue.size());
 
@@ -366,11 +375,148 @@ bool BufferQueueCore::adjustAvailableSlotsLocked(int delta) {
     return true;
 }
 
-void BufferQueueCore::waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) const {
+void BufferQueueCore::waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) {
     ATRACE_CALL();
+    if (!mIsAllocating) {
+        return;
+    }
+    const nsecs_t start = systemTime();
     while (mIsAllocating) {
         mIsAllocatingCondition.wait(lock);
     }
+    mAllocationWaitTime += systemTime() - start;
+}
+
+bool BufferQueueCore::isFreeBufferPendingLocked() const {
+    return mFreeBuffers.empty() && (mIsAllocating || mPendingPreallocationCount > 0);
+}
+
+void BufferQueueCore::waitForFreeBufferLocked(std::unique_lock<std::mutex>& lock) {
+    ATRACE_CALL();
+    if (!isFreeBufferPendingLocked()) {
+        return;
+    }
+    const nsecs_t start = systemTime();
+    while (isFreeBufferPendingLocked()) {
+        mIsAllocatingCondition.wait(lock);
+    }
+    mAllocationWaitTime += systemTime() - start;
+}
+
+bool BufferQueueCore::getPredictedBufferLocked(uint32_t* outWidth, uint32_t* outHeight,
+                                               PixelFormat* outFormat, uint64_t* outUsage) const {
+    if (!mHasDequeueRequest) {
+        return false;
+    }
+
+    // This resolves the request the same way as dequeueBuffer.
+    *outWidth = mLastDequeueWidth;
+    *outHeight = mLastDequeueHeight;
+    if (!mLastDequeueWidth && !mLastDequeueHeight) {
+        *outWidth = mDefaultWidth;
+        *outHeight = mDefaultHeight;
+        if (mAutoPrerotation && (mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
+            std::swap(*outWidth, *outHeight);
+        }
+    }
+    *outFormat = mLastDequeueFormat != 0 ? mLastDequeueFormat : mDefaultBufferFormat;
+    *outUsage = mLastDequeueUsage | mConsumerUsageBits;
+    return true;
+}
+
+bool BufferQueueCore::isSlotStaleLocked(int slot) const {
+    const sp<GraphicBuffer>& buffer(mSlots[slot].mGraphicBuffer);
+    uint32_t width;
+    uint32_t height;
+    PixelFormat format;
+    uint64_t usage;
+    if (buffer == nullptr || !getPredictedBufferLocked(&width, &height, &format, &usage)) {
+        return false;
+    }
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+    if (mSlots[slot].mAdditionalOptionsGenerationId != mAdditionalOptionsGenerationId) {
+        return true;
+    }
+#endif
+    return buffer->needsReallocation(width, height, format, buffer->getLayerCount(), usage);
+}
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_PREALLOCATE_BUFFERS)
+struct BufferQueueCore::PreallocationRequest {
+    std::mutex mutex;
+    std::condition_variable condition;
+    // The producer to run the next pass, or nullptr if no pass is requested.
+    sp<BufferQueueProducer> producer;
+    bool stopped = false;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] { return producer != nullptr || stopped; });
+            if (stopped) {
+                return;
+            }
+            sp<BufferQueueProducer> passProducer = std::move(producer);
+            lock.unlock();
+            passProducer->preallocateBuffers();
+            // This may drop the last reference to the BufferQueueCore, which then detaches this
+            // thread, so only the request may be used from here on.
+            passProducer.clear();
+            lock.lock();
+        }
+    }
+};
+#endif
+
+void BufferQueueCore::requestPreallocationLocked() {
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_PREALLOCATE_BUFFERS)
+    if (mPreallocating || !mHasDequeueRequest || !mAllowAllocation || mIsAbandoned ||
+        mConnectedApi == NO_CONNECTED_API || mSharedBufferMode) {
+        return;
+    }
+
+    sp<BufferQueueProducer> producer = mPreallocator.promote();
+    if (producer == nullptr) {
+        return;
+    }
+
+    BQ_LOGV("requestPreallocationLocked: requesting a preallocation pass");
+    mPreallocating = true;
+    if (mPreallocationRequest == nullptr) {
+        mPreallocationRequest = std::make_shared<PreallocationRequest>();
+        mPreallocationThread = std::thread(
+                [request = mPreallocationRequest] { request->run(); });
+    }
+    {
+        std::lock_guard<std::mutex> requestLock(mPreallocationRequest->mutex);
+        mPreallocationRequest->producer = std::move(producer);
+    }
+    mPreallocationRequest->condition.notify_one();
+#endif
+}
+
+void BufferQueueCore::stopPreallocationThread() {
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_PREALLOCATE_BUFFERS)
+    if (!mPreallocationThread.joinable()) {
+        return;
+    }
+
+    // A pending request holds a reference to the producer, so release it outside of the lock.
+    sp<BufferQueueProducer> pendingProducer;
+    {
+        std::lock_guard<std::mutex> requestLock(mPreallocationRequest->mutex);
+        mPreallocationRequest->stopped = true;
+        pendingProducer = std::move(mPreallocationRequest->producer);
+    }
+    mPreallocationRequest->condition.notify_one();
+
+    if (mPreallocationThread.get_id() == std::this_thread::get_id()) {
+        mPreallocationThread.detach();
+    } else {
+        mPreallocationThread.join();
+    }
+#endif
 }
 
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
@@ -385,13 +531,9 @@ void BufferQueueCore::validateConsistencyLocked() const {
     int allocatedSlots = 0;
     for (int slot = 0; slot < BufferQueueDefs::NUM_BUFFER_SLOTS; ++slot) {
         bool isInFreeSlots = mFreeSlots.count(slot) != 0;
-        bool isInFreeBuffers =
-                std::find(mFreeBuffers.cbegin(), mFreeBuffers.cend(), slot) !=
-                mFreeBuffers.cend();
+        bool isInFreeBuffers = mFreeBuffers.count(slot) != 0;
         bool isInActiveBuffers = mActiveBuffers.count(slot) != 0;
-        bool isInUnusedSlots =
-                std::find(mUnusedSlots.cbegin(), mUnusedSlots.cend(), slot) !=
-                mUnusedSlots.cend();
+        bool isInUnusedSlots = mUnusedSlots.count(slot) != 0;
 
         if (isInFreeSlots || isInFreeBuffers || isInActiveBuffers) {
             allocatedSlots++;
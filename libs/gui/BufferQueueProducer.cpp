@@ -97,7 +97,25 @@ status_t BufferQueueProducer::requestBuffer(int slot, sp<GraphicBuffer>* buf) {
     ATRACE_CALL();
     BQ_LOGV("requestBuffer: slot %d", slot);
     std::lock_guard<std::mutex> lock(mCore->mMutex);
+    return requestBufferLocked(slot, buf);
+}
+
+status_t BufferQueueProducer::requestBuffers(const std::vector<int32_t>& slots,
+                                             std::vector<RequestBufferOutput>* outputs) {
+    ATRACE_CALL();
+    BQ_LOGV("requestBuffers: %zu slots", slots.size());
+    outputs->clear();
+    outputs->reserve(slots.size());
+
+    std::lock_guard<std::mutex> lock(mCore->mMutex);
+    for (int32_t slot : slots) {
+        RequestBufferOutput& output = outputs->emplace_back();
+        output.result = requestBufferLocked(static_cast<int>(slot), &output.buffer);
+    }
+    return NO_ERROR;
+}
 
+status_t BufferQueueProducer::requestBufferLocked(int slot, sp<GraphicBuffer>* buf) {
     if (mCore->mIsAbandoned) {
         BQ_LOGE("requestBuffer: BufferQueue has been abandoned");
         return NO_INIT;
@@ -290,9 +308,7 @@ int BufferQueueProducer::getFreeSlotLocked() const {
     if (mCore->mFreeSlots.empty()) {
         return BufferQueueCore::INVALID_BUFFER_SLOT;
     }
-    int slot = *(mCore->mFreeSlots.begin());
-    mCore->mFreeSlots.erase(slot);
-    return slot;
+    return mCore->mFreeSlots.takeFirst();
 }
 
 status_t BufferQueueProducer::waitForFreeSlotThenRelock(FreeSlotCaller caller,
@@ -424,6 +440,30 @@ status_t BufferQueueProducer::waitForBufferRelease(std::unique_lock<std::mutex>&
 }
 #endif
 
+struct BufferQueueProducer::DequeueBufferState {
+    // The requested buffer, with the defaults of the BufferQueue resolved.
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PixelFormat format = 0;
+    uint64_t usage = 0;
+
+    int slot = BufferQueueCore::INVALID_BUFFER_SLOT;
+    sp<Fence> fence;
+    status_t returnFlags = NO_ERROR;
+    uint64_t bufferAge = 0;
+    bool attachedByConsumer = false;
+    bool callOnFrameDequeued = false;
+    uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
+#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
+#endif
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+    std::vector<gui::AdditionalOptions> allocOptions;
+    uint32_t allocOptionsGenId = 0;
+#endif
+};
+
 status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* outFence,
                                             uint32_t width, uint32_t height, PixelFormat format,
                                             uint64_t usage, uint64_t* outBufferAge,
@@ -451,258 +491,399 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
         return BAD_VALUE;
     }
 
-    status_t returnFlags = NO_ERROR;
-#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
-    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
-    EGLSyncKHR eglFence = EGL_NO_SYNC_KHR;
-#endif
-    bool attachedByConsumer = false;
-
+    DequeueBufferState state;
+    state.width = width;
+    state.height = height;
+    state.format = format;
+    state.usage = usage;
     sp<IConsumerListener> listener;
-    bool callOnFrameDequeued = false;
-    uint64_t bufferId = 0; // Only used if callOnFrameDequeued == true
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-    std::vector<gui::AdditionalOptions> allocOptions;
-    uint32_t allocOptionsGenId = 0;
-#endif
 
     { // Autolock scope
         std::unique_lock<std::mutex> lock(mCore->mMutex);
-
-        // If we don't have a free buffer, but we are currently allocating, we wait until allocation
-        // is finished such that we don't allocate in parallel.
-        if (mCore->mFreeBuffers.empty() && mCore->mIsAllocating) {
-            mDequeueWaitingForAllocation = true;
-            mCore->waitWhileAllocatingLocked(lock);
-            mDequeueWaitingForAllocation = false;
-            mDequeueWaitingForAllocationCondition.notify_all();
+        status_t status = dequeueSlotLocked(lock, /*waitForAllocation*/ true, &state);
+        if (status != NO_ERROR) {
+            return status;
         }
+        listener = mCore->mConsumerListener;
+    } // Autolock scope
 
-        if (format == 0) {
-            format = mCore->mDefaultBufferFormat;
-        }
+    if (state.returnFlags & BUFFER_NEEDS_REALLOCATION) {
+        BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", state.slot);
+        sp<GraphicBuffer> graphicBuffer = allocateDequeuedBuffer(state);
 
-        // Enable the usage bits the consumer requested
-        usage |= mCore->mConsumerUsageBits;
+        { // Autolock scope
+            std::lock_guard<std::mutex> lock(mCore->mMutex);
+            status_t error = setAllocatedBufferLocked(graphicBuffer, &state);
 
-        const bool useDefaultSize = !width && !height;
-        if (useDefaultSize) {
-            width = mCore->mDefaultWidth;
-            height = mCore->mDefaultHeight;
-            if (mCore->mAutoPrerotation &&
-                (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
-                std::swap(width, height);
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+
+            if (error != NO_ERROR) {
+                return error;
             }
+
+            VALIDATE_CONSISTENCY();
+        } // Autolock scope
+    }
+
+    *outSlot = state.slot;
+    *outFence = state.fence;
+    return finishDequeue(listener, &state, outBufferAge, outTimestamps);
+}
+
+status_t BufferQueueProducer::dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                                             std::vector<DequeueBufferOutput>* outputs) {
+    ATRACE_CALL();
+    BQ_LOGV("dequeueBuffers: %zu buffers", inputs.size());
+    outputs->clear();
+    outputs->resize(inputs.size());
+
+    std::vector<DequeueBufferState> states(inputs.size());
+    sp<IConsumerListener> listener;
+    bool allocating = false;
+
+    { // Autolock scope
+        std::unique_lock<std::mutex> lock(mCore->mMutex);
+        mConsumerName = mCore->mConsumerName;
+
+        status_t status = NO_ERROR;
+        if (mCore->mIsAbandoned) {
+            BQ_LOGE("dequeueBuffers: BufferQueue has been abandoned");
+            status = NO_INIT;
+        } else if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+            BQ_LOGE("dequeueBuffers: BufferQueue has no connected producer");
+            status = NO_INIT;
+        }
+        if (status != NO_ERROR) {
+            for (DequeueBufferOutput& output : *outputs) {
+                output.result = status;
+            }
+            return NO_ERROR;
         }
 
-        int found = BufferItem::INVALID_BUFFER_SLOT;
-        while (found == BufferItem::INVALID_BUFFER_SLOT) {
-            status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
-            if (status != NO_ERROR) {
-                return status;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            const DequeueBufferInput& input = inputs[i];
+            DequeueBufferOutput& output = (*outputs)[i];
+            if ((input.width && !input.height) || (!input.width && input.height)) {
+                BQ_LOGE("dequeueBuffers: invalid size: w=%u h=%u", input.width, input.height);
+                output.result = BAD_VALUE;
+                continue;
             }
 
-            // This should not happen
-            if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
-                BQ_LOGE("dequeueBuffer: no available buffer slots");
-                return -EBUSY;
+            DequeueBufferState& state = states[i];
+            state.width = input.width;
+            state.height = input.height;
+            state.format = input.format;
+            state.usage = input.usage;
+
+            // The buffers that this batch needs to reallocate are only allocated once the lock
+            // is released, so later slots of the batch must not wait for them.
+            output.result = dequeueSlotLocked(lock, /*waitForAllocation*/ !allocating, &state);
+            if (output.result == NO_ERROR && (state.returnFlags & BUFFER_NEEDS_REALLOCATION)) {
+                allocating = true;
             }
+        }
 
-            const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+        listener = mCore->mConsumerListener;
+    } // Autolock scope
 
-            // If we are not allowed to allocate new buffers,
-            // waitForFreeSlotThenRelock must have returned a slot containing a
-            // buffer. If this buffer would require reallocation to meet the
-            // requested attributes, we free it and attempt to get another one.
-            if (!mCore->mAllowAllocation) {
-                if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
-                    if (mCore->mSharedBufferSlot == found) {
-                        BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
-                        return BAD_VALUE;
-                    }
-                    mCore->mFreeSlots.insert(found);
-                    mCore->clearBufferSlotLocked(found);
-                    found = BufferItem::INVALID_BUFFER_SLOT;
-                    continue;
+    const auto needsAllocation = [&](size_t i) {
+        return (*outputs)[i].result == NO_ERROR &&
+                (states[i].returnFlags & BUFFER_NEEDS_REALLOCATION);
+    };
+
+    if (allocating) {
+        std::vector<sp<GraphicBuffer>> graphicBuffers(inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            if (needsAllocation(i)) {
+                BQ_LOGV("dequeueBuffers: allocating a new buffer for slot %d", states[i].slot);
+                graphicBuffers[i] = allocateDequeuedBuffer(states[i]);
+            }
+        }
+
+        { // Autolock scope
+            std::lock_guard<std::mutex> lock(mCore->mMutex);
+            for (size_t i = 0; i < inputs.size(); i++) {
+                if (needsAllocation(i)) {
+                    (*outputs)[i].result = setAllocatedBufferLocked(graphicBuffers[i], &states[i]);
                 }
             }
+
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+
+            VALIDATE_CONSISTENCY();
+        } // Autolock scope
+    }
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        DequeueBufferOutput& output = (*outputs)[i];
+        if (output.result != NO_ERROR) {
+            continue;
         }
+        output.slot = states[i].slot;
+        output.fence = states[i].fence;
+        output.result = finishDequeue(listener, &states[i], &output.bufferAge,
+                                      inputs[i].getTimestamps ? &output.timestamps.emplace()
+                                                              : nullptr);
+    }
+    return NO_ERROR;
+}
 
-        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+status_t BufferQueueProducer::dequeueSlotLocked(std::unique_lock<std::mutex>& lock,
+                                                bool waitForAllocation,
+                                                DequeueBufferState* state) {
+    // If we don't have a free buffer, but we are currently allocating or preallocating, we wait
+    // until allocation is finished such that we don't allocate in parallel.
+    if (waitForAllocation && mCore->isFreeBufferPendingLocked()) {
+        mDequeueWaitingForAllocation = true;
+        mCore->waitForFreeBufferLocked(lock);
+        mDequeueWaitingForAllocation = false;
+        mDequeueWaitingForAllocationCondition.notify_all();
+    }
 
-        bool needsReallocation = buffer == nullptr ||
-                buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
+    // Remember the request as made, so that the buffers preallocated for the
+    // next one follow changes of the defaults.
+    mCore->mHasDequeueRequest = true;
+    mCore->mLastDequeueWidth = state->width;
+    mCore->mLastDequeueHeight = state->height;
+    mCore->mLastDequeueFormat = state->format;
+    mCore->mLastDequeueUsage = state->usage;
 
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
-                mCore->mAdditionalOptionsGenerationId;
-#endif
+    if (state->format == 0) {
+        state->format = mCore->mDefaultBufferFormat;
+    }
 
-        if (mCore->mSharedBufferSlot == found && needsReallocation) {
-            BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
-            return BAD_VALUE;
+    // Enable the usage bits the consumer requested
+    state->usage |= mCore->mConsumerUsageBits;
+
+    const bool useDefaultSize = !state->width && !state->height;
+    if (useDefaultSize) {
+        state->width = mCore->mDefaultWidth;
+        state->height = mCore->mDefaultHeight;
+        if (mCore->mAutoPrerotation &&
+            (mCore->mTransformHintInUse & NATIVE_WINDOW_TRANSFORM_ROT_90)) {
+            std::swap(state->width, state->height);
         }
+    }
 
-        if (mCore->mSharedBufferSlot != found) {
-            mCore->mActiveBuffers.insert(found);
+    const uint32_t width = state->width;
+    const uint32_t height = state->height;
+    const PixelFormat format = state->format;
+    const uint64_t usage = state->usage;
+
+    int found = BufferItem::INVALID_BUFFER_SLOT;
+    while (found == BufferItem::INVALID_BUFFER_SLOT) {
+        status_t status = waitForFreeSlotThenRelock(FreeSlotCaller::Dequeue, lock, &found);
+        if (status != NO_ERROR) {
+            return status;
         }
-        *outSlot = found;
-        ATRACE_BUFFER_INDEX(found);
 
-        attachedByConsumer = mSlots[found].mNeedsReallocation;
-        mSlots[found].mNeedsReallocation = false;
+        // This should not happen
+        if (found == BufferQueueCore::INVALID_BUFFER_SLOT) {
+            BQ_LOGE("dequeueBuffer: no available buffer slots");
+            return -EBUSY;
+        }
 
-        mSlots[found].mBufferState.dequeue();
+        const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
 
-        if (needsReallocation) {
-            if (CC_UNLIKELY(ATRACE_ENABLED())) {
-                if (buffer == nullptr) {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
-                } else {
-                    ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
-                                          "layerCount:%d "
-                                          "usage:%d requested: %dx%d format:%d layerCount:%d "
-                                          "usage:%d ",
-                                          mConsumerName.c_str(), width, height, format,
-                                          BQ_LAYER_COUNT, usage, buffer->getWidth(),
-                                          buffer->getHeight(), buffer->getPixelFormat(),
-                                          buffer->getLayerCount(), buffer->getUsage());
+        // If we are not allowed to allocate new buffers,
+        // waitForFreeSlotThenRelock must have returned a slot containing a
+        // buffer. If this buffer would require reallocation to meet the
+        // requested attributes, we free it and attempt to get another one.
+        if (!mCore->mAllowAllocation) {
+            if (buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage)) {
+                if (mCore->mSharedBufferSlot == found) {
+                    BQ_LOGE("dequeueBuffer: cannot re-allocate a sharedbuffer");
+                    return BAD_VALUE;
                 }
+                mCore->mFreeSlots.insert(found);
+                mCore->clearBufferSlotLocked(found);
+                found = BufferItem::INVALID_BUFFER_SLOT;
+                continue;
             }
-            mSlots[found].mAcquireCalled = false;
-            mSlots[found].mGraphicBuffer = nullptr;
-            mSlots[found].mRequestBufferCalled = false;
-#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
-            mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
-            mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
-#endif
-            mSlots[found].mFence = Fence::NO_FENCE;
-            mCore->mBufferAge = 0;
-            mCore->mIsAllocating = true;
+        }
+    }
+
+    const sp<GraphicBuffer>& buffer(mSlots[found].mGraphicBuffer);
+
+    bool needsReallocation = buffer == nullptr ||
+            buffer->needsReallocation(width, height, format, BQ_LAYER_COUNT, usage);
+
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-            allocOptions = mCore->mAdditionalOptions;
-            allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+    needsReallocation |= mSlots[found].mAdditionalOptionsGenerationId !=
+            mCore->mAdditionalOptionsGenerationId;
 #endif
 
-            returnFlags |= BUFFER_NEEDS_REALLOCATION;
-        } else {
-            // We add 1 because that will be the frame number when this buffer
-            // is queued
-            mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
-        }
+    if (mCore->mSharedBufferSlot == found && needsReallocation) {
+        BQ_LOGE("dequeueBuffer: cannot re-allocate a shared buffer");
+        return BAD_VALUE;
+    }
 
-        BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
-                mCore->mBufferAge);
+    if (mCore->mSharedBufferSlot != found) {
+        mCore->mActiveBuffers.insert(found);
+    }
+    state->slot = found;
+    ATRACE_BUFFER_INDEX(found);
 
-        if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
-            BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
-                    "slot=%d w=%d h=%d format=%u",
-                    found, buffer->width, buffer->height, buffer->format);
-        }
+    state->attachedByConsumer = mSlots[found].mNeedsReallocation;
+    mSlots[found].mNeedsReallocation = false;
 
+    mSlots[found].mBufferState.dequeue();
+
+    if (needsReallocation) {
+        if (CC_UNLIKELY(ATRACE_ENABLED())) {
+            if (buffer == nullptr) {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation: null", mConsumerName.c_str());
+            } else {
+                ATRACE_FORMAT_INSTANT("%s buffer reallocation actual %dx%d format:%d "
+                                      "layerCount:%d "
+                                      "usage:%d requested: %dx%d format:%d layerCount:%d "
+                                      "usage:%d ",
+                                      mConsumerName.c_str(), width, height, format,
+                                      BQ_LAYER_COUNT, usage, buffer->getWidth(),
+                                      buffer->getHeight(), buffer->getPixelFormat(),
+                                      buffer->getLayerCount(), buffer->getUsage());
+            }
+        }
+        mSlots[found].mAcquireCalled = false;
+        mSlots[found].mGraphicBuffer = nullptr;
+        mSlots[found].mRequestBufferCalled = false;
 #if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
-        eglDisplay = mSlots[found].mEglDisplay;
-        eglFence = mSlots[found].mEglFence;
-#endif
-        // Don't return a fence in shared buffer mode, except for the first
-        // frame.
-        *outFence = (mCore->mSharedBufferMode &&
-                mCore->mSharedBufferSlot == found) ?
-                Fence::NO_FENCE : mSlots[found].mFence;
-#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
+        mSlots[found].mEglDisplay = EGL_NO_DISPLAY;
         mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
 #endif
         mSlots[found].mFence = Fence::NO_FENCE;
+        mCore->mBufferAge = 0;
+        mCore->mIsAllocating = true;
+        mCore->mSyncAllocationCount++;
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is dequeued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = found;
-            mSlots[found].mBufferState.mShared = true;
-        }
+        // The request changed, so the other free buffers are likely stale too.
+        // Replace them before the next dequeues need them.
+        mCore->requestPreallocationLocked();
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+        state->allocOptions = mCore->mAdditionalOptions;
+        state->allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+#endif
 
-        if (!(returnFlags & BUFFER_NEEDS_REALLOCATION)) {
-            callOnFrameDequeued = true;
-            bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
-        }
+        state->returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    } else {
+        // We add 1 because that will be the frame number when this buffer
+        // is queued
+        mCore->mBufferAge = mCore->mFrameCounter + 1 - mSlots[found].mFrameNumber;
+    }
 
-        listener = mCore->mConsumerListener;
-    } // Autolock scope
+    BQ_LOGV("dequeueBuffer: setting buffer age to %" PRIu64,
+            mCore->mBufferAge);
+    state->bufferAge = mCore->mBufferAge;
 
-    if (returnFlags & BUFFER_NEEDS_REALLOCATION) {
-        BQ_LOGV("dequeueBuffer: allocating a new buffer for slot %d", *outSlot);
+    if (CC_UNLIKELY(mSlots[found].mFence == nullptr)) {
+        BQ_LOGE("dequeueBuffer: about to return a NULL fence - "
+                "slot=%d w=%d h=%d format=%u",
+                found, buffer->width, buffer->height, buffer->format);
+    }
 
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-        std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
-        tempOptions.reserve(allocOptions.size());
-        for (const auto& it : allocOptions) {
-            tempOptions.emplace_back(it.name.c_str(), it.value);
-        }
-        const GraphicBufferAllocator::AllocationRequest allocRequest = {
-                .importBuffer = true,
-                .width = width,
-                .height = height,
-                .format = format,
-                .layerCount = BQ_LAYER_COUNT,
-                .usage = usage,
-                .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
-                .extras = std::move(tempOptions),
-        };
-        sp<GraphicBuffer> graphicBuffer = new GraphicBuffer(allocRequest);
-#else
-        sp<GraphicBuffer> graphicBuffer =
-                new GraphicBuffer(width, height, format, BQ_LAYER_COUNT, usage,
-                                  {mConsumerName.c_str(), mConsumerName.size()});
+#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
+    state->eglDisplay = mSlots[found].mEglDisplay;
+    state->eglFence = mSlots[found].mEglFence;
+#endif
+    // Don't return a fence in shared buffer mode, except for the first
+    // frame.
+    state->fence = (mCore->mSharedBufferMode &&
+            mCore->mSharedBufferSlot == found) ?
+            Fence::NO_FENCE : mSlots[found].mFence;
+#if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
+    mSlots[found].mEglFence = EGL_NO_SYNC_KHR;
 #endif
+    mSlots[found].mFence = Fence::NO_FENCE;
+
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is dequeued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = found;
+        mSlots[found].mBufferState.mShared = true;
+    }
 
-        status_t error = graphicBuffer->initCheck();
+    if (!(state->returnFlags & BUFFER_NEEDS_REALLOCATION)) {
+        state->callOnFrameDequeued = true;
+        state->bufferId = mSlots[found].mGraphicBuffer->getId();
+    }
 
-        { // Autolock scope
-            std::lock_guard<std::mutex> lock(mCore->mMutex);
+    return NO_ERROR;
+}
 
-            if (error == NO_ERROR && !mCore->mIsAbandoned) {
-                graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
-                mSlots[*outSlot].mGraphicBuffer = graphicBuffer;
+sp<GraphicBuffer> BufferQueueProducer::allocateDequeuedBuffer(
+        const DequeueBufferState& state) const {
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
-                mSlots[*outSlot].mAdditionalOptionsGenerationId = allocOptionsGenId;
+    std::vector<GraphicBufferAllocator::AdditionalOptions> tempOptions;
+    tempOptions.reserve(state.allocOptions.size());
+    for (const auto& it : state.allocOptions) {
+        tempOptions.emplace_back(it.name.c_str(), it.value);
+    }
+    const GraphicBufferAllocator::AllocationRequest allocRequest = {
+            .importBuffer = true,
+            .width = state.width,
+            .height = state.height,
+            .format = state.format,
+            .layerCount = BQ_LAYER_COUNT,
+            .usage = state.usage,
+            .requestorName = {mConsumerName.c_str(), mConsumerName.size()},
+            .extras = std::move(tempOptions),
+    };
+    return new GraphicBuffer(allocRequest);
+#else
+    return new GraphicBuffer(state.width, state.height, state.format, BQ_LAYER_COUNT,
+                             state.usage, {mConsumerName.c_str(), mConsumerName.size()});
 #endif
-                callOnFrameDequeued = true;
-                bufferId = mSlots[*outSlot].mGraphicBuffer->getId();
-            }
+}
 
-            mCore->mIsAllocating = false;
-            mCore->mIsAllocatingCondition.notify_all();
+status_t BufferQueueProducer::setAllocatedBufferLocked(const sp<GraphicBuffer>& graphicBuffer,
+                                                       DequeueBufferState* state) {
+    const int slot = state->slot;
+    status_t error = graphicBuffer->initCheck();
 
-            if (error != NO_ERROR) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
-                return error;
-            }
+    if (error == NO_ERROR && !mCore->mIsAbandoned) {
+        graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
+        mSlots[slot].mGraphicBuffer = graphicBuffer;
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+        mSlots[slot].mAdditionalOptionsGenerationId = state->allocOptionsGenId;
+#endif
+        state->callOnFrameDequeued = true;
+        state->bufferId = graphicBuffer->getId();
+    }
 
-            if (mCore->mIsAbandoned) {
-                mCore->mFreeSlots.insert(*outSlot);
-                mCore->clearBufferSlotLocked(*outSlot);
-                BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
-                return NO_INIT;
-            }
+    if (error != NO_ERROR) {
+        mCore->mFreeSlots.insert(slot);
+        mCore->clearBufferSlotLocked(slot);
+        BQ_LOGE("dequeueBuffer: createGraphicBuffer failed");
+        return error;
+    }
 
-            VALIDATE_CONSISTENCY();
-        } // Autolock scope
+    if (mCore->mIsAbandoned) {
+        mCore->mFreeSlots.insert(slot);
+        mCore->clearBufferSlotLocked(slot);
+        BQ_LOGE("dequeueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
     }
 
-    if (listener != nullptr && callOnFrameDequeued) {
-        listener->onFrameDequeued(bufferId);
+    return NO_ERROR;
+}
+
+status_t BufferQueueProducer::finishDequeue(const sp<IConsumerListener>& listener,
+                                            DequeueBufferState* state, uint64_t* outBufferAge,
+                                            FrameEventHistoryDelta* outTimestamps) {
+    if (listener != nullptr && state->callOnFrameDequeued) {
+        listener->onFrameDequeued(state->bufferId);
     }
 
-    if (attachedByConsumer) {
-        returnFlags |= BUFFER_NEEDS_REALLOCATION;
+    if (state->attachedByConsumer) {
+        state->returnFlags |= BUFFER_NEEDS_REALLOCATION;
     }
 
 #if !COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_GL_FENCE_CLEANUP)
-    if (eglFence != EGL_NO_SYNC_KHR) {
-        EGLint result = eglClientWaitSyncKHR(eglDisplay, eglFence, 0,
+    if (state->eglFence != EGL_NO_SYNC_KHR) {
+        EGLint result = eglClientWaitSyncKHR(state->eglDisplay, state->eglFence, 0,
                 1000000000);
         // If something goes wrong, log the error, but return the buffer without
         // synchronizing access to it. It's too late at this point to abort the
@@ -713,22 +894,22 @@ status_t BufferQueueProducer::dequeueBuffer(int* outSlot, sp<android::Fence>* ou
         } else if (result == EGL_TIMEOUT_EXPIRED_KHR) {
             BQ_LOGE("dequeueBuffer: timeout waiting for fence");
         }
-        eglDestroySyncKHR(eglDisplay, eglFence);
+        eglDestroySyncKHR(state->eglDisplay, state->eglFence);
     }
 #endif
 
     BQ_LOGV("dequeueBuffer: returning slot=%d/%" PRIu64 " buf=%p flags=%#x",
-            *outSlot,
-            mSlots[*outSlot].mFrameNumber,
-            mSlots[*outSlot].mGraphicBuffer != nullptr ?
-            mSlots[*outSlot].mGraphicBuffer->handle : nullptr, returnFlags);
+            state->slot,
+            mSlots[state->slot].mFrameNumber,
+            mSlots[state->slot].mGraphicBuffer != nullptr ?
+            mSlots[state->slot].mGraphicBuffer->handle : nullptr, state->returnFlags);
 
     if (outBufferAge) {
-        *outBufferAge = mCore->mBufferAge;
+        *outBufferAge = state->bufferAge;
     }
     addAndGetFrameTimestamps(nullptr, outTimestamps);
 
-    return returnFlags;
+    return state->returnFlags;
 }
 
 status_t BufferQueueProducer::detachBuffer(int slot) {
@@ -842,7 +1023,7 @@ status_t BufferQueueProducer::detachNextBuffer(sp<GraphicBuffer>* outBuffer,
         }
 
         int found = mCore->mFreeBuffers.front();
-        mCore->mFreeBuffers.remove(found);
+        mCore->mFreeBuffers.pop_front();
         mCore->mFreeSlots.insert(found);
 
         BQ_LOGV("detachNextBuffer detached slot %d", found);
@@ -932,289 +1113,428 @@ status_t BufferQueueProducer::attachBuffer(int* outSlot,
     return returnFlags;
 }
 
+struct BufferQueueProducer::QueueBufferState {
+    // The parts of the QueueBufferInput that don't depend on the slot.
+    int64_t requestedPresentTimestamp = 0;
+    bool isAutoTimestamp = false;
+    android_dataspace dataSpace = HAL_DATASPACE_UNKNOWN;
+    Rect crop = Rect::EMPTY_RECT;
+    int scalingMode = NATIVE_WINDOW_SCALING_MODE_FREEZE;
+    uint32_t transform = 0;
+    uint32_t stickyTransform = 0;
+    sp<Fence> acquireFence;
+    std::shared_ptr<FenceTime> acquireFenceTime;
+    bool getFrameTimestamps = false;
+
+    // The queued frame, and whether it replaced the last frame of the queue
+    // rather than becoming available.
+    BufferItem item;
+    bool frameReplaced = false;
+    int connectedApi = BufferQueueCore::NO_CONNECTED_API;
+    bool enableEglCpuThrottling = true;
+    sp<Fence> lastQueuedFence;
+};
+
 status_t BufferQueueProducer::queueBuffer(int slot,
         const QueueBufferInput &input, QueueBufferOutput *output) {
     ATRACE_CALL();
     ATRACE_BUFFER_INDEX(slot);
 
-    int64_t requestedPresentTimestamp;
-    bool isAutoTimestamp;
-    android_dataspace dataSpace;
-    Rect crop(Rect::EMPTY_RECT);
-    int scalingMode;
-    uint32_t transform;
-    uint32_t stickyTransform;
-    sp<Fence> acquireFence;
-    bool getFrameTimestamps = false;
-    input.deflate(&requestedPresentTimestamp, &isAutoTimestamp, &dataSpace,
-            &crop, &scalingMode, &transform, &acquireFence, &stickyTransform,
-            &getFrameTimestamps);
-    const Region& surfaceDamage = input.getSurfaceDamage();
-    const HdrMetadata& hdrMetadata = input.getHdrMetadata();
-    const std::optional<PictureProfileHandle>& pictureProfileHandle =
-            input.getPictureProfileHandle();
+    QueueBufferState state;
+    status_t status = prepareQueueBuffer(input, &state);
+    if (status != NO_ERROR) {
+        return status;
+    }
+
+    sp<IConsumerListener> listener;
+    int callbackTicket = 0;
 
-    if (acquireFence == nullptr) {
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+
+        status = queueBufferLocked(slot, input, &state, output);
+        if (status != NO_ERROR) {
+            return status;
+        }
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
+        mCore->notifyBufferReleased();
+#else
+        mCore->mDequeueCondition.notify_all();
+#endif
+        listener = mCore->mConsumerListener;
+
+        // Take a ticket for the callback functions
+        callbackTicket = mNextCallbackTicket++;
+
+        VALIDATE_CONSISTENCY();
+    } // Autolock scope
+
+    finishQueueBuffer(&state, output);
+
+    // Call back without the main BufferQueue lock held, but with the callback
+    // lock held so we can ensure that callbacks occur in order
+
+    { // scope for the lock
+        std::unique_lock<std::mutex> lock(mCallbackMutex);
+        while (callbackTicket != mCurrentCallbackTicket) {
+            mCallbackCondition.wait(lock);
+        }
+
+        if (listener != nullptr) {
+            if (state.frameReplaced) {
+                listener->onFrameReplaced(state.item);
+            } else {
+                listener->onFrameAvailable(state.item);
+            }
+        }
+
+        ++mCurrentCallbackTicket;
+        mCallbackCondition.notify_all();
+    }
+
+    // Wait without lock held
+    if (state.connectedApi == NATIVE_WINDOW_API_EGL && state.enableEglCpuThrottling) {
+        // Waiting here allows for two full buffers to be queued but not a
+        // third. In the event that frames take varying time, this makes a
+        // small trade-off in favor of latency rather than throughput.
+        state.lastQueuedFence->waitForever("Throttling EGL Production");
+    }
+
+    return NO_ERROR;
+}
+
+status_t BufferQueueProducer::queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                                           std::vector<QueueBufferOutput>* outputs) {
+    ATRACE_CALL();
+    BQ_LOGV("queueBuffers: %zu buffers", inputs.size());
+    outputs->clear();
+    outputs->resize(inputs.size());
+
+    std::vector<QueueBufferState> states(inputs.size());
+    for (size_t i = 0; i < inputs.size(); i++) {
+        (*outputs)[i].result = prepareQueueBuffer(inputs[i], &states[i]);
+    }
+
+    sp<IConsumerListener> listener;
+    int callbackTicket = 0;
+    const QueueBufferState* lastQueued = nullptr;
+
+    { // Autolock scope
+        std::lock_guard<std::mutex> lock(mCore->mMutex);
+
+        for (size_t i = 0; i < inputs.size(); i++) {
+            QueueBufferOutput& output = (*outputs)[i];
+            if (output.result != NO_ERROR) {
+                continue;
+            }
+            output.result = queueBufferLocked(inputs[i].slot, inputs[i], &states[i], &output);
+            if (output.result == NO_ERROR) {
+                lastQueued = &states[i];
+            }
+        }
+
+        if (lastQueued == nullptr) {
+            return NO_ERROR;
+        }
+
+        // Waiting dequeuers only need to be woken up once for the whole batch.
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
+        mCore->notifyBufferReleased();
+#else
+        mCore->mDequeueCondition.notify_all();
+#endif
+        listener = mCore->mConsumerListener;
+
+        // Take a single ticket for the callbacks of the batch
+        callbackTicket = mNextCallbackTicket++;
+
+        VALIDATE_CONSISTENCY();
+    } // Autolock scope
+
+    for (size_t i = 0; i < inputs.size(); i++) {
+        if ((*outputs)[i].result == NO_ERROR) {
+            finishQueueBuffer(&states[i], &(*outputs)[i]);
+        }
+    }
+
+    { // scope for the lock
+        std::unique_lock<std::mutex> lock(mCallbackMutex);
+        while (callbackTicket != mCurrentCallbackTicket) {
+            mCallbackCondition.wait(lock);
+        }
+
+        if (listener != nullptr) {
+            // Frames that became available are reported together, but a replaced frame must be
+            // reported after the frames queued before it.
+            std::vector<BufferItem> availableItems;
+            availableItems.reserve(inputs.size());
+            for (size_t i = 0; i < inputs.size(); i++) {
+                if ((*outputs)[i].result != NO_ERROR) {
+                    continue;
+                }
+                if (!states[i].frameReplaced) {
+                    availableItems.push_back(std::move(states[i].item));
+                    continue;
+                }
+                if (!availableItems.empty()) {
+                    listener->onFramesAvailable(availableItems);
+                    availableItems.clear();
+                }
+                listener->onFrameReplaced(states[i].item);
+            }
+            if (!availableItems.empty()) {
+                listener->onFramesAvailable(availableItems);
+            }
+        }
+
+        ++mCurrentCallbackTicket;
+        mCallbackCondition.notify_all();
+    }
+
+    // Wait without lock held
+    if (lastQueued->connectedApi == NATIVE_WINDOW_API_EGL && lastQueued->enableEglCpuThrottling) {
+        // As in queueBuffer, throttle on the fence of the buffer queued before the last one.
+        lastQueued->lastQueuedFence->waitForever("Throttling EGL Production");
+    }
+
+    return NO_ERROR;
+}
+
+status_t BufferQueueProducer::prepareQueueBuffer(const QueueBufferInput& input,
+                                                 QueueBufferState* state) const {
+    input.deflate(&state->requestedPresentTimestamp, &state->isAutoTimestamp, &state->dataSpace,
+            &state->crop, &state->scalingMode, &state->transform, &state->acquireFence,
+            &state->stickyTransform, &state->getFrameTimestamps);
+
+    if (state->acquireFence == nullptr) {
         BQ_LOGE("queueBuffer: fence is NULL");
         return BAD_VALUE;
     }
 
-    auto acquireFenceTime = std::make_shared<FenceTime>(acquireFence);
+    state->acquireFenceTime = std::make_shared<FenceTime>(state->acquireFence);
 
-    switch (scalingMode) {
+    switch (state->scalingMode) {
         case NATIVE_WINDOW_SCALING_MODE_FREEZE:
         case NATIVE_WINDOW_SCALING_MODE_SCALE_TO_WINDOW:
         case NATIVE_WINDOW_SCALING_MODE_SCALE_CROP:
         case NATIVE_WINDOW_SCALING_MODE_NO_SCALE_CROP:
             break;
         default:
-            BQ_LOGE("queueBuffer: unknown scaling mode %d", scalingMode);
+            BQ_LOGE("queueBuffer: unknown scaling mode %d", state->scalingMode);
             return BAD_VALUE;
     }
 
-    sp<IConsumerListener> frameAvailableListener;
-    sp<IConsumerListener> frameReplacedListener;
-    int callbackTicket = 0;
-    uint64_t currentFrameNumber = 0;
-    BufferItem item;
-    int connectedApi;
-    bool enableEglCpuThrottling = true;
-    sp<Fence> lastQueuedFence;
+    return NO_ERROR;
+}
 
-    { // Autolock scope
-        std::lock_guard<std::mutex> lock(mCore->mMutex);
+status_t BufferQueueProducer::queueBufferLocked(int slot, const QueueBufferInput& input,
+                                                QueueBufferState* state,
+                                                QueueBufferOutput* output) {
+    const Region& surfaceDamage = input.getSurfaceDamage();
+    const HdrMetadata& hdrMetadata = input.getHdrMetadata();
+    const std::optional<PictureProfileHandle>& pictureProfileHandle =
+            input.getPictureProfileHandle();
+    const Rect& crop = state->crop;
+    const int scalingMode = state->scalingMode;
+    const uint32_t transform = state->transform;
+    BufferItem& item = state->item;
 
-        if (mCore->mIsAbandoned) {
-            BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
-            return NO_INIT;
-        }
+    if (mCore->mIsAbandoned) {
+        BQ_LOGE("queueBuffer: BufferQueue has been abandoned");
+        return NO_INIT;
+    }
 
-        if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
-            BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
-            return NO_INIT;
-        }
+    if (mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API) {
+        BQ_LOGE("queueBuffer: BufferQueue has no connected producer");
+        return NO_INIT;
+    }
 
-        if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
-            BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
-                    slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mBufferState.isDequeued()) {
-            BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
-                    "(state = %s)", slot, mSlots[slot].mBufferState.string());
-            return BAD_VALUE;
-        } else if (!mSlots[slot].mRequestBufferCalled) {
-            BQ_LOGE("queueBuffer: slot %d was queued without requesting "
-                    "a buffer", slot);
-            return BAD_VALUE;
-        }
+    if (slot < 0 || slot >= BufferQueueDefs::NUM_BUFFER_SLOTS) {
+        BQ_LOGE("queueBuffer: slot index %d out of range [0, %d)",
+                slot, BufferQueueDefs::NUM_BUFFER_SLOTS);
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mBufferState.isDequeued()) {
+        BQ_LOGE("queueBuffer: slot %d is not owned by the producer "
+                "(state = %s)", slot, mSlots[slot].mBufferState.string());
+        return BAD_VALUE;
+    } else if (!mSlots[slot].mRequestBufferCalled) {
+        BQ_LOGE("queueBuffer: slot %d was queued without requesting "
+                "a buffer", slot);
+        return BAD_VALUE;
+    }
 
-        // If shared buffer mode has just been enabled, cache the slot of the
-        // first buffer that is queued and mark it as the shared buffer.
-        if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
-                BufferQueueCore::INVALID_BUFFER_SLOT) {
-            mCore->mSharedBufferSlot = slot;
-            mSlots[slot].mBufferState.mShared = true;
-        }
-
-        BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
-                " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
-                slot, mCore->mFrameCounter + 1, requestedPresentTimestamp, dataSpace,
-                hdrMetadata.validTypes, crop.left, crop.top, crop.right, crop.bottom,
-                transform,
-                BufferItem::scalingModeName(static_cast<uint32_t>(scalingMode)));
-
-        const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
-        Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
-        Rect croppedRect(Rect::EMPTY_RECT);
-        crop.intersect(bufferRect, &croppedRect);
-        if (croppedRect != crop) {
-            BQ_LOGE("queueBuffer: crop rect is not contained within the "
-                    "buffer in slot %d", slot);
-            return BAD_VALUE;
-        }
+    // If shared buffer mode has just been enabled, cache the slot of the
+    // first buffer that is queued and mark it as the shared buffer.
+    if (mCore->mSharedBufferMode && mCore->mSharedBufferSlot ==
+            BufferQueueCore::INVALID_BUFFER_SLOT) {
+        mCore->mSharedBufferSlot = slot;
+        mSlots[slot].mBufferState.mShared = true;
+    }
+
+    BQ_LOGV("queueBuffer: slot=%d/%" PRIu64 " time=%" PRIu64 " dataSpace=%d"
+            " validHdrMetadataTypes=0x%x crop=[%d,%d,%d,%d] transform=%#x scale=%s",
+            slot, mCore->mFrameCounter + 1, state->requestedPresentTimestamp, state->dataSpace,
+            hdrMetadata.validTypes, crop.left, crop.top, crop.right, crop.bottom,
+            transform,
+            BufferItem::scalingModeName(static_cast<uint32_t>(scalingMode)));
+
+    const sp<GraphicBuffer>& graphicBuffer(mSlots[slot].mGraphicBuffer);
+    Rect bufferRect(graphicBuffer->getWidth(), graphicBuffer->getHeight());
+    Rect croppedRect(Rect::EMPTY_RECT);
+    crop.intersect(bufferRect, &croppedRect);
+    if (croppedRect != crop) {
+        BQ_LOGE("queueBuffer: crop rect is not contained within the "
+                "buffer in slot %d", slot);
+        return BAD_VALUE;
+    }
+
+    // Override UNKNOWN dataspace with consumer default
+    if (state->dataSpace == HAL_DATASPACE_UNKNOWN) {
+        state->dataSpace = mCore->mDefaultBufferDataSpace;
+    }
 
-        // Override UNKNOWN dataspace with consumer default
-        if (dataSpace == HAL_DATASPACE_UNKNOWN) {
-            dataSpace = mCore->mDefaultBufferDataSpace;
-        }
-
-        mSlots[slot].mFence = acquireFence;
-        mSlots[slot].mBufferState.queue();
-
-        // Increment the frame counter and store a local version of it
-        // for use outside the lock on mCore->mMutex.
-        ++mCore->mFrameCounter;
-        currentFrameNumber = mCore->mFrameCounter;
-        mSlots[slot].mFrameNumber = currentFrameNumber;
-
-        item.mAcquireCalled = mSlots[slot].mAcquireCalled;
-        item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
-        item.mCrop = crop;
-        item.mTransform = transform &
-                ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
-        item.mTransformToDisplayInverse =
-                (transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
-        item.mScalingMode = static_cast<uint32_t>(scalingMode);
-        item.mTimestamp = requestedPresentTimestamp;
-        item.mIsAutoTimestamp = isAutoTimestamp;
-        item.mDataSpace = dataSpace;
-        item.mHdrMetadata = hdrMetadata;
+    mSlots[slot].mFence = state->acquireFence;
+    mSlots[slot].mBufferState.queue();
+
+    // Increment the frame counter and store a local version of it
+    // for use outside the lock on mCore->mMutex.
+    ++mCore->mFrameCounter;
+    const uint64_t currentFrameNumber = mCore->mFrameCounter;
+    mSlots[slot].mFrameNumber = currentFrameNumber;
+
+    item.mAcquireCalled = mSlots[slot].mAcquireCalled;
+    item.mGraphicBuffer = mSlots[slot].mGraphicBuffer;
+    item.mCrop = crop;
+    item.mTransform = transform &
+            ~static_cast<uint32_t>(NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY);
+    item.mTransformToDisplayInverse =
+            (transform & NATIVE_WINDOW_TRANSFORM_INVERSE_DISPLAY) != 0;
+    item.mScalingMode = static_cast<uint32_t>(scalingMode);
+    item.mTimestamp = state->requestedPresentTimestamp;
+    item.mIsAutoTimestamp = state->isAutoTimestamp;
+    item.mDataSpace = state->dataSpace;
+    item.mHdrMetadata = hdrMetadata;
 #if COM_ANDROID_GRAPHICS_LIBUI_FLAGS_APPLY_PICTURE_PROFILES
-        item.mPictureProfileHandle = pictureProfileHandle;
+    item.mPictureProfileHandle = pictureProfileHandle;
 #endif // COM_ANDROID_GRAPHICS_LIBUI_FLAGS_APPLY_PICTURE_PROFILES
-        item.mFrameNumber = currentFrameNumber;
-        item.mSlot = slot;
-        item.mFence = acquireFence;
-        item.mFenceTime = acquireFenceTime;
-        item.mIsDroppable = mCore->mAsyncMode ||
-                (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
-                (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
-                (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
-        item.mSurfaceDamage = surfaceDamage;
-        item.mQueuedBuffer = true;
-        item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
-        item.mApi = mCore->mConnectedApi;
-
-        mStickyTransform = stickyTransform;
-
-        // Cache the shared buffer data so that the BufferItem can be recreated.
-        if (mCore->mSharedBufferMode) {
-            mCore->mSharedBufferCache.crop = crop;
-            mCore->mSharedBufferCache.transform = transform;
-            mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
-                    scalingMode);
-            mCore->mSharedBufferCache.dataspace = dataSpace;
-        }
+    item.mFrameNumber = currentFrameNumber;
+    item.mSlot = slot;
+    item.mFence = state->acquireFence;
+    item.mFenceTime = state->acquireFenceTime;
+    item.mIsDroppable = mCore->mAsyncMode ||
+            (mConsumerIsSurfaceFlinger && mCore->mQueueBufferCanDrop) ||
+            (mCore->mLegacyBufferDrop && mCore->mQueueBufferCanDrop) ||
+            (mCore->mSharedBufferMode && mCore->mSharedBufferSlot == slot);
+    item.mSurfaceDamage = surfaceDamage;
+    item.mQueuedBuffer = true;
+    item.mAutoRefresh = mCore->mSharedBufferMode && mCore->mAutoRefresh;
+    item.mApi = mCore->mConnectedApi;
+
+    mStickyTransform = state->stickyTransform;
+
+    // Cache the shared buffer data so that the BufferItem can be recreated.
+    if (mCore->mSharedBufferMode) {
+        mCore->mSharedBufferCache.crop = crop;
+        mCore->mSharedBufferCache.transform = transform;
+        mCore->mSharedBufferCache.scalingMode = static_cast<uint32_t>(
+                scalingMode);
+        mCore->mSharedBufferCache.dataspace = state->dataSpace;
+    }
 
-        output->bufferReplaced = false;
-        if (mCore->mQueue.empty()) {
-            // When the queue is empty, we can ignore mDequeueBufferCannotBlock
-            // and simply queue this buffer
-            mCore->mQueue.push_back(item);
-            frameAvailableListener = mCore->mConsumerListener;
-        } else {
-            // When the queue is not empty, we need to look at the last buffer
-            // in the queue to see if we need to replace it
-            const BufferItem& last = mCore->mQueue.itemAt(
-                    mCore->mQueue.size() - 1);
-            if (last.mIsDroppable) {
-
-                if (!last.mIsStale) {
-                    mSlots[last.mSlot].mBufferState.freeQueued();
-
-                    // After leaving shared buffer mode, the shared buffer will
-                    // still be around. Mark it as no longer shared if this
-                    // operation causes it to be free.
-                    if (!mCore->mSharedBufferMode &&
-                            mSlots[last.mSlot].mBufferState.isFree()) {
-                        mSlots[last.mSlot].mBufferState.mShared = false;
-                    }
-                    // Don't put the shared buffer on the free list.
-                    if (!mSlots[last.mSlot].mBufferState.isShared()) {
-                        mCore->mActiveBuffers.erase(last.mSlot);
-                        mCore->mFreeBuffers.push_back(last.mSlot);
-                        output->bufferReplaced = true;
-                    }
+    output->bufferReplaced = false;
+    if (mCore->mQueue.empty()) {
+        // When the queue is empty, we can ignore mDequeueBufferCannotBlock
+        // and simply queue this buffer
+        mCore->mQueue.push_back(item);
+    } else {
+        // When the queue is not empty, we need to look at the last buffer
+        // in the queue to see if we need to replace it
+        const BufferItem& last = mCore->mQueue.itemAt(
+                mCore->mQueue.size() - 1);
+        if (last.mIsDroppable) {
+
+            if (!last.mIsStale) {
+                mSlots[last.mSlot].mBufferState.freeQueued();
+
+                // After leaving shared buffer mode, the shared buffer will
+                // still be around. Mark it as no longer shared if this
+                // operation causes it to be free.
+                if (!mCore->mSharedBufferMode &&
+                        mSlots[last.mSlot].mBufferState.isFree()) {
+                    mSlots[last.mSlot].mBufferState.mShared = false;
                 }
-
-                // Make sure to merge the damage rect from the frame we're about
-                // to drop into the new frame's damage rect.
-                if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
-                    item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
-                    item.mSurfaceDamage = Region::INVALID_REGION;
-                } else {
-                    item.mSurfaceDamage |= last.mSurfaceDamage;
+                // Don't put the shared buffer on the free list.
+                if (!mSlots[last.mSlot].mBufferState.isShared()) {
+                    mCore->mActiveBuffers.erase(last.mSlot);
+                    mCore->mFreeBuffers.push_back(last.mSlot);
+                    output->bufferReplaced = true;
                 }
+            }
 
-                // Overwrite the droppable buffer with the incoming one
-                mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
-                frameReplacedListener = mCore->mConsumerListener;
+            // Make sure to merge the damage rect from the frame we're about
+            // to drop into the new frame's damage rect.
+            if (last.mSurfaceDamage.bounds() == Rect::INVALID_RECT ||
+                item.mSurfaceDamage.bounds() == Rect::INVALID_RECT) {
+                item.mSurfaceDamage = Region::INVALID_REGION;
             } else {
-                mCore->mQueue.push_back(item);
-                frameAvailableListener = mCore->mConsumerListener;
+                item.mSurfaceDamage |= last.mSurfaceDamage;
             }
+
+            // Overwrite the droppable buffer with the incoming one
+            mCore->mQueue.editItemAt(mCore->mQueue.size() - 1) = item;
+            state->frameReplaced = true;
+        } else {
+            mCore->mQueue.push_back(item);
         }
+    }
 
-        mCore->mBufferHasBeenQueued = true;
-#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
-        mCore->notifyBufferReleased();
-#else
-        mCore->mDequeueCondition.notify_all();
-#endif
-        mCore->mLastQueuedSlot = slot;
+    mCore->mBufferHasBeenQueued = true;
+    mCore->mLastQueuedSlot = slot;
 
-        output->width = mCore->mDefaultWidth;
-        output->height = mCore->mDefaultHeight;
-        output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
-        output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
-        output->nextFrameNumber = mCore->mFrameCounter + 1;
+    output->width = mCore->mDefaultWidth;
+    output->height = mCore->mDefaultHeight;
+    output->transformHint = mCore->mTransformHintInUse = mCore->mTransformHint;
+    output->numPendingBuffers = static_cast<uint32_t>(mCore->mQueue.size());
+    output->nextFrameNumber = mCore->mFrameCounter + 1;
 
-        ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
+    ATRACE_INT(mCore->mConsumerName.c_str(), static_cast<int32_t>(mCore->mQueue.size()));
 #ifndef NO_BINDER
-        mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
+    mCore->mOccupancyTracker.registerOccupancyChange(mCore->mQueue.size());
 #endif
-        // Take a ticket for the callback functions
-        callbackTicket = mNextCallbackTicket++;
 
-        VALIDATE_CONSISTENCY();
+    state->connectedApi = mCore->mConnectedApi;
+    if (flags::bq_producer_throttles_only_async_mode()) {
+        state->enableEglCpuThrottling = mCore->mAsyncMode || mCore->mDequeueBufferCannotBlock;
+    }
+    state->lastQueuedFence = std::move(mLastQueueBufferFence);
 
-        connectedApi = mCore->mConnectedApi;
-        if (flags::bq_producer_throttles_only_async_mode()) {
-            enableEglCpuThrottling = mCore->mAsyncMode || mCore->mDequeueBufferCannotBlock;
-        }
-        lastQueuedFence = std::move(mLastQueueBufferFence);
+    mLastQueueBufferFence = state->acquireFence;
+    mLastQueuedCrop = item.mCrop;
+    mLastQueuedTransform = item.mTransform;
 
-        mLastQueueBufferFence = std::move(acquireFence);
-        mLastQueuedCrop = item.mCrop;
-        mLastQueuedTransform = item.mTransform;
-    } // Autolock scope
+    return NO_ERROR;
+}
 
+void BufferQueueProducer::finishQueueBuffer(QueueBufferState* state,
+                                            QueueBufferOutput* output) {
     // It is okay not to clear the GraphicBuffer when the consumer is SurfaceFlinger because
     // it is guaranteed that the BufferQueue is inside SurfaceFlinger's process and
     // there will be no Binder call
     if (!mConsumerIsSurfaceFlinger) {
-        item.mGraphicBuffer.clear();
+        state->item.mGraphicBuffer.clear();
     }
 
     // Update and get FrameEventHistory.
     nsecs_t postedTime = systemTime(SYSTEM_TIME_MONOTONIC);
     NewFrameEventsEntry newFrameEventsEntry = {
-        currentFrameNumber,
+        state->item.mFrameNumber,
         postedTime,
-        requestedPresentTimestamp,
-        std::move(acquireFenceTime)
+        state->requestedPresentTimestamp,
+        std::move(state->acquireFenceTime)
     };
     addAndGetFrameTimestamps(&newFrameEventsEntry,
-            getFrameTimestamps ? &output->frameTimestamps : nullptr);
-
-    // Call back without the main BufferQueue lock held, but with the callback
-    // lock held so we can ensure that callbacks occur in order
-
-    { // scope for the lock
-        std::unique_lock<std::mutex> lock(mCallbackMutex);
-        while (callbackTicket != mCurrentCallbackTicket) {
-            mCallbackCondition.wait(lock);
-        }
-
-        if (frameAvailableListener != nullptr) {
-            frameAvailableListener->onFrameAvailable(item);
-        } else if (frameReplacedListener != nullptr) {
-            frameReplacedListener->onFrameReplaced(item);
-        }
-
-        ++mCurrentCallbackTicket;
-        mCallbackCondition.notify_all();
-    }
-
-    // Wait without lock held
-    if (connectedApi == NATIVE_WINDOW_API_EGL && enableEglCpuThrottling) {
-        // Waiting here allows for two full buffers to be queued but not a
-        // third. In the event that frames take varying time, this makes a
-        // small trade-off in favor of latency rather than throughput.
-        lastQueuedFence->waitForever("Throttling EGL Production");
-    }
-
-    return NO_ERROR;
+            state->getFrameTimestamps ? &output->frameTimestamps : nullptr);
 }
 
 status_t BufferQueueProducer::cancelBuffer(int slot, const sp<Fence>& fence) {
@@ -1450,6 +1770,8 @@ status_t BufferQueueProducer::connect(const sp<IProducerListener>& listener,
     }
 
     mCore->mAllowAllocation = true;
+    mCore->mHasDequeueRequest = false;
+    mCore->mPreallocator = this;
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
     mCore->mAdditionalOptions.clear();
 #endif
@@ -1720,6 +2042,137 @@ void BufferQueueProducer::allocateBuffers(uint32_t width, uint32_t height,
     }
 }
 
+void BufferQueueProducer::preallocateBuffers() {
+    ATRACE_CALL();
+
+    // Ends the pass, and wakes up a dequeueBuffer waiting for the buffers
+    // that are not going to be replaced anymore.
+    const auto finishLocked = [this] {
+        mCore->mPreallocating = false;
+        mCore->mPendingPreallocationCount = 0;
+        mCore->mIsAllocatingCondition.notify_all();
+        VALIDATE_CONSISTENCY();
+    };
+
+    while (true) {
+        DequeueBufferState state;
+        std::vector<int32_t> discarded;
+        sp<IProducerListener> listener;
+        { // Autolock scope
+            std::unique_lock<std::mutex> lock(mCore->mMutex);
+            // Not waitWhileAllocatingLocked, since this thread waiting doesn't
+            // stall the producer.
+            while (mCore->mIsAllocating) {
+                mCore->mIsAllocatingCondition.wait(lock);
+            }
+
+            const bool predicted = mCore->getPredictedBufferLocked(&state.width, &state.height,
+                                                                   &state.format, &state.usage);
+            if (!predicted || !mCore->mAllowAllocation || mCore->mIsAbandoned ||
+                mCore->mConnectedApi == BufferQueueCore::NO_CONNECTED_API ||
+                mCore->mSharedBufferMode) {
+                finishLocked();
+                return;
+            }
+
+            // Free the stale buffers up front, so that a dequeueBuffer racing
+            // with this pass waits for their replacements instead of
+            // reallocating a stale one itself.
+            for (int slot : mCore->mFreeBuffers) {
+                if (mCore->isSlotStaleLocked(slot)) {
+                    discarded.push_back(slot);
+                }
+            }
+            for (int32_t slot : discarded) {
+                mCore->mFreeBuffers.remove(slot);
+                mCore->clearBufferSlotLocked(slot);
+                mCore->mFreeSlots.insert(slot);
+            }
+            listener = mCore->mConnectedProducerListener;
+            mCore->mPendingPreallocationCount += discarded.size();
+
+            if (mCore->mPendingPreallocationCount == 0 || mCore->mFreeSlots.empty()) {
+                finishLocked();
+                return;
+            }
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+            state.allocOptions = mCore->mAdditionalOptions;
+            state.allocOptionsGenId = mCore->mAdditionalOptionsGenerationId;
+#endif
+            mCore->mIsAllocating = true;
+        } // Autolock scope
+
+        // Call back without lock held
+        if (!discarded.empty() && listener != nullptr) {
+            listener->onBuffersDiscarded(discarded);
+        }
+
+        BQ_LOGV("preallocateBuffers: allocating %u x %u, format %d, usage %#" PRIx64,
+                state.width, state.height, state.format, state.usage);
+        sp<GraphicBuffer> graphicBuffer = allocateDequeuedBuffer(state);
+
+        { // Autolock scope
+            std::unique_lock<std::mutex> lock(mCore->mMutex);
+            mCore->mIsAllocating = false;
+            mCore->mIsAllocatingCondition.notify_all();
+
+            if (graphicBuffer->initCheck() != NO_ERROR) {
+                BQ_LOGE("preallocateBuffers: failed to allocate buffer (%u x %u, format %d, "
+                        "usage %#" PRIx64 ")",
+                        state.width, state.height, state.format, state.usage);
+                finishLocked();
+                return;
+            }
+
+            // Drop the buffer if the predicted one changed while allocating,
+            // and allocate the new one instead on the next iteration.
+            uint32_t width;
+            uint32_t height;
+            PixelFormat format;
+            uint64_t usage;
+            bool obsolete = !mCore->getPredictedBufferLocked(&width, &height, &format, &usage) ||
+                    graphicBuffer->needsReallocation(width, height, format, BQ_LAYER_COUNT,
+                                                     usage);
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+            obsolete |= state.allocOptionsGenId != mCore->mAdditionalOptionsGenerationId;
+#endif
+            if (obsolete) {
+                BQ_LOGV("preallocateBuffers: request changed while allocating. Retrying.");
+                continue;
+            }
+
+            mCore->mPendingPreallocationCount--;
+            if (mCore->mFreeSlots.empty()) {
+                // The slot was taken while allocating, by a buffer that was
+                // attached or allocated elsewhere.
+                BQ_LOGV("preallocateBuffers: a slot was occupied while "
+                        "allocating. Dropping allocated buffer.");
+                continue;
+            }
+
+            const int slot = mCore->mFreeSlots.takeFirst();
+            mCore->clearBufferSlotLocked(slot);
+            graphicBuffer->setGenerationNumber(mCore->mGenerationNumber);
+            mSlots[slot].mGraphicBuffer = graphicBuffer;
+            mSlots[slot].mFence = Fence::NO_FENCE;
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
+            mSlots[slot].mAdditionalOptionsGenerationId = state.allocOptionsGenId;
+#endif
+            mCore->mFreeBuffers.push_front(slot);
+            mCore->mPreallocatedBufferCount++;
+            BQ_LOGV("preallocateBuffers: allocated a new buffer in slot %d", slot);
+            VALIDATE_CONSISTENCY();
+
+            // If dequeue is waiting for the allocation, release the lock until
+            // it's not waiting anymore so it can use the buffer just allocated.
+            while (mDequeueWaitingForAllocation) {
+                mDequeueWaitingForAllocationCondition.wait(lock);
+            }
+        } // Autolock scope
+    }
+}
+
 status_t BufferQueueProducer::allowAllocation(bool allow) {
     ATRACE_CALL();
     BQ_LOGV("allowAllocation: %s", allow ? "true" : "false");
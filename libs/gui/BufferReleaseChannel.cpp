@@ -67,6 +67,35 @@ inline constexpr T to64(const uint32_t lo, const uint32_t hi) {
     return static_cast<T>(static_cast<uint64_t>(hi) << 32 | lo);
 }
 
+// Unflattens a message received with recvmsg or recvmmsg.
+status_t unflattenMessage(msghdr& msg, BufferReleaseChannel::Message& outMessage) {
+    if (msg.msg_iovlen != 1) {
+        ALOGE("Error reading release fence from socket: bad data length");
+        return UNKNOWN_ERROR;
+    }
+
+    if (msg.msg_controllen % sizeof(int) != 0) {
+        ALOGE("Error reading release fence from socket: bad fd length");
+        return UNKNOWN_ERROR;
+    }
+
+    size_t dataLen = msg.msg_iov->iov_len;
+    const void* data = static_cast<const void*>(msg.msg_iov->iov_base);
+    if (!data) {
+        ALOGE("Error reading release fence from socket: no buffer data");
+        return UNKNOWN_ERROR;
+    }
+
+    size_t fdCount = 0;
+    const int* fdData = nullptr;
+    if (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg)) {
+        fdData = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+        fdCount = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    }
+
+    return outMessage.unflatten(data, dataLen, fdData, fdCount);
+}
+
 } // namespace
 
 size_t BufferReleaseChannel::Message::getPodSize() const {
@@ -164,31 +193,7 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
         return UNKNOWN_ERROR;
     }
 
-    if (msg.msg_iovlen != 1) {
-        ALOGE("Error reading release fence from socket: bad data length");
-        return UNKNOWN_ERROR;
-    }
-
-    if (msg.msg_controllen % sizeof(int) != 0) {
-        ALOGE("Error reading release fence from socket: bad fd length");
-        return UNKNOWN_ERROR;
-    }
-
-    size_t dataLen = msg.msg_iov->iov_len;
-    const void* data = static_cast<const void*>(msg.msg_iov->iov_base);
-    if (!data) {
-        ALOGE("Error reading release fence from socket: no buffer data");
-        return UNKNOWN_ERROR;
-    }
-
-    size_t fdCount = 0;
-    const int* fdData = nullptr;
-    if (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg)) {
-        fdData = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
-        fdCount = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
-    }
-
-    if (status_t err = message.unflatten(data, dataLen, fdData, fdCount); err != OK) {
+    if (status_t err = unflattenMessage(msg, message); err != OK) {
         return err;
     }
 
@@ -199,6 +204,68 @@ status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFence(
     return OK;
 }
 
+status_t BufferReleaseChannel::ConsumerEndpoint::readReleaseFences(
+        std::vector<Message>& outMessages) {
+    std::lock_guard lock{mMutex};
+    const size_t messageSize = Message().getFlattenedSize();
+    mFlattenedBuffer.resize(messageSize * kMaxMessagesPerRead);
+    std::array<std::array<uint8_t, CMSG_SPACE(sizeof(int))>, kMaxMessagesPerRead>
+            controlMessageBuffers;
+    std::array<iovec, kMaxMessagesPerRead> iovs;
+    std::array<mmsghdr, kMaxMessagesPerRead> msgs;
+
+    bool readAny = false;
+    status_t error = OK;
+    while (true) {
+        for (size_t i = 0; i < kMaxMessagesPerRead; i++) {
+            controlMessageBuffers[i] = {};
+            iovs[i] = {
+                    .iov_base = mFlattenedBuffer.data() + i * messageSize,
+                    .iov_len = messageSize,
+            };
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = controlMessageBuffers[i].data();
+            msgs[i].msg_hdr.msg_controllen = controlMessageBuffers[i].size();
+        }
+
+        int count;
+        do {
+            count = recvmmsg(mFd, msgs.data(), kMaxMessagesPerRead, MSG_DONTWAIT, nullptr);
+        } while (count == -1 && errno == EINTR);
+        if (count == -1) {
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                break;
+            }
+            ALOGE("Error reading release fences from socket: error %d (%s)", errno,
+                  strerror(errno));
+            return UNKNOWN_ERROR;
+        }
+
+        // Unflatten every message even after an error, so that the fences of the following
+        // messages are owned and closed.
+        for (int i = 0; i < count; i++) {
+            Message message;
+            if (status_t err = unflattenMessage(msgs[i].msg_hdr, message); err != OK) {
+                error = err;
+                continue;
+            }
+            outMessages.push_back(std::move(message));
+            readAny = true;
+        }
+
+        if (static_cast<size_t>(count) < kMaxMessagesPerRead) {
+            break;
+        }
+    }
+
+    if (error != OK) {
+        return error;
+    }
+    return readAny ? OK : WOULD_BLOCK;
+}
+
 status_t BufferReleaseChannel::ProducerEndpoint::writeReleaseFence(
         const ReleaseCallbackId& callbackId, const sp<Fence>& fence,
         uint32_t maxAcquiredBufferCount) {
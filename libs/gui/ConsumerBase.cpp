@@ -217,6 +217,28 @@ void ConsumerBase::onFrameAvailable(const BufferItem& item) {
     }
 }
 
+void ConsumerBase::onFramesAvailable(const std::vector<BufferItem>& items) {
+    CB_LOGV("onFramesAvailable");
+
+    sp<FrameAvailableListener> listener;
+    { // scope for the lock
+        Mutex::Autolock lock(mFrameAvailableMutex);
+        listener = mFrameAvailableListener.promote();
+    }
+
+    if (listener != nullptr) {
+        CB_LOGV("actually calling onFramesAvailable");
+        listener->onFramesAvailable(items);
+    }
+}
+
+void ConsumerBase::FrameAvailableListener::onFramesAvailable(
+        const std::vector<BufferItem>& items) {
+    for (const BufferItem& item : items) {
+        onFrameAvailable(item);
+    }
+}
+
 void ConsumerBase::onFrameReplaced(const BufferItem &item) {
     CB_LOGV("onFrameReplaced");
 
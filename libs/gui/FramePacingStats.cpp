@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include <gui/FramePacingStats.h>
+
+namespace android::gui {
+
+FramePacingStats::FramePacingStats(size_t capacity) : mRecords(std::max<size_t>(capacity, 1)) {}
+
+FramePacingStats::Record* FramePacingStats::find(uint64_t frameNumber) {
+    Record& record = mRecords[frameNumber % mRecords.size()];
+    return record.frameNumber == frameNumber ? &record : nullptr;
+}
+
+void FramePacingStats::onFrameQueued(uint64_t frameNumber, nsecs_t queueTime,
+                                     nsecs_t dequeueWait) {
+    if (frameNumber == 0) {
+        return;
+    }
+    mRecords[frameNumber % mRecords.size()] = {.frameNumber = frameNumber,
+                                               .dequeueWait = dequeueWait,
+                                               .queueTime = queueTime};
+}
+
+void FramePacingStats::onFrameAcquired(uint64_t frameNumber, nsecs_t acquireTime) {
+    if (Record* record = find(frameNumber)) {
+        record->acquireTime = acquireTime;
+    }
+}
+
+void FramePacingStats::onFrameApplied(uint64_t frameNumber, nsecs_t applyTime, bool stuffed) {
+    if (Record* record = find(frameNumber)) {
+        record->applyTime = applyTime;
+        record->stuffed = stuffed;
+    }
+}
+
+void FramePacingStats::onFrameLatched(uint64_t frameNumber, nsecs_t latchTime) {
+    if (Record* record = find(frameNumber)) {
+        record->latchTime = latchTime;
+    }
+}
+
+void FramePacingStats::onFrameReleased(uint64_t frameNumber, nsecs_t releaseTime) {
+    if (Record* record = find(frameNumber)) {
+        record->releaseTime = releaseTime;
+    }
+}
+
+void FramePacingStats::clear() {
+    std::fill(mRecords.begin(), mRecords.end(), Record{});
+}
+
+nsecs_t FramePacingStats::getMetric(const Record& record, Metric metric) {
+    const auto delta = [](nsecs_t start, nsecs_t end) -> nsecs_t {
+        return start < 0 || end < start ? -1 : end - start;
+    };
+
+    switch (metric) {
+        case Metric::DequeueWait:
+            return record.dequeueWait;
+        case Metric::QueueToAcquire:
+            return delta(record.queueTime, record.acquireTime);
+        case Metric::AcquireToApply:
+            return delta(record.acquireTime, record.applyTime);
+        case Metric::ApplyToLatch:
+            return delta(record.applyTime, record.latchTime);
+        case Metric::LatchToRelease:
+            return delta(record.latchTime, record.releaseTime);
+    }
+    return -1;
+}
+
+FramePacingStats::Summary FramePacingStats::getSummary() const {
+    Summary summary;
+    std::vector<nsecs_t> values;
+    values.reserve(mRecords.size());
+
+    for (size_t i = 0; i < kMetricCount; i++) {
+        const auto metric = static_cast<Metric>(i);
+        values.clear();
+        for (const Record& record : mRecords) {
+            if (record.frameNumber == 0) {
+                continue;
+            }
+            if (const nsecs_t value = getMetric(record, metric); value >= 0) {
+                values.push_back(value);
+            }
+        }
+        if (values.empty()) {
+            continue;
+        }
+
+        std::sort(values.begin(), values.end());
+        const auto percentile = [&values](size_t p) {
+            return values[std::min(values.size() - 1, values.size() * p / 100)];
+        };
+        summary.metrics[i] = {.count = values.size(),
+                              .p50 = percentile(50),
+                              .p90 = percentile(90),
+                              .p99 = percentile(99),
+                              .max = values.back()};
+    }
+
+    for (const Record& record : mRecords) {
+        if (record.frameNumber != 0) {
+            summary.frameCount++;
+            summary.stuffedFrameCount += record.stuffed ? 1 : 0;
+        }
+    }
+    return summary;
+}
+
+const char* FramePacingStats::toString(Metric metric) {
+    switch (metric) {
+        case Metric::DequeueWait:
+            return "DequeueWait";
+        case Metric::QueueToAcquire:
+            return "QueueToAcquire";
+        case Metric::AcquireToApply:
+            return "AcquireToApply";
+        case Metric::ApplyToLatch:
+            return "ApplyToLatch";
+        case Metric::LatchToRelease:
+            return "LatchToRelease";
+    }
+    return "Unknown";
+}
+
+} // namespace android::gui
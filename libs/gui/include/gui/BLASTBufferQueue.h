@@ -17,11 +17,15 @@
 #ifndef ANDROID_GUI_BLAST_BUFFER_QUEUE_H
 #define ANDROID_GUI_BLAST_BUFFER_QUEUE_H
 
+#include <array>
+#include <atomic>
 #include <optional>
 #include <queue>
 
 #include <gui/BufferItem.h>
 #include <gui/BufferItemConsumer.h>
+#include <gui/BufferQueueDefs.h>
+#include <gui/FramePacingStats.h>
 #include <gui/IGraphicBufferConsumer.h>
 #include <gui/IGraphicBufferProducer.h>
 #include <gui/SurfaceComposerClient.h>
@@ -101,6 +105,7 @@ public:
 
     void onFrameReplaced(const BufferItem& item) override;
     void onFrameAvailable(const BufferItem& item) override;
+    void onFramesAvailable(const std::vector<BufferItem>& items) override;
     void onFrameDequeued(const uint64_t) override;
     void onFrameCancelled(const uint64_t) override;
 
@@ -144,6 +149,12 @@ public:
      */
     void setTransactionHangCallback(std::function<void(const std::string&)> callback);
     void setApplyToken(sp<IBinder>);
+
+    // Returns percentiles of the time the most recent frames spent in each stage between dequeue
+    // and release, and how many of them were stuffed. This is meant to spot pacing problems
+    // without capturing a trace.
+    gui::FramePacingStats::Summary getFramePacingStats() const;
+
     virtual ~BLASTBufferQueue();
 
     void onFirstRef() override;
@@ -174,6 +185,8 @@ private:
 
     void flushShadowQueue() REQUIRES(mMutex);
     void acquireAndReleaseBuffer() REQUIRES(mMutex);
+    // Returns how long the producer waited to dequeue the slot of item, and resets it.
+    nsecs_t takeDequeueWait(const BufferItem& item);
     void releaseBuffer(const ReleaseCallbackId& callbackId, const sp<Fence>& releaseFence)
             REQUIRES(mMutex);
 
@@ -324,6 +337,15 @@ private:
 
     std::unordered_set<uint64_t> mSyncedFrameNumbers GUARDED_BY(mMutex);
 
+    gui::FramePacingStats mFramePacingStats GUARDED_BY(mMutex);
+    // The last frame applied, or handed to a sync transaction, and the last frame latched by
+    // SurfaceFlinger. A frame applied while the former is ahead of the latter is stuffed.
+    uint64_t mPacingLastAppliedFrameNumber GUARDED_BY(mMutex) = 0;
+    uint64_t mPacingLastLatchedFrameNumber GUARDED_BY(mMutex) = 0;
+    // Time the producer was blocked in dequeueBuffer for the buffer now in each slot, or -1. Set
+    // by BBQBufferQueueProducer without mMutex, and consumed when the buffer is queued.
+    std::array<std::atomic<nsecs_t>, BufferQueueDefs::NUM_BUFFER_SLOTS> mDequeueWaits;
+
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BUFFER_RELEASE_CHANNEL)
     // BufferReleaseChannel is used to communicate buffer releases from SurfaceFlinger to the
     // client.
@@ -331,8 +353,15 @@ private:
     std::shared_ptr<gui::BufferReleaseChannel::ProducerEndpoint> mBufferReleaseProducer;
 
     void updateBufferReleaseProducer() REQUIRES(mMutex);
+
+    // Reads all the releases pending in mBufferReleaseConsumer and applies them with
+    // releaseBufferCallbacks.
     void drainBufferReleaseConsumer();
 
+    // Applies a batch of releases read from the buffer release channel, taking mMutex once for
+    // the whole batch.
+    void releaseBufferCallbacks(const std::vector<gui::BufferReleaseChannel::Message>& releases);
+
     // BufferReleaseReader is used to do blocking but interruptible reads from the buffer
     // release channel. To implement this, BufferReleaseReader owns an epoll file descriptor that
     // is configured to wake up when either the BufferReleaseReader::ConsumerEndpoint or an eventfd
@@ -345,15 +374,16 @@ private:
         BufferReleaseReader(const BufferReleaseReader&) = delete;
         BufferReleaseReader& operator=(const BufferReleaseReader&) = delete;
 
-        // Block until we can read a buffer release message.
+        // Block until we can read buffer release messages, then read all the pending ones.
         //
         // Returns:
-        // * OK if a ReleaseCallbackId and Fence were successfully read.
+        // * OK if at least one message was successfully read.
         // * WOULD_BLOCK if the blocking read was interrupted by interruptBlockingRead.
         // * TIMED_OUT if the blocking read timed out.
-        // * UNKNOWN_ERROR if something went wrong.
-        status_t readBlocking(ReleaseCallbackId& outId, sp<Fence>& outReleaseFence,
-                              uint32_t& outMaxAcquiredBufferCount, nsecs_t timeout);
+        // * UNKNOWN_ERROR if something went wrong. Messages read before the error are still
+        //   appended to outMessages.
+        status_t readBlocking(std::vector<gui::BufferReleaseChannel::Message>& outMessages,
+                              nsecs_t timeout);
 
         void interruptBlockingRead();
         void clearInterrupts();
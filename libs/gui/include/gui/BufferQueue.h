@@ -63,6 +63,7 @@ public:
         ~ProxyConsumerListener() override;
         void onDisconnect() override;
         void onFrameAvailable(const BufferItem& item) override;
+        void onFramesAvailable(const std::vector<BufferItem>& items) override;
         void onFrameReplaced(const BufferItem& item) override;
         void onBuffersReleased() override;
         void onSidebandStreamChanged() override;
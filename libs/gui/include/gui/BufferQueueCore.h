@@ -22,6 +22,7 @@
 #include <gui/AdditionalOptions.h>
 #include <gui/BufferItem.h>
 #include <gui/BufferQueueDefs.h>
+#include <gui/BufferQueueSlots.h>
 #include <gui/BufferSlot.h>
 #include <gui/OccupancyTracker.h>
 
@@ -29,13 +30,14 @@
 #include <utils/RefBase.h>
 #include <utils/String8.h>
 #include <utils/StrongPointer.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 #include <utils/Vector.h>
 
-#include <list>
-#include <set>
 #include <mutex>
 #include <condition_variable>
+#include <memory>
+#include <thread>
 
 #define ATRACE_BUFFER_INDEX(index)                                                        \
     do {                                                                                  \
@@ -48,6 +50,7 @@
 
 namespace android {
 
+class BufferQueueProducer;
 class IConsumerListener;
 class IProducerListener;
 
@@ -137,8 +140,37 @@ private:
     // away slots. Returns false if the request can't be met.
     bool adjustAvailableSlotsLocked(int delta);
 
-    // waitWhileAllocatingLocked blocks until mIsAllocating is false.
-    void waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock) const;
+    // waitWhileAllocatingLocked blocks until mIsAllocating is false. The time spent blocked is
+    // added to mAllocationWaitTime.
+    void waitWhileAllocatingLocked(std::unique_lock<std::mutex>& lock);
+
+    // isFreeBufferPendingLocked returns true if there is no free buffer, but one is being
+    // allocated, or the preallocation pass has discarded buffers that it is going to replace.
+    bool isFreeBufferPendingLocked() const;
+
+    // waitForFreeBufferLocked blocks while isFreeBufferPendingLocked is true. The time spent
+    // blocked is added to mAllocationWaitTime.
+    void waitForFreeBufferLocked(std::unique_lock<std::mutex>& lock);
+
+    // getPredictedBufferLocked resolves the buffer that the next dequeueBuffer is expected to
+    // request, from the last request of the producer and the current defaults of the consumer.
+    // Returns false if the producer hasn't dequeued a buffer since it connected.
+    bool getPredictedBufferLocked(uint32_t* outWidth, uint32_t* outHeight, PixelFormat* outFormat,
+                                  uint64_t* outUsage) const;
+
+    // isSlotStaleLocked returns true if the buffer in the given slot would have to be reallocated
+    // by the next dequeueBuffer.
+    bool isSlotStaleLocked(int slot) const;
+
+    // requestPreallocationLocked asks the preallocation thread to run a pass of the connected
+    // producer that replaces the free buffers which the next dequeueBuffer would otherwise have to
+    // reallocate. It does nothing if a pass is already running, since that pass checks the buffers
+    // again before each allocation. The thread is started by the first request.
+    void requestPreallocationLocked();
+
+    // stopPreallocationThread stops the preallocation thread and waits for the pass it runs to
+    // return. It must be called without mMutex held, once the BufferQueue is abandoned.
+    void stopPreallocationThread();
 
 #if DEBUG_ONLY_CODE
     // validateConsistencyLocked ensures that the free lists are in sync with
@@ -216,18 +248,18 @@ private:
 
     // mFreeSlots contains all of the slots which are FREE and do not currently
     // have a buffer attached.
-    std::set<int> mFreeSlots;
+    BufferQueueDefs::SlotSet mFreeSlots;
 
     // mFreeBuffers contains all of the slots which are FREE and currently have
-    // a buffer attached.
-    std::list<int> mFreeBuffers;
+    // a buffer attached, in the order in which they were freed.
+    BufferQueueDefs::SlotQueue mFreeBuffers;
 
     // mUnusedSlots contains all slots that are currently unused. They should be
     // free and not have a buffer attached.
-    std::list<int> mUnusedSlots;
+    BufferQueueDefs::SlotQueue mUnusedSlots;
 
     // mActiveBuffers contains all slots which have a non-FREE buffer attached.
-    std::set<int> mActiveBuffers;
+    BufferQueueDefs::SlotSet mActiveBuffers;
 
     // mDequeueCondition is a condition variable used for dequeueBuffer in
     // synchronous mode.
@@ -372,6 +404,40 @@ private:
     // will eventually be released or acquired by the consumer.
     bool mAllowExtraAcquire = false;
 
+    // The width, height, format and usage of the last dequeueBuffer call, as requested by the
+    // producer. Zero values are resolved to the current defaults when predicting the next request.
+    // mHasDequeueRequest is false until the connected producer has dequeued a buffer.
+    bool mHasDequeueRequest = false;
+    uint32_t mLastDequeueWidth = 0;
+    uint32_t mLastDequeueHeight = 0;
+    PixelFormat mLastDequeueFormat = PIXEL_FORMAT_UNKNOWN;
+    uint64_t mLastDequeueUsage = 0;
+
+    // mPreallocator is the connected producer, which runs the preallocation passes started by
+    // requestPreallocationLocked. mPreallocating is true while a pass is requested or running.
+    // mPendingPreallocationCount is the number of discarded buffers that the pass still has to
+    // replace, including the one being allocated. A dequeueBuffer that finds no free buffer waits
+    // for them instead of allocating one itself.
+    wp<BufferQueueProducer> mPreallocator;
+    bool mPreallocating = false;
+    size_t mPendingPreallocationCount = 0;
+
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_PREALLOCATE_BUFFERS)
+    // The state shared with the preallocation thread, which keeps it alive in case the last
+    // reference to this BufferQueueCore is dropped on that thread.
+    struct PreallocationRequest;
+    std::shared_ptr<PreallocationRequest> mPreallocationRequest;
+    std::thread mPreallocationThread;
+#endif
+
+    // Allocation statistics reported by dumpState. mSyncAllocationCount counts the buffers that
+    // dequeueBuffer allocated on the thread of the producer, mPreallocatedBufferCount the buffers
+    // that were allocated in the background instead, and mAllocationWaitTime the time spent in
+    // waitWhileAllocatingLocked.
+    uint64_t mSyncAllocationCount = 0;
+    uint64_t mPreallocatedBufferCount = 0;
+    nsecs_t mAllocationWaitTime = 0;
+
 #if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_EXTENDEDALLOCATE)
     // Additional options to pass when allocating GraphicBuffers.
     // GenerationID changes when the options change, indicating reallocation is required
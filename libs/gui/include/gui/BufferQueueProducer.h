@@ -35,6 +35,7 @@ class BufferQueueProducer : public BnGraphicBufferProducer {
 #endif
 public:
     friend class BufferQueue; // Needed to access binderDied
+    friend class BufferQueueCore; // Needed to access preallocateBuffers
 
     explicit BufferQueueProducer(const sp<BufferQueueCore>& core,
                                  bool consumerIsSurfaceFlinger = false);
@@ -132,6 +133,24 @@ public:
     // window.h (e.g. NATIVE_WINDOW_FORMAT).
     virtual int query(int what, int* outValue);
 
+    // See IGraphicBufferProducer::requestBuffers. The whole batch is handled
+    // under a single acquisition of the BufferQueue lock.
+    status_t requestBuffers(const std::vector<int32_t>& slots,
+                            std::vector<RequestBufferOutput>* outputs) override;
+
+    // See IGraphicBufferProducer::dequeueBuffers. The slots of the batch are
+    // dequeued under a single acquisition of the BufferQueue lock, and the
+    // buffers that need to be reallocated are allocated once it is released.
+    status_t dequeueBuffers(const std::vector<DequeueBufferInput>& inputs,
+                            std::vector<DequeueBufferOutput>* outputs) override;
+
+    // See IGraphicBufferProducer::queueBuffers. The batch is queued under a
+    // single acquisition of the BufferQueue lock, waiting dequeuers are woken
+    // up once, and the frames that became available are passed to the
+    // consumer in a single onFramesAvailable call.
+    status_t queueBuffers(const std::vector<QueueBufferInput>& inputs,
+                          std::vector<QueueBufferOutput>* outputs) override;
+
     // connect attempts to connect a producer API to the BufferQueue.  This
     // must be called before any other IGraphicBufferProducer methods are
     // called except for getAllocator.  A consumer must already be connected.
@@ -253,6 +272,53 @@ private:
     status_t waitForFreeSlotThenRelock(FreeSlotCaller caller, std::unique_lock<std::mutex>& lock,
             int* found) const;
 
+    // State carried by a dequeue or queue operation from the part done under
+    // mCore->mMutex to the part done after it is released. Both are defined in
+    // BufferQueueProducer.cpp.
+    struct DequeueBufferState;
+    struct QueueBufferState;
+
+    // The checks and bookkeeping of requestBuffer. Must be called with
+    // mCore->mMutex held.
+    status_t requestBufferLocked(int slot, sp<GraphicBuffer>* buf);
+
+    // Waits for a free slot for the buffer described by state and dequeues it.
+    // If waitForAllocation is true, first waits for any allocation in progress
+    // to finish. Returns the dequeueBuffer flags in state on success.
+    status_t dequeueSlotLocked(std::unique_lock<std::mutex>& lock, bool waitForAllocation,
+                               DequeueBufferState* state);
+
+    // Allocates the buffer of a slot dequeued with BUFFER_NEEDS_REALLOCATION.
+    // Must be called without mCore->mMutex held.
+    sp<GraphicBuffer> allocateDequeuedBuffer(const DequeueBufferState& state) const;
+
+    // Stores the buffer returned by allocateDequeuedBuffer in its slot, or
+    // frees the slot if the allocation failed or the BufferQueue was abandoned.
+    status_t setAllocatedBufferLocked(const sp<GraphicBuffer>& graphicBuffer,
+                                      DequeueBufferState* state);
+
+    // Notifies the consumer of the dequeue and waits for the EGL fence of the
+    // slot, without mCore->mMutex held. Returns the dequeueBuffer result.
+    status_t finishDequeue(const sp<IConsumerListener>& listener, DequeueBufferState* state,
+                           uint64_t* outBufferAge, FrameEventHistoryDelta* outTimestamps);
+
+    // Validates the parts of input that don't depend on the slot.
+    status_t prepareQueueBuffer(const QueueBufferInput& input, QueueBufferState* state) const;
+
+    // Queues the buffer in slot and fills in output. Callers must wake up
+    // waiting dequeuers and take a callback ticket once they are done queueing.
+    status_t queueBufferLocked(int slot, const QueueBufferInput& input, QueueBufferState* state,
+                               QueueBufferOutput* output);
+
+    // Records the frame events of a queued buffer, without mCore->mMutex held.
+    void finishQueueBuffer(QueueBufferState* state, QueueBufferOutput* output);
+
+    // Replaces the free buffers that don't match the buffer predicted for the
+    // next dequeueBuffer, one buffer at a time. Runs on the thread started by
+    // BufferQueueCore::requestPreallocationLocked until there is nothing left
+    // to replace.
+    void preallocateBuffers();
+
     sp<BufferQueueCore> mCore;
 
     // This references mCore->mSlots. Lock mCore->mMutex while accessing.
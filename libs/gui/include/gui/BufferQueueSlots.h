@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include <ui/BufferQueueDefs.h>
+
+namespace android::BufferQueueDefs {
+
+// SlotSet is a set of slot indices backed by a bitmap with one bit per slot, so inserting,
+// removing and taking the lowest slot are constant time and never allocate. It iterates in
+// ascending slot order, like std::set<int>. Iterators walk a snapshot of the set, so the set may be
+// modified while it is being iterated.
+class SlotSet {
+    static_assert(NUM_BUFFER_SLOTS <= 64, "SlotSet needs one bit per slot");
+
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator() = default;
+        explicit const_iterator(uint64_t bits) : mBits(bits) {}
+
+        int operator*() const { return __builtin_ctzll(mBits); }
+        const_iterator& operator++() {
+            mBits &= mBits - 1;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator it = *this;
+            ++*this;
+            return it;
+        }
+        bool operator==(const const_iterator& other) const { return mBits == other.mBits; }
+        bool operator!=(const const_iterator& other) const { return mBits != other.mBits; }
+
+    private:
+        uint64_t mBits = 0;
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return const_iterator(mBits); }
+    const_iterator end() const { return const_iterator(); }
+
+    bool empty() const { return mBits == 0; }
+    size_t size() const { return static_cast<size_t>(__builtin_popcountll(mBits)); }
+    size_t count(int slot) const { return static_cast<size_t>((mBits >> slot) & 1); }
+
+    void insert(int slot) { mBits |= bit(slot); }
+    size_t erase(int slot) {
+        const size_t erased = count(slot);
+        mBits &= ~bit(slot);
+        return erased;
+    }
+    void erase(const_iterator it) { erase(*it); }
+    void clear() { mBits = 0; }
+
+    // Removes and returns the lowest slot. The set must not be empty.
+    int takeFirst() {
+        const int slot = *begin();
+        mBits &= mBits - 1;
+        return slot;
+    }
+
+private:
+    static uint64_t bit(int slot) { return uint64_t{1} << slot; }
+
+    uint64_t mBits = 0;
+};
+
+// SlotQueue is a FIFO of distinct slot indices stored in a fixed ring, so pushing and popping at
+// either end is constant time and never allocates. Membership is tracked in a SlotSet, so count()
+// is constant time as well. Removing a slot from the middle shifts the slots queued after it.
+class SlotQueue {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int*;
+        using reference = int;
+
+        const_iterator() = default;
+        const_iterator(const SlotQueue* queue, size_t index) : mQueue(queue), mIndex(index) {}
+
+        int operator*() const { return mQueue->at(mIndex); }
+        const_iterator& operator++() {
+            ++mIndex;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator it = *this;
+            ++*this;
+            return it;
+        }
+        bool operator==(const const_iterator& other) const { return mIndex == other.mIndex; }
+        bool operator!=(const const_iterator& other) const { return mIndex != other.mIndex; }
+
+    private:
+        const SlotQueue* mQueue = nullptr;
+        size_t mIndex = 0;
+    };
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mSize); }
+
+    bool empty() const { return mSize == 0; }
+    size_t size() const { return mSize; }
+    size_t count(int slot) const { return mMembers.count(slot); }
+
+    int front() const { return at(0); }
+    int back() const { return at(mSize - 1); }
+
+    void push_back(int slot) {
+        mSlots[wrap(mHead + mSize)] = slot;
+        mSize++;
+        mMembers.insert(slot);
+    }
+    void push_front(int slot) {
+        mHead = wrap(mHead + kCapacity - 1);
+        mSlots[mHead] = slot;
+        mSize++;
+        mMembers.insert(slot);
+    }
+    void pop_front() {
+        mMembers.erase(front());
+        mHead = wrap(mHead + 1);
+        mSize--;
+    }
+    void pop_back() {
+        mMembers.erase(back());
+        mSize--;
+    }
+
+    // Removes slot from the queue if it is queued, keeping the order of the other slots.
+    void remove(int slot) {
+        if (!mMembers.erase(slot)) {
+            return;
+        }
+        size_t index = 0;
+        while (at(index) != slot) {
+            index++;
+        }
+        for (; index + 1 < mSize; index++) {
+            mSlots[wrap(mHead + index)] = at(index + 1);
+        }
+        mSize--;
+    }
+
+    void clear() {
+        mHead = 0;
+        mSize = 0;
+        mMembers.clear();
+    }
+
+private:
+    static constexpr size_t kCapacity = NUM_BUFFER_SLOTS;
+
+    static size_t wrap(size_t index) { return index % kCapacity; }
+    int at(size_t index) const { return mSlots[wrap(mHead + index)]; }
+
+    std::array<int, kCapacity> mSlots{};
+    size_t mHead = 0;
+    size_t mSize = 0;
+    SlotSet mMembers;
+};
+
+} // namespace android::BufferQueueDefs
@@ -53,6 +53,8 @@ private:
     };
 
 public:
+    struct Message;
+
     class ConsumerEndpoint : public Endpoint {
     public:
         ConsumerEndpoint(std::string name, android::base::unique_fd fd)
@@ -68,6 +70,20 @@ public:
         status_t readReleaseFence(ReleaseCallbackId& outReleaseCallbackId,
                                   sp<Fence>& outReleaseFence, uint32_t& maxAcquiredBufferCount);
 
+        /**
+         * Reads all the release fences present in the BufferReleaseChannel and appends them to
+         * outMessages, in the order they were written. Up to kMaxMessagesPerRead fences are read
+         * per syscall.
+         *
+         * Returns OK if at least one fence was read.
+         * Returns WOULD_BLOCK if there is no fence present.
+         * Other errors probably indicate that the channel is broken. The fences read before the
+         * error are still appended to outMessages.
+         */
+        status_t readReleaseFences(std::vector<Message>& outMessages);
+
+        static constexpr size_t kMaxMessagesPerRead = 16;
+
     private:
         std::mutex mMutex;
         std::vector<uint8_t> mFlattenedBuffer GUARDED_BY(mMutex);
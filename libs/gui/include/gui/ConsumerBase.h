@@ -43,6 +43,7 @@ public:
     struct FrameAvailableListener : public virtual RefBase {
         // See IConsumerListener::onFrame{Available,Replaced}
         virtual void onFrameAvailable(const BufferItem& item) = 0;
+        virtual void onFramesAvailable(const std::vector<BufferItem>& items);
         virtual void onFrameReplaced(const BufferItem& /* item */) {}
         virtual void onFrameDequeued(const uint64_t){};
         virtual void onFrameCancelled(const uint64_t){};
@@ -172,13 +173,14 @@ protected:
 
     // Implementation of the IConsumerListener interface.  These
     // calls are used to notify the ConsumerBase of asynchronous events in the
-    // BufferQueue.  The onFrameAvailable, onFrameReplaced, and
+    // BufferQueue.  The onFrame{s,}Available, onFrameReplaced, and
     // onBuffersReleased methods should not need to be overridden by derived
     // classes, but if they are overridden the ConsumerBase implementation must
     // be called from the derived class. The ConsumerBase version of
     // onSidebandStreamChanged does nothing and can be overriden by derived
     // classes if they want the notification.
     virtual void onFrameAvailable(const BufferItem& item) override;
+    virtual void onFramesAvailable(const std::vector<BufferItem>& items) override;
     virtual void onFrameReplaced(const BufferItem& item) override;
     virtual void onFrameDequeued(const uint64_t bufferId) override;
     virtual void onFrameCancelled(const uint64_t bufferId) override;
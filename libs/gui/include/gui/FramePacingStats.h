@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <utils/Timers.h>
+
+namespace android::gui {
+
+// Records when each frame of a BLASTBufferQueue reaches each stage of its pipeline, from the
+// producer's dequeue to the release of the buffer by SurfaceFlinger, in a fixed-size ring indexed
+// by frame number. Recording a stage is a handful of stores, so the stats are always on, and
+// percentiles of the stage latencies are only computed when asked for.
+//
+// Not thread safe: BLASTBufferQueue records and reads the stats under its own lock.
+class FramePacingStats {
+public:
+    enum class Metric : size_t {
+        // Time the producer was blocked in dequeueBuffer for the frame's buffer.
+        DequeueWait,
+        // Time from queueBuffer until BLASTBufferQueue acquired the frame.
+        QueueToAcquire,
+        // Time from acquire until the transaction with the frame was applied, or handed to a sync
+        // transaction.
+        AcquireToApply,
+        // Time from applying the transaction until SurfaceFlinger latched the frame.
+        ApplyToLatch,
+        // Time from latch until the buffer was released back to the BufferQueue.
+        LatchToRelease,
+    };
+    static constexpr size_t kMetricCount = static_cast<size_t>(Metric::LatchToRelease) + 1;
+
+    static constexpr size_t kDefaultCapacity = 128;
+
+    struct Percentiles {
+        // Number of frames in the ring for which the metric is known.
+        size_t count = 0;
+        nsecs_t p50 = 0;
+        nsecs_t p90 = 0;
+        nsecs_t p99 = 0;
+        nsecs_t max = 0;
+    };
+
+    struct Summary {
+        std::array<Percentiles, kMetricCount> metrics;
+        // Number of frames in the ring.
+        size_t frameCount = 0;
+        // Number of frames in the ring that were applied while an earlier frame was still
+        // waiting to be latched, i.e. frames that SurfaceFlinger will present at least one vsync
+        // later than the app intended. See BufferStuffing.md.
+        size_t stuffedFrameCount = 0;
+
+        const Percentiles& operator[](Metric metric) const {
+            return metrics[static_cast<size_t>(metric)];
+        }
+    };
+
+    explicit FramePacingStats(size_t capacity = kDefaultCapacity);
+
+    // Starts the record of a frame, replacing the oldest one in the ring. dequeueWait is -1 if
+    // unknown.
+    void onFrameQueued(uint64_t frameNumber, nsecs_t queueTime, nsecs_t dequeueWait);
+    void onFrameAcquired(uint64_t frameNumber, nsecs_t acquireTime);
+    // stuffed is true if an earlier frame was applied but not latched yet.
+    void onFrameApplied(uint64_t frameNumber, nsecs_t applyTime, bool stuffed);
+    void onFrameLatched(uint64_t frameNumber, nsecs_t latchTime);
+    void onFrameReleased(uint64_t frameNumber, nsecs_t releaseTime);
+
+    // Drops all records, e.g. when a new producer restarts the frame numbers.
+    void clear();
+
+    Summary getSummary() const;
+
+    static const char* toString(Metric);
+
+private:
+    struct Record {
+        // Frame numbers start at 1, so 0 marks an empty record.
+        uint64_t frameNumber = 0;
+        nsecs_t dequeueWait = -1;
+        nsecs_t queueTime = -1;
+        nsecs_t acquireTime = -1;
+        nsecs_t applyTime = -1;
+        nsecs_t latchTime = -1;
+        nsecs_t releaseTime = -1;
+        bool stuffed = false;
+    };
+
+    Record* find(uint64_t frameNumber);
+    static nsecs_t getMetric(const Record&, Metric);
+
+    std::vector<Record> mRecords;
+};
+
+} // namespace android::gui
@@ -23,6 +23,7 @@
 #include <utils/RefBase.h>
 
 #include <cstdint>
+#include <vector>
 
 #include <com_android_graphics_libgui_flags.h>
 
@@ -66,6 +67,14 @@ public:
     // This is called without any lock held and can be called concurrently by multiple threads.
     virtual void onFrameAvailable(const BufferItem& item) = 0; /* Asynchronous */
 
+    // onFramesAvailable is called from queueBuffers once for the frames of a batch that became
+    // available for consumption, in the order they were queued. The default implementation calls
+    // onFrameAvailable for each frame; consumers that can handle the whole batch at once may
+    // override it.
+    //
+    // This is called without any lock held and can be called concurrently by multiple threads.
+    virtual void onFramesAvailable(const std::vector<BufferItem>& items); /* Asynchronous */
+
     // onFrameReplaced is called from queueBuffer if the frame being queued is replacing an existing
     // slot in the queue. Any call to queueBuffer that doesn't call onFrameAvailable will call this
     // callback instead. The item passed to the callback will contain all of the information about
@@ -236,8 +236,12 @@ struct layer_state_t {
     layer_state_t();
 
     void merge(const layer_state_t& other);
+    // Only the fields selected by what are parceled, so that a transaction which moves a few
+    // layers does not carry every property of each layer. Fields that are not selected keep their
+    // default value when read. The parcel starts with kParcelVersion, which must match on read.
     status_t write(Parcel& output) const;
     status_t read(const Parcel& input);
+    static constexpr int32_t kParcelVersion = 2;
     // Compares two layer_state_t structs and returns a set of change flags describing all the
     // states that are different.
     uint64_t diff(const layer_state_t& other) const;
@@ -18,6 +18,7 @@
 
 #include <gui/BLASTBufferQueue.h>
 
+#include <android-base/scopeguard.h>
 #include <android-base/thread_annotations.h>
 #include <android/hardware/graphics/common/1.2/types.h>
 #include <gui/AidlUtil.h>
@@ -43,6 +44,11 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 #include <com_android_graphics_libgui_flags.h>
 
 using namespace std::chrono_literals;
@@ -190,6 +196,10 @@ public:
         mBlastBufferQueueAdapter->setApplyToken(std::move(applyToken));
     }
 
+    gui::FramePacingStats::Summary getFramePacingStats() {
+        return mBlastBufferQueueAdapter->getFramePacingStats();
+    }
+
 private:
     sp<TestBLASTBufferQueue> mBlastBufferQueueAdapter;
 };
@@ -515,6 +525,117 @@ TEST_F(BLASTBufferQueueTest, TripleBuffering) {
     adapter.waitForCallbacks();
 }
 
+TEST_F(BLASTBufferQueueTest, FramePacingStats) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer);
+
+    constexpr int kFrameCount = 10;
+    for (int i = 0; i < kFrameCount; i++) {
+        int slot;
+        sp<Fence> fence;
+        sp<GraphicBuffer> buf;
+        auto ret = igbProducer->dequeueBuffer(&slot, &fence, mDisplayWidth, mDisplayHeight,
+                                              PIXEL_FORMAT_RGBA_8888, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                              nullptr, nullptr);
+        ASSERT_TRUE(ret == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION || ret == NO_ERROR);
+        if (ret == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            ASSERT_EQ(OK, igbProducer->requestBuffer(slot, &buf));
+        }
+
+        IGraphicBufferProducer::QueueBufferOutput qbOutput;
+        IGraphicBufferProducer::QueueBufferInput input(systemTime(), true /* autotimestamp */,
+                                                       HAL_DATASPACE_UNKNOWN,
+                                                       Rect(mDisplayWidth, mDisplayHeight),
+                                                       NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                       Fence::NO_FENCE);
+        ASSERT_EQ(OK, igbProducer->queueBuffer(slot, input, &qbOutput));
+        adapter.waitForCallback(static_cast<int64_t>(qbOutput.frameNumber));
+    }
+    adapter.waitForCallbacks();
+
+    using Metric = gui::FramePacingStats::Metric;
+    const auto stats = adapter.getFramePacingStats();
+    EXPECT_EQ(static_cast<size_t>(kFrameCount), stats.frameCount);
+    EXPECT_EQ(static_cast<size_t>(kFrameCount), stats[Metric::DequeueWait].count);
+    EXPECT_EQ(static_cast<size_t>(kFrameCount), stats[Metric::QueueToAcquire].count);
+    EXPECT_EQ(static_cast<size_t>(kFrameCount), stats[Metric::AcquireToApply].count);
+    // Every frame was latched, since the next one was only queued once the previous one was
+    // presented, and all but the last one were released.
+    EXPECT_EQ(static_cast<size_t>(kFrameCount), stats[Metric::ApplyToLatch].count);
+    EXPECT_EQ(static_cast<size_t>(kFrameCount - 1), stats[Metric::LatchToRelease].count);
+    EXPECT_EQ(0u, stats.stuffedFrameCount);
+}
+
+// Measures how long dequeueBuffer waits for a buffer release while every CPU is busy. The time
+// at which SurfaceFlinger releases a buffer isn't observable from the client, so the wait covers
+// the release-to-dequeue latency plus the time the buffer spends with SurfaceFlinger.
+TEST_F(BLASTBufferQueueTest, DequeueWaitForReleaseUnderLoad) {
+    BLASTBufferQueueHelper adapter(mSurfaceControl, mDisplayWidth, mDisplayHeight);
+    sp<IGraphicBufferProducer> igbProducer;
+    setUpProducer(adapter, igbProducer, 3);
+
+    // One thread per CPU, each busy 90% of the time and stopping on its own after a deadline, so
+    // that the load can't outlive the test if it hangs.
+    std::atomic<bool> stopLoad = false;
+    std::vector<std::thread> load;
+    const auto loadDeadline = std::chrono::steady_clock::now() + 30s;
+    for (unsigned i = 0; i < std::max(1u, std::thread::hardware_concurrency()); i++) {
+        load.emplace_back([&stopLoad, loadDeadline] {
+            while (!stopLoad && std::chrono::steady_clock::now() < loadDeadline) {
+                const auto busyUntil = std::chrono::steady_clock::now() + 9ms;
+                while (std::chrono::steady_clock::now() < busyUntil) {
+                }
+                std::this_thread::sleep_for(1ms);
+            }
+        });
+    }
+    auto stopLoadGuard = base::make_scope_guard([&] {
+        stopLoad = true;
+        for (auto& thread : load) {
+            thread.join();
+        }
+    });
+
+    constexpr int kFrameCount = 240;
+    std::vector<nsecs_t> waits;
+    waits.reserve(kFrameCount);
+    for (int i = 0; i < kFrameCount; i++) {
+        int slot;
+        sp<Fence> fence;
+        sp<GraphicBuffer> buf;
+        const nsecs_t start = systemTime();
+        auto ret = igbProducer->dequeueBuffer(&slot, &fence, mDisplayWidth, mDisplayHeight,
+                                              PIXEL_FORMAT_RGBA_8888, GRALLOC_USAGE_SW_WRITE_OFTEN,
+                                              nullptr, nullptr);
+        waits.push_back(systemTime() - start);
+        ASSERT_TRUE(ret == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION || ret == NO_ERROR);
+        if (ret == IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            ASSERT_EQ(OK, igbProducer->requestBuffer(slot, &buf));
+        }
+
+        IGraphicBufferProducer::QueueBufferOutput qbOutput;
+        IGraphicBufferProducer::QueueBufferInput input(systemTime(), true /* autotimestamp */,
+                                                       HAL_DATASPACE_UNKNOWN,
+                                                       Rect(mDisplayWidth, mDisplayHeight),
+                                                       NATIVE_WINDOW_SCALING_MODE_FREEZE, 0,
+                                                       Fence::NO_FENCE);
+        ASSERT_EQ(OK, igbProducer->queueBuffer(slot, input, &qbOutput));
+    }
+    adapter.waitForCallbacks();
+
+    std::sort(waits.begin(), waits.end());
+    const auto percentileUs = [&waits](size_t percentile) {
+        return std::to_string(ns2us(waits[waits.size() * percentile / 100]));
+    };
+    RecordProperty("dequeueWaitP50Us", percentileUs(50));
+    RecordProperty("dequeueWaitP90Us", percentileUs(90));
+    RecordProperty("dequeueWaitP99Us", percentileUs(99));
+    // The waits depend on the device and how the load is scheduled, so only check that buffers
+    // kept being released.
+    EXPECT_LT(waits[waits.size() * 99 / 100], std::chrono::nanoseconds(1s).count());
+}
+
 class WaitForCommittedCallback {
 public:
     WaitForCommittedCallback() = default;
@@ -149,6 +149,53 @@ class BufferItemConsumerTest : public ::testing::Test {
     sp<GraphicBuffer> mBuffers[BufferQueueDefs::NUM_BUFFER_SLOTS];
 };
 
+struct BatchListener : public ConsumerBase::FrameAvailableListener {
+    void onFrameAvailable(const BufferItem& item) override {
+        mFrameNumbers.push_back(item.mFrameNumber);
+    }
+    void onFramesAvailable(const std::vector<BufferItem>& items) override {
+        mBatches++;
+        FrameAvailableListener::onFramesAvailable(items);
+    }
+
+    int mBatches = 0;
+    std::vector<uint64_t> mFrameNumbers;
+};
+
+// Test that a batch queued through queueBuffers reaches the frame available listener at once.
+TEST_F(BufferItemConsumerTest, ForwardsBatchedFramesToListener) {
+    // Not controlled by the app, so that queued frames aren't droppable.
+    sp<BufferItemConsumer> consumer = new BufferItemConsumer(kUsage, kMaxLockedBuffers, false);
+    sp<BatchListener> listener = sp<BatchListener>::make();
+    consumer->setFrameAvailableListener(listener);
+
+    sp<IGraphicBufferProducer> producer = consumer->getSurface()->getIGraphicBufferProducer();
+    IGraphicBufferProducer::QueueBufferOutput bufferOutput;
+    ASSERT_EQ(NO_ERROR,
+              producer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false,
+                                &bufferOutput));
+    ASSERT_EQ(NO_ERROR, producer->setMaxDequeuedBufferCount(2));
+
+    std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+    for (int i = 0; i < 2; i++) {
+        int slot;
+        sp<Fence> fence;
+        ASSERT_GE(producer->dequeueBuffer(&slot, &fence, kWidth, kHeight, 0, 0, nullptr,
+                                          nullptr),
+                  0);
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(NO_ERROR, producer->requestBuffer(slot, &buffer));
+        queueInputs.emplace_back(0ll, true, HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+                                 NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE, 0, false,
+                                 slot);
+    }
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+    ASSERT_EQ(NO_ERROR, producer->queueBuffers(queueInputs, &queueOutputs));
+
+    EXPECT_EQ(1, listener->mBatches);
+    EXPECT_THAT(listener->mFrameNumbers, testing::ElementsAre(1u, 2u));
+}
+
 // Test that detaching buffer from consumer side triggers onBufferFreed.
 TEST_F(BufferItemConsumerTest, TriggerBufferFreed_DetachBufferFromConsumer) {
     int slot;
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <gui/BufferQueueSlots.h>
+
+namespace android::BufferQueueDefs {
+
+namespace test {
+
+TEST(SlotSetTest, IteratesInAscendingOrder) {
+    SlotSet set;
+    EXPECT_TRUE(set.empty());
+    for (int slot : {63, 5, 0, 17}) {
+        set.insert(slot);
+    }
+    set.insert(5);
+
+    EXPECT_EQ(4u, set.size());
+    EXPECT_EQ(1u, set.count(63));
+    EXPECT_EQ(0u, set.count(62));
+    EXPECT_EQ((std::vector<int>{0, 5, 17, 63}), std::vector<int>(set.begin(), set.end()));
+
+    EXPECT_EQ(0, set.takeFirst());
+    EXPECT_EQ(1u, set.erase(17));
+    EXPECT_EQ(0u, set.erase(17));
+    set.erase(set.begin());
+    EXPECT_EQ((std::vector<int>{63}), std::vector<int>(set.begin(), set.end()));
+}
+
+TEST(SlotSetTest, CanBeModifiedWhileIterating) {
+    SlotSet set;
+    for (int slot = 0; slot < NUM_BUFFER_SLOTS; slot++) {
+        set.insert(slot);
+    }
+
+    int visited = 0;
+    for (int slot : set) {
+        set.erase(slot);
+        visited++;
+    }
+    EXPECT_EQ(NUM_BUFFER_SLOTS, visited);
+    EXPECT_TRUE(set.empty());
+}
+
+TEST(SlotQueueTest, KeepsFifoOrder) {
+    SlotQueue queue;
+    queue.push_back(4);
+    queue.push_back(2);
+    queue.push_front(9);
+    queue.push_back(7);
+
+    EXPECT_EQ(4u, queue.size());
+    EXPECT_EQ(9, queue.front());
+    EXPECT_EQ(7, queue.back());
+    EXPECT_EQ((std::vector<int>{9, 4, 2, 7}), std::vector<int>(queue.begin(), queue.end()));
+
+    queue.remove(4);
+    queue.remove(4);
+    EXPECT_EQ(0u, queue.count(4));
+    EXPECT_EQ((std::vector<int>{9, 2, 7}), std::vector<int>(queue.begin(), queue.end()));
+
+    queue.pop_front();
+    queue.pop_back();
+    EXPECT_EQ((std::vector<int>{2}), std::vector<int>(queue.begin(), queue.end()));
+    EXPECT_EQ(1u, queue.count(2));
+    EXPECT_EQ(0u, queue.count(9));
+}
+
+TEST(SlotQueueTest, WrapsAroundTheRing) {
+    SlotQueue queue;
+    for (int slot = 0; slot < NUM_BUFFER_SLOTS; slot++) {
+        queue.push_back(slot);
+    }
+    // Cycle the slots so that the head of the queue moves all the way around the ring.
+    for (int i = 0; i < NUM_BUFFER_SLOTS + NUM_BUFFER_SLOTS / 2; i++) {
+        const int slot = queue.front();
+        queue.pop_front();
+        queue.push_back(slot);
+    }
+    queue.remove(0);
+
+    std::vector<int> expected;
+    for (int i = 0; i < NUM_BUFFER_SLOTS; i++) {
+        const int slot = (i + NUM_BUFFER_SLOTS / 2) % NUM_BUFFER_SLOTS;
+        if (slot != 0) {
+            expected.push_back(slot);
+        }
+    }
+    EXPECT_EQ(expected, std::vector<int>(queue.begin(), queue.end()));
+
+    queue.clear();
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(0u, queue.count(1));
+}
+
+} // namespace test
+} // namespace android::BufferQueueDefs
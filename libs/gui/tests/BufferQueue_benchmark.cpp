@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures a burst producer that dequeues and queues several buffers at a time, as camera and
+// video decoders do, with the batched BufferQueueProducer methods and with the default
+// IGraphicBufferProducer implementations that call the single-buffer methods in a loop. The
+// consumerWakeups counter reports the consumer notifications per burst. Also measures the single
+// buffer dequeue, queue, acquire and release loop.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gui/BufferItem.h>
+#include <gui/BufferQueue.h>
+#include <gui/IConsumerListener.h>
+#include <gui/IProducerListener.h>
+#include <system/window.h>
+#include <ui/Fence.h>
+#include <ui/GraphicBuffer.h>
+
+namespace android {
+
+namespace {
+
+using DequeueBufferInput = IGraphicBufferProducer::DequeueBufferInput;
+using DequeueBufferOutput = IGraphicBufferProducer::DequeueBufferOutput;
+using QueueBufferInput = IGraphicBufferProducer::QueueBufferInput;
+using QueueBufferOutput = IGraphicBufferProducer::QueueBufferOutput;
+
+struct CountingConsumer : public BnConsumerListener {
+    void onFrameAvailable(const BufferItem&) override { wakeups++; }
+    void onFramesAvailable(const std::vector<BufferItem>&) override { wakeups++; }
+    void onBuffersReleased() override {}
+    void onSidebandStreamChanged() override {}
+
+    size_t wakeups = 0;
+};
+
+class Burst {
+public:
+    explicit Burst(size_t size) : mSize(size) {
+        BufferQueue::createBufferQueue(&mProducer, &mConsumer);
+        mConsumer->consumerConnect(mListener, false);
+        QueueBufferOutput output;
+        mProducer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU, false,
+                           &output);
+        mProducer->setMaxDequeuedBufferCount(static_cast<int>(size));
+        mConsumer->setMaxAcquiredBufferCount(static_cast<int>(size));
+
+        DequeueBufferInput input;
+        input.width = 64;
+        input.height = 64;
+        input.format = HAL_PIXEL_FORMAT_RGBA_8888;
+        input.usage = GRALLOC_USAGE_SW_WRITE_OFTEN;
+        mDequeueInputs.assign(size, input);
+
+        // Allocate the buffers up front so that the benchmark doesn't measure allocations.
+        std::vector<DequeueBufferOutput> dequeueOutputs;
+        mProducer->dequeueBuffers(mDequeueInputs, &dequeueOutputs);
+        std::vector<int32_t> slots;
+        for (const DequeueBufferOutput& dequeueOutput : dequeueOutputs) {
+            slots.push_back(dequeueOutput.slot);
+        }
+        std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+        mProducer->requestBuffers(slots, &requestOutputs);
+        for (int32_t slot : slots) {
+            mProducer->cancelBuffer(slot, Fence::NO_FENCE);
+        }
+    }
+
+    // Dequeues and queues a burst of buffers with either the batched or the looping methods,
+    // then acquires and releases them on the consumer side.
+    void run(bool batched) {
+        std::vector<DequeueBufferOutput> dequeueOutputs;
+        if (batched) {
+            mProducer->dequeueBuffers(mDequeueInputs, &dequeueOutputs);
+        } else {
+            mProducer->IGraphicBufferProducer::dequeueBuffers(mDequeueInputs, &dequeueOutputs);
+        }
+
+        std::vector<QueueBufferInput> queueInputs;
+        queueInputs.reserve(mSize);
+        for (const DequeueBufferOutput& dequeueOutput : dequeueOutputs) {
+            queueInputs.emplace_back(0, true, HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+                                     NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE, 0,
+                                     false, dequeueOutput.slot);
+        }
+        std::vector<QueueBufferOutput> queueOutputs;
+        if (batched) {
+            mProducer->queueBuffers(queueInputs, &queueOutputs);
+        } else {
+            mProducer->IGraphicBufferProducer::queueBuffers(queueInputs, &queueOutputs);
+        }
+
+        for (size_t i = 0; i < mSize; i++) {
+            BufferItem item;
+            mConsumer->acquireBuffer(&item, 0);
+            mConsumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+        }
+    }
+
+    size_t wakeups() const { return mListener->wakeups; }
+
+private:
+    const size_t mSize;
+    sp<IGraphicBufferProducer> mProducer;
+    sp<IGraphicBufferConsumer> mConsumer;
+    const sp<CountingConsumer> mListener = sp<CountingConsumer>::make();
+    std::vector<DequeueBufferInput> mDequeueInputs;
+};
+
+void runBursts(benchmark::State& state, bool batched) {
+    Burst burst(static_cast<size_t>(state.range(0)));
+    const size_t wakeupsBefore = burst.wakeups();
+    for (auto _ : state) {
+        burst.run(batched);
+    }
+    state.counters["consumerWakeups"] =
+            benchmark::Counter(static_cast<double>(burst.wakeups() - wakeupsBefore),
+                               benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void dequeueQueue_batched(benchmark::State& state) {
+    runBursts(state, true);
+}
+BENCHMARK(dequeueQueue_batched)->Arg(1)->Arg(4)->Arg(8);
+
+void dequeueQueue_loop(benchmark::State& state) {
+    runBursts(state, false);
+}
+BENCHMARK(dequeueQueue_loop)->Arg(1)->Arg(4)->Arg(8);
+
+// The steady state of a triple-buffered producer: every iteration dequeues, queues, acquires and
+// releases one buffer, so it measures the slot bookkeeping of BufferQueueCore.
+void dequeueQueueAcquireRelease(benchmark::State& state) {
+    constexpr int kBufferCount = 3;
+
+    sp<IGraphicBufferProducer> producer;
+    sp<IGraphicBufferConsumer> consumer;
+    BufferQueue::createBufferQueue(&producer, &consumer);
+    consumer->consumerConnect(sp<CountingConsumer>::make(), false);
+    QueueBufferOutput output;
+    producer->connect(sp<StubProducerListener>::make(), NATIVE_WINDOW_API_CPU, false, &output);
+    producer->setMaxDequeuedBufferCount(kBufferCount - 1);
+
+    const QueueBufferInput input(0, true, HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+                                 NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE);
+    for (auto _ : state) {
+        int slot = 0;
+        sp<Fence> fence;
+        const status_t result = producer->dequeueBuffer(&slot, &fence, 64, 64,
+                                                        HAL_PIXEL_FORMAT_RGBA_8888,
+                                                        GRALLOC_USAGE_SW_WRITE_OFTEN, nullptr,
+                                                        nullptr);
+        if (result & IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION) {
+            sp<GraphicBuffer> buffer;
+            producer->requestBuffer(slot, &buffer);
+        }
+        producer->queueBuffer(slot, input, &output);
+
+        BufferItem item;
+        consumer->acquireBuffer(&item, 0);
+        consumer->releaseBuffer(item.mSlot, item.mFrameNumber, Fence::NO_FENCE);
+    }
+}
+BENCHMARK(dequeueQueueAcquireRelease);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -43,6 +43,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <future>
 #include <thread>
 
@@ -1135,6 +1136,80 @@ TEST_F(BufferQueueTest, TestDiscardFreeBuffers) {
     }
 }
 
+#if COM_ANDROID_GRAPHICS_LIBGUI_FLAGS(BQ_PREALLOCATE_BUFFERS)
+struct WaitForDiscardListener : public BnProducerListener {
+public:
+    virtual void onBufferReleased() {}
+    virtual bool needsReleaseNotify() { return false; }
+    virtual void onBuffersDiscarded(const std::vector<int32_t>& slots) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDiscardedCount += slots.size();
+        mCondition.notify_all();
+    }
+
+    bool waitForDiscarded(size_t count) {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mCondition.wait_for(lock, 5s, [&] { return mDiscardedCount >= count; });
+    }
+
+private:
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    size_t mDiscardedCount = 0;
+};
+
+TEST_F(BufferQueueTest, PreallocatesBuffersAfterResize) {
+    createBufferQueue();
+    sp<MockConsumer> mc(new MockConsumer);
+    ASSERT_EQ(OK, mConsumer->consumerConnect(mc, false));
+    ASSERT_EQ(OK, mConsumer->setDefaultBufferSize(64, 64));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    sp<WaitForDiscardListener> pl(new WaitForDiscardListener);
+    ASSERT_EQ(OK, mProducer->connect(pl, NATIVE_WINDOW_API_CPU, false, &output));
+    ASSERT_EQ(OK, mProducer->setMaxDequeuedBufferCount(2));
+
+    const auto dumpContains = [this](const char* text) {
+        String8 dumpString;
+        mConsumer->dumpState(String8{}, &dumpString);
+        return dumpString.find(text) != -1;
+    };
+
+    // Allocate two buffers at the initial size
+    int slots[2];
+    sp<Fence> fence;
+    for (int& slot : slots) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, TEST_PRODUCER_USAGE_BITS,
+                                           nullptr, nullptr));
+    }
+    for (int slot : slots) {
+        ASSERT_EQ(OK, mProducer->cancelBuffer(slot, Fence::NO_FENCE));
+    }
+    ASSERT_TRUE(dumpContains("sync-allocations=2 "));
+
+    // Resizing discards both free buffers in the background. Once they are
+    // discarded, dequeueBuffer waits for their replacements.
+    ASSERT_EQ(OK, mConsumer->setDefaultBufferSize(128, 128));
+    ASSERT_TRUE(pl->waitForDiscarded(2));
+
+    // The first frames after the resize get new buffers without allocating them
+    for (int& slot : slots) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION,
+                  mProducer->dequeueBuffer(&slot, &fence, 0, 0, 0, TEST_PRODUCER_USAGE_BITS,
+                                           nullptr, nullptr));
+        sp<GraphicBuffer> buffer;
+        ASSERT_EQ(OK, mProducer->requestBuffer(slot, &buffer));
+        EXPECT_EQ(128u, buffer->getWidth());
+        EXPECT_EQ(128u, buffer->getHeight());
+    }
+    EXPECT_TRUE(dumpContains("sync-allocations=2 "));
+    EXPECT_TRUE(dumpContains("preallocated=2 "));
+
+    // Abandoning the BufferQueue stops the preallocation thread
+    ASSERT_EQ(OK, mConsumer->consumerDisconnect());
+}
+#endif
+
 TEST_F(BufferQueueTest, TestBufferReplacedInQueueBuffer) {
     createBufferQueue();
     sp<MockConsumer> mc(new MockConsumer);
@@ -1180,6 +1255,83 @@ TEST_F(BufferQueueTest, TestBufferReplacedInQueueBuffer) {
     ASSERT_EQ(true, output.bufferReplaced);
 }
 
+struct BatchCountingConsumer : public MockConsumer {
+    void onFrameAvailable(const BufferItem& /* item */) override { mFrameAvailableCount++; }
+    void onFramesAvailable(const std::vector<BufferItem>& items) override {
+        mFramesAvailableCount++;
+        for (const BufferItem& item : items) {
+            mFrameNumbers.push_back(item.mFrameNumber);
+        }
+    }
+
+    int mFrameAvailableCount = 0;
+    int mFramesAvailableCount = 0;
+    std::vector<uint64_t> mFrameNumbers;
+};
+
+TEST_F(BufferQueueTest, BatchedDequeueAndQueueNotifyConsumerOnce) {
+    constexpr size_t kBatchSize = 3;
+
+    createBufferQueue();
+    sp<BatchCountingConsumer> consumer = sp<BatchCountingConsumer>::make();
+    ASSERT_EQ(OK, mConsumer->consumerConnect(consumer, false));
+    IGraphicBufferProducer::QueueBufferOutput output;
+    ASSERT_EQ(OK,
+              mProducer->connect(new StubProducerListener, NATIVE_WINDOW_API_CPU, false, &output));
+    ASSERT_EQ(OK, mProducer->setMaxDequeuedBufferCount(kBatchSize));
+    ASSERT_EQ(OK, mConsumer->setMaxAcquiredBufferCount(kBatchSize));
+
+    IGraphicBufferProducer::DequeueBufferInput dequeueInput;
+    dequeueInput.width = 1;
+    dequeueInput.height = 1;
+    dequeueInput.usage = TEST_PRODUCER_USAGE_BITS;
+    std::vector<IGraphicBufferProducer::DequeueBufferInput> dequeueInputs(kBatchSize,
+                                                                           dequeueInput);
+    std::vector<IGraphicBufferProducer::DequeueBufferOutput> dequeueOutputs;
+    ASSERT_EQ(OK, mProducer->dequeueBuffers(dequeueInputs, &dequeueOutputs));
+    ASSERT_EQ(kBatchSize, dequeueOutputs.size());
+
+    std::vector<int32_t> slots;
+    for (const auto& dequeueOutput : dequeueOutputs) {
+        ASSERT_EQ(IGraphicBufferProducer::BUFFER_NEEDS_REALLOCATION, dequeueOutput.result);
+        EXPECT_EQ(std::find(slots.begin(), slots.end(), dequeueOutput.slot), slots.end());
+        slots.push_back(dequeueOutput.slot);
+    }
+
+    std::vector<IGraphicBufferProducer::RequestBufferOutput> requestOutputs;
+    ASSERT_EQ(OK, mProducer->requestBuffers(slots, &requestOutputs));
+    ASSERT_EQ(kBatchSize, requestOutputs.size());
+    for (const auto& requestOutput : requestOutputs) {
+        ASSERT_EQ(OK, requestOutput.result);
+        EXPECT_NE(nullptr, requestOutput.buffer);
+    }
+
+    std::vector<IGraphicBufferProducer::QueueBufferInput> queueInputs;
+    for (int32_t slot : slots) {
+        queueInputs.emplace_back(0ll, true, HAL_DATASPACE_UNKNOWN, Rect::INVALID_RECT,
+                                 NATIVE_WINDOW_SCALING_MODE_FREEZE, 0, Fence::NO_FENCE, 0, false,
+                                 slot);
+    }
+    std::vector<IGraphicBufferProducer::QueueBufferOutput> queueOutputs;
+    ASSERT_EQ(OK, mProducer->queueBuffers(queueInputs, &queueOutputs));
+    ASSERT_EQ(kBatchSize, queueOutputs.size());
+    for (size_t i = 0; i < kBatchSize; i++) {
+        EXPECT_EQ(OK, queueOutputs[i].result);
+        EXPECT_EQ(i + 1, queueOutputs[i].numPendingBuffers);
+    }
+
+    EXPECT_EQ(0, consumer->mFrameAvailableCount);
+    EXPECT_EQ(1, consumer->mFramesAvailableCount);
+    EXPECT_EQ((std::vector<uint64_t>{1, 2, 3}), consumer->mFrameNumbers);
+
+    for (size_t i = 0; i < kBatchSize; i++) {
+        BufferItem item;
+        ASSERT_EQ(OK, mConsumer->acquireBuffer(&item, 0));
+        EXPECT_EQ(slots[i], item.mSlot);
+        EXPECT_EQ(i + 1, item.mFrameNumber);
+    }
+}
+
 struct BufferDetachedListener : public BnProducerListener {
 public:
     BufferDetachedListener() = default;
@@ -138,6 +138,40 @@ TEST_F(BufferReleaseChannelTest, ProduceAndConsume) {
     }
 }
 
+// Verify that readReleaseFences reads every pending message, across several batches, in the
+// order they were written.
+TEST_F(BufferReleaseChannelTest, ReadReleaseFencesDrainsChannel) {
+    std::vector<BufferReleaseChannel::Message> messages;
+    ASSERT_EQ(WOULD_BLOCK, mConsumer->readReleaseFences(messages));
+    ASSERT_TRUE(messages.empty());
+
+    sp<Fence> fence = sp<Fence>::make(memfd_create("fake-fence-fd", 0));
+    const uint64_t count = BufferReleaseChannel::ConsumerEndpoint::kMaxMessagesPerRead * 2 + 3;
+    for (uint64_t i = 0; i < count; i++) {
+        ReleaseCallbackId producerId{i, i + 1};
+        // Alternate between messages with and without a fence.
+        ASSERT_EQ(OK,
+                  mProducer->writeReleaseFence(producerId, i % 2 ? fence : Fence::NO_FENCE,
+                                               static_cast<uint32_t>(i + 2)));
+    }
+
+    ASSERT_EQ(OK, mConsumer->readReleaseFences(messages));
+    ASSERT_EQ(count, messages.size());
+    for (uint64_t i = 0; i < count; i++) {
+        ReleaseCallbackId expectedId{i, i + 1};
+        ASSERT_EQ(expectedId, messages[i].releaseCallbackId);
+        ASSERT_EQ(i + 2, messages[i].maxAcquiredBufferCount);
+        if (i % 2) {
+            ASSERT_TRUE(is_same_file(fence->get(), messages[i].releaseFence->get()));
+        } else {
+            ASSERT_FALSE(messages[i].releaseFence->isValid());
+        }
+    }
+
+    ASSERT_EQ(WOULD_BLOCK, mConsumer->readReleaseFences(messages));
+    ASSERT_EQ(count, messages.size());
+}
+
 // Verify that BufferReleaseChannel::ConsumerEndpoint's socket can't be written to.
 TEST_F(BufferReleaseChannelTest, ConsumerSocketReadOnly) {
     uint64_t data = 0;
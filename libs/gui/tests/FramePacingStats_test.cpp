@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <gui/FramePacingStats.h>
+
+namespace android::gui {
+
+namespace {
+
+using Metric = FramePacingStats::Metric;
+
+constexpr nsecs_t kMs = 1'000'000;
+
+// Records a frame that takes stageMs in each stage after queue.
+void recordFrame(FramePacingStats& stats, uint64_t frameNumber, nsecs_t stageMs,
+                 bool stuffed = false) {
+    const nsecs_t queueTime = static_cast<nsecs_t>(frameNumber) * 100 * kMs;
+    stats.onFrameQueued(frameNumber, queueTime, stageMs * kMs);
+    stats.onFrameAcquired(frameNumber, queueTime + stageMs * kMs);
+    stats.onFrameApplied(frameNumber, queueTime + 2 * stageMs * kMs, stuffed);
+    stats.onFrameLatched(frameNumber, queueTime + 3 * stageMs * kMs);
+    stats.onFrameReleased(frameNumber, queueTime + 4 * stageMs * kMs);
+}
+
+} // namespace
+
+TEST(FramePacingStatsTest, Percentiles) {
+    FramePacingStats stats(100);
+    for (uint64_t frameNumber = 1; frameNumber <= 100; frameNumber++) {
+        recordFrame(stats, frameNumber, static_cast<nsecs_t>(frameNumber));
+    }
+
+    const auto summary = stats.getSummary();
+    EXPECT_EQ(100u, summary.frameCount);
+    EXPECT_EQ(0u, summary.stuffedFrameCount);
+    for (size_t i = 0; i < FramePacingStats::kMetricCount; i++) {
+        const auto& percentiles = summary.metrics[i];
+        SCOPED_TRACE(FramePacingStats::toString(static_cast<Metric>(i)));
+        EXPECT_EQ(100u, percentiles.count);
+        EXPECT_EQ(51 * kMs, percentiles.p50);
+        EXPECT_EQ(91 * kMs, percentiles.p90);
+        EXPECT_EQ(100 * kMs, percentiles.p99);
+        EXPECT_EQ(100 * kMs, percentiles.max);
+    }
+}
+
+TEST(FramePacingStatsTest, RingKeepsMostRecentFrames) {
+    FramePacingStats stats(4);
+    for (uint64_t frameNumber = 1; frameNumber <= 10; frameNumber++) {
+        recordFrame(stats, frameNumber, frameNumber <= 6 ? 100 : 1, frameNumber == 9);
+    }
+
+    const auto summary = stats.getSummary();
+    EXPECT_EQ(4u, summary.frameCount);
+    EXPECT_EQ(1u, summary.stuffedFrameCount);
+    EXPECT_EQ(1 * kMs, summary[Metric::QueueToAcquire].max);
+}
+
+TEST(FramePacingStatsTest, IgnoresStagesOfEvictedFrames) {
+    FramePacingStats stats(4);
+    stats.onFrameQueued(1, 0, -1);
+    stats.onFrameQueued(5, 10 * kMs, -1);
+    // Frame 1 shares its record with frame 5, which replaced it.
+    stats.onFrameAcquired(1, 20 * kMs);
+    stats.onFrameAcquired(5, 12 * kMs);
+
+    const auto summary = stats.getSummary();
+    EXPECT_EQ(1u, summary.frameCount);
+    EXPECT_EQ(0u, summary[Metric::DequeueWait].count);
+    EXPECT_EQ(1u, summary[Metric::QueueToAcquire].count);
+    EXPECT_EQ(2 * kMs, summary[Metric::QueueToAcquire].max);
+    // Not latched or released yet.
+    EXPECT_EQ(0u, summary[Metric::ApplyToLatch].count);
+    EXPECT_EQ(0u, summary[Metric::LatchToRelease].count);
+}
+
+TEST(FramePacingStatsTest, ClearDropsRecords) {
+    FramePacingStats stats;
+    recordFrame(stats, 1, 2, true /* stuffed */);
+    stats.clear();
+    recordFrame(stats, 1, 2);
+
+    const FramePacingStats::Summary summary = stats.getSummary();
+    EXPECT_EQ(1u, summary.frameCount);
+    EXPECT_EQ(0u, summary.stuffedFrameCount);
+    EXPECT_EQ(1u, summary[Metric::QueueToAcquire].count);
+    EXPECT_EQ(2 * kMs, summary[Metric::QueueToAcquire].p50);
+}
+
+} // namespace android::gui
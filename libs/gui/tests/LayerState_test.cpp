@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android/native_window.h>
+#include <binder/Binder.h>
+#include <binder/Parcel.h>
+
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace test {
+
+TEST(LayerState, ParcellingOnlyWritesChangedFields) {
+    layer_state_t positionOnly;
+    positionOnly.layerId = 3;
+    positionOnly.what = layer_state_t::ePositionChanged;
+    positionOnly.x = 12.f;
+    positionOnly.y = 34.f;
+    // Not selected by what, so not parceled.
+    positionOnly.z = 5;
+    positionOnly.cornerRadius = 8.f;
+
+    Parcel positionParcel;
+    ASSERT_EQ(OK, positionOnly.write(positionParcel));
+    positionParcel.setDataPosition(0);
+    layer_state_t read;
+    ASSERT_EQ(OK, read.read(positionParcel));
+    EXPECT_EQ(positionParcel.dataPosition(), positionParcel.dataSize());
+
+    EXPECT_EQ(read.layerId, 3);
+    EXPECT_EQ(read.what, layer_state_t::ePositionChanged);
+    EXPECT_EQ(read.x, 12.f);
+    EXPECT_EQ(read.y, 34.f);
+    EXPECT_EQ(read.z, 0);
+    EXPECT_EQ(read.cornerRadius, 0.f);
+
+    layer_state_t manyChanges = positionOnly;
+    manyChanges.what |= layer_state_t::eCornerRadiusChanged | layer_state_t::eCropChanged |
+            layer_state_t::eColorTransformChanged | layer_state_t::eTransparentRegionChanged;
+    Parcel manyChangesParcel;
+    ASSERT_EQ(OK, manyChanges.write(manyChangesParcel));
+    EXPECT_LT(positionParcel.dataSize(), manyChangesParcel.dataSize());
+}
+
+TEST(LayerState, Parcelling) {
+    layer_state_t state;
+    state.layerId = 7;
+    state.what = layer_state_t::eLayerChanged | layer_state_t::eAlphaChanged |
+            layer_state_t::eColorChanged | layer_state_t::eMatrixChanged |
+            layer_state_t::eFlagsChanged | layer_state_t::eCropChanged |
+            layer_state_t::eCornerRadiusChanged | layer_state_t::eBufferCropChanged |
+            layer_state_t::eFrameRateChanged | layer_state_t::eDesiredHdrHeadroomChanged |
+            layer_state_t::eBufferChanged;
+    state.z = -2;
+    state.color = half4(0.1f, 0.2f, 0.3f, 0.4f);
+    state.matrix = {.dsdx = 2.f, .dtdx = 0.5f, .dtdy = 0.25f, .dsdy = 3.f};
+    state.flags = layer_state_t::eLayerHidden;
+    state.mask = layer_state_t::eLayerHidden | layer_state_t::eLayerOpaque;
+    state.crop = FloatRect(1.f, 2.f, 30.f, 40.f);
+    state.cornerRadius = 6.f;
+    state.bufferCrop = Rect(5, 6, 70, 80);
+    state.frameRate = 60.f;
+    state.frameRateCompatibility = ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_FIXED_SOURCE;
+    state.changeFrameRateStrategy = ANATIVEWINDOW_CHANGE_FRAME_RATE_ALWAYS;
+    state.desiredHdrSdrRatio = 2.5f;
+    state.bufferData = std::make_shared<BufferData>();
+    state.bufferData->frameNumber = 42;
+    state.listeners.emplace_back(sp<BBinder>::make(), std::vector<CallbackId>{});
+
+    Parcel p;
+    ASSERT_EQ(OK, state.write(p));
+    p.setDataPosition(0);
+    layer_state_t read;
+    ASSERT_EQ(OK, read.read(p));
+
+    EXPECT_EQ(read.layerId, state.layerId);
+    EXPECT_EQ(read.what, state.what);
+    EXPECT_EQ(read.z, state.z);
+    EXPECT_EQ(read.color, state.color);
+    EXPECT_EQ(read.matrix, state.matrix);
+    EXPECT_EQ(read.flags, state.flags);
+    EXPECT_EQ(read.mask, state.mask);
+    EXPECT_EQ(read.crop, state.crop);
+    EXPECT_EQ(read.cornerRadius, state.cornerRadius);
+    EXPECT_EQ(read.bufferCrop, state.bufferCrop);
+    EXPECT_EQ(read.frameRate, state.frameRate);
+    EXPECT_EQ(read.frameRateCompatibility, state.frameRateCompatibility);
+    EXPECT_EQ(read.changeFrameRateStrategy, state.changeFrameRateStrategy);
+    EXPECT_EQ(read.desiredHdrSdrRatio, state.desiredHdrSdrRatio);
+    ASSERT_NE(read.bufferData, nullptr);
+    EXPECT_EQ(read.bufferData->frameNumber, 42u);
+    ASSERT_EQ(read.listeners.size(), 1u);
+    EXPECT_EQ(read.listeners[0].transactionCompletedListener,
+              state.listeners[0].transactionCompletedListener);
+}
+
+TEST(LayerState, ParcellingRejectsUnknownVersion) {
+    Parcel p;
+    p.writeInt32(layer_state_t::kParcelVersion + 1);
+    p.setDataPosition(0);
+    layer_state_t read;
+    EXPECT_EQ(BAD_VALUE, read.read(p));
+}
+
+} // namespace test
+} // namespace android
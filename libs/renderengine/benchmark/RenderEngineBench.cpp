@@ -310,6 +310,94 @@ void BM_homescreen_edgeExtension(benchmark::State& benchState, Args&&... args) {
     benchDrawLayers(*re, layers, benchState, "homescreen_edge_extension");
 }
 
+/**
+ * Measure how long display composition waits when it is submitted behind screenshots that are
+ * already queued on a threaded RenderEngine. Only the composition draw is timed; the screenshots
+ * are drawn with the given priority, so that running with Priority::Composition reproduces the
+ * first-in first-out behavior of a single queue.
+ */
+template <class... Args>
+void BM_composition_behind_screenshots(benchmark::State& benchState, Args&&... args) {
+    auto args_tuple = std::make_tuple(std::move(args)...);
+    auto re = createRenderEngine(RenderEngine::Threaded::YES, RenderEngine::GraphicsApi::GL,
+                                 RenderEngine::BlurAlgorithm::GAUSSIAN);
+    const DisplaySettings::Priority screenshotPriority = std::get<0>(args_tuple);
+    static constexpr int kQueuedScreenshots = 3;
+
+    auto [width, height] = getDisplaySize();
+    auto srcBuffer = createTexture(*re, kHomescreenPath);
+    auto compositionBuffer = allocateBuffer(*re, width, height);
+    std::vector<std::shared_ptr<ExternalTexture>> screenshotBuffers;
+    for (int i = 0; i < kQueuedScreenshots; i++) {
+        screenshotBuffers.push_back(allocateBuffer(*re, width, height, 0, "screenshot"));
+    }
+
+    const FloatRect layerRect(0, 0, width, height);
+    LayerSettings layer{
+            .geometry =
+                    Geometry{
+                            .boundaries = layerRect,
+                    },
+            .source =
+                    PixelSource{
+                            .buffer =
+                                    Buffer{
+                                            .buffer = srcBuffer,
+                                    },
+                    },
+            .alpha = half(1.0f),
+    };
+    // Screenshots are made expensive with a blur so that the composition draw has something to
+    // wait behind.
+    LayerSettings blurLayer{
+            .geometry =
+                    Geometry{
+                            .boundaries = layerRect,
+                    },
+            .alpha = half(1.0f),
+            .skipContentDraw = true,
+            .backgroundBlurRadius = 60,
+    };
+    const auto compositionLayers = std::vector<LayerSettings>{layer};
+    const auto screenshotLayers = std::vector<LayerSettings>{layer, blurLayer};
+
+    const Rect displayRect(0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height));
+    const DisplaySettings compositionDisplay{
+            .physicalDisplay = displayRect,
+            .clip = displayRect,
+            .maxLuminance = 500,
+    };
+    DisplaySettings screenshotDisplay = compositionDisplay;
+    screenshotDisplay.priority = screenshotPriority;
+
+    for (auto _ : benchState) {
+        benchState.PauseTiming();
+        std::vector<ftl::Future<FenceResult>> screenshots;
+        for (const auto& screenshotBuffer : screenshotBuffers) {
+            screenshots.push_back(re->drawLayers(screenshotDisplay, screenshotLayers,
+                                                 screenshotBuffer, base::unique_fd()));
+        }
+        benchState.ResumeTiming();
+
+        sp<Fence> compositionFence = re->drawLayers(compositionDisplay, compositionLayers,
+                                                    compositionBuffer, base::unique_fd())
+                                             .get()
+                                             .value();
+        compositionFence->waitForever(LOG_TAG);
+
+        benchState.PauseTiming();
+        for (auto& screenshot : screenshots) {
+            screenshot.get().value()->waitForever(LOG_TAG);
+        }
+        benchState.ResumeTiming();
+    }
+}
+
+BENCHMARK_CAPTURE(BM_composition_behind_screenshots, fifo, DisplaySettings::Priority::Composition);
+
+BENCHMARK_CAPTURE(BM_composition_behind_screenshots, prioritized,
+                  DisplaySettings::Priority::Screenshot);
+
 BENCHMARK_CAPTURE(BM_homescreen_blur, gaussian, RenderEngine::Threaded::YES,
                   RenderEngine::GraphicsApi::GL, RenderEngine::BlurAlgorithm::GAUSSIAN);
 
@@ -105,6 +105,17 @@ struct DisplaySettings {
 
     // For now, meaningful primarily when the TonemappingStrategy is Local
     float targetHdrSdrRatio = 1.f;
+
+    // Scheduling class of this draw. A threaded RenderEngine always runs queued display
+    // composition ahead of queued screenshots, and screenshots ahead of layer caching, so that
+    // background renders never delay presenting a frame. This does not affect the output pixels.
+    enum class Priority {
+        Composition,
+        Screenshot,
+        LayerCaching,
+        ftl_last = LayerCaching
+    };
+    Priority priority = Priority::Composition;
 };
 
 static inline bool operator==(const DisplaySettings& lhs, const DisplaySettings& rhs) {
@@ -27,6 +27,7 @@ namespace android {
 
 using renderengine::PrimeCacheConfig;
 using testing::_;
+using testing::AnyNumber;
 using testing::Eq;
 using testing::Mock;
 using testing::Return;
@@ -246,4 +247,68 @@ TEST_F(RenderEngineThreadedTest, drawLayers_protectedOutputBuffer) {
     ASSERT_TRUE(result.ok());
 }
 
+TEST_F(RenderEngineThreadedTest, drawLayers_compositionRunsBeforeQueuedBackgroundWork) {
+    using Priority = renderengine::DisplaySettings::Priority;
+    std::vector<renderengine::LayerSettings> layers;
+    std::shared_ptr<renderengine::ExternalTexture> buffer = std::make_shared<
+            renderengine::impl::
+                    ExternalTexture>(sp<GraphicBuffer>::make(), *mRenderEngine,
+                                     renderengine::impl::ExternalTexture::Usage::READABLE |
+                                             renderengine::impl::ExternalTexture::Usage::WRITEABLE);
+
+    std::promise<void> blockerStarted;
+    std::promise<void> unblock;
+    std::shared_future<void> unblocked = unblock.get_future().share();
+    std::vector<Priority> drawOrder;
+
+    EXPECT_CALL(*mRenderEngine, useProtectedContext(false)).Times(AnyNumber());
+    EXPECT_CALL(*mRenderEngine, drawLayersInternal)
+            .Times(4)
+            .WillRepeatedly([&](const std::shared_ptr<std::promise<FenceResult>>&& resultPromise,
+                                const renderengine::DisplaySettings& display,
+                                const std::vector<renderengine::LayerSettings>&,
+                                const std::shared_ptr<renderengine::ExternalTexture>&,
+                                base::unique_fd&&) {
+                if (drawOrder.empty()) {
+                    blockerStarted.set_value();
+                    unblocked.wait();
+                }
+                drawOrder.push_back(display.priority);
+                resultPromise->set_value(Fence::NO_FENCE);
+            });
+
+    const auto draw = [&](Priority priority) {
+        renderengine::DisplaySettings settings;
+        settings.priority = priority;
+        return mThreadedRE->drawLayers(settings, layers, buffer, base::unique_fd());
+    };
+
+    // Keep the RenderEngine thread busy so that the following work is queued up behind it.
+    auto blocker = draw(Priority::Composition);
+    blockerStarted.get_future().wait();
+
+    auto layerCaching = draw(Priority::LayerCaching);
+    auto screenshot = draw(Priority::Screenshot);
+    auto composition = draw(Priority::Composition);
+    unblock.set_value();
+
+    ASSERT_TRUE(blocker.get().ok());
+    ASSERT_TRUE(layerCaching.get().ok());
+    ASSERT_TRUE(screenshot.get().ok());
+    ASSERT_TRUE(composition.get().ok());
+    EXPECT_THAT(drawOrder,
+                testing::ElementsAre(Priority::Composition, Priority::Composition,
+                                     Priority::Screenshot, Priority::LayerCaching));
+}
+
+TEST_F(RenderEngineThreadedTest, dump_reportsQueueDelays) {
+    std::string result;
+    EXPECT_CALL(*mRenderEngine, dump(_));
+    mThreadedRE->dump(result);
+    EXPECT_THAT(result, testing::HasSubstr("RenderEngineThreaded queue delays"));
+    EXPECT_THAT(result, testing::HasSubstr("Composition"));
+    EXPECT_THAT(result, testing::HasSubstr("Screenshot"));
+    EXPECT_THAT(result, testing::HasSubstr("LayerCaching"));
+}
+
 } // namespace android
@@ -19,11 +19,14 @@
 #include "RenderEngineThreaded.h"
 
 #include <sched.h>
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
 #include <future>
 
 #include <android-base/stringprintf.h>
 #include <common/trace.h>
+#include <ftl/enum.h>
 #include <private/gui/SyncFeatures.h>
 #include <processgroup/processgroup.h>
 
@@ -99,12 +102,7 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     while (mRunning) {
         const auto getNextTask = [this]() -> std::optional<Work> {
             std::scoped_lock lock(mThreadMutex);
-            if (!mFunctionCalls.empty()) {
-                Work task = mFunctionCalls.front();
-                mFunctionCalls.pop();
-                return std::make_optional<Work>(task);
-            }
-            return std::nullopt;
+            return dequeueWorkLocked();
         };
 
         const auto task = getNextTask();
@@ -115,7 +113,7 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
 
         std::unique_lock<std::mutex> lock(mThreadMutex);
         mCondition.wait(lock, [this]() REQUIRES(mThreadMutex) {
-            return !mRunning || !mFunctionCalls.empty();
+            return !mRunning || hasQueuedWorkLocked();
         });
     }
 
@@ -123,6 +121,53 @@ void RenderEngineThreaded::threadMain(CreateInstanceFactory factory) NO_THREAD_S
     mRenderEngine.reset();
 }
 
+void RenderEngineThreaded::queueWorkLocked(Work&& work, Priority priority) const {
+    mFunctionCalls[static_cast<size_t>(priority)].push(
+            {std::move(work), std::chrono::steady_clock::now()});
+}
+
+std::optional<RenderEngineThreaded::Work> RenderEngineThreaded::dequeueWorkLocked() {
+    // Queues are ordered from the highest to the lowest priority class.
+    for (size_t i = 0; i < kPriorityCount; i++) {
+        auto& queue = mFunctionCalls[i];
+        if (queue.empty()) {
+            continue;
+        }
+
+        QueuedWork queued = std::move(queue.front());
+        queue.pop();
+
+        const auto delay = std::chrono::steady_clock::now() - queued.queueTime;
+        auto& stats = mQueueDelayStats[i];
+        stats.count++;
+        stats.total += delay;
+        stats.max = std::max<std::chrono::nanoseconds>(stats.max, delay);
+        return std::make_optional<Work>(std::move(queued.work));
+    }
+    return std::nullopt;
+}
+
+bool RenderEngineThreaded::hasQueuedWorkLocked() const {
+    return std::any_of(mFunctionCalls.begin(), mFunctionCalls.end(),
+                       [](const auto& queue) { return !queue.empty(); });
+}
+
+void RenderEngineThreaded::dumpQueueDelays(std::string& result) const {
+    std::lock_guard lock(mThreadMutex);
+    result.append("RenderEngineThreaded queue delays:\n");
+    for (size_t i = 0; i < kPriorityCount; i++) {
+        const auto& stats = mQueueDelayStats[i];
+        const auto average = stats.count == 0 ? std::chrono::nanoseconds(0)
+                                              : stats.total / static_cast<int64_t>(stats.count);
+        base::StringAppendF(&result,
+                            "  %-12s queued=%zu executed=%" PRIu64 " avg=%.3fms max=%.3fms\n",
+                            ftl::enum_string(static_cast<Priority>(i)).c_str(),
+                            mFunctionCalls[i].size(), stats.count,
+                            std::chrono::duration<double, std::milli>(average).count(),
+                            std::chrono::duration<double, std::milli>(stats.max).count());
+    }
+}
+
 void RenderEngineThreaded::waitUntilInitialized() const {
     if (!mIsInitialized) {
         std::unique_lock<std::mutex> lock(mInitializedMutex);
@@ -138,7 +183,7 @@ std::future<void> RenderEngineThreaded::primeCache(PrimeCacheConfig config) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([resultPromise, config](renderengine::RenderEngine& instance) {
+        queueWorkLocked([resultPromise, config](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::primeCache");
             if (setSchedFifo(false) != NO_ERROR) {
                 ALOGW("Couldn't set SCHED_OTHER for primeCache");
@@ -162,7 +207,7 @@ void RenderEngineThreaded::dump(std::string& result) {
     std::future<std::string> resultFuture = resultPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise, &result](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&resultPromise, &result](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::dump");
             std::string localResult = result;
             instance.dump(localResult);
@@ -172,6 +217,7 @@ void RenderEngineThreaded::dump(std::string& result) {
     mCondition.notify_one();
     // Note: This is an rvalue.
     result.assign(resultFuture.get());
+    dumpQueueDelays(result);
 }
 
 void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buffer,
@@ -181,7 +227,7 @@ void RenderEngineThreaded::mapExternalTextureBuffer(const sp<GraphicBuffer>& buf
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
+        queueWorkLocked([=](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::mapExternalTextureBuffer");
             instance.mapExternalTextureBuffer(buffer, isRenderable);
         });
@@ -195,7 +241,7 @@ void RenderEngineThreaded::unmapExternalTextureBuffer(sp<GraphicBuffer>&& buffer
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push(
+        queueWorkLocked(
                 [=, buffer = std::move(buffer)](renderengine::RenderEngine& instance) mutable {
                     SFTRACE_NAME("REThreaded::unmapExternalTextureBuffer");
                     instance.unmapExternalTextureBuffer(std::move(buffer));
@@ -228,7 +274,7 @@ void RenderEngineThreaded::cleanupPostRender() {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([=](renderengine::RenderEngine& instance) {
+        queueWorkLocked([=](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::cleanupPostRender");
             instance.cleanupPostRender();
         });
@@ -269,13 +315,14 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawLayers(
     {
         std::lock_guard lock(mThreadMutex);
         mNeedsPostRenderCleanup = true;
-        mFunctionCalls.push(
+        queueWorkLocked(
                 [resultPromise, display, layers, buffer, fd](renderengine::RenderEngine& instance) {
                     SFTRACE_NAME("REThreaded::drawLayers");
                     instance.updateProtectedContext(layers, {buffer.get()});
                     instance.drawLayersInternal(std::move(resultPromise), display, layers, buffer,
                                                 base::unique_fd(fd));
-                });
+                },
+                display.priority);
     }
     mCondition.notify_one();
     return resultFuture;
@@ -292,14 +339,18 @@ ftl::Future<FenceResult> RenderEngineThreaded::drawGainmap(
     {
         std::lock_guard lock(mThreadMutex);
         mNeedsPostRenderCleanup = true;
-        mFunctionCalls.push([resultPromise, sdr, sdrFence = std::move(sdrFence), hdr,
-                             hdrFence = std::move(hdrFence), hdrSdrRatio, dataspace,
-                             gainmap](renderengine::RenderEngine& instance) mutable {
-            SFTRACE_NAME("REThreaded::drawGainmap");
-            instance.updateProtectedContext({}, {sdr.get(), hdr.get(), gainmap.get()});
-            instance.drawGainmapInternal(std::move(resultPromise), sdr, std::move(sdrFence), hdr,
-                                         std::move(hdrFence), hdrSdrRatio, dataspace, gainmap);
-        });
+        // Gainmaps are only drawn for screenshots.
+        queueWorkLocked(
+                [resultPromise, sdr, sdrFence = std::move(sdrFence), hdr,
+                 hdrFence = std::move(hdrFence), hdrSdrRatio, dataspace,
+                 gainmap](renderengine::RenderEngine& instance) mutable {
+                    SFTRACE_NAME("REThreaded::drawGainmap");
+                    instance.updateProtectedContext({}, {sdr.get(), hdr.get(), gainmap.get()});
+                    instance.drawGainmapInternal(std::move(resultPromise), sdr, std::move(sdrFence),
+                                                 hdr, std::move(hdrFence), hdrSdrRatio, dataspace,
+                                                 gainmap);
+                },
+                Priority::Screenshot);
     }
     mCondition.notify_one();
     return resultFuture;
@@ -310,7 +361,7 @@ int RenderEngineThreaded::getContextPriority() {
     std::future<int> resultFuture = resultPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&resultPromise](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&resultPromise](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::getContextPriority");
             int priority = instance.getContextPriority();
             resultPromise.set_value(priority);
@@ -330,7 +381,7 @@ void RenderEngineThreaded::onActiveDisplaySizeChanged(ui::Size size) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([size](renderengine::RenderEngine& instance) {
+        queueWorkLocked([size](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::onActiveDisplaySizeChanged");
             instance.onActiveDisplaySizeChanged(size);
         });
@@ -343,7 +394,7 @@ std::optional<pid_t> RenderEngineThreaded::getRenderEngineTid() const {
     std::future<pid_t> tidFuture = tidPromise.get_future();
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([&tidPromise](renderengine::RenderEngine& instance) {
+        queueWorkLocked([&tidPromise](renderengine::RenderEngine& instance) {
             tidPromise.set_value(gettid());
         });
     }
@@ -357,7 +408,7 @@ void RenderEngineThreaded::setEnableTracing(bool tracingEnabled) {
     // for the futures.
     {
         std::lock_guard lock(mThreadMutex);
-        mFunctionCalls.push([tracingEnabled](renderengine::RenderEngine& instance) {
+        queueWorkLocked([tracingEnabled](renderengine::RenderEngine& instance) {
             SFTRACE_NAME("REThreaded::setEnableTracing");
             instance.setEnableTracing(tracingEnabled);
         });
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <array>
+#include <chrono>
 #include <condition_variable>
 #include <mutex>
 #include <queue>
@@ -34,6 +36,10 @@ using CreateInstanceFactory = std::function<std::unique_ptr<renderengine::Render
  * This class extends a basic RenderEngine class. It contains a thread. Each time a function of
  * this class is called, we create a lambda function that is put on a queue. The main thread then
  * executes the functions in order.
+ *
+ * Draws are queued by DisplaySettings::Priority. Work of a higher priority class always runs
+ * before any queued work of a lower class, and work within a class runs in submission order.
+ * Everything that is not a background draw is queued as Composition work.
  */
 class RenderEngineThreaded : public RenderEngine {
 public:
@@ -86,8 +92,16 @@ protected:
                              const std::shared_ptr<ExternalTexture>& gainmap) override;
 
 private:
+    using Work = std::function<void(renderengine::RenderEngine&)>;
+    using Priority = DisplaySettings::Priority;
+
     void threadMain(CreateInstanceFactory factory);
     void waitUntilInitialized() const;
+    void queueWorkLocked(Work&& work, Priority priority = Priority::Composition) const
+            REQUIRES(mThreadMutex);
+    std::optional<Work> dequeueWorkLocked() REQUIRES(mThreadMutex);
+    bool hasQueuedWorkLocked() const REQUIRES(mThreadMutex);
+    void dumpQueueDelays(std::string& result) const;
     static status_t setSchedFifo(bool enabled);
 
     // No-op. This method is only called on leaf implementations of RenderEngine.
@@ -103,10 +117,24 @@ private:
     std::atomic<bool> mRunning = true;
     std::atomic<bool> mNeedsPostRenderCleanup = false;
 
-    using Work = std::function<void(renderengine::RenderEngine&)>;
-    mutable std::queue<Work> mFunctionCalls GUARDED_BY(mThreadMutex);
+    struct QueuedWork {
+        Work work;
+        std::chrono::steady_clock::time_point queueTime;
+    };
+    static constexpr size_t kPriorityCount = static_cast<size_t>(Priority::ftl_last) + 1;
+    // One FIFO per priority class, indexed by DisplaySettings::Priority.
+    mutable std::array<std::queue<QueuedWork>, kPriorityCount> mFunctionCalls
+            GUARDED_BY(mThreadMutex);
     mutable std::condition_variable mCondition;
 
+    // Time spent by work in the queue before the RenderEngine thread picked it up.
+    struct QueueDelayStats {
+        uint64_t count = 0;
+        std::chrono::nanoseconds total{0};
+        std::chrono::nanoseconds max{0};
+    };
+    std::array<QueueDelayStats, kPriorityCount> mQueueDelayStats GUARDED_BY(mThreadMutex);
+
     // Used to allow select thread safe methods to be accessed without requiring the
     // method to be invoked on the RenderEngine thread
     std::atomic_bool mIsInitialized = false;
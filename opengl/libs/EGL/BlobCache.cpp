@@ -25,7 +25,9 @@
 #include <log/log.h>
 #include <utils/Trace.h>
 
-#include <chrono>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 namespace android {
 
@@ -42,17 +44,8 @@ BlobCache::BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize
       : mMaxTotalSize(maxTotalSize),
         mMaxKeySize(maxKeySize),
         mMaxValueSize(maxValueSize),
-        mTotalSize(0) {
-    int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
-#ifdef _WIN32
-    srand(now);
-#else
-    mRandState[0] = (now >> 0) & 0xFFFF;
-    mRandState[1] = (now >> 16) & 0xFFFF;
-    mRandState[2] = (now >> 32) & 0xFFFF;
-#endif
-    ALOGV("initializing random seed using %lld", (unsigned long long)now);
-}
+        mTotalSize(0),
+        mClockHand(0) {}
 
 BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const void* value,
                                        size_t valueSize) {
@@ -81,60 +74,55 @@ BlobCache::InsertResult BlobCache::set(const void* key, size_t keySize, const vo
         return InsertResult::kInvalidValueSize;
     }
 
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
+    std::string_view cacheKey(static_cast<const char*>(key), keySize);
+    Shard& shard = getShard(cacheKey);
+
+    // Copy the value before taking the lock, so that readers of the shard
+    // aren't blocked on it.
+    std::unique_ptr<uint8_t[]> valueCopy(new uint8_t[valueSize]);
+    memcpy(valueCopy.get(), value, valueSize);
 
     bool didClean = false;
     while (true) {
-        auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-        if (index == mCacheEntries.end() || cacheEntry < *index) {
-            // Create a new cache entry.
-            std::shared_ptr<Blob> keyBlob(new Blob(key, keySize, true));
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            size_t newTotalSize = mTotalSize + keySize + valueSize;
-            if (mMaxTotalSize < newTotalSize) {
-                if (isCleanable()) {
-                    // Clean the cache and try again.
-                    clean();
-                    didClean = true;
-                    continue;
-                } else {
-                    ALOGV("set: not caching new key/value pair because the "
-                          "total cache size limit would be exceeded: %zu "
-                          "(limit: %zu)",
-                          keySize + valueSize, mMaxTotalSize);
-                    return InsertResult::kNotEnoughSpace;
+        {
+            std::lock_guard<std::shared_mutex> lock(shard.mMutex);
+            auto index = shard.mEntries.find(cacheKey);
+            if (index == shard.mEntries.end()) {
+                // Create a new cache entry.
+                if (reserveSpace(0, keySize + valueSize)) {
+                    shard.mEntries.emplace(std::piecewise_construct,
+                                           std::forward_as_tuple(cacheKey),
+                                           std::forward_as_tuple(std::move(valueCopy),
+                                                                 valueSize));
+                    ALOGV("set: created new cache entry with %zu byte key and %zu byte value",
+                          keySize, valueSize);
+                    return didClean ? InsertResult::kDidClean : InsertResult::kInserted;
                 }
-            }
-            mCacheEntries.insert(index, CacheEntry(keyBlob, valueBlob));
-            mTotalSize = newTotalSize;
-            ALOGV("set: created new cache entry with %zu byte key and %zu byte value", keySize,
-                  valueSize);
-        } else {
-            // Update the existing cache entry.
-            std::shared_ptr<Blob> valueBlob(new Blob(value, valueSize, true));
-            std::shared_ptr<Blob> oldValueBlob(index->getValue());
-            size_t newTotalSize = mTotalSize + valueSize - oldValueBlob->getSize();
-            if (mMaxTotalSize < newTotalSize) {
-                if (isCleanable()) {
-                    // Clean the cache and try again.
-                    clean();
-                    didClean = true;
-                    continue;
-                } else {
-                    ALOGV("set: not caching new value because the total cache "
-                          "size limit would be exceeded: %zu (limit: %zu)",
-                          keySize + valueSize, mMaxTotalSize);
-                    return InsertResult::kNotEnoughSpace;
+            } else {
+                // Update the existing cache entry.
+                CacheEntry& entry = index->second;
+                if (reserveSpace(entry.mValueSize, valueSize)) {
+                    entry.mValue = std::move(valueCopy);
+                    entry.mValueSize = valueSize;
+                    ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
+                          "value",
+                          keySize, valueSize);
+                    return didClean ? InsertResult::kDidClean : InsertResult::kInserted;
                 }
             }
-            index->setValue(valueBlob);
-            mTotalSize = newTotalSize;
-            ALOGV("set: updated existing cache entry with %zu byte key and %zu byte "
-                  "value",
-                  keySize, valueSize);
         }
-        return didClean ? InsertResult::kDidClean : InsertResult::kInserted;
+
+        // clean locks the shards itself, so it must be called without holding
+        // the lock of this one.
+        if (!isCleanable()) {
+            ALOGV("set: not caching new key/value pair because the total cache "
+                  "size limit would be exceeded: %zu (limit: %zu)",
+                  keySize + valueSize, mMaxTotalSize);
+            return InsertResult::kNotEnoughSpace;
+        }
+        // Clean the cache and try again.
+        clean();
+        didClean = true;
     }
 }
 
@@ -144,21 +132,29 @@ size_t BlobCache::get(const void* key, size_t keySize, void* value, size_t value
               mMaxKeySize);
         return 0;
     }
-    std::shared_ptr<Blob> cacheKey(new Blob(key, keySize, false));
-    CacheEntry cacheEntry(cacheKey, nullptr);
-    auto index = std::lower_bound(mCacheEntries.begin(), mCacheEntries.end(), cacheEntry);
-    if (index == mCacheEntries.end() || cacheEntry < *index) {
+    std::string_view cacheKey(static_cast<const char*>(key), keySize);
+    Shard& shard = getShard(cacheKey);
+
+    std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+    auto index = shard.mEntries.find(cacheKey);
+    if (index == shard.mEntries.end()) {
         ALOGV("get: no cache entry found for key of size %zu", keySize);
         return 0;
     }
 
-    // The key was found. Return the value if the caller's buffer is large
-    // enough.
-    std::shared_ptr<Blob> valueBlob(index->getValue());
-    size_t valueBlobSize = valueBlob->getSize();
+    // The key was found. Mark the entry as recently used, avoiding the store
+    // when the bit is already set so that concurrent readers don't contend on
+    // the cache line.
+    const CacheEntry& entry = index->second;
+    if (!entry.mReferenced.load(std::memory_order_relaxed)) {
+        entry.mReferenced.store(true, std::memory_order_relaxed);
+    }
+
+    // Return the value if the caller's buffer is large enough.
+    size_t valueBlobSize = entry.mValueSize;
     if (valueBlobSize <= valueSize) {
         ALOGV("get: copying %zu bytes to caller's buffer", valueBlobSize);
-        memcpy(value, valueBlob->getData(), valueBlobSize);
+        memcpy(value, entry.mValue.get(), valueBlobSize);
     } else {
         ALOGV("get: caller's buffer is too small for value: %zu (needs %zu)", valueSize,
               valueBlobSize);
@@ -173,37 +169,82 @@ static inline size_t align4(size_t size) {
 size_t BlobCache::getFlattenedSize() const {
     auto buildId = base::GetProperty("ro.build.id", "");
     size_t size = align4(sizeof(Header) + buildId.size());
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size += align4(sizeof(EntryHeader) + keyBlob->getSize() + valueBlob->getSize());
+    for (const Shard& shard : mShards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mMutex);
+        for (const auto& [key, entry] : shard.mEntries) {
+            size += align4(sizeof(EntryHeader) + key.size() + entry.mValueSize);
+        }
     }
     return size;
 }
 
 int BlobCache::flatten(void* buffer, size_t size) const {
+    Snapshot snapshot;
+    takeSnapshot(&snapshot);
+    return flatten(snapshot, base::GetProperty("ro.build.id", ""), buffer, size);
+}
+
+void BlobCache::flatten(std::vector<uint8_t>* buffer, size_t offset) const {
+    auto buildId = base::GetProperty("ro.build.id", "");
+    Snapshot snapshot;
+    takeSnapshot(&snapshot);
+    size_t size = getFlattenedSize(snapshot, buildId);
+    buffer->resize(offset + size);
+    flatten(snapshot, buildId, buffer->data() + offset, size);
+}
+
+void BlobCache::takeSnapshot(Snapshot* snapshot) const {
+    snapshot->mLocks.reserve(kShardCount);
+    for (const Shard& shard : mShards) {
+        snapshot->mLocks.emplace_back(shard.mMutex);
+        for (const auto& [key, entry] : shard.mEntries) {
+            snapshot->mEntries.emplace_back(&key, &entry);
+        }
+    }
+
+    // Order the entries by key size and then key contents, independent of the
+    // hash layout, so the same contents always serialize to the same bytes.
+    std::sort(snapshot->mEntries.begin(), snapshot->mEntries.end(),
+              [](const auto& lhs, const auto& rhs) {
+                  const std::string& lhsKey = *lhs.first;
+                  const std::string& rhsKey = *rhs.first;
+                  if (lhsKey.size() == rhsKey.size()) {
+                      return memcmp(lhsKey.data(), rhsKey.data(), lhsKey.size()) < 0;
+                  }
+                  return lhsKey.size() < rhsKey.size();
+              });
+}
+
+size_t BlobCache::getFlattenedSize(const Snapshot& snapshot, const std::string& buildId) {
+    size_t size = align4(sizeof(Header) + buildId.size());
+    for (const auto& [key, entry] : snapshot.mEntries) {
+        size += align4(sizeof(EntryHeader) + key->size() + entry->mValueSize);
+    }
+    return size;
+}
+
+int BlobCache::flatten(const Snapshot& snapshot, const std::string& buildId, void* buffer,
+                       size_t size) {
     // Write the cache header
     if (size < sizeof(Header)) {
         ALOGE("flatten: not enough room for cache header");
         return 0;
     }
+
     Header* header = reinterpret_cast<Header*>(buffer);
     header->mMagicNumber = blobCacheMagic;
     header->mBlobCacheVersion = blobCacheVersion;
     header->mDeviceVersion = blobCacheDeviceVersion;
-    header->mNumEntries = mCacheEntries.size();
-    auto buildId = base::GetProperty("ro.build.id", "");
+    header->mNumEntries = snapshot.mEntries.size();
     header->mBuildIdLength = buildId.size();
     memcpy(header->mBuildId, buildId.c_str(), header->mBuildIdLength);
 
     // Write cache entries
     uint8_t* byteBuffer = reinterpret_cast<uint8_t*>(buffer);
     off_t byteOffset = align4(sizeof(Header) + header->mBuildIdLength);
-    for (const CacheEntry& e : mCacheEntries) {
-        std::shared_ptr<Blob> const& keyBlob = e.getKey();
-        std::shared_ptr<Blob> const& valueBlob = e.getValue();
-        size_t keySize = keyBlob->getSize();
-        size_t valueSize = valueBlob->getSize();
+    for (const auto& [key, entry] : snapshot.mEntries) {
+        size_t keySize = key->size();
+        size_t valueSize = entry->mValueSize;
 
         size_t entrySize = sizeof(EntryHeader) + keySize + valueSize;
         size_t totalSize = align4(entrySize);
@@ -216,8 +257,8 @@ int BlobCache::flatten(void* buffer, size_t size) const {
         eheader->mKeySize = keySize;
         eheader->mValueSize = valueSize;
 
-        memcpy(eheader->mData, keyBlob->getData(), keySize);
-        memcpy(eheader->mData + keySize, valueBlob->getData(), valueSize);
+        memcpy(eheader->mData, key->data(), keySize);
+        memcpy(eheader->mData + keySize, entry->mValue.get(), valueSize);
 
         if (totalSize > entrySize) {
             // We have padding bytes. Those will get written to storage, and contribute to the CRC,
@@ -280,7 +321,9 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
         }
 
         const uint8_t* data = eheader->mData;
-        set(data, keySize, data + keySize, valueSize);
+        // Loading the serialized contents isn't a new insertion, so this
+        // bypasses any subclass override.
+        BlobCache::set(data, keySize, data + keySize, valueSize);
 
         byteOffset += totalSize;
     }
@@ -288,88 +331,67 @@ int BlobCache::unflatten(void const* buffer, size_t size) {
     return 0;
 }
 
-long int BlobCache::blob_random() {
-#ifdef _WIN32
-    return rand();
-#else
-    return nrand48(mRandState);
-#endif
-}
-
-void BlobCache::clean() {
-    ATRACE_NAME("BlobCache::clean");
-
-    // Remove a random cache entry until the total cache size gets below half
-    // the maximum total cache size.
-    while (mTotalSize > mMaxTotalSize / 2) {
-        size_t i = size_t(blob_random() % (mCacheEntries.size()));
-        const CacheEntry& entry(mCacheEntries[i]);
-        mTotalSize -= entry.getKey()->getSize() + entry.getValue()->getSize();
-        mCacheEntries.erase(mCacheEntries.begin() + i);
-    }
-}
-
-bool BlobCache::isCleanable() const {
-    return mTotalSize > mMaxTotalSize / 2;
-}
-
-BlobCache::Blob::Blob(const void* data, size_t size, bool copyData)
-      : mData(copyData ? malloc(size) : data), mSize(size), mOwnsData(copyData) {
-    if (data != nullptr && copyData) {
-        memcpy(const_cast<void*>(mData), data, size);
-    }
-}
-
-BlobCache::Blob::~Blob() {
-    if (mOwnsData) {
-        free(const_cast<void*>(mData));
-    }
-}
-
-bool BlobCache::Blob::operator<(const Blob& rhs) const {
-    if (mSize == rhs.mSize) {
-        return memcmp(mData, rhs.mData, mSize) < 0;
-    } else {
-        return mSize < rhs.mSize;
+void BlobCache::clear() {
+    for (Shard& shard : mShards) {
+        std::lock_guard<std::shared_mutex> lock(shard.mMutex);
+        for (const auto& [key, entry] : shard.mEntries) {
+            mTotalSize -= key.size() + entry.mValueSize;
+        }
+        shard.mEntries.clear();
     }
 }
 
-const void* BlobCache::Blob::getData() const {
-    return mData;
+BlobCache::Shard& BlobCache::getShard(std::string_view key) {
+    return mShards[KeyHash()(key) % kShardCount];
 }
 
-size_t BlobCache::Blob::getSize() const {
-    return mSize;
+bool BlobCache::reserveSpace(size_t oldSize, size_t newSize) {
+    size_t totalSize = mTotalSize.load(std::memory_order_relaxed);
+    size_t newTotalSize;
+    do {
+        newTotalSize = totalSize - oldSize + newSize;
+        if (mMaxTotalSize < newTotalSize) {
+            return false;
+        }
+    } while (!mTotalSize.compare_exchange_weak(totalSize, newTotalSize,
+                                               std::memory_order_relaxed));
+    return true;
 }
 
-BlobCache::CacheEntry::CacheEntry() {}
-
-BlobCache::CacheEntry::CacheEntry(const std::shared_ptr<Blob>& key,
-                                  const std::shared_ptr<Blob>& value)
-      : mKey(key), mValue(value) {}
-
-BlobCache::CacheEntry::CacheEntry(const CacheEntry& ce) : mKey(ce.mKey), mValue(ce.mValue) {}
-
-bool BlobCache::CacheEntry::operator<(const CacheEntry& rhs) const {
-    return *mKey < *rhs.mKey;
-}
+void BlobCache::clean() {
+    ATRACE_NAME("BlobCache::clean");
 
-const BlobCache::CacheEntry& BlobCache::CacheEntry::operator=(const CacheEntry& rhs) {
-    mKey = rhs.mKey;
-    mValue = rhs.mValue;
-    return *this;
-}
+    std::lock_guard<std::mutex> cleanLock(mCleanMutex);
 
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getKey() const {
-    return mKey;
-}
+    // Another thread may have cleaned the cache while this one was waiting.
+    if (!isCleanable()) {
+        return;
+    }
 
-std::shared_ptr<BlobCache::Blob> BlobCache::CacheEntry::getValue() const {
-    return mValue;
+    // Sweep the shards, starting where the previous sweep stopped, until the
+    // total cache size gets below half the maximum total cache size. The first
+    // round clears the referenced bits it passes, so two rounds are enough to
+    // evict any entry that isn't read again in the meantime.
+    const size_t targetSize = mMaxTotalSize / 2;
+    for (size_t i = 0; i < 2 * kShardCount && mTotalSize > targetSize; i++) {
+        Shard& shard = mShards[mClockHand];
+        mClockHand = (mClockHand + 1) % kShardCount;
+
+        std::lock_guard<std::shared_mutex> lock(shard.mMutex);
+        for (auto entry = shard.mEntries.begin();
+             entry != shard.mEntries.end() && mTotalSize > targetSize;) {
+            if (entry->second.mReferenced.exchange(false, std::memory_order_relaxed)) {
+                ++entry;
+                continue;
+            }
+            mTotalSize -= entry->first.size() + entry->second.mValueSize;
+            entry = shard.mEntries.erase(entry);
+        }
+    }
 }
 
-void BlobCache::CacheEntry::setValue(const std::shared_ptr<Blob>& value) {
-    mValue = value;
+bool BlobCache::isCleanable() const {
+    return mTotalSize > mMaxTotalSize / 2;
 }
 
 } // namespace android
@@ -18,14 +18,26 @@
 #define ANDROID_BLOB_CACHE_H
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace android {
 
-// A BlobCache is an in-memory cache for binary key/value pairs.  A BlobCache
-// does NOT provide any thread-safety guarantees.
+// A BlobCache is an in-memory cache for binary key/value pairs.  The entries
+// are spread over shards by key hash, and each shard has its own reader/writer
+// lock, so a BlobCache may be used from multiple threads at once and readers
+// of the same shard don't block each other.
 //
 // The cache contents can be serialized to an in-memory buffer or mmap'd file
 // and then reloaded in a subsequent execution of the program.  This
@@ -38,6 +50,7 @@ public:
     // maxValueSize, respectively. The total combined size of ALL cache entries
     // (key sizes plus value sizes) will not exceed maxTotalSize.
     BlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize);
+    virtual ~BlobCache() = default;
 
     // Return value from set(), below.
     enum class InsertResult {
@@ -74,7 +87,11 @@ public:
     //   0 < keySize
     //   value != NULL
     //   0 < valueSize
-    InsertResult set(const void* key, size_t keySize, const void* value, size_t valueSize);
+    //
+    // Subclasses that persist entries override set, so entries inserted
+    // through a BlobCache pointer are persisted too.
+    virtual InsertResult set(const void* key, size_t keySize, const void* value,
+                             size_t valueSize);
 
     // get retrieves from the cache the binary value associated with a given
     // binary key.  If the key is present in the cache then the length of the
@@ -107,6 +124,13 @@ public:
     //   size >= this.getFlattenedSize()
     int flatten(void* buffer, size_t size) const;
 
+    // flatten serializes the current contents of the cache into 'buffer',
+    // after the first 'offset' bytes which are left for the caller. The buffer
+    // is sized while every shard is locked, so unlike a getFlattenedSize call
+    // followed by a flatten call, sets from other threads can't make it too
+    // small.
+    void flatten(std::vector<uint8_t>* buffer, size_t offset) const;
+
     // unflatten replaces the contents of the cache with the serialized cache
     // contents in the memory pointed to by 'buffer'.  The previous contents of
     // the BlobCache will be evicted from the cache.  If an error occurs while
@@ -117,10 +141,7 @@ public:
 
     // clear flushes out all contents of the cache then the BlobCache, leaving
     // it in an empty state.
-    void clear() {
-        mCacheEntries.clear();
-        mTotalSize = 0;
-    }
+    void clear();
 
 protected:
     // mMaxTotalSize is the maximum size that all cache entries can occupy. This
@@ -135,66 +156,70 @@ private:
     BlobCache(const BlobCache&);
     void operator=(const BlobCache&);
 
-    // A random function helper to get around MinGW not having nrand48()
-    long int blob_random();
-
-    // clean evicts a randomly chosen set of entries from the cache such that
-    // the total size of all remaining entries is less than mMaxTotalSize/2.
-    void clean();
-
-    // isCleanable returns true if the cache is full enough for the clean method
-    // to have some effect, and false otherwise.
-    bool isCleanable() const;
+    // kShardCount is the number of shards the cache entries are spread over.
+    static constexpr size_t kShardCount = 16;
 
-    // A Blob is an immutable sized unstructured data blob.
-    class Blob {
-    public:
-        Blob(const void* data, size_t size, bool copyData);
-        ~Blob();
+    // KeyHash hashes the binary keys. It is transparent so that lookups don't
+    // have to copy the caller's key.
+    struct KeyHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view key) const {
+            return std::hash<std::string_view>()(key);
+        }
+    };
 
-        bool operator<(const Blob& rhs) const;
+    // A CacheEntry holds the value of a single key/value pair in the cache. The
+    // key is the map key of the shard holding the entry.
+    struct CacheEntry {
+        CacheEntry(std::unique_ptr<uint8_t[]> value, size_t valueSize)
+              : mValue(std::move(value)), mValueSize(valueSize) {}
 
-        const void* getData() const;
-        size_t getSize() const;
+        std::unique_ptr<uint8_t[]> mValue;
+        size_t mValueSize;
 
-    private:
-        // Copying is not allowed.
-        Blob(const Blob&);
-        void operator=(const Blob&);
+        // mReferenced is set by get and cleared by clean. An entry that has been
+        // read since the last sweep gets a second chance instead of being evicted.
+        mutable std::atomic<bool> mReferenced = false;
+    };
 
-        // mData points to the buffer containing the blob data.
-        const void* mData;
+    // A Shard holds the entries whose key hash maps to it. get takes mMutex in
+    // shared mode, while set, clean and clear take it exclusively.
+    struct Shard {
+        mutable std::shared_mutex mMutex;
+        std::unordered_map<std::string, CacheEntry, KeyHash, std::equal_to<>> mEntries;
+    };
 
-        // mSize is the size of the blob data in bytes.
-        size_t mSize;
+    Shard& getShard(std::string_view key);
 
-        // mOwnsData indicates whether or not this Blob object should free the
-        // memory pointed to by mData when the Blob gets destructed.
-        bool mOwnsData;
+    // A Snapshot holds a shared lock on every shard, and the entries of all
+    // shards in the order they are serialized.
+    struct Snapshot {
+        std::vector<std::shared_lock<std::shared_mutex>> mLocks;
+        std::vector<std::pair<const std::string*, const CacheEntry*>> mEntries;
     };
 
-    // A CacheEntry is a single key/value pair in the cache.
-    class CacheEntry {
-    public:
-        CacheEntry();
-        CacheEntry(const std::shared_ptr<Blob>& key, const std::shared_ptr<Blob>& value);
-        CacheEntry(const CacheEntry& ce);
-
-        bool operator<(const CacheEntry& rhs) const;
-        const CacheEntry& operator=(const CacheEntry&);
+    // takeSnapshot locks the shards, always in shard order. clean and set hold
+    // at most one shard lock at a time, so this can't deadlock with them.
+    void takeSnapshot(Snapshot* snapshot) const;
 
-        std::shared_ptr<Blob> getKey() const;
-        std::shared_ptr<Blob> getValue() const;
+    // getFlattenedSize and flatten for the contents of a snapshot.
+    static size_t getFlattenedSize(const Snapshot& snapshot, const std::string& buildId);
+    static int flatten(const Snapshot& snapshot, const std::string& buildId, void* buffer,
+                       size_t size);
 
-        void setValue(const std::shared_ptr<Blob>& value);
+    // reserveSpace atomically replaces oldSize bytes of the total cache size
+    // with newSize bytes, and returns false if that would exceed mMaxTotalSize.
+    bool reserveSpace(size_t oldSize, size_t newSize);
 
-    private:
-        // mKey is the key that identifies the cache entry.
-        std::shared_ptr<Blob> mKey;
+    // clean evicts entries from the cache such that the total size of all
+    // remaining entries is at most mMaxTotalSize/2. It sweeps the shards like
+    // a clock hand, evicting the entries that haven't been read since the
+    // previous sweep first.
+    void clean();
 
-        // mValue is the cached data associated with the key.
-        std::shared_ptr<Blob> mValue;
-    };
+    // isCleanable returns true if the cache is full enough for the clean method
+    // to have some effect, and false otherwise.
+    bool isCleanable() const;
 
     // A Header is the header for the entire BlobCache serialization format. No
     // need to make this portable, so we simply write the struct out.
@@ -253,16 +278,21 @@ private:
     const size_t mMaxValueSize;
 
     // mTotalSize is the total combined size of all keys and values currently in
-    // the cache.
-    size_t mTotalSize;
+    // the cache. Space is reserved in it before an entry is added, so it never
+    // exceeds mMaxTotalSize.
+    std::atomic<size_t> mTotalSize;
+
+    // mCleanMutex serializes calls to clean, so that threads that run out of
+    // space at the same time don't evict twice as much as needed.
+    std::mutex mCleanMutex;
 
-    // mRandState is the pseudo-random number generator state. It is passed to
-    // nrand48 to generate random numbers when needed.
-    unsigned short mRandState[3];
+    // mClockHand is the index of the shard the next sweep of clean starts at.
+    // It is guarded by mCleanMutex.
+    size_t mClockHand;
 
-    // mCacheEntries stores all the cache entries that are resident in memory.
-    // Cache entries are added to it by the 'set' method.
-    std::vector<CacheEntry> mCacheEntries;
+    // mShards stores all the cache entries that are resident in memory. Cache
+    // entries are added to them by the 'set' method.
+    std::array<Shard, kShardCount> mShards;
 };
 
 } // namespace android
@@ -0,0 +1,81 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// Measures the throughput of BlobCache when several shader compilation threads look up and insert
+// entries at once. BENCHMARK_MAIN is provided by MultifileBlobCache_benchmark.cpp.
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include "BlobCache.h"
+
+namespace android {
+
+namespace {
+
+constexpr size_t kMaxKeySize = 12 * 1024;
+constexpr size_t kMaxValueSize = 64 * 1024;
+constexpr size_t kMaxTotalSize = 2 * 1024 * 1024;
+
+constexpr int kKeyCount = 1024;
+constexpr size_t kValueSize = 1024;
+
+std::unique_ptr<BlobCache> sCache;
+
+// One in every setInterval operations is a set, the others are gets.
+void getAndSet(benchmark::State& state, int setInterval) {
+    if (state.thread_index() == 0) {
+        sCache = std::make_unique<BlobCache>(kMaxKeySize, kMaxValueSize, kMaxTotalSize);
+        std::vector<uint8_t> value(kValueSize);
+        for (int key = 0; key < kKeyCount; key++) {
+            sCache->set(&key, sizeof(key), value.data(), value.size());
+        }
+    }
+
+    // The first iteration waits for every thread, so the entries are cached by then.
+    std::vector<uint8_t> value(kValueSize);
+    int i = state.thread_index() * kKeyCount / state.threads() + 1;
+    for (auto _ : state) {
+        int key = i % kKeyCount;
+        if (i % setInterval == 0) {
+            sCache->set(&key, sizeof(key), value.data(), value.size());
+        } else {
+            benchmark::DoNotOptimize(sCache->get(&key, sizeof(key), value.data(), value.size()));
+        }
+        i++;
+    }
+    state.SetItemsProcessed(state.iterations());
+
+    if (state.thread_index() == 0) {
+        sCache.reset();
+    }
+}
+
+void blobCache_getOnly(benchmark::State& state) {
+    getAndSet(state, kKeyCount + 1);
+}
+BENCHMARK(blobCache_getOnly)->ThreadRange(1, 16)->UseRealTime();
+
+void blobCache_getAndSet(benchmark::State& state) {
+    getAndSet(state, 10);
+}
+BENCHMARK(blobCache_getAndSet)->ThreadRange(1, 16)->UseRealTime();
+
+} // namespace
+
+} // namespace android
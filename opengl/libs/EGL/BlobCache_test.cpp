@@ -20,7 +20,10 @@
 #include <gtest/gtest.h>
 #include <stdio.h>
 
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 
 namespace android {
 
@@ -294,6 +297,63 @@ TEST_F(BlobCacheTest, ExceedingTotalLimitHalvesCacheSize) {
     ASSERT_EQ(maxEntries / 2 + 1, numCached);
 }
 
+TEST_F(BlobCacheTest, CleanEvictsEntriesThatWereNotReadFirst) {
+    // Fill up the entire cache with 1 char key/value pairs.
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(BlobCache::InsertResult::kInserted, mBC->set(&k, 1, "x", 1));
+    }
+    // Read the first two entries, so they get a second chance during the clean.
+    for (int i = 0; i < 2; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+    {
+        uint8_t k = maxEntries;
+        ASSERT_EQ(BlobCache::InsertResult::kDidClean, mBC->set(&k, 1, "x", 1));
+    }
+    for (int i = 0; i < 2; i++) {
+        uint8_t k = i;
+        ASSERT_EQ(size_t(1), mBC->get(&k, 1, nullptr, 0));
+    }
+}
+
+TEST_F(BlobCacheTest, ConcurrentSetsAndGetsReturnConsistentValues) {
+    static constexpr int kThreadCount = 8;
+    static constexpr int kKeysPerThread = 64;
+    static constexpr size_t kValueSize = 64;
+    // Leave room for a quarter of the entries, so the threads also clean.
+    mBC.reset(new BlobCache(sizeof(int), kValueSize,
+                            kThreadCount * kKeysPerThread * (sizeof(int) + kValueSize) / 4));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+        threads.emplace_back([this, t]() {
+            uint8_t value[kValueSize];
+            for (int round = 0; round < 16; round++) {
+                for (int i = 0; i < kKeysPerThread; i++) {
+                    // Keys are shared between threads, but the value is derived from the key.
+                    int k = (t * kKeysPerThread / 2 + i) % (kThreadCount * kKeysPerThread);
+                    memset(value, k & 0xff, kValueSize);
+                    mBC->set(&k, sizeof(k), value, kValueSize);
+
+                    memset(value, 0xee, kValueSize);
+                    size_t size = mBC->get(&k, sizeof(k), value, kValueSize);
+                    if (size != 0) {
+                        ASSERT_EQ(kValueSize, size);
+                        ASSERT_EQ(k & 0xff, value[0]);
+                        ASSERT_EQ(k & 0xff, value[kValueSize - 1]);
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 TEST_F(BlobCacheTest, InvalidKeySize) {
     ASSERT_EQ(BlobCache::InsertResult::kInvalidKeySize, mBC->set("", 0, "efgh", 4));
 }
@@ -377,6 +437,95 @@ TEST_F(BlobCacheFlattenTest, FlattenDoesntChangeCache) {
     }
 }
 
+TEST_F(BlobCacheFlattenTest, FlattenIsIndependentOfInsertionOrder) {
+    const int maxEntries = MAX_TOTAL_SIZE / 2;
+    for (int i = 0; i < maxEntries; i++) {
+        uint8_t k = i;
+        mBC->set(&k, 1, &k, 1);
+    }
+    for (int i = maxEntries - 1; i >= 0; i--) {
+        uint8_t k = i;
+        mBC2->set(&k, 1, &k, 1);
+    }
+
+    size_t size = mBC->getFlattenedSize();
+    ASSERT_EQ(size, mBC2->getFlattenedSize());
+    std::vector<uint8_t> flat(size);
+    std::vector<uint8_t> flat2(size);
+    ASSERT_EQ(OK, mBC->flatten(flat.data(), size));
+    ASSERT_EQ(OK, mBC2->flatten(flat2.data(), size));
+    ASSERT_EQ(flat, flat2);
+}
+
+TEST_F(BlobCacheFlattenTest, FlattenAfterUnflattenIsIdentical) {
+    mBC->set("abcd", 4, "efgh", 4);
+    mBC->set("z", 1, "y", 1);
+
+    size_t size = mBC->getFlattenedSize();
+    std::vector<uint8_t> flat(size);
+    ASSERT_EQ(OK, mBC->flatten(flat.data(), size));
+    ASSERT_EQ(OK, mBC2->unflatten(flat.data(), size));
+
+    ASSERT_EQ(size, mBC2->getFlattenedSize());
+    std::vector<uint8_t> flat2(size);
+    ASSERT_EQ(OK, mBC2->flatten(flat2.data(), size));
+    ASSERT_EQ(flat, flat2);
+}
+
+TEST_F(BlobCacheFlattenTest, FlattenWhileSettingFromOtherThreads) {
+    static constexpr int kThreadCount = 4;
+    static constexpr int kKeyCount = 256;
+    static constexpr size_t kValueSize = 32;
+    // Leave room for half of the entries, so the setters also clean.
+    mBC.reset(new BlobCache(sizeof(int), kValueSize,
+                            kKeyCount * (sizeof(int) + kValueSize) / 2));
+    mBC2.reset(new BlobCache(sizeof(int), kValueSize,
+                             kKeyCount * (sizeof(int) + kValueSize) / 2));
+
+    std::atomic<bool> done = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreadCount; t++) {
+        threads.emplace_back([this, t, &done]() {
+            uint8_t value[kValueSize];
+            for (int i = t; !done; i = (i + kThreadCount) % kKeyCount) {
+                memset(value, i & 0xff, kValueSize);
+                mBC->set(&i, sizeof(i), value, kValueSize);
+            }
+        });
+    }
+
+    // Every flatten must see a consistent snapshot, even though the cache
+    // grows and shrinks while it runs.
+    for (int i = 0; i < 200; i++) {
+        std::vector<uint8_t> flat;
+        mBC->flatten(&flat, 0);
+        ASSERT_EQ(OK, mBC2->unflatten(flat.data(), flat.size()));
+        for (int k = 0; k < kKeyCount; k++) {
+            uint8_t value[kValueSize];
+            size_t size = mBC2->get(&k, sizeof(k), value, kValueSize);
+            if (size != 0) {
+                ASSERT_EQ(kValueSize, size);
+                ASSERT_EQ(k & 0xff, value[0]);
+            }
+        }
+    }
+
+    done = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+TEST_F(BlobCacheFlattenTest, FlattenLeavesRoomForCallerHeader) {
+    mBC->set("abcd", 4, "efgh", 4);
+    std::vector<uint8_t> flat;
+    mBC->flatten(&flat, 8);
+    ASSERT_EQ(mBC->getFlattenedSize() + 8, flat.size());
+    ASSERT_EQ(OK, mBC2->unflatten(flat.data() + 8, flat.size() - 8));
+    unsigned char buf[4];
+    ASSERT_EQ(size_t(4), mBC2->get("abcd", 4, buf, 4));
+}
+
 TEST_F(BlobCacheFlattenTest, FlattenCatchesBufferTooSmall) {
     // Fill up the entire cache with 1 char key/value pairs.
     const int maxEntries = MAX_TOTAL_SIZE / 2;
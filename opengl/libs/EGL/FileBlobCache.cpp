@@ -21,6 +21,8 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -32,9 +34,24 @@
 // Cache file header
 static const char* cacheFileMagic = "EGL$";
 static const size_t cacheFileHeaderSize = 8;
+static const char* tempFileSuffix = ".tmp";
+
+// Journal file header, followed by the CRC of the cache file contents the
+// journal applies to.
+static const char* journalFileMagic = "EGJ$";
+static const size_t journalHeaderSize = 8;
+static const char* journalFileSuffix = ".journal";
 
 namespace android {
 
+// Header of each journal record. It is followed by the key and the value. The
+// CRC covers the rest of the header, the key and the value.
+struct JournalRecordHeader {
+    uint32_t mCrc;
+    uint32_t mKeySize;
+    uint32_t mValueSize;
+};
+
 uint32_t GenerateCRC32(const uint8_t *data, size_t size)
 {
     const unsigned long initialValue = crc32_z(0u, nullptr, 0u);
@@ -42,11 +59,79 @@ uint32_t GenerateCRC32(const uint8_t *data, size_t size)
 }
 
 FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-        const std::string& filename)
+        const std::string& filename, bool journal)
         : BlobCache(maxKeySize, maxValueSize, maxTotalSize)
-        , mFilename(filename) {
+        , mFilename(filename)
+        , mJournalFd(-1)
+        , mJournalSize(0)
+        , mBytesWritten(0)
+        , mWriterIdle(true)
+        , mExitRequested(false) {
     ATRACE_CALL();
 
+    uint32_t baseCrc;
+    readCacheFile(&baseCrc);
+
+    if (journal && mFilename.length() > 0) {
+        if (openJournal(baseCrc)) {
+            mJournalThread = std::thread(&FileBlobCache::processJournal, this);
+        } else if (mJournalFd != -1) {
+            // Fall back to rewriting the whole cache file.
+            close(mJournalFd);
+            mJournalFd = -1;
+        }
+    }
+}
+
+FileBlobCache::~FileBlobCache() {
+    if (mJournalThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mJournalMutex);
+            mExitRequested = true;
+        }
+        mWorkAvailableCondition.notify_one();
+        mJournalThread.join();
+    }
+    if (mJournalFd != -1) {
+        close(mJournalFd);
+    }
+}
+
+BlobCache::InsertResult FileBlobCache::set(const void* key, size_t keySize, const void* value,
+        size_t valueSize) {
+    InsertResult result = BlobCache::set(key, keySize, value, valueSize);
+    if (mJournalFd == -1 ||
+            (result != InsertResult::kInserted && result != InsertResult::kDidClean)) {
+        return result;
+    }
+
+    // Serialize the record here, so the writer thread only has to copy the
+    // pending records to the journal.
+    JournalRecordHeader header;
+    header.mKeySize = keySize;
+    header.mValueSize = valueSize;
+    uLong crc = crc32_z(0u, nullptr, 0u);
+    crc = crc32_z(crc, reinterpret_cast<const Bytef*>(&header.mKeySize),
+            sizeof(header) - offsetof(JournalRecordHeader, mKeySize));
+    crc = crc32_z(crc, static_cast<const Bytef*>(key), keySize);
+    crc = crc32_z(crc, static_cast<const Bytef*>(value), valueSize);
+    header.mCrc = static_cast<uint32_t>(crc);
+
+    {
+        std::lock_guard<std::mutex> lock(mJournalMutex);
+        const uint8_t* headerBytes = reinterpret_cast<const uint8_t*>(&header);
+        const uint8_t* keyBytes = static_cast<const uint8_t*>(key);
+        const uint8_t* valueBytes = static_cast<const uint8_t*>(value);
+        mPendingRecords.insert(mPendingRecords.end(), headerBytes, headerBytes + sizeof(header));
+        mPendingRecords.insert(mPendingRecords.end(), keyBytes, keyBytes + keySize);
+        mPendingRecords.insert(mPendingRecords.end(), valueBytes, valueBytes + valueSize);
+    }
+    mWorkAvailableCondition.notify_one();
+    return result;
+}
+
+bool FileBlobCache::readCacheFile(uint32_t* outCrc) {
+    *outCrc = 0;
     if (mFilename.length() > 0) {
         size_t headerSize = cacheFileHeaderSize;
 
@@ -56,14 +141,14 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
                 ALOGE("error opening cache file %s: %s (%d)", mFilename.c_str(),
                         strerror(errno), errno);
             }
-            return;
+            return false;
         }
 
         struct stat statBuf;
         if (fstat(fd, &statBuf) == -1) {
             ALOGE("error stat'ing cache file: %s (%d)", strerror(errno), errno);
             close(fd);
-            return;
+            return false;
         }
 
         // Check the size before trying to mmap it.
@@ -72,7 +157,7 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             ALOGE("cache file is too large: %#" PRIx64,
                   static_cast<off64_t>(statBuf.st_size));
             close(fd);
-            return;
+            return false;
         }
 
         uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize,
@@ -81,7 +166,7 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
             ALOGE("error mmaping cache file: %s (%d)", strerror(errno),
                     errno);
             close(fd);
-            return;
+            return false;
         }
 
         // Check the file magic and CRC
@@ -89,13 +174,13 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
         if (memcmp(buf, cacheFileMagic, 4) != 0) {
             ALOGE("cache file has bad mojo");
             close(fd);
-            return;
+            return false;
         }
         uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
         if (GenerateCRC32(buf + headerSize, cacheSize) != *crc) {
             ALOGE("cache file failed CRC check");
             close(fd);
-            return;
+            return false;
         }
 
         int err = unflatten(buf + headerSize, cacheSize);
@@ -104,33 +189,66 @@ FileBlobCache::FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxT
                     -err);
             munmap(buf, fileSize);
             close(fd);
-            return;
+            return false;
         }
 
+        *outCrc = *crc;
         munmap(buf, fileSize);
         close(fd);
+        return true;
     }
+    return false;
 }
 
+
 void FileBlobCache::writeToFile() {
     ATRACE_CALL();
 
+    if (mJournalThread.joinable()) {
+        std::unique_lock<std::mutex> lock(mJournalMutex);
+        mWriterIdleCondition.wait(lock,
+                [this] { return mPendingRecords.empty() && mWriterIdle; });
+        return;
+    }
+
+    uint32_t crc;
+    writeCacheFile(&crc);
+}
+
+bool FileBlobCache::writeCacheFile(uint32_t* outCrc) {
     if (mFilename.length() > 0) {
-        size_t cacheSize = getFlattenedSize();
         size_t headerSize = cacheFileHeaderSize;
-        const char* fname = mFilename.c_str();
+
+        // Flatten the contents before touching the file. Sizing the buffer and
+        // flattening happen under the same shard locks, so sets from other
+        // threads can't make the flatten fail.
+        std::vector<uint8_t> buf;
+        flatten(&buf, headerSize);
+        size_t fileSize = buf.size();
+        size_t cacheSize = fileSize - headerSize;
+
+        // Write the file magic and CRC
+        memcpy(buf.data(), cacheFileMagic, 4);
+        uint32_t crc = GenerateCRC32(buf.data() + headerSize, cacheSize);
+        memcpy(buf.data() + 4, &crc, sizeof(crc));
+
+        // Write the new contents to a temporary file and rename it over the
+        // cache file, so a failed write leaves the previous cache file, and
+        // the journal written on top of it, intact.
+        std::string tempName = mFilename + tempFileSuffix;
+        const char* fname = tempName.c_str();
 
         // Try to create the file with no permissions so we can write it
         // without anyone trying to read it.
         int fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
         if (fd == -1) {
             if (errno == EEXIST) {
-                // The file exists, delete it and try again.
+                // A previous write was interrupted, delete it and try again.
                 if (unlink(fname) == -1) {
                     // No point in retrying if the unlink failed.
                     ALOGE("error unlinking cache file %s: %s (%d)", fname,
                             strerror(errno), errno);
-                    return;
+                    return false;
                 }
                 // Retry now that we've unlinked the file.
                 fd = open(fname, O_CREAT | O_EXCL | O_RDWR, 0);
@@ -138,48 +256,177 @@ void FileBlobCache::writeToFile() {
             if (fd == -1) {
                 ALOGE("error creating cache file %s: %s (%d)", fname,
                         strerror(errno), errno);
-                return;
+                return false;
             }
         }
 
-        size_t fileSize = headerSize + cacheSize;
-
-        uint8_t* buf = new uint8_t [fileSize];
-        if (!buf) {
-            ALOGE("error allocating buffer for cache contents: %s (%d)",
-                    strerror(errno), errno);
+        if (write(fd, buf.data(), fileSize) != static_cast<ssize_t>(fileSize)) {
+            ALOGE("error writing cache file: %s (%d)", strerror(errno),
+                    errno);
             close(fd);
             unlink(fname);
-            return;
+            return false;
         }
 
-        int err = flatten(buf + headerSize, cacheSize);
-        if (err < 0) {
-            ALOGE("error writing cache contents: %s (%d)", strerror(-err),
-                    -err);
-            delete [] buf;
-            close(fd);
+        fchmod(fd, S_IRUSR);
+        close(fd);
+
+        if (rename(fname, mFilename.c_str()) == -1) {
+            ALOGE("error renaming cache file %s: %s (%d)", fname,
+                    strerror(errno), errno);
             unlink(fname);
-            return;
+            return false;
         }
 
-        // Write the file magic and CRC
-        memcpy(buf, cacheFileMagic, 4);
-        uint32_t* crc = reinterpret_cast<uint32_t*>(buf + 4);
-        *crc = GenerateCRC32(buf + headerSize, cacheSize);
+        mBytesWritten += fileSize;
+        *outCrc = crc;
+        return true;
+    }
+    return false;
+}
 
-        if (write(fd, buf, fileSize) == -1) {
-            ALOGE("error writing cache file: %s (%d)", strerror(errno),
-                    errno);
-            delete [] buf;
-            close(fd);
-            unlink(fname);
-            return;
+
+bool FileBlobCache::openJournal(uint32_t baseCrc) {
+    ATRACE_CALL();
+
+    std::string journalName = mFilename + journalFileSuffix;
+    mJournalFd = open(journalName.c_str(), O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+    if (mJournalFd == -1) {
+        ALOGE("error opening cache journal %s: %s (%d)", journalName.c_str(),
+                strerror(errno), errno);
+        return false;
+    }
+
+    struct stat statBuf;
+    if (fstat(mJournalFd, &statBuf) == -1) {
+        ALOGE("error stat'ing cache journal: %s (%d)", strerror(errno), errno);
+        return false;
+    }
+
+    size_t fileSize = statBuf.st_size;
+    if (fileSize < journalHeaderSize || fileSize > mMaxTotalSize * 2) {
+        return resetJournal(baseCrc);
+    }
+
+    uint8_t* buf = reinterpret_cast<uint8_t*>(mmap(nullptr, fileSize,
+            PROT_READ, MAP_PRIVATE, mJournalFd, 0));
+    if (buf == MAP_FAILED) {
+        ALOGE("error mmaping cache journal: %s (%d)", strerror(errno), errno);
+        return resetJournal(baseCrc);
+    }
+
+    // A journal written on top of another version of the cache file doesn't
+    // apply to this one. The entries it holds were folded into the cache file
+    // when it was rewritten.
+    uint32_t journalBaseCrc;
+    memcpy(&journalBaseCrc, buf + 4, sizeof(journalBaseCrc));
+    if (memcmp(buf, journalFileMagic, 4) != 0 || journalBaseCrc != baseCrc) {
+        ALOGV("discarding cache journal that doesn't match the cache file");
+        munmap(buf, fileSize);
+        return resetJournal(baseCrc);
+    }
+
+    // Replay the records until the first one that is incomplete or fails its
+    // CRC check, which is where a write was interrupted.
+    size_t offset = journalHeaderSize;
+    while (offset + sizeof(JournalRecordHeader) <= fileSize) {
+        JournalRecordHeader header;
+        memcpy(&header, buf + offset, sizeof(header));
+        size_t recordSize = sizeof(header) + header.mKeySize + header.mValueSize;
+        if (header.mKeySize > fileSize || header.mValueSize > fileSize ||
+                offset + recordSize > fileSize) {
+            break;
+        }
+        const uint8_t* record = buf + offset;
+        if (GenerateCRC32(record + offsetof(JournalRecordHeader, mKeySize),
+                recordSize - offsetof(JournalRecordHeader, mKeySize)) != header.mCrc) {
+            break;
         }
+        const uint8_t* key = record + sizeof(header);
+        BlobCache::set(key, header.mKeySize, key + header.mKeySize, header.mValueSize);
+        offset += recordSize;
+    }
+    munmap(buf, fileSize);
 
-        delete [] buf;
-        fchmod(fd, S_IRUSR);
-        close(fd);
+    if (offset < fileSize) {
+        ALOGW("dropping %zu bytes from the end of the cache journal", fileSize - offset);
+        if (ftruncate(mJournalFd, offset) == -1) {
+            ALOGE("error truncating cache journal: %s (%d)", strerror(errno), errno);
+            return resetJournal(baseCrc);
+        }
+    }
+    mJournalSize = offset;
+    return true;
+}
+
+bool FileBlobCache::resetJournal(uint32_t baseCrc) {
+    uint8_t header[journalHeaderSize];
+    memcpy(header, journalFileMagic, 4);
+    memcpy(header + 4, &baseCrc, sizeof(baseCrc));
+    if (ftruncate(mJournalFd, 0) == -1 ||
+            pwrite(mJournalFd, header, sizeof(header), 0) != sizeof(header)) {
+        ALOGE("error resetting cache journal: %s (%d)", strerror(errno), errno);
+        return false;
+    }
+    mBytesWritten += sizeof(header);
+    mJournalSize = sizeof(header);
+    return true;
+}
+
+bool FileBlobCache::appendToJournal(const std::vector<uint8_t>& records) {
+    ATRACE_CALL();
+
+    ssize_t written = pwrite(mJournalFd, records.data(), records.size(), mJournalSize);
+    if (written != static_cast<ssize_t>(records.size())) {
+        ALOGE("error appending to cache journal: %s (%d)", strerror(errno), errno);
+        // Drop the partial write, so later records aren't appended after a
+        // torn one.
+        if (ftruncate(mJournalFd, mJournalSize) == -1) {
+            ALOGE("error truncating cache journal: %s (%d)", strerror(errno), errno);
+        }
+        return false;
+    }
+    mBytesWritten += records.size();
+    mJournalSize += records.size();
+    return true;
+}
+
+void FileBlobCache::compactJournal() {
+    ATRACE_CALL();
+
+    // The records still pending are appended to the new journal, so they
+    // aren't lost even if the flattened contents already hold them.
+    uint32_t crc;
+    if (!writeCacheFile(&crc)) {
+        return;
+    }
+    resetJournal(crc);
+}
+
+void FileBlobCache::processJournal() {
+    std::vector<uint8_t> records;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mJournalMutex);
+            mWriterIdle = true;
+            mWriterIdleCondition.notify_all();
+            mWorkAvailableCondition.wait(lock,
+                    [this] { return !mPendingRecords.empty() || mExitRequested; });
+            if (mPendingRecords.empty()) {
+                return;
+            }
+            records.clear();
+            records.swap(mPendingRecords);
+            mWriterIdle = false;
+        }
+
+        appendToJournal(records);
+
+        // Fold the journal into the cache file once replaying it would cost
+        // about as much as reading a full cache file.
+        if (mJournalSize > mMaxTotalSize) {
+            compactJournal();
+        }
     }
 }
 
@@ -18,31 +18,92 @@
 #define ANDROID_FILE_BLOB_CACHE_H
 
 #include "BlobCache.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace android {
 
 uint32_t GenerateCRC32(const uint8_t *data, size_t size);
 
+// A FileBlobCache saves the contents of a BlobCache to a single cache file.
+//
+// In journal mode, entries set in the cache are also appended to a journal
+// file next to the cache file by a writer thread, so saving the cache doesn't
+// rewrite the whole cache file. Each journal record has its own CRC, and the
+// journal header records the CRC of the cache file it applies to. Startup
+// replays the valid records of a matching journal on top of the cache file.
+// Once the journal grows past maxTotalSize, the writer thread rewrites the
+// cache file and starts a new journal.
 class FileBlobCache : public BlobCache {
 public:
     // FileBlobCache attempts to load the saved cache contents from disk into
     // BlobCache.
     FileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-            const std::string& filename);
+            const std::string& filename, bool journal = false);
+    ~FileBlobCache() override;
+
+    // set inserts the key/value pair into BlobCache. In journal mode, the pair
+    // is also queued to be appended to the journal.
+    InsertResult set(const void* key, size_t keySize, const void* value,
+                     size_t valueSize) override;
 
     // writeToFile attempts to save the current contents of BlobCache to
-    // disk.
+    // disk. In journal mode, it only waits for the queued entries to be
+    // appended to the journal.
     void writeToFile();
 
     // Return the total size of the cache
     size_t getSize();
 
+    // Return the number of bytes written to the cache and journal files, used
+    // to measure write amplification.
+    size_t getBytesWritten() const { return mBytesWritten; }
+
 private:
+    // readCacheFile loads the cache file into BlobCache, and returns the CRC
+    // of its contents in outCrc.
+    bool readCacheFile(uint32_t* outCrc);
+
+    // writeCacheFile rewrites the cache file with the flattened contents of
+    // BlobCache, and returns the CRC of the contents in outCrc.
+    bool writeCacheFile(uint32_t* outCrc);
+
+    // openJournal replays the journal on top of the loaded cache file, and
+    // opens it to append further entries. A journal that doesn't apply to the
+    // cache file with the CRC baseCrc is discarded.
+    bool openJournal(uint32_t baseCrc);
+    bool resetJournal(uint32_t baseCrc);
+    bool appendToJournal(const std::vector<uint8_t>& records);
+    void compactJournal();
+    void processJournal();
+
     // mFilename is the name of the file for storing cache contents.
     std::string mFilename;
+
+    // mJournalFd is the journal file, or -1 when not in journal mode. It
+    // doesn't change after construction, and the journal is only written by
+    // the writer thread once it is started.
+    int mJournalFd;
+    size_t mJournalSize;
+
+    std::atomic<size_t> mBytesWritten;
+
+    // Below are the components used for the journal writer thread
+    std::thread mJournalThread;
+    std::mutex mJournalMutex;
+    std::condition_variable mWorkAvailableCondition;
+    std::condition_variable mWriterIdleCondition;
+    // mPendingRecords holds the serialized records waiting to be appended.
+    std::vector<uint8_t> mPendingRecords;
+    bool mWriterIdle;
+    bool mExitRequested;
 };
 
 } // namespace android
 
-#endif // ANDROID_BLOB_CACHE_H
+#endif // ANDROID_FILE_BLOB_CACHE_H
@@ -0,0 +1,301 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#include "FileBlobCache.h"
+
+#include <android-base/test_utils.h>
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+constexpr size_t kMaxKeySize = 12 * 1024;
+constexpr size_t kMaxValueSize = 64 * 1024;
+constexpr size_t kMaxTotalSize = 2 * 1024 * 1024;
+
+class FileBlobCacheTest : public ::testing::TestWithParam<bool> {
+protected:
+    virtual void SetUp() {
+        mTempDir.reset(new TemporaryDir());
+        mFilename = std::string(mTempDir->path) + "/cache";
+        reopenCache();
+    }
+
+    virtual void TearDown() { mCache.reset(); }
+
+    void reopenCache() {
+        mCache.reset();
+        mCache.reset(
+                new FileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, mFilename, GetParam()));
+    }
+
+    std::string getJournalFilename() const { return mFilename + ".journal"; }
+
+    std::unique_ptr<TemporaryDir> mTempDir;
+    std::string mFilename;
+    std::unique_ptr<FileBlobCache> mCache;
+};
+
+TEST_P(FileBlobCacheTest, EntriesPersistAcrossInstances) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mCache->set("abcd", 4, "efgh", 4);
+    mCache->set("ijkl", 4, "mnop", 4);
+    mCache->writeToFile();
+
+    reopenCache();
+    ASSERT_EQ(size_t(4), mCache->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('h', buf[3]);
+    ASSERT_EQ(size_t(4), mCache->get("ijkl", 4, buf, 4));
+    ASSERT_EQ('m', buf[0]);
+    ASSERT_EQ('p', buf[3]);
+}
+
+TEST_P(FileBlobCacheTest, LatestValuePersists) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mCache->set("abcd", 4, "efgh", 4);
+    mCache->writeToFile();
+    mCache->set("abcd", 4, "ijkl", 4);
+    mCache->writeToFile();
+
+    reopenCache();
+    ASSERT_EQ(size_t(4), mCache->get("abcd", 4, buf, 4));
+    ASSERT_EQ('i', buf[0]);
+    ASSERT_EQ('l', buf[3]);
+}
+
+// Save the cache after every few entries, as the deferred save in egl_cache does, and report how
+// many bytes reach the disk for each byte inserted and how long a save takes.
+TEST_P(FileBlobCacheTest, MeasureWriteAmplificationAndSaveLatency) {
+    constexpr int kEntryCount = 512;
+    constexpr int kEntriesPerSave = 8;
+    constexpr size_t kValueSize = 2 * 1024;
+
+    std::vector<uint8_t> value(kValueSize);
+    size_t bytesInserted = 0;
+    std::chrono::nanoseconds saveTime(0);
+    for (int i = 0; i < kEntryCount; i++) {
+        std::fill(value.begin(), value.end(), static_cast<uint8_t>(i));
+        mCache->set(&i, sizeof(i), value.data(), value.size());
+        bytesInserted += sizeof(i) + value.size();
+
+        if ((i + 1) % kEntriesPerSave == 0) {
+            auto start = std::chrono::steady_clock::now();
+            mCache->writeToFile();
+            saveTime += std::chrono::steady_clock::now() - start;
+        }
+    }
+
+    const size_t bytesWritten = mCache->getBytesWritten();
+    const double writeAmplification = static_cast<double>(bytesWritten) / bytesInserted;
+    const auto saveLatency = saveTime / (kEntryCount / kEntriesPerSave);
+    RecordProperty("write_amplification_percent", static_cast<int>(writeAmplification * 100));
+    RecordProperty("save_latency_us",
+                   static_cast<int>(
+                           std::chrono::duration_cast<std::chrono::microseconds>(saveLatency)
+                                   .count()));
+
+    if (GetParam()) {
+        // Each entry is written to the journal once, and the journal never grows past the cache
+        // limit, so at most one compaction rewrites the cache file.
+        ASSERT_LT(writeAmplification, 2.5);
+    } else {
+        // Every save rewrites all the entries inserted so far.
+        ASSERT_GT(writeAmplification, 10.0);
+    }
+
+    reopenCache();
+    for (int i = 0; i < kEntryCount; i++) {
+        ASSERT_EQ(kValueSize, mCache->get(&i, sizeof(i), value.data(), value.size()));
+        ASSERT_EQ(static_cast<uint8_t>(i), value[0]);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(FileBlobCacheTests, FileBlobCacheTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return info.param ? "Journal" : "Full";
+                         });
+
+class FileBlobCacheJournalTest : public FileBlobCacheTest {};
+
+TEST_P(FileBlobCacheJournalTest, SavesDontRewriteCacheFile) {
+    mCache->set("abcd", 4, "efgh", 4);
+    mCache->writeToFile();
+
+    struct stat statBuf;
+    ASSERT_EQ(-1, stat(mFilename.c_str(), &statBuf));
+    ASSERT_EQ(0, stat(getJournalFilename().c_str(), &statBuf));
+    ASSERT_GT(statBuf.st_size, 0);
+}
+
+TEST_P(FileBlobCacheJournalTest, TornRecordIsDropped) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mCache->set("abcd", 4, "efgh", 4);
+    mCache->set("ijkl", 4, "mnop", 4);
+    mCache->writeToFile();
+    mCache.reset();
+
+    // Cut the last record short, as if the process died while appending it.
+    struct stat statBuf;
+    ASSERT_EQ(0, stat(getJournalFilename().c_str(), &statBuf));
+    ASSERT_EQ(0, truncate(getJournalFilename().c_str(), statBuf.st_size - 1));
+
+    reopenCache();
+    ASSERT_EQ(size_t(4), mCache->get("abcd", 4, buf, 4));
+    ASSERT_EQ(size_t(0), mCache->get("ijkl", 4, buf, 4));
+
+    // Entries set after the torn record are kept.
+    mCache->set("qrst", 4, "uvwx", 4);
+    mCache->writeToFile();
+    reopenCache();
+    ASSERT_EQ(size_t(4), mCache->get("abcd", 4, buf, 4));
+    ASSERT_EQ(size_t(4), mCache->get("qrst", 4, buf, 4));
+    ASSERT_EQ('u', buf[0]);
+}
+
+TEST_P(FileBlobCacheJournalTest, CompactionFoldsJournalIntoCacheFile) {
+    constexpr size_t kValueSize = 32 * 1024;
+    std::vector<uint8_t> value(kValueSize);
+    // Insert twice the cache limit, so the journal is compacted at least once.
+    const int entryCount = 2 * kMaxTotalSize / kValueSize;
+    for (int i = 0; i < entryCount; i++) {
+        std::fill(value.begin(), value.end(), static_cast<uint8_t>(i));
+        mCache->set(&i, sizeof(i), value.data(), value.size());
+    }
+    mCache->writeToFile();
+
+    struct stat statBuf;
+    ASSERT_EQ(0, stat(mFilename.c_str(), &statBuf));
+    ASSERT_EQ(0, stat(getJournalFilename().c_str(), &statBuf));
+    ASSERT_LE(static_cast<size_t>(statBuf.st_size), kMaxTotalSize);
+
+    // The last entry is always in the cache after its set, so it must survive the compaction.
+    reopenCache();
+    const int last = entryCount - 1;
+    ASSERT_EQ(kValueSize, mCache->get(&last, sizeof(last), value.data(), value.size()));
+    ASSERT_EQ(static_cast<uint8_t>(last), value[0]);
+}
+
+TEST_P(FileBlobCacheJournalTest, SetsDuringCompactionArePersisted) {
+    constexpr int kThreadCount = 4;
+    constexpr int kKeysPerThread = 8;
+    constexpr int kRounds = 24;
+    constexpr size_t kValueSize = 16 * 1024;
+
+    // The keys are overwritten on every round, so the cache never evicts while the journal grows
+    // past the cache limit a few times, and the writer thread compacts it while the other threads
+    // keep setting entries.
+    std::vector<std::thread> setters;
+    for (int t = 0; t < kThreadCount; t++) {
+        setters.emplace_back([this, t]() {
+            std::vector<uint8_t> value(kValueSize);
+            for (int round = 0; round < kRounds; round++) {
+                for (int i = 0; i < kKeysPerThread; i++) {
+                    int key = t * kKeysPerThread + i;
+                    std::fill(value.begin(), value.end(), static_cast<uint8_t>(round));
+                    mCache->set(&key, sizeof(key), value.data(), value.size());
+                }
+            }
+        });
+    }
+    for (auto& setter : setters) {
+        setter.join();
+    }
+    mCache->writeToFile();
+
+    struct stat statBuf;
+    ASSERT_EQ(0, stat(mFilename.c_str(), &statBuf));
+
+    reopenCache();
+    std::vector<uint8_t> value(kValueSize);
+    for (int key = 0; key < kThreadCount * kKeysPerThread; key++) {
+        SCOPED_TRACE(key);
+        ASSERT_EQ(kValueSize, mCache->get(&key, sizeof(key), value.data(), value.size()));
+        ASSERT_EQ(static_cast<uint8_t>(kRounds - 1), value[0]);
+        ASSERT_EQ(static_cast<uint8_t>(kRounds - 1), value[kValueSize - 1]);
+    }
+}
+
+TEST_P(FileBlobCacheJournalTest, FailedCompactionKeepsCacheFile) {
+    constexpr int kKeyCount = 32;
+    constexpr size_t kValueSize = 16 * 1024;
+    std::vector<uint8_t> value(kValueSize);
+    auto setRound = [&](int round) {
+        std::fill(value.begin(), value.end(), static_cast<uint8_t>(round));
+        for (int key = 0; key < kKeyCount; key++) {
+            mCache->set(&key, sizeof(key), value.data(), value.size());
+        }
+    };
+
+    // Overwrite the keys until the journal has been compacted into a cache file.
+    int round = 0;
+    struct stat statBuf;
+    while (stat(mFilename.c_str(), &statBuf) == -1) {
+        ASSERT_LT(round, 16);
+        setRound(round++);
+        mCache->writeToFile();
+    }
+
+    // Block the temporary file the next compactions write, so they fail. The journal keeps
+    // growing on top of the existing cache file instead.
+    const std::string tempFilename = mFilename + ".tmp";
+    ASSERT_EQ(0, mkdir(tempFilename.c_str(), S_IRWXU));
+    const int lastRound = round + kMaxTotalSize / (kKeyCount * kValueSize);
+    while (round <= lastRound) {
+        setRound(round++);
+    }
+    mCache->writeToFile();
+    ASSERT_EQ(0, stat(mFilename.c_str(), &statBuf));
+
+    reopenCache();
+    for (int key = 0; key < kKeyCount; key++) {
+        SCOPED_TRACE(key);
+        ASSERT_EQ(kValueSize, mCache->get(&key, sizeof(key), value.data(), value.size()));
+        ASSERT_EQ(static_cast<uint8_t>(lastRound), value[0]);
+    }
+    ASSERT_EQ(0, rmdir(tempFilename.c_str()));
+}
+
+TEST_P(FileBlobCacheJournalTest, JournalForOtherCacheFileIsDiscarded) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mCache->set("abcd", 4, "efgh", 4);
+    mCache->writeToFile();
+    mCache.reset();
+
+    // Write a cache file the journal wasn't written on top of.
+    {
+        FileBlobCache fullCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, mFilename, false);
+        fullCache.set("ijkl", 4, "mnop", 4);
+        fullCache.writeToFile();
+    }
+
+    reopenCache();
+    ASSERT_EQ(size_t(0), mCache->get("abcd", 4, buf, 4));
+    ASSERT_EQ(size_t(4), mCache->get("ijkl", 4, buf, 4));
+}
+
+INSTANTIATE_TEST_SUITE_P(FileBlobCacheJournalTests, FileBlobCacheJournalTest,
+                         ::testing::Values(true));
+
+} // namespace android
@@ -32,6 +32,7 @@
 #include <string>
 
 #include "EGL/eglext_angle.h"
+#include "egl_gl_entries.h"
 #include "egl_platform_entries.h"
 #include "egl_trace.h"
 #include "egldefs.h"
@@ -155,7 +156,8 @@ int Loader::driver_t::set(void* hnd, int32_t api)
 }
 
 Loader::Loader()
-    : getProcAddress(nullptr)
+    : getProcAddress(nullptr),
+      lazyGlEntries(base::GetBoolProperty("debug.egl.lazy_gl_entries", true))
 {
 }
 
@@ -381,75 +383,6 @@ void Loader::close(egl_connection_t* cnx)
     cnx->angleLoaded = false;
 }
 
-void Loader::init_api(void* dso,
-        char const * const * api,
-        char const * const * ref_api,
-        __eglMustCastToProperFunctionPointerType* curr,
-        getProcAddressType getProcAddress)
-{
-    ATRACE_CALL();
-
-    const ssize_t SIZE = 256;
-    char scrap[SIZE];
-    while (*api) {
-        char const * name = *api;
-        if (ref_api) {
-            char const * ref_name = *ref_api;
-            if (std::strcmp(name, ref_name) != 0) {
-                *curr++ = nullptr;
-                ref_api++;
-                continue;
-            }
-        }
-
-        __eglMustCastToProperFunctionPointerType f =
-            (__eglMustCastToProperFunctionPointerType)dlsym(dso, name);
-        if (f == nullptr) {
-            // couldn't find the entry-point, use eglGetProcAddress()
-            f = getProcAddress(name);
-        }
-        if (f == nullptr) {
-            // Try without the OES postfix
-            ssize_t index = ssize_t(strlen(name)) - 3;
-            if ((index>0 && (index<SIZE-1)) && (!strcmp(name+index, "OES"))) {
-                strncpy(scrap, name, index);
-                scrap[index] = 0;
-                f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
-                //ALOGD_IF(f, "found <%s> instead", scrap);
-            }
-        }
-        if (f == nullptr) {
-            // Try with the OES postfix
-            ssize_t index = ssize_t(strlen(name)) - 3;
-            if (index>0 && strcmp(name+index, "OES")) {
-                snprintf(scrap, SIZE, "%sOES", name);
-                f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
-                //ALOGD_IF(f, "found <%s> instead", scrap);
-            }
-        }
-        if (f == nullptr) {
-            //ALOGD("%s", name);
-            f = (__eglMustCastToProperFunctionPointerType)gl_unimplemented;
-
-            /*
-             * GL_EXT_debug_marker is special, we always report it as
-             * supported, it's handled by GLES_trace. If GLES_trace is not
-             * enabled, then these are no-ops.
-             */
-            if (!strcmp(name, "glInsertEventMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            } else if (!strcmp(name, "glPushGroupMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            } else if (!strcmp(name, "glPopGroupMarkerEXT")) {
-                f = (__eglMustCastToProperFunctionPointerType)gl_noop;
-            }
-        }
-        *curr++ = f;
-        api++;
-        if (ref_api) ref_api++;
-    }
-}
-
 static std::string findLibrary(const std::string libraryName, const std::string searchPath,
                                const bool exact) {
     if (exact) {
@@ -485,9 +418,7 @@ static std::string findLibrary(const std::string libraryName, const std::string
     return std::string();
 }
 
-static void* load_system_driver(const char* kind, const char* suffix, const bool exact) {
-    ATRACE_CALL();
-
+static std::string find_system_driver(const char* kind, const char* suffix, const bool exact) {
     std::string libraryName = std::string("lib") + kind;
     if (suffix) {
         libraryName += std::string("_") + suffix;
@@ -499,15 +430,16 @@ static void* load_system_driver(const char* kind, const char* suffix, const bool
         libraryName += std::string("_");
     }
 
+    const bool isSuffixAngle = suffix != nullptr && strcmp(suffix, ANGLE_SUFFIX_VALUE) == 0;
+    return findLibrary(libraryName, isSuffixAngle ? SYSTEM_LIB_PATH : VENDOR_LIB_EGL_DIR, exact);
+}
+
+static void* open_system_driver(const std::string& absolutePath, const char* suffix) {
+    ATRACE_CALL();
+
     void* dso = nullptr;
 
     const bool isSuffixAngle = suffix != nullptr && strcmp(suffix, ANGLE_SUFFIX_VALUE) == 0;
-    const std::string absolutePath =
-            findLibrary(libraryName, isSuffixAngle ? SYSTEM_LIB_PATH : VENDOR_LIB_EGL_DIR, exact);
-    if (absolutePath.empty()) {
-        // this happens often, we don't want to log an error
-        return nullptr;
-    }
     const char* const driverAbsolutePath = absolutePath.c_str();
 
     // Currently the default driver is unlikely to be ANGLE on most devices,
@@ -537,8 +469,26 @@ static void* load_system_driver(const char* kind, const char* suffix, const bool
     return dso;
 }
 
-static void* load_angle(const char* kind, android_namespace_t* ns) {
-    std::string name = std::string("lib") + kind + "_angle.so";
+static void* load_system_driver(const char* kind, const char* suffix, const bool exact) {
+    const std::string absolutePath = find_system_driver(kind, suffix, exact);
+    if (absolutePath.empty()) {
+        // this happens often, we don't want to log an error
+        return nullptr;
+    }
+    return open_system_driver(absolutePath, suffix);
+}
+
+static std::string find_angle(const char* kind) {
+    if (!android::GraphicsEnv::getInstance().shouldUseSystemAngle()) {
+        auto prop = base::GetProperty("debug.angle.libs.suffix", "");
+        if (!prop.empty()) {
+            return std::string("lib") + kind + "_" + prop + ".so";
+        }
+    }
+    return std::string("lib") + kind + "_angle.so";
+}
+
+static void* open_angle(const std::string& name, android_namespace_t* ns) {
     void* so = nullptr;
 
     if (android::GraphicsEnv::getInstance().shouldUseSystemAngle()) {
@@ -548,10 +498,6 @@ static void* load_angle(const char* kind, android_namespace_t* ns) {
                 .flags = ANDROID_DLEXT_USE_NAMESPACE,
                 .library_namespace = ns,
         };
-        auto prop = base::GetProperty("debug.angle.libs.suffix", "");
-        if (!prop.empty()) {
-            name = std::string("lib") + kind + "_" + prop + ".so";
-        }
         so = do_android_dlopen_ext(name.c_str(), RTLD_LOCAL | RTLD_NOW, &dlextinfo);
     }
 
@@ -587,6 +533,38 @@ static void* load_updated_driver(const char* kind, android_namespace_t* ns) {
     return nullptr;
 }
 
+// Loads a driver split into EGL, GLESv1_CM and GLESv2 libraries. find returns the library to open
+// for a kind, or an empty string if the driver has none, and open opens it. All three libraries
+// are found first, and nothing is opened unless libEGL is found and opens.
+Loader::driver_t* Loader::load_split_driver(
+        egl_connection_t* cnx, const std::function<std::string(const char*)>& find,
+        const std::function<void*(const std::string&)>& open) {
+    ATRACE_CALL();
+
+    const std::string egl = find("EGL");
+    const std::string gles1 = find("GLESv1_CM");
+    const std::string gles2 = find("GLESv2");
+    if (egl.empty()) {
+        return nullptr;
+    }
+    void* dso = open(egl);
+    if (!dso) {
+        return nullptr;
+    }
+
+    initialize_api(dso, cnx, EGL);
+    driver_t* hnd = new driver_t(dso);
+
+    dso = gles1.empty() ? nullptr : open(gles1);
+    initialize_api(dso, cnx, GLESv1_CM);
+    hnd->set(dso, GLESv1_CM);
+
+    dso = gles2.empty() ? nullptr : open(gles2);
+    initialize_api(dso, cnx, GLESv2);
+    hnd->set(dso, GLESv2);
+    return hnd;
+}
+
 Loader::driver_t* Loader::attempt_to_load_angle(egl_connection_t* cnx) {
     ATRACE_CALL();
 
@@ -600,26 +578,13 @@ Loader::driver_t* Loader::attempt_to_load_angle(egl_connection_t* cnx) {
 
     // use ANGLE APK driver
     android::GraphicsEnv::getInstance().setDriverToLoad(android::GpuStatsInfo::Driver::ANGLE);
-    driver_t* hnd = nullptr;
 
     // ANGLE doesn't ship with GLES library, and thus we skip GLES driver.
     // b/370113081: if there is no libEGL_angle.so in namespace ns, libEGL_angle.so in system
     // partition will be loaded instead. If there is no libEGL_angle.so in system partition, no
     // angle libs are loaded, and app that sets to use ANGLE will crash.
-    void* dso = load_angle("EGL", ns);
-    if (dso) {
-        initialize_api(dso, cnx, EGL);
-        hnd = new driver_t(dso);
-
-        dso = load_angle("GLESv1_CM", ns);
-        initialize_api(dso, cnx, GLESv1_CM);
-        hnd->set(dso, GLESv1_CM);
-
-        dso = load_angle("GLESv2", ns);
-        initialize_api(dso, cnx, GLESv2);
-        hnd->set(dso, GLESv2);
-    }
-    return hnd;
+    return load_split_driver(cnx, find_angle,
+                             [ns](const std::string& name) { return open_angle(name, ns); });
 }
 
 void Loader::attempt_to_init_angle_backend(void* dso, egl_connection_t* cnx) {
@@ -654,20 +619,10 @@ Loader::driver_t* Loader::attempt_to_load_updated_driver(egl_connection_t* cnx)
         return hnd;
     }
 
-    dso = load_updated_driver("EGL", ns);
-    if (dso) {
-        initialize_api(dso, cnx, EGL);
-        hnd = new driver_t(dso);
-
-        dso = load_updated_driver("GLESv1_CM", ns);
-        initialize_api(dso, cnx, GLESv1_CM);
-        hnd->set(dso, GLESv1_CM);
-
-        dso = load_updated_driver("GLESv2", ns);
-        initialize_api(dso, cnx, GLESv2);
-        hnd->set(dso, GLESv2);
-    }
-    return hnd;
+    // The namespace's linker does the search, so there is nothing to find before opening.
+    return load_split_driver(
+            cnx, [](const char* kind) { return std::string(kind); },
+            [ns](const std::string& kind) { return load_updated_driver(kind.c_str(), ns); });
 }
 
 Loader::driver_t* Loader::attempt_to_load_system_driver(egl_connection_t* cnx, const char* suffix,
@@ -687,20 +642,12 @@ Loader::driver_t* Loader::attempt_to_load_system_driver(egl_connection_t* cnx, c
         hnd = new driver_t(dso);
         return hnd;
     }
-    dso = load_system_driver("EGL", suffix, exact);
-    if (dso) {
-        initialize_api(dso, cnx, EGL);
-        hnd = new driver_t(dso);
-
-        dso = load_system_driver("GLESv1_CM", suffix, exact);
-        initialize_api(dso, cnx, GLESv1_CM);
-        hnd->set(dso, GLESv1_CM);
-
-        dso = load_system_driver("GLESv2", suffix, exact);
-        initialize_api(dso, cnx, GLESv2);
-        hnd->set(dso, GLESv2);
-    }
-    return hnd;
+    return load_split_driver(
+            cnx,
+            [suffix, exact](const char* kind) { return find_system_driver(kind, suffix, exact); },
+            [suffix](const std::string& absolutePath) {
+                return open_system_driver(absolutePath, suffix);
+            });
 }
 
 void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
@@ -736,17 +683,21 @@ void Loader::initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask) {
     }
 
     if (mask & GLESv1_CM) {
-        init_api(dso, gl_names_1, gl_names,
-            (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
-            getProcAddress);
+        size_t eager = egl_init_gl_entries(egl_connection_t::GLESv1_INDEX, dso, gl_names_1,
+                gl_names,
+                (__eglMustCastToProperFunctionPointerType*)
+                    &cnx->hooks[egl_connection_t::GLESv1_INDEX]->gl,
+                getProcAddress, lazyGlEntries);
+        ALOGV("resolved %zu GLESv1_CM entry points eagerly", eager);
     }
 
     if (mask & GLESv2) {
-        init_api(dso, gl_names, nullptr,
-            (__eglMustCastToProperFunctionPointerType*)
-                &cnx->hooks[egl_connection_t::GLESv2_INDEX]->gl,
-            getProcAddress);
+        size_t eager = egl_init_gl_entries(egl_connection_t::GLESv2_INDEX, dso, gl_names,
+                nullptr,
+                (__eglMustCastToProperFunctionPointerType*)
+                    &cnx->hooks[egl_connection_t::GLESv2_INDEX]->gl,
+                getProcAddress, lazyGlEntries);
+        ALOGV("resolved %zu GLESv2 entry points eagerly", eager);
     }
 }
 
@@ -20,6 +20,9 @@
 #include <EGL/egl.h>
 #include <stdint.h>
 
+#include <functional>
+#include <string>
+
 namespace android {
 
 struct egl_connection_t;
@@ -42,6 +45,8 @@ class Loader {
     };
 
     getProcAddressType getProcAddress;
+    // Whether GLES extension entry points are resolved on their first call.
+    const bool lazyGlEntries;
 
 public:
     static Loader& getInstance();
@@ -58,11 +63,9 @@ private:
     void unload_system_driver(egl_connection_t* cnx);
     void initialize_api(void* dso, egl_connection_t* cnx, uint32_t mask);
     void attempt_to_init_angle_backend(void* dso, egl_connection_t* cnx);
-
-    static __attribute__((noinline)) void init_api(void* dso, const char* const* api,
-                                                   const char* const* ref_api,
-                                                   __eglMustCastToProperFunctionPointerType* curr,
-                                                   getProcAddressType getProcAddress);
+    driver_t* load_split_driver(egl_connection_t* cnx,
+                                const std::function<std::string(const char*)>& find,
+                                const std::function<void*(const std::string&)>& open);
 };
 
 }; // namespace android
@@ -0,0 +1,846 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// #define LOG_NDEBUG 0
+
+#include "MappedBlobStore.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "FileBlobCache.h"
+
+using namespace std::literals;
+
+constexpr uint32_t kMappedIndexMagic = 'MBS$';
+constexpr uint32_t kMappedEntryMagic = 'MBE$';
+
+// When trimming, the cache is reduced to the limits divided by this value
+constexpr size_t kCacheLimitDivisor = 2;
+
+// How long the worker thread waits for more changes before committing the index
+constexpr auto kIndexCommitDelay = 500ms;
+
+namespace {
+
+size_t alignEntrySize(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+size_t getSlotCount(size_t maxTotalEntries) {
+    // Keep the table at most half full with live entries
+    size_t slotCount = 16;
+    while (slotCount < maxTotalEntries * 2) {
+        slotCount *= 2;
+    }
+    return slotCount;
+}
+
+size_t getDataCapacity(size_t maxTotalSize) {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (maxTotalSize * 2 + pageSize - 1) / pageSize * pageSize;
+}
+
+} // namespace
+
+namespace android {
+
+MappedBlobStore::MappedBlobStore(size_t maxTotalSize, size_t maxTotalEntries,
+                                 const std::string& dirName, uint32_t cacheVersion,
+                                 const std::string& buildId)
+      : mMaxTotalSize(maxTotalSize),
+        mMaxTotalEntries(maxTotalEntries),
+        mDirName(dirName),
+        mCacheVersion(cacheVersion),
+        mBuildId(buildId) {
+    if (mkdir(mDirName.c_str(), 0755) != 0 && errno != EEXIST) {
+        ALOGE("INIT: Unable to create directory (%s), errno (%i)", mDirName.c_str(), errno);
+        return;
+    }
+
+    if (!lockDirectory()) {
+        return;
+    }
+
+    if (!loadIndex()) {
+        ALOGV("INIT: No usable index in %s, starting from scratch", mDirName.c_str());
+        clear();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGeneration = 0;
+        mDataEnd = 0;
+        mSyncedEnd = 0;
+        mAccessCounter = 0;
+        mSlots.assign(getSlotCount(mMaxTotalEntries), {});
+        mVerified.assign(mSlots.size(), false);
+        mUsedSlots = 0;
+        mTotalSize = 0;
+        mTotalEntries = 0;
+        if (!openDataFile(mGeneration, /*create=*/true, &mDataFile)) {
+            return;
+        }
+        mIndexDirty = true;
+    }
+
+    mTaskThread = std::thread(&MappedBlobStore::processTasks, this);
+
+    // Commit the index of a new cache right away, so that the data file is not orphaned
+    bool indexDirty;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        indexDirty = mIndexDirty;
+    }
+    if (indexDirty) {
+        requestWork(/*commit=*/true, /*compact=*/false);
+    }
+
+    ALOGV("INIT: Mapped blobcache initialization succeeded");
+    mInitialized = true;
+}
+
+MappedBlobStore::~MappedBlobStore() {
+    if (mTaskThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mWorkerMutex);
+            mExitRequested = true;
+        }
+        mWorkAvailableCondition.notify_one();
+        mTaskThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mDataFile.data != nullptr) {
+            munmap(mDataFile.data, mDataFile.capacity);
+        }
+    }
+
+    // Closing the directory releases its lock
+    if (mDirFd != -1) {
+        close(mDirFd);
+    }
+}
+
+bool MappedBlobStore::lockDirectory() {
+    // Lock the directory itself rather than a file in it, since clear() removes every file
+    mDirFd = open(mDirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (mDirFd == -1) {
+        ALOGE("INIT: Unable to open directory (%s), errno (%i)", mDirName.c_str(), errno);
+        return false;
+    }
+    if (flock(mDirFd, LOCK_EX | LOCK_NB) != 0) {
+        ALOGW("INIT: Directory (%s) is in use by another process, errno (%i)", mDirName.c_str(),
+              errno);
+        close(mDirFd);
+        mDirFd = -1;
+        return false;
+    }
+    return true;
+}
+
+std::string MappedBlobStore::getDataFilePath(uint32_t generation) const {
+    return mDirName + "/data." + std::to_string(generation);
+}
+
+bool MappedBlobStore::loadIndex() {
+    std::string indexPath = mDirName + "/" + kMappedBlobStoreIndexFile;
+    int fd = open(indexPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        ALOGV("INIT: Index file (%s) missing", indexPath.c_str());
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(MappedIndexHeader))) {
+        ALOGE("INIT: Index file (%s) is too small", indexPath.c_str());
+        close(fd);
+        return false;
+    }
+
+    // Read the whole index at once
+    std::vector<uint8_t> buffer(static_cast<size_t>(st.st_size));
+    ssize_t result = read(fd, buffer.data(), buffer.size());
+    close(fd);
+    if (result != static_cast<ssize_t>(buffer.size())) {
+        ALOGE("INIT: Error reading index (%s): %s", indexPath.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    MappedIndexHeader header;
+    memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic != kMappedIndexMagic) {
+        ALOGE("INIT: Index has bad magic (%u)!", header.magic);
+        return false;
+    }
+    if (header.crc !=
+        GenerateCRC32(buffer.data() + offsetof(MappedIndexHeader, cacheVersion),
+                      buffer.size() - offsetof(MappedIndexHeader, cacheVersion))) {
+        ALOGE("INIT: Index failed CRC check!");
+        return false;
+    }
+    if (header.cacheVersion != mCacheVersion) {
+        ALOGV("INIT: Cache version has changed! old(%u) new(%u)", header.cacheVersion,
+              mCacheVersion);
+        return false;
+    }
+    header.buildId[PROP_VALUE_MAX - 1] = '\0';
+    if (strcmp(header.buildId, mBuildId.c_str()) != 0) {
+        ALOGV("INIT: BuildId has changed! old(%s) new(%s)", header.buildId, mBuildId.c_str());
+        return false;
+    }
+    if (buffer.size() != sizeof(header) + header.slotCount * sizeof(MappedIndexSlot)) {
+        ALOGE("INIT: Index size does not match its slot count (%" PRIu64 ")", header.slotCount);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!openDataFile(header.generation, /*create=*/false, &mDataFile)) {
+        return false;
+    }
+    if (header.dataEnd > mDataFile.capacity) {
+        ALOGV("INIT: Data (%" PRIu64 ") does not fit the cache limit anymore", header.dataEnd);
+        munmap(mDataFile.data, mDataFile.capacity);
+        mDataFile = {};
+        return false;
+    }
+
+    mGeneration = header.generation;
+    mDataEnd = header.dataEnd;
+    mSyncedEnd = header.dataEnd;
+    mAccessCounter = header.accessCounter;
+    mSlots.assign(getSlotCount(mMaxTotalEntries), {});
+    mVerified.assign(mSlots.size(), false);
+    mUsedSlots = 0;
+    mTotalSize = 0;
+    mTotalEntries = 0;
+
+    // Insert the entries into a fresh table, which drops removed slots and adapts to a
+    // changed entry limit.
+    const auto* slots = reinterpret_cast<const MappedIndexSlot*>(buffer.data() + sizeof(header));
+    for (size_t i = 0; i < header.slotCount; i++) {
+        const MappedIndexSlot& slot = slots[i];
+        if (slot.state != MappedSlotState::Live) {
+            continue;
+        }
+        if (slot.offset > mDataEnd || slot.offset + slot.entrySize > mDataEnd ||
+            slot.entrySize < sizeof(MappedEntryHeader) + slot.valueSize) {
+            ALOGV("INIT: Entry %u is out of bounds, dropping it", slot.entryHash);
+            continue;
+        }
+        // get() reads the key and value sizes from the entry header, so they must fit the slot
+        MappedEntryHeader entryHeader;
+        memcpy(&entryHeader, mDataFile.data + slot.offset, sizeof(entryHeader));
+        if (entryHeader.valueSize != slot.valueSize ||
+            alignEntrySize(sizeof(MappedEntryHeader) + uint64_t(entryHeader.keySize) +
+                           entryHeader.valueSize) != slot.entrySize) {
+            ALOGV("INIT: Entry %u does not match its slot, dropping it", slot.entryHash);
+            continue;
+        }
+        if (mTotalEntries >= mMaxTotalEntries) {
+            break;
+        }
+        insertSlotLocked(slot);
+    }
+
+    ALOGV("INIT: Loaded %zu entries from generation %u", mTotalEntries, mGeneration);
+    return true;
+}
+
+bool MappedBlobStore::openDataFile(uint32_t generation, bool create, DataFile* outFile) {
+    std::string dataPath = getDataFilePath(generation);
+    int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_TRUNC : 0);
+    int fd = open(dataPath.c_str(), flags, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ALOGE("Cache error - failed to open data file: %s, error: %s", dataPath.c_str(),
+              std::strerror(errno));
+        return false;
+    }
+
+    // Allocate the blocks up front. Writing to a hole of a sparse file through the mapping raises
+    // SIGBUS once the disk is full, where this fails cleanly.
+    const size_t capacity = getDataCapacity(mMaxTotalSize);
+    if (int err = posix_fallocate(fd, 0, static_cast<off_t>(capacity)); err != 0) {
+        ALOGE("Cache error - failed to allocate data file: %s, error: %s", dataPath.c_str(),
+              std::strerror(err));
+        close(fd);
+        if (create) {
+            remove(dataPath.c_str());
+        }
+        return false;
+    }
+
+    void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    // We can close the file now and the mmap will remain
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        ALOGE("Failed to mmap data file, error: %s", std::strerror(errno));
+        return false;
+    }
+
+    outFile->data = static_cast<uint8_t*>(data);
+    outFile->capacity = capacity;
+    return true;
+}
+
+// Remove the index and every data file, leaving the directory in place
+void MappedBlobStore::clear() {
+    DIR* dir = opendir(mDirName.c_str());
+    if (dir == nullptr) {
+        ALOGE("CLEAR: Unable to open dir: %s", mDirName.c_str());
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (entry->d_name == "."s || entry->d_name == ".."s) {
+            continue;
+        }
+        std::string fullPath = mDirName + "/" + entry->d_name;
+        if (remove(fullPath.c_str()) != 0) {
+            ALOGE("CLEAR: Error removing %s: %s", fullPath.c_str(), std::strerror(errno));
+        }
+    }
+    closedir(dir);
+}
+
+void MappedBlobStore::set(uint32_t entryHash, const void* key, EGLsizeiANDROID keySize,
+                          const void* value, EGLsizeiANDROID valueSize) {
+    if (!mInitialized || mAddDisabled) {
+        return;
+    }
+
+    const MappedEntryHeader header = {kMappedEntryMagic, 0, static_cast<uint32_t>(keySize),
+                                      static_cast<uint32_t>(valueSize)};
+    const size_t entrySize = alignEntrySize(sizeof(MappedEntryHeader) + keySize + valueSize);
+
+    // If the data file is full, compact it and try once more
+    for (int attempt = 0;; attempt++) {
+        bool added = false;
+        bool compact = false;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (MappedIndexSlot* slot = findSlotLocked(entryHash)) {
+                removeSlotLocked(slot);
+                mIndexDirty = true;
+            }
+
+            // A zero size value indicates the user wants to remove the entry from cache
+            if (valueSize == 0) {
+                ALOGV("SET: Zero size detected, removing %u from cache", entryHash);
+            } else {
+                if (mTotalSize + entrySize > mMaxTotalSize ||
+                    mTotalEntries + 1 > mMaxTotalEntries) {
+                    ALOGV("SET: Cache is full, trimming to make space");
+                    applyLRULocked(mMaxTotalSize / kCacheLimitDivisor,
+                                   mMaxTotalEntries / kCacheLimitDivisor);
+                }
+
+                uint64_t offset;
+                if (appendLocked(header, key, value, &offset)) {
+                    insertSlotLocked({entryHash, MappedSlotState::Live, offset,
+                                      static_cast<uint32_t>(entrySize),
+                                      static_cast<uint32_t>(valueSize), ++mAccessCounter});
+                    mIndexDirty = true;
+                    added = true;
+                    // Compact in the background before the data file fills up
+                    compact = mDataEnd > mDataFile.capacity / 4 * 3;
+                }
+            }
+        }
+
+        if (valueSize == 0 || added) {
+            requestWork(/*commit=*/true, compact);
+            return;
+        }
+
+        if (attempt > 0) {
+            ALOGE("SET: Unable to add %u after compacting", entryHash);
+            return;
+        }
+
+        ALOGV("SET: Data file is full, compacting before adding %u", entryHash);
+        requestWork(/*commit=*/false, /*compact=*/true);
+        waitForWorkComplete();
+    }
+}
+
+EGLsizeiANDROID MappedBlobStore::get(uint32_t entryHash, const void* key, EGLsizeiANDROID keySize,
+                                     void* value, EGLsizeiANDROID valueSize) {
+    if (!mInitialized) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    MappedIndexSlot* slot = findSlotLocked(entryHash);
+    if (slot == nullptr) {
+        ALOGV("GET: Cache MISS - cache does not contain entry: %u", entryHash);
+        return 0;
+    }
+
+    const uint8_t* entry = mDataFile.data + slot->offset;
+    MappedEntryHeader header;
+    memcpy(&header, entry, sizeof(header));
+    if (header.magic != kMappedEntryMagic || header.keySize != static_cast<uint32_t>(keySize) ||
+        header.valueSize != slot->valueSize ||
+        memcmp(entry + sizeof(header), key, keySize) != 0) {
+        ALOGW("GET: Cached key and new key do not match! This is a hash collision or modified "
+              "file");
+        return 0;
+    }
+
+    // Check the CRC of each entry the first time it is read
+    const size_t slotIndex = static_cast<size_t>(slot - mSlots.data());
+    if (!mVerified[slotIndex]) {
+        if (header.crc !=
+            GenerateCRC32(entry + sizeof(header), header.keySize + header.valueSize)) {
+            ALOGV("GET: Entry %u failed CRC check! Removing.", entryHash);
+            removeSlotLocked(slot);
+            mIndexDirty = true;
+            return 0;
+        }
+        mVerified[slotIndex] = true;
+    }
+
+    if (header.valueSize > static_cast<uint32_t>(valueSize)) {
+        ALOGV("GET: Cache MISS - valueSize not large enough (%lu) for entry %u, returning "
+              "required size (%u)",
+              valueSize, entryHash, header.valueSize);
+        return header.valueSize;
+    }
+
+    ALOGV("GET: Cache HIT - cache contains entry: %u", entryHash);
+    memcpy(value, entry + sizeof(header) + header.keySize, header.valueSize);
+
+    // The access time is saved with the next index commit
+    slot->lastAccess = ++mAccessCounter;
+    mIndexDirty = true;
+    return header.valueSize;
+}
+
+void MappedBlobStore::finish() {
+    if (!mInitialized) {
+        return;
+    }
+
+    ALOGV("FINISH: Committing index and waiting for work to complete.");
+    {
+        std::lock_guard<std::mutex> lock(mWorkerMutex);
+        mCommitRequested = true;
+        mFlushRequested = true;
+    }
+    mWorkAvailableCondition.notify_one();
+    waitForWorkComplete();
+}
+
+size_t MappedBlobStore::getTotalSize() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTotalSize;
+}
+
+size_t MappedBlobStore::getTotalEntries() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mTotalEntries;
+}
+
+MappedIndexSlot* MappedBlobStore::findSlotLocked(uint32_t entryHash) {
+    const size_t mask = mSlots.size() - 1;
+    for (size_t i = entryHash & mask;; i = (i + 1) & mask) {
+        MappedIndexSlot& slot = mSlots[i];
+        if (slot.state == MappedSlotState::Empty) {
+            return nullptr;
+        }
+        if (slot.state == MappedSlotState::Live && slot.entryHash == entryHash) {
+            return &slot;
+        }
+    }
+}
+
+void MappedBlobStore::insertSlotLocked(const MappedIndexSlot& newSlot) {
+    // Rebuild the table once removed slots make probing too long
+    if ((mUsedSlots + 1) * 4 > mSlots.size() * 3) {
+        std::vector<MappedIndexSlot> oldSlots(mSlots.size());
+        std::vector<bool> oldVerified(mSlots.size(), false);
+        mSlots.swap(oldSlots);
+        mVerified.swap(oldVerified);
+        mUsedSlots = 0;
+        mTotalSize = 0;
+        mTotalEntries = 0;
+        for (size_t i = 0; i < oldSlots.size(); i++) {
+            if (oldSlots[i].state == MappedSlotState::Live) {
+                insertSlotLocked(oldSlots[i]);
+                mVerified[findSlotLocked(oldSlots[i].entryHash) - mSlots.data()] = oldVerified[i];
+            }
+        }
+    }
+
+    const size_t mask = mSlots.size() - 1;
+    for (size_t i = newSlot.entryHash & mask;; i = (i + 1) & mask) {
+        MappedIndexSlot& slot = mSlots[i];
+        if (slot.state != MappedSlotState::Live) {
+            if (slot.state == MappedSlotState::Empty) {
+                mUsedSlots++;
+            }
+            slot = newSlot;
+            slot.state = MappedSlotState::Live;
+            mVerified[i] = false;
+            break;
+        }
+    }
+    mTotalSize += newSlot.entrySize;
+    mTotalEntries++;
+}
+
+void MappedBlobStore::removeSlotLocked(MappedIndexSlot* slot) {
+    // The entry stays in the data file until the next compaction
+    slot->state = MappedSlotState::Removed;
+    mTotalSize -= slot->entrySize;
+    mTotalEntries--;
+}
+
+void MappedBlobStore::applyLRULocked(size_t cacheSizeLimit, size_t cacheEntryLimit) {
+    std::vector<MappedIndexSlot*> liveSlots;
+    liveSlots.reserve(mTotalEntries);
+    for (auto& slot : mSlots) {
+        if (slot.state == MappedSlotState::Live) {
+            liveSlots.push_back(&slot);
+        }
+    }
+    std::sort(liveSlots.begin(), liveSlots.end(),
+              [](const MappedIndexSlot* a, const MappedIndexSlot* b) {
+                  return a->lastAccess < b->lastAccess;
+              });
+
+    for (MappedIndexSlot* slot : liveSlots) {
+        if (mTotalSize <= cacheSizeLimit && mTotalEntries <= cacheEntryLimit) {
+            break;
+        }
+        ALOGV("LRU: Removing entryHash %u", slot->entryHash);
+        removeSlotLocked(slot);
+    }
+    mIndexDirty = true;
+    ALOGV("LRU: Reduced cache to size %zu entries %zu", mTotalSize, mTotalEntries);
+}
+
+bool MappedBlobStore::appendLocked(const MappedEntryHeader& header, const void* key,
+                                   const void* value, uint64_t* outOffset) {
+    const size_t entrySize =
+            alignEntrySize(sizeof(MappedEntryHeader) + header.keySize + header.valueSize);
+    if (mDataEnd + entrySize > mDataFile.capacity) {
+        return false;
+    }
+
+    uint8_t* entry = mDataFile.data + mDataEnd;
+    memcpy(entry + sizeof(MappedEntryHeader), key, header.keySize);
+    memcpy(entry + sizeof(MappedEntryHeader) + header.keySize, value, header.valueSize);
+
+    // Add CRC check to the header (always do this last!)
+    MappedEntryHeader entryHeader = header;
+    entryHeader.crc = GenerateCRC32(entry + sizeof(MappedEntryHeader),
+                                    header.keySize + header.valueSize);
+    memcpy(entry, &entryHeader, sizeof(entryHeader));
+
+    *outOffset = mDataEnd;
+    mDataEnd += entrySize;
+    return true;
+}
+
+void MappedBlobStore::serializeIndexLocked(std::vector<uint8_t>* outBuffer) {
+    outBuffer->resize(sizeof(MappedIndexHeader) + mSlots.size() * sizeof(MappedIndexSlot));
+
+    MappedIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kMappedIndexMagic;
+    header.cacheVersion = mCacheVersion;
+    header.generation = mGeneration;
+    header.dataEnd = mDataEnd;
+    header.slotCount = mSlots.size();
+    header.accessCounter = mAccessCounter;
+    strncpy(header.buildId, mBuildId.c_str(), PROP_VALUE_MAX - 1);
+
+    memcpy(outBuffer->data(), &header, sizeof(header));
+    memcpy(outBuffer->data() + sizeof(header), mSlots.data(),
+           mSlots.size() * sizeof(MappedIndexSlot));
+
+    // Finally update the crc, using cacheVersion and everything that follows
+    header.crc = GenerateCRC32(outBuffer->data() + offsetof(MappedIndexHeader, cacheVersion),
+                               outBuffer->size() - offsetof(MappedIndexHeader, cacheVersion));
+    memcpy(outBuffer->data() + offsetof(MappedIndexHeader, crc), &header.crc, sizeof(header.crc));
+
+    mIndexDirty = false;
+}
+
+// Replace the index file with the buffer, so that a crash leaves either the old or the new index
+bool MappedBlobStore::writeIndexFile(const std::vector<uint8_t>& buffer) {
+    std::string indexPath = mDirName + "/" + kMappedBlobStoreIndexFile;
+    std::string tempPath = indexPath + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        ALOGE("COMMIT: Unable to create index file: %s, error: %s", tempPath.c_str(),
+              std::strerror(errno));
+        return false;
+    }
+
+    ssize_t result = write(fd, buffer.data(), buffer.size());
+    if (result != static_cast<ssize_t>(buffer.size()) || fsync(fd) != 0) {
+        ALOGE("COMMIT: Error writing index file: %s, error: %s", tempPath.c_str(),
+              std::strerror(errno));
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    if (rename(tempPath.c_str(), indexPath.c_str()) != 0) {
+        ALOGE("COMMIT: Unable to rename %s: %s", tempPath.c_str(), std::strerror(errno));
+        return false;
+    }
+
+    // Make the rename itself durable
+    int dirFd = open(mDirName.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd != -1) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+
+// Sync the data appended since the last commit, then write the index that refers to it
+void MappedBlobStore::commitIndex() {
+    std::vector<uint8_t> buffer;
+    uint8_t* data;
+    uint32_t generation;
+    uint64_t syncStart;
+    uint64_t syncEnd;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mIndexDirty) {
+            return;
+        }
+        serializeIndexLocked(&buffer);
+        data = mDataFile.data;
+        generation = mGeneration;
+        syncStart = mSyncedEnd;
+        syncEnd = mDataEnd;
+    }
+
+    // Only the worker thread replaces the data file, so it stays mapped here
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    syncStart = syncStart / pageSize * pageSize;
+    if (syncEnd > syncStart && msync(data + syncStart, syncEnd - syncStart, MS_SYNC) != 0) {
+        ALOGE("COMMIT: Unable to sync data file: %s", std::strerror(errno));
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIndexDirty = true;
+        return;
+    }
+
+    bool written = writeIndexFile(buffer);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!written) {
+        mIndexDirty = true;
+    } else if (generation == mGeneration) {
+        mSyncedEnd = std::max(mSyncedEnd, syncEnd);
+    }
+    ALOGV("COMMIT: Committed index for generation %u up to %" PRIu64, generation, syncEnd);
+}
+
+// Copy the live entries into the data file of the next generation and switch to it
+void MappedBlobStore::compact() {
+    std::vector<MappedIndexSlot> liveSlots;
+    DataFile oldFile;
+    uint32_t newGeneration;
+    uint64_t snapshotEnd;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const auto& slot : mSlots) {
+            if (slot.state == MappedSlotState::Live) {
+                liveSlots.push_back(slot);
+            }
+        }
+        oldFile = mDataFile;
+        newGeneration = mGeneration + 1;
+        snapshotEnd = mDataEnd;
+    }
+
+    ALOGV("COMPACT: Compacting %zu entries into generation %u", liveSlots.size(), newGeneration);
+
+    DataFile newFile;
+    if (!openDataFile(newGeneration, /*create=*/true, &newFile)) {
+        // Keep serving the current data file, but don't retry the allocation on every set
+        ALOGE("COMPACT: Unable to create generation %u, no longer adding entries",
+              newGeneration);
+        mAddDisabled = true;
+        return;
+    }
+
+    // Entries below the snapshot end are never modified, so copy them without the lock.
+    // Sorting by offset keeps the reads sequential.
+    std::sort(liveSlots.begin(), liveSlots.end(),
+              [](const MappedIndexSlot& a, const MappedIndexSlot& b) {
+                  return a.offset < b.offset;
+              });
+    std::unordered_map<uint64_t, uint64_t> newOffsets;
+    newOffsets.reserve(liveSlots.size());
+    uint64_t newEnd = 0;
+    for (const auto& slot : liveSlots) {
+        memcpy(newFile.data + newEnd, oldFile.data + slot.offset, slot.entrySize);
+        newOffsets.emplace(slot.offset, newEnd);
+        newEnd += slot.entrySize;
+    }
+
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        // Copy what was added while compacting, and drop what was removed
+        std::vector<MappedIndexSlot> slots(mSlots.size());
+        std::vector<bool> verified(mSlots.size(), false);
+        mSlots.swap(slots);
+        mVerified.swap(verified);
+        mUsedSlots = 0;
+        mTotalSize = 0;
+        mTotalEntries = 0;
+        for (MappedIndexSlot slot : slots) {
+            if (slot.state != MappedSlotState::Live) {
+                continue;
+            }
+            if (slot.offset < snapshotEnd) {
+                slot.offset = newOffsets.at(slot.offset);
+            } else {
+                if (newEnd + slot.entrySize > newFile.capacity) {
+                    ALOGE("COMPACT: Dropping entry %u that does not fit", slot.entryHash);
+                    continue;
+                }
+                memcpy(newFile.data + newEnd, oldFile.data + slot.offset, slot.entrySize);
+                slot.offset = newEnd;
+                newEnd += slot.entrySize;
+            }
+            insertSlotLocked(slot);
+        }
+
+        mDataFile = newFile;
+        mGeneration = newGeneration;
+        mDataEnd = newEnd;
+        mSyncedEnd = 0;
+        serializeIndexLocked(&buffer);
+    }
+
+    if (msync(newFile.data, newEnd, MS_SYNC) != 0 || !writeIndexFile(buffer)) {
+        ALOGE("COMPACT: Unable to commit generation %u", newGeneration);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIndexDirty = true;
+    } else {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mSyncedEnd = std::max(mSyncedEnd, newEnd);
+    }
+
+    // Nothing refers to the old data file anymore
+    munmap(oldFile.data, oldFile.capacity);
+    std::string oldPath = getDataFilePath(newGeneration - 1);
+    if (remove(oldPath.c_str()) != 0) {
+        ALOGW("COMPACT: Error removing %s: %s", oldPath.c_str(), std::strerror(errno));
+    }
+    ALOGV("COMPACT: Compacted data file to %" PRIu64 " bytes", newEnd);
+}
+
+void MappedBlobStore::requestWork(bool commit, bool compact) {
+    {
+        std::lock_guard<std::mutex> lock(mWorkerMutex);
+        mCommitRequested |= commit;
+        mCompactRequested |= compact;
+        if (compact) {
+            mFlushRequested = true;
+        }
+    }
+    mWorkAvailableCondition.notify_one();
+}
+
+// Wait until all requested work has been completed
+void MappedBlobStore::waitForWorkComplete() {
+    std::unique_lock<std::mutex> lock(mWorkerMutex);
+    mWorkerIdleCondition.wait(lock, [this] {
+        return mWorkerThreadIdle && !mCommitRequested && !mCompactRequested;
+    });
+}
+
+// Process requests until the destructor asks the thread to exit
+void MappedBlobStore::processTasks() {
+    // Remove the data files a crash during compaction may have left behind
+    uint32_t generation;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        generation = mGeneration;
+    }
+    remove(getDataFilePath(generation + 1).c_str());
+    if (generation > 0) {
+        remove(getDataFilePath(generation - 1).c_str());
+    }
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(mWorkerMutex);
+        if (!mCommitRequested && !mCompactRequested && !mExitRequested) {
+            ALOGV("WORKER: No work available, waiting");
+            mWorkerThreadIdle = true;
+            mWorkerIdleCondition.notify_all();
+            mWorkAvailableCondition.wait(lock, [this] {
+                return mCommitRequested || mCompactRequested || mExitRequested;
+            });
+        }
+
+        // Give more sets a chance to land before paying for a commit
+        if (!mFlushRequested && !mExitRequested) {
+            mWorkAvailableCondition.wait_for(lock, kIndexCommitDelay,
+                                             [this] { return mFlushRequested || mExitRequested; });
+        }
+
+        mWorkerThreadIdle = false;
+        bool compactRequested = std::exchange(mCompactRequested, false);
+        bool commitRequested = std::exchange(mCommitRequested, false);
+        bool exitRequested = mExitRequested;
+        mFlushRequested = false;
+        lock.unlock();
+
+        if (compactRequested) {
+            compact();
+        }
+        if (commitRequested || exitRequested) {
+            commitIndex();
+        }
+
+        if (exitRequested) {
+            ALOGV("WORKER: Exiting work loop.");
+            lock.lock();
+            mWorkerThreadIdle = true;
+            mWorkerIdleCondition.notify_all();
+            return;
+        }
+    }
+}
+
+}; // namespace android
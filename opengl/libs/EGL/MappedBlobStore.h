@@ -0,0 +1,185 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+#ifndef ANDROID_MAPPED_BLOB_STORE_H
+#define ANDROID_MAPPED_BLOB_STORE_H
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <android-base/thread_annotations.h>
+#include <cutils/properties.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+constexpr char kMappedBlobStoreIndexFile[] = "index";
+
+// On-disk header of the index file. It is followed by the index slots.
+struct MappedIndexHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t cacheVersion;
+    uint32_t generation;
+    uint64_t dataEnd;
+    uint64_t slotCount;
+    uint64_t accessCounter;
+    char buildId[PROP_VALUE_MAX];
+};
+
+enum class MappedSlotState : uint32_t {
+    Empty = 0,
+    Live,
+    Removed,
+};
+
+// One slot of the open-addressed index, keyed by entry hash with linear probing.
+struct MappedIndexSlot {
+    uint32_t entryHash;
+    MappedSlotState state;
+    uint64_t offset;
+    uint32_t entrySize;
+    uint32_t valueSize;
+    // Value of the access counter when the entry was last set or read, used for LRU.
+    uint64_t lastAccess;
+};
+
+static_assert(sizeof(MappedIndexSlot) == 32, "MappedIndexSlot is written to disk as is");
+
+// Header of each entry in the data file. It is followed by the key and the value.
+struct MappedEntryHeader {
+    uint32_t magic;
+    uint32_t crc;
+    uint32_t keySize;
+    uint32_t valueSize;
+};
+
+// Alternative storage for MultifileBlobCache that keeps every entry in a single data file.
+//
+// The data file is allocated at twice the cache limit and memory-mapped once. Entries are only
+// ever appended to it, so committed entries are never modified in place. The index lives in
+// memory as an open-addressed table, and a worker thread commits it to disk by syncing the
+// appended data, writing the index to a temporary file and renaming it over the previous one. A
+// crash can lose the entries set since the last commit, but never leaves the index pointing at
+// incomplete data.
+//
+// Removed and evicted entries leave garbage behind in the data file. Once the data file is three
+// quarters full, the worker thread copies the live entries into a new data file and switches the
+// index to it. The data file name carries a generation number, so the switch happens with the
+// index commit.
+//
+// Startup reads the index with a single read and maps the data file.
+//
+// Only one process can use a cache directory at a time, since nothing coordinates the appends
+// and compactions of several processes. The store holds a lock on the directory, and fails to
+// initialize if another process holds it.
+class MappedBlobStore {
+public:
+    MappedBlobStore(size_t maxTotalSize, size_t maxTotalEntries, const std::string& dirName,
+                    uint32_t cacheVersion, const std::string& buildId);
+    ~MappedBlobStore();
+
+    bool isInitialized() const { return mInitialized; }
+
+    // The key and value sizes are checked by MultifileBlobCache.
+    void set(uint32_t entryHash, const void* key, EGLsizeiANDROID keySize, const void* value,
+             EGLsizeiANDROID valueSize);
+    EGLsizeiANDROID get(uint32_t entryHash, const void* key, EGLsizeiANDROID keySize, void* value,
+                        EGLsizeiANDROID valueSize);
+
+    // Commits the index and waits for the worker thread to complete.
+    void finish();
+
+    size_t getTotalSize() const;
+    size_t getTotalEntries() const;
+
+private:
+    struct DataFile {
+        uint8_t* data = nullptr;
+        size_t capacity = 0;
+    };
+
+    bool lockDirectory();
+    bool loadIndex();
+    bool openDataFile(uint32_t generation, bool create, DataFile* outFile);
+    std::string getDataFilePath(uint32_t generation) const;
+    void clear();
+
+    MappedIndexSlot* findSlotLocked(uint32_t entryHash) REQUIRES(mMutex);
+    void insertSlotLocked(const MappedIndexSlot& slot) REQUIRES(mMutex);
+    void removeSlotLocked(MappedIndexSlot* slot) REQUIRES(mMutex);
+    void applyLRULocked(size_t cacheSizeLimit, size_t cacheEntryLimit) REQUIRES(mMutex);
+    bool appendLocked(const MappedEntryHeader& header, const void* key, const void* value,
+                      uint64_t* outOffset) REQUIRES(mMutex);
+
+    void serializeIndexLocked(std::vector<uint8_t>* outBuffer) REQUIRES(mMutex);
+    bool writeIndexFile(const std::vector<uint8_t>& buffer);
+    void commitIndex();
+    void compact();
+
+    void requestWork(bool commit, bool compact);
+    void waitForWorkComplete();
+    void processTasks();
+
+    const size_t mMaxTotalSize;
+    const size_t mMaxTotalEntries;
+    const std::string mDirName;
+    const uint32_t mCacheVersion;
+    const std::string mBuildId;
+    bool mInitialized = false;
+    // The cache directory, held open for its lock
+    int mDirFd = -1;
+    // Set when a new data file can't be allocated, after which entries are no longer added
+    std::atomic<bool> mAddDisabled = false;
+
+    mutable std::mutex mMutex;
+    DataFile mDataFile GUARDED_BY(mMutex);
+    uint32_t mGeneration GUARDED_BY(mMutex) = 0;
+    uint64_t mDataEnd GUARDED_BY(mMutex) = 0;
+    // Offset up to which the data file has been synced for the last index commit.
+    uint64_t mSyncedEnd GUARDED_BY(mMutex) = 0;
+    uint64_t mAccessCounter GUARDED_BY(mMutex) = 0;
+    std::vector<MappedIndexSlot> mSlots GUARDED_BY(mMutex);
+    // Whether the CRC of each entry has been checked since the data file was mapped.
+    std::vector<bool> mVerified GUARDED_BY(mMutex);
+    size_t mUsedSlots GUARDED_BY(mMutex) = 0;
+    size_t mTotalSize GUARDED_BY(mMutex) = 0;
+    size_t mTotalEntries GUARDED_BY(mMutex) = 0;
+    bool mIndexDirty GUARDED_BY(mMutex) = false;
+
+    // Below are the components used for the worker thread
+    std::thread mTaskThread;
+    std::mutex mWorkerMutex;
+    std::condition_variable mWorkAvailableCondition;
+    std::condition_variable mWorkerIdleCondition;
+    bool mCommitRequested = false;
+    bool mCompactRequested = false;
+    // Set when the requested work should not wait for more changes
+    bool mFlushRequested = false;
+    bool mExitRequested = false;
+    bool mWorkerThreadIdle = true;
+};
+
+}; // namespace android
+
+#endif // ANDROID_MAPPED_BLOB_STORE_H
@@ -72,7 +72,8 @@ void freeHotCacheEntry(android::MultifileHotCache& entry) {
 namespace android {
 
 MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-                                       size_t maxTotalEntries, const std::string& baseDir)
+                                       size_t maxTotalEntries, const std::string& baseDir,
+                                       MultifileBackend backend)
       : mInitialized(false),
         mCacheVersion(0),
         mMaxKeySize(maxKeySize),
@@ -115,6 +116,21 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
         mBuildId = debugBuildId;
     }
 
+    if (backend == MultifileBackend::MappedFile) {
+        ALOGV("INIT: Using a single mapped file for the multifile blobcache");
+        mMappedStore = std::make_unique<MappedBlobStore>(mMaxTotalSize, mMaxTotalEntries,
+                                                         baseDir + ".mapped", mCacheVersion,
+                                                         mBuildId);
+        if (mMappedStore->isInitialized()) {
+            mInitialized = true;
+            return;
+        }
+        // Another process of the app holds the mapped cache, or its data file can't be
+        // allocated, so use separate files instead.
+        ALOGW("INIT: Mapped blobcache unavailable, falling back to multiple files");
+        mMappedStore.reset();
+    }
+
     // Establish the name of our multifile directory
     mMultifileDirName = baseDir + ".multifile";
 
@@ -296,7 +312,7 @@ MultifileBlobCache::MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, s
 }
 
 MultifileBlobCache::~MultifileBlobCache() {
-    if (!mInitialized) {
+    if (!mInitialized || mMappedStore) {
         return;
     }
 
@@ -330,6 +346,11 @@ void MultifileBlobCache::set(const void* key, EGLsizeiANDROID keySize, const voi
     // Generate a hash of the key and use it to track this entry
     uint32_t entryHash = android::JenkinsHashMixBytes(0, static_cast<const uint8_t*>(key), keySize);
 
+    if (mMappedStore) {
+        mMappedStore->set(entryHash, key, keySize, value, valueSize);
+        return;
+    }
+
     std::string fullPath = mMultifileDirName + "/" + std::to_string(entryHash);
 
     // See if we already have this file
@@ -423,6 +444,10 @@ EGLsizeiANDROID MultifileBlobCache::get(const void* key, EGLsizeiANDROID keySize
     // Generate a hash of the key and use it to track this entry
     uint32_t entryHash = android::JenkinsHashMixBytes(0, static_cast<const uint8_t*>(key), keySize);
 
+    if (mMappedStore) {
+        return mMappedStore->get(entryHash, key, keySize, value, valueSize);
+    }
+
     // See if we have this file
     if (!contains(entryHash)) {
         ALOGV("GET: Cache MISS - cache does not contain entry: %u", entryHash);
@@ -560,6 +585,11 @@ void MultifileBlobCache::finish() {
         return;
     }
 
+    if (mMappedStore) {
+        mMappedStore->finish();
+        return;
+    }
+
     // Wait for all deferred writes to complete
     ALOGV("FINISH: Waiting for work to complete.");
     waitForWorkComplete();
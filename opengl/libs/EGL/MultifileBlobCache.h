@@ -24,6 +24,7 @@
 #include <cutils/properties.h>
 #include <future>
 #include <map>
+#include <memory>
 #include <queue>
 #include <string>
 #include <thread>
@@ -31,6 +32,7 @@
 #include <unordered_set>
 
 #include "FileBlobCache.h"
+#include "MappedBlobStore.h"
 
 #include <com_android_graphics_egl_flags.h>
 
@@ -67,6 +69,14 @@ struct MultifileHotCache {
     size_t entrySize;
 };
 
+// Where MultifileBlobCache keeps its entries
+enum class MultifileBackend {
+    // One file per entry
+    Files,
+    // A single memory-mapped data file and an index, see MappedBlobStore
+    MappedFile,
+};
+
 enum class TaskCommand {
     Invalid = 0,
     WriteToDisk,
@@ -127,7 +137,8 @@ using MultifileEntryStatsMapIter = MultifileEntryStatsMap::iterator;
 class MultifileBlobCache {
 public:
     MultifileBlobCache(size_t maxKeySize, size_t maxValueSize, size_t maxTotalSize,
-                       size_t maxTotalEntries, const std::string& baseDir);
+                       size_t maxTotalEntries, const std::string& baseDir,
+                       MultifileBackend backend = MultifileBackend::Files);
     ~MultifileBlobCache();
 
     void set(const void* key, EGLsizeiANDROID keySize, const void* value,
@@ -137,8 +148,12 @@ public:
 
     void finish();
 
-    size_t getTotalSize() const { return mTotalCacheSize; }
-    size_t getTotalEntries() const { return mTotalCacheEntries; }
+    size_t getTotalSize() const {
+        return mMappedStore ? mMappedStore->getTotalSize() : mTotalCacheSize;
+    }
+    size_t getTotalEntries() const {
+        return mMappedStore ? mMappedStore->getTotalEntries() : mTotalCacheEntries;
+    }
     size_t getTotalCacheSizeDivisor() const { return mTotalCacheSizeDivisor; }
 
     const std::string& getCurrentBuildId() const { return mBuildId; }
@@ -174,6 +189,9 @@ private:
     bool mInitialized;
     std::string mMultifileDirName;
 
+    // Set when using MultifileBackend::MappedFile, which then handles all the entries
+    std::unique_ptr<MappedBlobStore> mMappedStore;
+
     std::string mBuildId;
     uint32_t mCacheVersion;
 
@@ -0,0 +1,90 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// Measures the cold start of MultifileBlobCache with 10k entries on disk, from construction to
+// the first cache hit, for each backend.
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "MultifileBlobCache.h"
+
+namespace android {
+
+namespace {
+
+constexpr size_t kMaxKeySize = 1 * 1024;
+constexpr size_t kMaxValueSize = 8 * 1024;
+constexpr size_t kMaxTotalSize = 64 * 1024 * 1024;
+constexpr size_t kMaxTotalEntries = 16 * 1024;
+
+constexpr int kEntryCount = 10 * 1024;
+constexpr size_t kValueSize = 2 * 1024;
+
+void populateCache(const std::string& baseDir, MultifileBackend backend) {
+    MultifileBlobCache cache(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries, baseDir,
+                             backend);
+    std::vector<uint8_t> value(kValueSize);
+    for (int i = 0; i < kEntryCount; i++) {
+        std::fill(value.begin(), value.end(), static_cast<uint8_t>(i));
+        cache.set(&i, sizeof(i), value.data(), value.size());
+    }
+    cache.finish();
+}
+
+void coldStart(benchmark::State& state, MultifileBackend backend) {
+    TemporaryDir tempDir;
+    const std::string baseDir = std::string(tempDir.path) + "/cache";
+    populateCache(baseDir, backend);
+
+    std::vector<uint8_t> value(kValueSize);
+    int key = kEntryCount / 2;
+    for (auto _ : state) {
+        auto cache = std::make_unique<MultifileBlobCache>(kMaxKeySize, kMaxValueSize,
+                                                          kMaxTotalSize, kMaxTotalEntries,
+                                                          baseDir, backend);
+        if (cache->get(&key, sizeof(key), value.data(), value.size()) != kValueSize) {
+            state.SkipWithError("Cache miss after cold start");
+            break;
+        }
+
+        state.PauseTiming();
+        cache->finish();
+        cache.reset();
+        state.ResumeTiming();
+    }
+}
+
+void multifileBlobCache_coldStart10kEntries_files(benchmark::State& state) {
+    coldStart(state, MultifileBackend::Files);
+}
+BENCHMARK(multifileBlobCache_coldStart10kEntries_files)->Unit(benchmark::kMillisecond);
+
+void multifileBlobCache_coldStart10kEntries_mapped(benchmark::State& state) {
+    coldStart(state, MultifileBackend::MappedFile);
+}
+BENCHMARK(multifileBlobCache_coldStart10kEntries_mapped)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+} // namespace android
+
+BENCHMARK_MAIN();
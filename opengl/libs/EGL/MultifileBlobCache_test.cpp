@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <utils/JenkinsHash.h>
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 
@@ -912,4 +913,210 @@ TEST_F(MultifileBlobCacheTest, ZeroSizeRemovesEntry) {
     }
 }
 
+class MultifileBlobCacheMappedTest : public MultifileBlobCacheTest {
+protected:
+    void SetUp() override {
+        clearProperties();
+        mTempFile.reset(new TemporaryFile());
+        reopenCache();
+    }
+
+    void reopenCache() {
+        mMBC.reset();
+        mMBC.reset(new MultifileBlobCache(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                          kMaxTotalEntries, &mTempFile->path[0],
+                                          MultifileBackend::MappedFile));
+    }
+
+    std::string getMappedDirName() { return std::string(&mTempFile->path[0]) + ".mapped"; }
+
+    std::vector<std::string> getMappedFiles() {
+        std::vector<std::string> files;
+        DIR* dir = opendir(getMappedDirName().c_str());
+        if (dir == nullptr) {
+            return files;
+        }
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if (entry->d_name != "."s && entry->d_name != ".."s) {
+                files.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        return files;
+    }
+
+    // Flips one byte of a file in the mapped cache directory
+    void corruptFile(const std::string& name, off_t offset) {
+        std::string path = getMappedDirName() + "/" + name;
+        int fd = open(path.c_str(), O_RDWR);
+        ASSERT_NE(-1, fd);
+        uint8_t byte = 0;
+        ASSERT_EQ(1, pread(fd, &byte, 1, offset));
+        byte ^= 0xff;
+        ASSERT_EQ(1, pwrite(fd, &byte, 1, offset));
+        close(fd);
+    }
+};
+
+TEST_F(MultifileBlobCacheMappedTest, CacheSingleValueSucceeds) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mMBC->set("abcd", 4, "efgh", 4);
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+    ASSERT_EQ('f', buf[1]);
+    ASSERT_EQ('g', buf[2]);
+    ASSERT_EQ('h', buf[3]);
+}
+
+TEST_F(MultifileBlobCacheMappedTest, GetOnlyWritesIfBufferIsLargeEnough) {
+    unsigned char buf[3] = {0xee, 0xee, 0xee};
+    mMBC->set("abcd", 4, "efgh", 4);
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 3));
+    ASSERT_EQ(0xee, buf[0]);
+    ASSERT_EQ(0xee, buf[1]);
+    ASSERT_EQ(0xee, buf[2]);
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, nullptr, 0));
+}
+
+TEST_F(MultifileBlobCacheMappedTest, MultipleSetsCacheLatestValue) {
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    mMBC->set("abcd", 4, "efgh", 4);
+    mMBC->set("abcd", 4, "ijkl", 4);
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('i', buf[0]);
+    ASSERT_EQ('j', buf[1]);
+    ASSERT_EQ('k', buf[2]);
+    ASSERT_EQ('l', buf[3]);
+    ASSERT_EQ(size_t(1), mMBC->getTotalEntries());
+}
+
+TEST_F(MultifileBlobCacheMappedTest, EntriesPersistInTwoFiles) {
+    for (int i = 0; i < kMaxTotalEntries; i++) {
+        mMBC->set(&i, sizeof(i), &i, sizeof(i));
+    }
+
+    // Close the cache so everything writes out
+    mMBC->finish();
+    reopenCache();
+
+    for (int i = 0; i < kMaxTotalEntries; i++) {
+        int result = 0;
+        ASSERT_EQ(sizeof(i), mMBC->get(&i, sizeof(i), &result, sizeof(result)));
+        ASSERT_EQ(i, result);
+    }
+
+    // All entries live in the data file next to the index
+    std::vector<std::string> files = getMappedFiles();
+    ASSERT_EQ(size_t(2), files.size());
+    ASSERT_NE(files.end(), std::find(files.begin(), files.end(), kMappedBlobStoreIndexFile));
+    ASSERT_LT(getFileDescriptorCount(), kMaxTotalEntries / 2);
+}
+
+TEST_F(MultifileBlobCacheMappedTest, EvictionAndCompactionKeepLatestEntries) {
+    // Write many times the cache limit, so that entries are evicted and the data file compacted
+    std::vector<uint8_t> value(kMaxValueSize / 2);
+    std::vector<uint8_t> result(value.size());
+    for (int i = 0; i < 200; i++) {
+        std::fill(value.begin(), value.end(), static_cast<uint8_t>(i));
+        mMBC->set(&i, sizeof(i), value.data(), value.size());
+        ASSERT_EQ(value.size(), mMBC->get(&i, sizeof(i), result.data(), result.size()));
+        ASSERT_EQ(value, result);
+        ASSERT_LE(mMBC->getTotalSize(), kMaxTotalSize);
+        ASSERT_LE(mMBC->getTotalEntries(), kMaxTotalEntries);
+    }
+
+    mMBC->finish();
+    reopenCache();
+
+    // The most recent entry survives, and the old data files are gone
+    int last = 199;
+    ASSERT_EQ(value.size(), mMBC->get(&last, sizeof(last), result.data(), result.size()));
+    ASSERT_EQ(value, result);
+    ASSERT_EQ(size_t(2), getMappedFiles().size());
+}
+
+TEST_F(MultifileBlobCacheMappedTest, ZeroSizeRemovesEntry) {
+    int result = 0;
+    for (int entry = 0; entry < 20; entry++) {
+        mMBC->set(&entry, sizeof(entry), &entry, sizeof(entry));
+    }
+
+    int removed = 5;
+    mMBC->set(&removed, sizeof(removed), nullptr, 0);
+    ASSERT_EQ(size_t(0), mMBC->get(&removed, sizeof(removed), &result, sizeof(result)));
+
+    mMBC->finish();
+    reopenCache();
+    ASSERT_EQ(size_t(0), mMBC->get(&removed, sizeof(removed), &result, sizeof(result)));
+    ASSERT_EQ(size_t(19), mMBC->getTotalEntries());
+}
+
+TEST_F(MultifileBlobCacheMappedTest, CorruptIndexClears) {
+    mMBC->set("abcd", 4, "efgh", 4);
+    mMBC->finish();
+    mMBC.reset();
+
+    // Damage the end of the index, which is covered by its CRC
+    struct stat st;
+    ASSERT_EQ(0, stat((getMappedDirName() + "/" + kMappedBlobStoreIndexFile).c_str(), &st));
+    corruptFile(kMappedBlobStoreIndexFile, st.st_size - 1);
+
+    reopenCache();
+    unsigned char buf[4];
+    ASSERT_EQ(size_t(0), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ(size_t(0), mMBC->getTotalEntries());
+}
+
+TEST_F(MultifileBlobCacheMappedTest, CorruptEntryMisses) {
+    mMBC->set("abcd", 4, "efgh", 4);
+    mMBC->finish();
+    mMBC.reset();
+
+    // Damage the value of the only entry, which follows its header and key
+    std::vector<std::string> files = getMappedFiles();
+    auto dataFile = std::find_if(files.begin(), files.end(),
+                                 [](const std::string& name) { return name.starts_with("data."); });
+    ASSERT_NE(files.end(), dataFile);
+    corruptFile(*dataFile, sizeof(MappedEntryHeader) + 4);
+
+    reopenCache();
+    unsigned char buf[4];
+    ASSERT_EQ(size_t(0), mMBC->get("abcd", 4, buf, 4));
+}
+
+TEST_F(MultifileBlobCacheMappedTest, MismatchedBuildIdClears) {
+    mMBC->set("abcd", 4, "efgh", 4);
+    mMBC->finish();
+    mMBC.reset();
+
+    // Set a debug buildId
+    base::SetProperty("debug.egl.blobcache.build_id", "foo");
+    base::WaitForProperty("debug.egl.blobcache.build_id", "foo");
+
+    reopenCache();
+    unsigned char buf[4];
+    ASSERT_EQ(size_t(0), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ(size_t(0), mMBC->getTotalEntries());
+}
+
+TEST_F(MultifileBlobCacheMappedTest, SecondCacheFallsBackToMultifile) {
+    mMBC->set("abcd", 4, "efgh", 4);
+
+    // The first cache holds the lock on the mapped directory
+    MultifileBlobCache second(kMaxKeySize, kMaxValueSize, kMaxTotalSize, kMaxTotalEntries,
+                              &mTempFile->path[0], MultifileBackend::MappedFile);
+    unsigned char buf[4] = {0xee, 0xee, 0xee, 0xee};
+    ASSERT_EQ(size_t(0), second.get("abcd", 4, buf, 4));
+    second.set("ijkl", 4, "mnop", 4);
+    ASSERT_EQ(size_t(4), second.get("ijkl", 4, buf, 4));
+    ASSERT_EQ('m', buf[0]);
+    second.finish();
+
+    struct stat st;
+    ASSERT_EQ(0, stat((std::string(&mTempFile->path[0]) + ".multifile").c_str(), &st));
+    ASSERT_EQ(size_t(4), mMBC->get("abcd", 4, buf, 4));
+    ASSERT_EQ('e', buf[0]);
+}
+
 } // namespace android
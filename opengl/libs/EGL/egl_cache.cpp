@@ -19,9 +19,11 @@
 #include "egl_cache.h"
 
 #include <android-base/properties.h>
+#include <graphicsenv/GraphicsEnv.h>
 #include <inttypes.h>
 #include <log/log.h>
 #include <private/EGL/cache.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <thread>
@@ -50,6 +52,13 @@ namespace android {
 // called from android_view_ThreadedRenderer.cpp
 void egl_set_cache_filename(const char* filename) {
     egl_cache_t::get()->setCacheFilename(filename);
+
+    // Vulkan caches the layers it finds next to the shader cache, in the code cache directory of
+    // the app.
+    if (const char* slash = strrchr(filename, '/')) {
+        android::GraphicsEnv::getInstance().setLayerCacheFilename(
+                std::string(filename, slash + 1) + "com.android.vulkan.layers_cache");
+    }
 }
 
 //
@@ -69,7 +78,12 @@ static EGLsizeiANDROID getBlob(const void* key, EGLsizeiANDROID keySize, void* v
 // egl_cache_t definition
 //
 egl_cache_t::egl_cache_t()
-      : mInitialized(false), mMultifileMode(false), mCacheByteLimit(kMaxMonolithicTotalSize) {}
+      : mInitialized(false),
+        mMultifileMode(false),
+        mMultifileBackend(MultifileBackend::Files),
+        mJournalMode(false),
+        mSharedMode(false),
+        mCacheByteLimit(kMaxMonolithicTotalSize) {}
 
 egl_cache_t::~egl_cache_t() {}
 
@@ -109,6 +123,13 @@ void egl_cache_t::initialize(egl_display_t* display) {
                       "%#x",
                       err);
             }
+
+            updateMode();
+            android::GraphicsEnv& graphicsEnv = android::GraphicsEnv::getInstance();
+            if (mSharedMode && !cnx->angleLoaded && !graphicsEnv.getDriverNamespace()) {
+                mSharedBlobStoreClient = std::make_shared<SharedBlobStoreClient>(
+                        graphicsEnv.getSharedBlobStore(base::GetProperty("ro.build.id", "")));
+            }
         }
     }
 
@@ -117,6 +138,10 @@ void egl_cache_t::initialize(egl_display_t* display) {
 
 void egl_cache_t::terminate() {
     std::lock_guard<std::mutex> lock(mMutex);
+    if (mSharedBlobStoreClient) {
+        reportSharedBlobUsage(mSharedBlobStoreClient.get());
+    }
+    mSharedBlobStoreClient = nullptr;
     if (mBlobCache) {
         mBlobCache->writeToFile();
     }
@@ -130,61 +155,97 @@ void egl_cache_t::terminate() {
 
 void egl_cache_t::setBlob(const void* key, EGLsizeiANDROID keySize, const void* value,
                           EGLsizeiANDROID valueSize) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<FileBlobCache> bc;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
 
-    if (keySize < 0 || valueSize < 0) {
-        ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
-        return;
-    }
+        if (keySize < 0 || valueSize < 0) {
+            ALOGW("EGL_ANDROID_blob_cache set: negative sizes are not allowed");
+            return;
+        }
 
-    updateMode();
+        updateMode();
+
+        if (!mInitialized) {
+            return;
+        }
 
-    if (mInitialized) {
         if (mMultifileMode) {
             MultifileBlobCache* mbc = getMultifileBlobCacheLocked();
             mbc->set(key, keySize, value, valueSize);
-        } else {
-            BlobCache* bc = getBlobCacheLocked();
-            bc->set(key, keySize, value, valueSize);
-
-            if (!mSavePending) {
-                mSavePending = true;
-                std::thread deferredSaveThread([this]() {
-                    sleep(kDeferredMonolithicSaveDelay);
-                    std::lock_guard<std::mutex> lock(mMutex);
-                    if (mInitialized && mBlobCache) {
-                        mBlobCache->writeToFile();
-                    }
-                    mSavePending = false;
-                });
-                deferredSaveThread.detach();
-            }
+            return;
+        }
+
+        bc = getBlobCacheLocked();
+        if (!mSavePending) {
+            mSavePending = true;
+            std::thread deferredSaveThread([this]() {
+                sleep(kDeferredMonolithicSaveDelay);
+                std::lock_guard<std::mutex> lock(mMutex);
+                if (mInitialized && mBlobCache) {
+                    mBlobCache->writeToFile();
+                }
+                mSavePending = false;
+            });
+            deferredSaveThread.detach();
         }
     }
+
+    // The monolithic cache locks its own shards, so threads compiling shaders
+    // in parallel don't serialize on mMutex here.
+    bc->set(key, keySize, value, valueSize);
 }
 
 EGLsizeiANDROID egl_cache_t::getBlob(const void* key, EGLsizeiANDROID keySize, void* value,
                                      EGLsizeiANDROID valueSize) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    std::shared_ptr<FileBlobCache> bc;
+    std::shared_ptr<SharedBlobStoreClient> sharedClient;
+    EGLsizeiANDROID localSize = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (keySize < 0 || valueSize < 0) {
+            ALOGW("EGL_ANDROID_blob_cache get: negative sizes are not allowed");
+            return 0;
+        }
 
-    if (keySize < 0 || valueSize < 0) {
-        ALOGW("EGL_ANDROID_blob_cache get: negative sizes are not allowed");
-        return 0;
-    }
+        updateMode();
 
-    updateMode();
+        if (!mInitialized) {
+            return 0;
+        }
 
-    if (mInitialized) {
+        sharedClient = mSharedBlobStoreClient;
         if (mMultifileMode) {
             MultifileBlobCache* mbc = getMultifileBlobCacheLocked();
-            return mbc->get(key, keySize, value, valueSize);
+            localSize = mbc->get(key, keySize, value, valueSize);
         } else {
-            BlobCache* bc = getBlobCacheLocked();
-            return bc->get(key, keySize, value, valueSize);
+            bc = getBlobCacheLocked();
         }
     }
 
-    return 0;
+    if (bc) {
+        localSize = bc->get(key, keySize, value, valueSize);
+    }
+    if (!sharedClient) {
+        return localSize;
+    }
+
+    // The shared store is immutable and the client locks its own state, so
+    // this doesn't hold mMutex either.
+    EGLsizeiANDROID size = sharedClient->get(key, keySize, value, valueSize, localSize);
+    if (sharedClient->shouldReport() && !mReportPending.exchange(true)) {
+        std::thread reportThread([this, sharedClient]() {
+            reportSharedBlobUsage(sharedClient.get());
+            mReportPending = false;
+        });
+        reportThread.detach();
+    }
+    return size;
+}
+
+void egl_cache_t::reportSharedBlobUsage(SharedBlobStoreClient* client) {
+    android::GraphicsEnv::getInstance().reportBlobCacheUsage(client->takeUsage());
 }
 
 void egl_cache_t::setCacheMode(EGLCacheMode cacheMode) {
@@ -263,22 +324,58 @@ void egl_cache_t::updateMode() {
         }
 
         ALOGV("Using multifile EGL blobcache limit of %zu bytes", mCacheByteLimit);
+
+        // Check whether entries should go in a single mapped file instead of one file each
+        std::string backend = base::GetProperty("ro.egl.blobcache.multifile_backend", "");
+        std::string debugBackend = base::GetProperty("debug.egl.blobcache.multifile_backend", "");
+        if (!debugBackend.empty()) {
+            ALOGV("Overriding multifile backend %s with %s", backend.c_str(),
+                  debugBackend.c_str());
+            backend = debugBackend;
+        }
+        if (backend == "mapped") {
+            ALOGV("Using a single mapped file for the multifile EGL blobcache");
+            mMultifileBackend = MultifileBackend::MappedFile;
+        }
+    } else {
+        // Check whether the monolithic cache should be saved incrementally
+        mJournalMode = base::GetBoolProperty("ro.egl.blobcache.journal", false);
+        std::string journal = base::GetProperty("debug.egl.blobcache.journal", "");
+        if (journal == "true") {
+            mJournalMode = true;
+        } else if (journal == "false") {
+            mJournalMode = false;
+        }
+        ALOGV("Using %s saves for the monolithic EGL blobcache",
+              mJournalMode ? "journaled" : "full");
+    }
+
+    // Check whether local misses should fall back to the blob store shared by GpuService
+    mSharedMode = base::GetBoolProperty("ro.egl.blobcache.shared", false);
+    std::string shared = base::GetProperty("debug.egl.blobcache.shared", "");
+    if (shared == "true") {
+        mSharedMode = true;
+    } else if (shared == "false") {
+        mSharedMode = false;
     }
+    ALOGV("%s the shared EGL blobcache", mSharedMode ? "Using" : "Not using");
 }
 
-BlobCache* egl_cache_t::getBlobCacheLocked() {
+std::shared_ptr<FileBlobCache> egl_cache_t::getBlobCacheLocked() {
     if (mBlobCache == nullptr) {
-        mBlobCache.reset(new FileBlobCache(kMaxMonolithicKeySize, kMaxMonolithicValueSize,
-                                           mCacheByteLimit, mFilename));
+        mBlobCache = std::make_shared<FileBlobCache>(kMaxMonolithicKeySize,
+                                                     kMaxMonolithicValueSize, mCacheByteLimit,
+                                                     mFilename, mJournalMode);
     }
-    return mBlobCache.get();
+    return mBlobCache;
 }
 
 MultifileBlobCache* egl_cache_t::getMultifileBlobCacheLocked() {
     if (mMultifileBlobCache == nullptr) {
         mMultifileBlobCache.reset(new MultifileBlobCache(kMaxMultifileKeySize,
                                                          kMaxMultifileValueSize, mCacheByteLimit,
-                                                         kMaxMultifileTotalEntries, mFilename));
+                                                         kMaxMultifileTotalEntries, mFilename,
+                                                         mMultifileBackend));
     }
     return mMultifileBlobCache.get();
 }
@@ -19,7 +19,9 @@
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <graphicsenv/SharedBlobStore.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -94,12 +96,16 @@ private:
     // getBlobCacheLocked returns the BlobCache object being used to store the
     // key/value blob pairs.  If the BlobCache object has not yet been created,
     // this will do so, loading the serialized cache contents from disk if
-    // possible.
-    BlobCache* getBlobCacheLocked();
+    // possible.  The BlobCache is safe for concurrent use, so callers may
+    // release mMutex before using the returned reference.
+    std::shared_ptr<FileBlobCache> getBlobCacheLocked();
 
     // Get or create the multifile blobcache
     MultifileBlobCache* getMultifileBlobCacheLocked();
 
+    // Report the blob cache usage collected by client to GpuService.
+    static void reportSharedBlobUsage(SharedBlobStoreClient* client);
+
     // mInitialized indicates whether the egl_cache_t is in the initialized
     // state.  It is initialized to false at construction time, and gets set to
     // true when initialize is called.  It is set back to false when terminate
@@ -110,8 +116,9 @@ private:
 
     // mBlobCache is the cache in which the key/value blob pairs are stored.  It
     // is initially NULL, and will be initialized by getBlobCacheLocked the
-    // first time it's needed.
-    std::unique_ptr<FileBlobCache> mBlobCache;
+    // first time it's needed.  It is shared with the getBlob and setBlob calls
+    // in progress, so terminate doesn't destroy it while they use it.
+    std::shared_ptr<FileBlobCache> mBlobCache;
 
     // The multifile version of blobcache allowing larger contents to be stored
     std::unique_ptr<MultifileBlobCache> mMultifileBlobCache;
@@ -140,6 +147,28 @@ private:
     // Whether to use multiple files to store cache entries
     bool mMultifileMode;
 
+    // Where the multifile cache keeps its entries
+    MultifileBackend mMultifileBackend;
+
+    // Whether the monolithic cache appends new entries to a journal instead of
+    // rewriting the whole cache file on every save
+    bool mJournalMode;
+
+    // Whether lookups that miss the app's cache fall back to the blob store
+    // GpuService shares between apps
+    bool mSharedMode;
+
+    // mSharedBlobStoreClient serves lookups from the shared blob store and
+    // collects the usage reported to GpuService. It is created by initialize
+    // when shared mode is on and the system driver is loaded, as blobs of
+    // other drivers can't be shared between apps.
+    std::shared_ptr<SharedBlobStoreClient> mSharedBlobStoreClient;
+
+    // mReportPending indicates whether a thread is reporting the shared blob
+    // usage, so that lookups don't make the shader compile threads wait on
+    // the binder call.
+    std::atomic<bool> mReportPending = false;
+
     // Cache limit
     size_t mCacheByteLimit;
 };
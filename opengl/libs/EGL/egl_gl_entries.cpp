@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "egl_gl_entries.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "egl_trace.h"
+#include "egldefs.h"
+
+namespace android {
+
+namespace {
+
+constexpr size_t kNumGlEntries =
+        sizeof(gl_hooks_t::gl_t) / sizeof(__eglMustCastToProperFunctionPointerType);
+
+// Extension entry points end with their vendor suffix, e.g. glDrawBuffersIndexedEXT, while core
+// entry points end with a lower case letter or a dimension, e.g. glTexImage2D.
+constexpr bool is_extension_entry(const char* name) {
+    size_t length = 0;
+    while (name[length]) {
+        length++;
+    }
+    size_t suffix = 0;
+    while (suffix < length && name[length - suffix - 1] >= 'A' &&
+           name[length - suffix - 1] <= 'Z') {
+        suffix++;
+    }
+    return suffix >= 2;
+}
+
+// What the stubs of one GLES version need to resolve their entry point.
+struct lazy_gl_table_t {
+    void* dso;
+    egl_get_proc_address_t getProcAddress;
+    // Entry point names, indexed by slot.
+    const char* const* names;
+    __eglMustCastToProperFunctionPointerType* table;
+    // Entry points resolved by the stubs so far.
+    std::atomic<__eglMustCastToProperFunctionPointerType> entries[kNumGlEntries];
+};
+
+lazy_gl_table_t sLazyGlTables[2];
+
+__eglMustCastToProperFunctionPointerType bind_lazy_gl_entry(
+        int version, size_t slot, __eglMustCastToProperFunctionPointerType stub) {
+    lazy_gl_table_t& lazy = sLazyGlTables[version];
+    __eglMustCastToProperFunctionPointerType f = lazy.entries[slot].load(std::memory_order_acquire);
+    if (f == nullptr) {
+        f = egl_find_gl_entry(lazy.dso, lazy.names[slot], lazy.getProcAddress);
+        lazy.entries[slot].store(f, std::memory_order_release);
+        // Later calls go straight to the driver, unless a GLES layer took the slot, in which
+        // case the layer keeps calling this stub.
+        __atomic_compare_exchange_n(&lazy.table[slot], &stub, f, false, __ATOMIC_RELEASE,
+                                    __ATOMIC_RELAXED);
+    }
+    return f;
+}
+
+template <int Version, size_t Slot, typename Fn>
+struct lazy_gl_entry_t;
+
+template <int Version, size_t Slot, typename R, typename... Args>
+struct lazy_gl_entry_t<Version, Slot, R (*)(Args...)> {
+    static R call(Args... args) {
+        __eglMustCastToProperFunctionPointerType f =
+                bind_lazy_gl_entry(Version, Slot,
+                                   reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+                                           &call));
+        return reinterpret_cast<R (*)(Args...)>(f)(args...);
+    }
+};
+
+template <int Version, bool Lazy, size_t Slot, typename Fn>
+__eglMustCastToProperFunctionPointerType lazy_gl_stub() {
+    if constexpr (Lazy) {
+        return reinterpret_cast<__eglMustCastToProperFunctionPointerType>(
+                &lazy_gl_entry_t<Version, Slot, Fn>::call);
+    } else {
+        return nullptr;
+    }
+}
+
+// Returns the stub of each slot of the table, or null for the entry points resolved eagerly.
+template <int Version>
+const __eglMustCastToProperFunctionPointerType* lazy_gl_stubs() {
+#undef GL_ENTRY
+#define GL_ENTRY(_r, _api, ...)                                                     \
+    lazy_gl_stub<Version, is_extension_entry(#_api),                                \
+                 offsetof(gl_hooks_t::gl_t, _api) /                                 \
+                         sizeof(__eglMustCastToProperFunctionPointerType),          \
+                 decltype(gl_hooks_t::gl_t::_api)>(),
+
+    static const __eglMustCastToProperFunctionPointerType sStubs[kNumGlEntries] = {
+        #include "../entries.in"
+    };
+#undef GL_ENTRY
+    return sStubs;
+}
+
+} // namespace
+
+__eglMustCastToProperFunctionPointerType egl_find_gl_entry(void* dso, const char* name,
+                                                           egl_get_proc_address_t getProcAddress) {
+    const ssize_t SIZE = 256;
+    char scrap[SIZE];
+
+    __eglMustCastToProperFunctionPointerType f =
+        (__eglMustCastToProperFunctionPointerType)dlsym(dso, name);
+    if (f == nullptr) {
+        // couldn't find the entry-point, use eglGetProcAddress()
+        f = getProcAddress(name);
+    }
+    if (f == nullptr) {
+        // Try without the OES postfix
+        ssize_t index = ssize_t(strlen(name)) - 3;
+        if ((index>0 && (index<SIZE-1)) && (!strcmp(name+index, "OES"))) {
+            strncpy(scrap, name, index);
+            scrap[index] = 0;
+            f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
+            //ALOGD_IF(f, "found <%s> instead", scrap);
+        }
+    }
+    if (f == nullptr) {
+        // Try with the OES postfix
+        ssize_t index = ssize_t(strlen(name)) - 3;
+        if (index>0 && strcmp(name+index, "OES")) {
+            snprintf(scrap, SIZE, "%sOES", name);
+            f = (__eglMustCastToProperFunctionPointerType)dlsym(dso, scrap);
+            //ALOGD_IF(f, "found <%s> instead", scrap);
+        }
+    }
+    if (f == nullptr) {
+        //ALOGD("%s", name);
+        f = (__eglMustCastToProperFunctionPointerType)gl_unimplemented;
+
+        /*
+         * GL_EXT_debug_marker is special, we always report it as
+         * supported, it's handled by GLES_trace. If GLES_trace is not
+         * enabled, then these are no-ops.
+         */
+        if (!strcmp(name, "glInsertEventMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        } else if (!strcmp(name, "glPushGroupMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        } else if (!strcmp(name, "glPopGroupMarkerEXT")) {
+            f = (__eglMustCastToProperFunctionPointerType)gl_noop;
+        }
+    }
+    return f;
+}
+
+size_t egl_init_gl_entries(int version, void* dso, const char* const* api,
+                           const char* const* ref_api,
+                           __eglMustCastToProperFunctionPointerType* table,
+                           egl_get_proc_address_t getProcAddress, bool lazy) {
+    ATRACE_CALL();
+
+    lazy_gl_table_t& lazyTable = sLazyGlTables[version];
+    lazyTable.dso = dso;
+    lazyTable.getProcAddress = getProcAddress;
+    lazyTable.names = ref_api ? ref_api : api;
+    lazyTable.table = table;
+    for (auto& entry : lazyTable.entries) {
+        entry.store(nullptr, std::memory_order_relaxed);
+    }
+    const __eglMustCastToProperFunctionPointerType* stubs =
+            version == egl_connection_t::GLESv1_INDEX
+            ? lazy_gl_stubs<egl_connection_t::GLESv1_INDEX>()
+            : lazy_gl_stubs<egl_connection_t::GLESv2_INDEX>();
+
+    size_t eager = 0;
+    for (size_t slot = 0; *api && slot < kNumGlEntries; slot++) {
+        char const * name = *api;
+        if (ref_api) {
+            char const * ref_name = *ref_api++;
+            if (strcmp(name, ref_name) != 0) {
+                table[slot] = nullptr;
+                continue;
+            }
+        }
+        api++;
+
+        if (lazy && stubs[slot]) {
+            table[slot] = stubs[slot];
+        } else {
+            table[slot] = egl_find_gl_entry(dso, name, getProcAddress);
+            eager++;
+        }
+    }
+    return eager;
+}
+
+}; // namespace android
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_EGL_GL_ENTRIES_H
+#define ANDROID_EGL_GL_ENTRIES_H
+
+#include <EGL/egl.h>
+#include <stddef.h>
+
+namespace android {
+
+typedef __eglMustCastToProperFunctionPointerType (*egl_get_proc_address_t)(const char*);
+
+// Returns the driver's implementation of the GLES entry point name. Entry points the driver
+// doesn't export are looked up with its eglGetProcAddress, then with and without the OES suffix.
+// Returns gl_unimplemented, or gl_noop for GL_EXT_debug_marker, if the driver has none.
+__eglMustCastToProperFunctionPointerType egl_find_gl_entry(void* dso, const char* name,
+                                                           egl_get_proc_address_t getProcAddress);
+
+// Fills the gl_hooks_t::gl_t table at the egl_connection_t hooks index version with the driver's
+// entry points. api lists the entry points of that GLES version; if ref_api is set, api is a
+// subset of it in the same order, and the slots missing from api are cleared.
+//
+// If lazy is set, extension entry points are not resolved here. Their slots get a stub that
+// resolves the entry point on its first call and then replaces itself in the table, since most
+// apps never call most of them.
+//
+// Returns the number of entry points resolved eagerly.
+size_t egl_init_gl_entries(int version, void* dso, const char* const* api,
+                           const char* const* ref_api,
+                           __eglMustCastToProperFunctionPointerType* table,
+                           egl_get_proc_address_t getProcAddress, bool lazy);
+
+}; // namespace android
+
+#endif // ANDROID_EGL_GL_ENTRIES_H
@@ -0,0 +1,88 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// Measures the part of eglInitialize that fills the GLES API tables from the driver, with the
+// no-op driver in libEGL_stub_driver, and counts the entry points resolved before the first draw.
+
+#include <benchmark/benchmark.h>
+#include <dlfcn.h>
+
+#include "egl_gl_entries.h"
+#include "egldefs.h"
+
+namespace android {
+
+#undef GL_ENTRY
+#define GL_ENTRY(_r, _api, ...) #_api,
+
+char const * const gl_names[] = {
+    #include "../entries.in"
+    nullptr
+};
+
+char const * const gl_names_1[] = {
+    #include "../entries_gles1.in"
+    nullptr
+};
+
+#undef GL_ENTRY
+
+void gl_unimplemented() {}
+
+void gl_noop() {}
+
+namespace {
+
+constexpr char kStubDriver[] = "libEGL_stub_driver.so";
+
+// Resolves both GLES tables the way Loader does for a single library driver. The argument is
+// whether extension entry points are bound lazily.
+void initGlEntries(benchmark::State& state) {
+    void* dso = dlopen(kStubDriver, RTLD_NOW | RTLD_LOCAL);
+    if (!dso) {
+        state.SkipWithError(dlerror());
+        return;
+    }
+    auto getProcAddress = (egl_get_proc_address_t)dlsym(dso, "eglGetProcAddress");
+    const bool lazy = state.range(0);
+
+    gl_hooks_t hooks[2] = {};
+    size_t eager = 0;
+    for (auto _ : state) {
+        eager = egl_init_gl_entries(egl_connection_t::GLESv1_INDEX, dso, gl_names_1, gl_names,
+                                    (__eglMustCastToProperFunctionPointerType*)&hooks[0].gl,
+                                    getProcAddress, lazy);
+        eager += egl_init_gl_entries(egl_connection_t::GLESv2_INDEX, dso, gl_names, nullptr,
+                                     (__eglMustCastToProperFunctionPointerType*)&hooks[1].gl,
+                                     getProcAddress, lazy);
+        benchmark::ClobberMemory();
+    }
+    state.counters["eager_symbols"] = eager;
+
+    // The tables must still dispatch to the driver once the stubs have bound themselves.
+    hooks[1].gl.glDiscardFramebufferEXT(0, 0, nullptr);
+    if (hooks[1].gl.glDiscardFramebufferEXT !=
+        (decltype(hooks[1].gl.glDiscardFramebufferEXT))getProcAddress("glDiscardFramebufferEXT")) {
+        state.SkipWithError("lazy entry point was not bound");
+    }
+    dlclose(dso);
+}
+BENCHMARK(initGlEntries)->ArgName("lazy")->Arg(0)->Arg(1);
+
+} // namespace
+} // namespace android
+
+BENCHMARK_MAIN();
@@ -0,0 +1,54 @@
+/*
+ ** Copyright 2026, The Android Open Source Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// A GLES driver that implements every entry point as a no-op, for the startup benchmark. Like
+// most drivers it exports the entry points and also returns them from eglGetProcAddress.
+
+#include <string.h>
+
+#include "../hooks.h"
+
+#define STUB_EXPORT extern "C" __attribute__((visibility("default")))
+
+#undef GL_ENTRY
+#define GL_ENTRY(_r, _api, ...) \
+    STUB_EXPORT _r _api(__VA_ARGS__) { return static_cast<_r>(0); }
+#include "../entries.in"
+#undef GL_ENTRY
+
+namespace {
+
+struct stub_entry_t {
+    const char* name;
+    __eglMustCastToProperFunctionPointerType f;
+};
+
+#define GL_ENTRY(_r, _api, ...) {#_api, (__eglMustCastToProperFunctionPointerType)&_api},
+const stub_entry_t sStubEntries[] = {
+    #include "../entries.in"
+};
+#undef GL_ENTRY
+
+} // namespace
+
+STUB_EXPORT __eglMustCastToProperFunctionPointerType eglGetProcAddress(const char* procname) {
+    for (const stub_entry_t& entry : sStubEntries) {
+        if (strcmp(entry.name, procname) == 0) {
+            return entry.f;
+        }
+    }
+    return nullptr;
+}
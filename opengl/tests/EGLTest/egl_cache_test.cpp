@@ -27,8 +27,11 @@
 #include "MultifileBlobCache.h"
 #include "egl_display.h"
 
+#include <atomic>
 #include <fstream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 using namespace std::literals;
 
@@ -328,6 +331,49 @@ TEST_P(EGLCacheTest, TrimCacheOnOverflow) {
     ASSERT_EQ(0xee, buf2[3]);
 }
 
+TEST_P(EGLCacheTest, SavingWhileSettingKeepsCacheFile) {
+    // Skip if not in monolithic mode
+    if (mCacheMode == egl_cache_t::EGLCacheMode::Multifile) {
+        GTEST_SKIP() << "Skipping test designed for monolithic";
+    }
+
+    mCache->setCacheLimit(64 * 1024);
+    mCache->initialize(egl_display_t::get(EGL_DEFAULT_DISPLAY));
+    mCache->setBlob("abcd", 4, "efgh", 4);
+
+    // Sets don't hold the egl_cache_t lock, so they land while terminate is
+    // writing the cache out. Each write must still produce a file that the
+    // next initialize loads.
+    std::atomic<bool> done(false);
+    std::vector<std::thread> setters;
+    for (int t = 0; t < 4; t++) {
+        setters.emplace_back([this, t, &done]() {
+            uint8_t value[32];
+            for (int i = 0; !done; i = (i + 1) % 64) {
+                int key = t * 64 + i;
+                memset(value, key & 0xff, sizeof(value));
+                mCache->setBlob(&key, sizeof(key), value, sizeof(value));
+            }
+        });
+    }
+
+    int hits = 0;
+    for (int i = 0; i < 20; i++) {
+        mCache->terminate();
+        mCache->initialize(egl_display_t::get(EGL_DEFAULT_DISPLAY));
+        uint8_t buf[4] = { 0xee, 0xee, 0xee, 0xee };
+        if (mCache->getBlob("abcd", 4, buf, 4) == 4 && buf[0] == 'e') {
+            hits++;
+        }
+    }
+
+    done = true;
+    for (auto& setter : setters) {
+        setter.join();
+    }
+    ASSERT_EQ(20, hits);
+}
+
 INSTANTIATE_TEST_CASE_P(MonolithicCacheTests,
         EGLCacheTest, ::testing::Values(egl_cache_t::EGLCacheMode::Monolithic));
 INSTANTIATE_TEST_CASE_P(MultifileCacheTests,
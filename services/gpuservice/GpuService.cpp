@@ -20,15 +20,19 @@
 
 #include <android-base/stringprintf.h>
 #include <android-base/properties.h>
+#include <android/content/pm/IPackageManagerNative.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
+#include <binder/IServiceManager.h>
 #include <binder/Parcel.h>
 #include <binder/PermissionCache.h>
+#include <cutils/multiuser.h>
 #include <cutils/properties.h>
 #include <gpumem/GpuMem.h>
 #include <gpuwork/GpuWork.h>
 #include <gpustats/GpuStats.h>
 #include <private/android_filesystem_config.h>
+#include <sharedblobcache/SharedBlobCache.h>
 #include <tracing/GpuMemTracer.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
@@ -47,6 +51,7 @@ status_t cmdHelp(int out);
 status_t cmdVkjson(int out, int err);
 status_t cmdVkprofiles(int out, int err);
 void dumpGameDriverInfo(std::string* result);
+bool isTrustedBlobCacheSource(uid_t appId);
 } // namespace
 
 const String16 sDump("android.permission.DUMP");
@@ -59,7 +64,9 @@ GpuService::GpuService()
       : mGpuMem(std::make_shared<GpuMem>()),
         mGpuWork(std::make_shared<gpuwork::GpuWork>()),
         mGpuStats(std::make_unique<GpuStats>()),
-        mGpuMemTracer(std::make_unique<GpuMemTracer>()) {
+        mGpuMemTracer(std::make_unique<GpuMemTracer>()),
+        mSharedBlobCache(std::make_unique<SharedBlobCache>(base::GetProperty("ro.build.id", ""),
+                                                           isTrustedBlobCacheSource)) {
 
     mGpuMemAsyncInitThread = std::make_unique<std::thread>([this] (){
         mGpuMem->initialize();
@@ -106,6 +113,27 @@ void GpuService::addVulkanEngineName(const std::string& appPackageName,
     mGpuStats->addVulkanEngineName(appPackageName, driverVersionCode, engineName);
 }
 
+base::unique_fd GpuService::getSharedBlobStore() {
+    return mSharedBlobCache->getStore();
+}
+
+void GpuService::reportBlobCacheUsage(const SharedBlobUsage& usage) {
+    // Entries are only promoted once enough distinct apps reported them, so the app must come
+    // from binder rather than from the report, and count once across users.
+    const uid_t uid = IPCThreadState::self()->getCallingUid();
+    const uid_t appId = multiuser_get_app_id(uid);
+
+    // Isolated and SDK sandbox processes run code that isn't the app's own, so they don't
+    // report at all.
+    if ((appId >= AID_ISOLATED_START && appId <= AID_ISOLATED_END) ||
+        (appId >= AID_SDK_SANDBOX_PROCESS_START && appId <= AID_SDK_SANDBOX_PROCESS_END)) {
+        ALOGW("Permission Denial: can't report blob cache usage from uid=%d", uid);
+        return;
+    }
+
+    mSharedBlobCache->reportUsage(appId, usage);
+}
+
 void GpuService::toggleAngleAsSystemDriver(bool enabled) {
     IPCThreadState* ipc = IPCThreadState::self();
     const int pid = ipc->getCallingPid();
@@ -181,6 +209,7 @@ status_t GpuService::doDump(int fd, const Vector<String16>& args, bool /*asProto
         bool dumpMem = false;
         bool dumpStats = false;
         bool dumpWork = false;
+        bool dumpSharedBlobCache = false;
         size_t numArgs = args.size();
 
         if (numArgs) {
@@ -193,9 +222,11 @@ status_t GpuService::doDump(int fd, const Vector<String16>& args, bool /*asProto
                     dumpMem = true;
                 } else if (args[index] == String16("--gpuwork")) {
                     dumpWork = true;
+                } else if (args[index] == String16("--sharedblobcache")) {
+                    dumpSharedBlobCache = true;
                 }
             }
-            dumpAll = !(dumpDriverInfo || dumpMem || dumpStats || dumpWork);
+            dumpAll = !(dumpDriverInfo || dumpMem || dumpStats || dumpWork || dumpSharedBlobCache);
         }
 
         if (dumpAll || dumpDriverInfo) {
@@ -214,6 +245,10 @@ status_t GpuService::doDump(int fd, const Vector<String16>& args, bool /*asProto
             mGpuWork->dump(args, &result);
             result.append("\n");
         }
+        if (dumpAll || dumpSharedBlobCache) {
+            mSharedBlobCache->dump(&result);
+            result.append("\n");
+        }
     }
 
     write(fd, result.c_str(), result.size());
@@ -237,7 +272,10 @@ status_t cmdHelp(int out) {
 }
 
 status_t cmdVkjson(int out, int /*err*/) {
-    dprintf(out, "%s\n", VkJsonInstanceToJson(VkJsonGetInstance()).c_str());
+    if (!VkJsonInstanceWriteJson(VkJsonGetInstance(), out)) {
+        return UNKNOWN_ERROR;
+    }
+    dprintf(out, "\n");
     return NO_ERROR;
 }
 
@@ -258,6 +296,33 @@ void dumpGameDriverInfo(std::string* result) {
     StringAppendF(result, "Pre-release Game Driver: %s\n", preReleaseGameDriver);
 }
 
+bool isTrustedBlobCacheSource(uid_t appId) {
+    // The shell runs whatever the user pushes, unlike the other system uids.
+    if (appId < AID_APP_START) {
+        return appId != AID_SHELL;
+    }
+
+    // Otherwise only preinstalled apps are trusted. A shared uid doesn't map to a single package
+    // and isn't trusted either.
+    sp<content::pm::IPackageManagerNative> packageManager =
+            interface_cast<content::pm::IPackageManagerNative>(
+                    defaultServiceManager()->checkService(String16("package_native")));
+    if (packageManager == nullptr) {
+        ALOGE("%s: unable to access native PackageManager", __func__);
+        return false;
+    }
+    std::vector<std::string> names;
+    if (!packageManager->getNamesForUids({static_cast<int32_t>(appId)}, &names).isOk() ||
+        names.size() != 1 || names[0].empty()) {
+        return false;
+    }
+    int32_t locationFlags = 0;
+    if (!packageManager->getLocationFlags(names[0], &locationFlags).isOk()) {
+        return false;
+    }
+    return locationFlags != 0;
+}
+
 } // anonymous namespace
 
 } // namespace android
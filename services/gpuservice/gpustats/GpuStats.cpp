@@ -30,11 +30,146 @@
 
 namespace android {
 
+struct GpuStats::Report {
+    enum class Type {
+        DRIVER_STATS,
+        TARGET_STATS,
+        VULKAN_ENGINE_NAME,
+    };
+
+    Type type;
+    std::string appPackageName;
+    uint64_t driverVersionCode = 0;
+    std::chrono::time_point<std::chrono::system_clock> receivedTime;
+
+    // DRIVER_STATS
+    std::string driverPackageName;
+    std::string driverVersionName;
+    int64_t driverBuildTime = 0;
+    int32_t vulkanVersion = 0;
+    GpuStatsInfo::Driver driver = GpuStatsInfo::Driver::NONE;
+    bool isDriverLoaded = false;
+    int64_t driverLoadingTime = 0;
+
+    // TARGET_STATS
+    GpuStatsInfo::Stats stats = GpuStatsInfo::Stats::CPU_VULKAN_IN_USE;
+    std::vector<uint64_t> values;
+
+    // VULKAN_ENGINE_NAME
+    std::string engineName;
+
+    Report* next = nullptr;
+};
+
+GpuStats::GpuStats() {
+    mAggregator = std::thread(&GpuStats::aggregatorLoop, this);
+}
+
 GpuStats::~GpuStats() {
+    {
+        std::lock_guard<std::mutex> lock(mAggregatorLock);
+        mAggregatorStopping = true;
+    }
+    mAggregatorCondition.notify_one();
+    mAggregator.join();
+
     if (mStatsdRegistered) {
         AStatsManager_clearPullAtomCallback(android::util::GPU_STATS_GLOBAL_INFO);
         AStatsManager_clearPullAtomCallback(android::util::GPU_STATS_APP_INFO);
     }
+
+    Report* report = mPendingReports.exchange(nullptr);
+    while (report) {
+        Report* next = report->next;
+        delete report;
+        report = next;
+    }
+}
+
+void GpuStats::queueReport(Report* report) {
+    if (mPendingReportCount.fetch_add(1) >= MAX_NUM_PENDING_REPORTS) {
+        mPendingReportCount.fetch_sub(1);
+        ALOGV("Too many pending GpuStats reports. Dropping the report of %s.",
+              report->appPackageName.c_str());
+        delete report;
+        return;
+    }
+    report->receivedTime = std::chrono::system_clock::now();
+
+    // Same push as SurfaceFlinger's LocklessQueue: retry until no other thread pushed between
+    // the load and the compare_exchange.
+    Report* previousHead = mPendingReports.load();
+    do {
+        report->next = previousHead;
+    } while (!mPendingReports.compare_exchange_weak(previousHead, report));
+
+    // Only the report that makes the list non-empty wakes the aggregator. Taking the lock makes
+    // sure the aggregator is either waiting or hasn't checked the list yet.
+    if (!previousHead) {
+        { std::lock_guard<std::mutex> lock(mAggregatorLock); }
+        mAggregatorCondition.notify_one();
+    }
+}
+
+void GpuStats::aggregatorLoop() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mAggregatorLock);
+            mAggregatorCondition.wait(lock, [this] {
+                return mAggregatorStopping || mPendingReports.load() != nullptr;
+            });
+            if (mAggregatorStopping) {
+                return;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        mergePendingReportsLocked();
+    }
+}
+
+void GpuStats::mergePendingReportsLocked() {
+    ATRACE_CALL();
+
+    // The list is taken under mLock so reports are merged in the order they were received.
+    Report* reversed = mPendingReports.exchange(nullptr);
+    if (!reversed) {
+        return;
+    }
+    registerStatsdCallbacksIfNeeded();
+
+    Report* report = nullptr;
+    while (reversed) {
+        Report* next = reversed->next;
+        reversed->next = report;
+        report = reversed;
+        reversed = next;
+    }
+
+    size_t count = 0;
+    while (report) {
+        switch (report->type) {
+            case Report::Type::DRIVER_STATS:
+                mergeDriverStatsLocked(*report);
+                break;
+            case Report::Type::TARGET_STATS:
+                mergeTargetStatsLocked(*report);
+                break;
+            case Report::Type::VULKAN_ENGINE_NAME:
+                mergeVulkanEngineNameLocked(*report);
+                break;
+        }
+        Report* next = report->next;
+        delete report;
+        report = next;
+        count++;
+    }
+    mPendingReportCount.fetch_sub(count);
+}
+
+const std::string* GpuStats::findPackageNameLocked(const std::string& appPackageName) const {
+    const auto found = mPackageNames.find(appPackageName);
+    return found == mPackageNames.end() ? nullptr : &*found;
 }
 
 static void addLoadingCount(GpuStatsInfo::Driver driver, bool isDriverLoaded,
@@ -84,12 +219,11 @@ static void addLoadingTime(GpuStatsInfo::Driver driver, int64_t driverLoadingTim
     }
 }
 
-void GpuStats::purgeOldDriverStats() {
+void GpuStats::purgeOldDriverStatsLocked() {
     ALOG_ASSERT(mAppStats.size() == MAX_NUM_APP_RECORDS);
 
     struct GpuStatsApp {
-        // Key is <app package name>+<driver version code>.
-        const std::string *appStatsKey = nullptr;
+        const AppKey *appStatsKey = nullptr;
         const std::chrono::time_point<std::chrono::system_clock> *lastAccessTime = nullptr;
     };
     std::vector<GpuStatsApp> gpuStatsApps(MAX_NUM_APP_RECORDS);
@@ -114,6 +248,19 @@ void GpuStats::purgeOldDriverStats() {
         gpuStatsApps[i].appStatsKey = nullptr;
         gpuStatsApps[i].lastAccessTime = nullptr;
     }
+
+    // Drop the package names that no app record refers to anymore.
+    std::unordered_set<const std::string*> usedPackageNames;
+    for (const auto& [appStatsKey, gpuStatsAppInfo] : mAppStats) {
+        usedPackageNames.insert(appStatsKey.appPackageName);
+    }
+    for (auto it = mPackageNames.begin(); it != mPackageNames.end();) {
+        if (usedPackageNames.count(&*it)) {
+            ++it;
+        } else {
+            it = mPackageNames.erase(it);
+        }
+    }
 }
 
 void GpuStats::insertDriverStats(const std::string& driverPackageName,
@@ -123,8 +270,6 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
                                  bool isDriverLoaded, int64_t driverLoadingTime) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    registerStatsdCallbacksIfNeeded();
     ALOGV("Received:\n"
           "\tdriverPackageName[%s]\n"
           "\tdriverVersionName[%s]\n"
@@ -139,6 +284,31 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
           appPackageName.c_str(), vulkanVersion, static_cast<int32_t>(driver), isDriverLoaded,
           driverLoadingTime);
 
+    Report* report = new Report();
+    report->type = Report::Type::DRIVER_STATS;
+    report->appPackageName = appPackageName;
+    report->driverVersionCode = driverVersionCode;
+    report->driverPackageName = driverPackageName;
+    report->driverVersionName = driverVersionName;
+    report->driverBuildTime = driverBuildTime;
+    report->vulkanVersion = vulkanVersion;
+    report->driver = driver;
+    report->isDriverLoaded = isDriverLoaded;
+    report->driverLoadingTime = driverLoadingTime;
+    queueReport(report);
+}
+
+void GpuStats::mergeDriverStatsLocked(const Report& report) {
+    const std::string& driverPackageName = report.driverPackageName;
+    const std::string& driverVersionName = report.driverVersionName;
+    const uint64_t driverVersionCode = report.driverVersionCode;
+    const int64_t driverBuildTime = report.driverBuildTime;
+    const std::string& appPackageName = report.appPackageName;
+    const int32_t vulkanVersion = report.vulkanVersion;
+    const GpuStatsInfo::Driver driver = report.driver;
+    const bool isDriverLoaded = report.isDriverLoaded;
+    const int64_t driverLoadingTime = report.driverLoadingTime;
+
     if (!mGlobalStats.count(driverVersionCode)) {
         GpuStatsGlobalInfo globalInfo;
         addLoadingCount(driver, isDriverLoaded, &globalInfo);
@@ -152,12 +322,14 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
         addLoadingCount(driver, isDriverLoaded, &mGlobalStats[driverVersionCode]);
     }
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-    if (!mAppStats.count(appStatsKey)) {
+    const std::string* internedPackageName = findPackageNameLocked(appPackageName);
+    if (!internedPackageName ||
+        !mAppStats.count(AppKey{internedPackageName, driverVersionCode})) {
         if (mAppStats.size() >= MAX_NUM_APP_RECORDS) {
             ALOGV("GpuStatsAppInfo has reached maximum size. Removing old stats to make room.");
-            purgeOldDriverStats();
+            purgeOldDriverStatsLocked();
         }
+        internedPackageName = &*mPackageNames.insert(appPackageName).first;
 
         GpuStatsAppInfo appInfo;
         addLoadingTime(driver, driverLoadingTime, &appInfo);
@@ -165,13 +337,14 @@ void GpuStats::insertDriverStats(const std::string& driverPackageName,
         appInfo.driverVersionCode = driverVersionCode;
         appInfo.angleInUse =
                 driver == GpuStatsInfo::Driver::ANGLE || driverPackageName == "angle";
-        appInfo.lastAccessTime = std::chrono::system_clock::now();
-        mAppStats.insert({appStatsKey, appInfo});
+        appInfo.lastAccessTime = report.receivedTime;
+        mAppStats.insert({AppKey{internedPackageName, driverVersionCode}, appInfo});
     } else {
-        mAppStats[appStatsKey].angleInUse =
+        GpuStatsAppInfo& appInfo = mAppStats[AppKey{internedPackageName, driverVersionCode}];
+        appInfo.angleInUse =
                 driver == GpuStatsInfo::Driver::ANGLE || driverPackageName == "angle";
-        addLoadingTime(driver, driverLoadingTime, &mAppStats[appStatsKey]);
-        mAppStats[appStatsKey].lastAccessTime = std::chrono::system_clock::now();
+        addLoadingTime(driver, driverLoadingTime, &appInfo);
+        appInfo.lastAccessTime = report.receivedTime;
     }
 }
 
@@ -186,18 +359,27 @@ void GpuStats::addVulkanEngineName(const std::string& appPackageName,
                                    const char* engineNameCStr) {
     ATRACE_CALL();
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
     const size_t engineNameLen = std::min(strlen(engineNameCStr),
                                           GpuStatsAppInfo::MAX_VULKAN_ENGINE_NAME_LENGTH);
-    const std::string engineName{engineNameCStr, engineNameLen};
 
-    std::lock_guard<std::mutex> lock(mLock);
-    registerStatsdCallbacksIfNeeded();
+    Report* report = new Report();
+    report->type = Report::Type::VULKAN_ENGINE_NAME;
+    report->appPackageName = appPackageName;
+    report->driverVersionCode = driverVersionCode;
+    report->engineName.assign(engineNameCStr, engineNameLen);
+    queueReport(report);
+}
 
-    const auto foundApp = mAppStats.find(appStatsKey);
+void GpuStats::mergeVulkanEngineNameLocked(const Report& report) {
+    const std::string* internedPackageName = findPackageNameLocked(report.appPackageName);
+    if (!internedPackageName) {
+        return;
+    }
+    const auto foundApp = mAppStats.find(AppKey{internedPackageName, report.driverVersionCode});
     if (foundApp == mAppStats.end()) {
         return;
     }
+    const std::string& engineName = report.engineName;
 
     // Storing in std::set<> is not efficient for serialization tasks. Use
     // vector instead and filter out dups
@@ -213,17 +395,29 @@ void GpuStats::insertTargetStatsArray(const std::string& appPackageName,
                                  const uint64_t* values, const uint32_t valueCount) {
     ATRACE_CALL();
 
-    const std::string appStatsKey = appPackageName + std::to_string(driverVersionCode);
-
-    std::lock_guard<std::mutex> lock(mLock);
-    registerStatsdCallbacksIfNeeded();
+    Report* report = new Report();
+    report->type = Report::Type::TARGET_STATS;
+    report->appPackageName = appPackageName;
+    report->driverVersionCode = driverVersionCode;
+    report->stats = stats;
+    report->values.assign(values, values + valueCount);
+    queueReport(report);
+}
 
-    const auto foundApp = mAppStats.find(appStatsKey);
+void GpuStats::mergeTargetStatsLocked(const Report& report) {
+    const std::string* internedPackageName = findPackageNameLocked(report.appPackageName);
+    if (!internedPackageName) {
+        return;
+    }
+    const auto foundApp = mAppStats.find(AppKey{internedPackageName, report.driverVersionCode});
     if (foundApp == mAppStats.end()) {
         return;
     }
 
     GpuStatsAppInfo& targetAppStats = foundApp->second;
+    const GpuStatsInfo::Stats stats = report.stats;
+    const uint64_t* values = report.values.data();
+    const uint32_t valueCount = report.values.size();
 
     if (stats == GpuStatsInfo::Stats::VULKAN_INSTANCE_EXTENSION
         || stats == GpuStatsInfo::Stats::VULKAN_DEVICE_EXTENSION) {
@@ -313,6 +507,7 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
     }
 
     std::lock_guard<std::mutex> lock(mLock);
+    mergePendingReportsLocked();
     bool dumpAll = true;
 
     std::unordered_set<std::string> argsSet;
@@ -347,12 +542,14 @@ void GpuStats::dump(const Vector<String16>& args, std::string* result) {
 
         if (dumpApp) {
             mAppStats.clear();
+            mPackageNames.clear();
             clearAll = false;
         }
 
         if (clearAll) {
             mGlobalStats.clear();
             mAppStats.clear();
+            mPackageNames.clear();
         }
     }
 }
@@ -405,83 +602,103 @@ static std::string int64VectorToProtoByteString(const std::vector<int64_t>& valu
 AStatsManager_PullAtomCallbackReturn GpuStats::pullAppInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
+    // Take the stats and serialize them outside mLock, so the aggregator isn't blocked.
+    std::vector<GpuStatsAppInfo> appStats;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mergePendingReportsLocked();
+        if (data) {
+            appStats.reserve(mAppStats.size());
+            for (auto& ele : mAppStats) {
+                appStats.push_back(std::move(ele.second));
+            }
+        }
+        mAppStats.clear();
+        mPackageNames.clear();
+    }
 
     if (data) {
-        for (const auto& ele : mAppStats) {
+        for (const auto& appInfo : appStats) {
             std::string glDriverBytes = int64VectorToProtoByteString(
-                ele.second.glDriverLoadingTime);
+                appInfo.glDriverLoadingTime);
             std::string vkDriverBytes = int64VectorToProtoByteString(
-                ele.second.vkDriverLoadingTime);
+                appInfo.vkDriverLoadingTime);
             std::string angleDriverBytes = int64VectorToProtoByteString(
-                ele.second.angleDriverLoadingTime);
+                appInfo.angleDriverLoadingTime);
 
             std::vector<const char*> engineNames;
-            for (const std::string &engineName : ele.second.vulkanEngineNames) {
+            for (const std::string &engineName : appInfo.vulkanEngineNames) {
                 engineNames.push_back(engineName.c_str());
             }
 
             android::util::addAStatsEvent(
                     data,
                     android::util::GPU_STATS_APP_INFO,
-                    ele.second.appPackageName.c_str(),
-                    ele.second.driverVersionCode,
+                    appInfo.appPackageName.c_str(),
+                    appInfo.driverVersionCode,
                     android::util::BytesField(glDriverBytes.c_str(),
                                               glDriverBytes.length()),
                     android::util::BytesField(vkDriverBytes.c_str(),
                                               vkDriverBytes.length()),
                     android::util::BytesField(angleDriverBytes.c_str(),
                                               angleDriverBytes.length()),
-                    ele.second.cpuVulkanInUse,
-                    ele.second.falsePrerotation,
-                    ele.second.gles1InUse,
-                    ele.second.angleInUse,
-                    ele.second.createdGlesContext,
-                    ele.second.createdVulkanDevice,
-                    ele.second.createdVulkanSwapchain,
-                    ele.second.vulkanApiVersion,
-                    ele.second.vulkanDeviceFeaturesEnabled,
-                    ele.second.vulkanInstanceExtensions,
-                    ele.second.vulkanDeviceExtensions,
+                    appInfo.cpuVulkanInUse,
+                    appInfo.falsePrerotation,
+                    appInfo.gles1InUse,
+                    appInfo.angleInUse,
+                    appInfo.createdGlesContext,
+                    appInfo.createdVulkanDevice,
+                    appInfo.createdVulkanSwapchain,
+                    appInfo.vulkanApiVersion,
+                    appInfo.vulkanDeviceFeaturesEnabled,
+                    appInfo.vulkanInstanceExtensions,
+                    appInfo.vulkanDeviceExtensions,
                     engineNames);
         }
     }
 
-    mAppStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
 AStatsManager_PullAtomCallbackReturn GpuStats::pullGlobalInfoAtom(AStatsEventList* data) {
     ATRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mLock);
-    // flush cpuVulkanVersion and glesVersion to builtin driver stats
-    interceptSystemDriverStatsLocked();
+    std::vector<GpuStatsGlobalInfo> globalStats;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mergePendingReportsLocked();
+        // flush cpuVulkanVersion and glesVersion to builtin driver stats
+        interceptSystemDriverStatsLocked();
+        if (data) {
+            globalStats.reserve(mGlobalStats.size());
+            for (auto& ele : mGlobalStats) {
+                globalStats.push_back(std::move(ele.second));
+            }
+        }
+        mGlobalStats.clear();
+    }
 
     if (data) {
-        for (const auto& ele : mGlobalStats) {
+        for (const auto& globalInfo : globalStats) {
           android::util::addAStatsEvent(
                   data,
                   android::util::GPU_STATS_GLOBAL_INFO,
-                  ele.second.driverPackageName.c_str(),
-                  ele.second.driverVersionName.c_str(),
-                  ele.second.driverVersionCode,
-                  ele.second.driverBuildTime,
-                  ele.second.glLoadingCount,
-                  ele.second.glLoadingFailureCount,
-                  ele.second.vkLoadingCount,
-                  ele.second.vkLoadingFailureCount,
-                  ele.second.vulkanVersion,
-                  ele.second.cpuVulkanVersion,
-                  ele.second.glesVersion,
-                  ele.second.angleLoadingCount,
-                  ele.second.angleLoadingFailureCount);
+                  globalInfo.driverPackageName.c_str(),
+                  globalInfo.driverVersionName.c_str(),
+                  globalInfo.driverVersionCode,
+                  globalInfo.driverBuildTime,
+                  globalInfo.glLoadingCount,
+                  globalInfo.glLoadingFailureCount,
+                  globalInfo.vkLoadingCount,
+                  globalInfo.vkLoadingFailureCount,
+                  globalInfo.vulkanVersion,
+                  globalInfo.cpuVulkanVersion,
+                  globalInfo.glesVersion,
+                  globalInfo.angleLoadingCount,
+                  globalInfo.angleLoadingFailureCount);
         }
     }
 
-    mGlobalStats.clear();
-
     return AStatsManager_PULL_SUCCESS;
 }
 
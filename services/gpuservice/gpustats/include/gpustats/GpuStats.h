@@ -22,14 +22,27 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace android {
 
+/*
+ * GpuStats collects the driver and target stats that apps report. Binder threads only queue the
+ * reports on a lockless list, and a background aggregator merges them into the stats under mLock,
+ * so apps launching at once don't contend on the stats. dump() and the statsd pulls merge the
+ * queued reports first, so they always see every report received before them.
+ */
 class GpuStats {
 public:
+    GpuStats();
     ~GpuStats();
 
     // Insert new gpu driver stats into global stats and app stats.
@@ -57,18 +70,52 @@ public:
     static const size_t MAX_NUM_APP_RECORDS = 100;
     // The number of apps to remove when mAppStats fills up.
     static const size_t APP_RECORD_HEADROOM = 10;
+    // Reports received beyond this many waiting for the aggregator are dropped.
+    static const size_t MAX_NUM_PENDING_REPORTS = 1024;
 
 private:
     // Friend class for testing.
     friend class TestableGpuStats;
 
+    // A report queued by one of the insert calls.
+    struct Report;
+
+    // Key of mAppStats. appPackageName points into mPackageNames.
+    struct AppKey {
+        const std::string* appPackageName;
+        uint64_t driverVersionCode;
+
+        bool operator==(const AppKey& other) const {
+            return appPackageName == other.appPackageName &&
+                    driverVersionCode == other.driverVersionCode;
+        }
+    };
+    struct AppKeyHash {
+        size_t operator()(const AppKey& key) const {
+            return std::hash<const std::string*>()(key.appPackageName) ^
+                    std::hash<uint64_t>()(key.driverVersionCode);
+        }
+    };
+
+    // Queues a report for the aggregator. Takes ownership of report.
+    void queueReport(Report* report);
+    // Merges the queued reports into the stats.
+    void mergePendingReportsLocked();
+    void mergeDriverStatsLocked(const Report& report);
+    void mergeTargetStatsLocked(const Report& report);
+    void mergeVulkanEngineNameLocked(const Report& report);
+    // Returns the interned copy of appPackageName, or nullptr if it isn't interned.
+    const std::string* findPackageNameLocked(const std::string& appPackageName) const;
+    // Background thread that merges the queued reports.
+    void aggregatorLoop();
+
     // Native atom puller callback registered in statsd.
     static AStatsManager_PullAtomCallbackReturn pullAtomCallback(int32_t atomTag,
                                                                  AStatsEventList* data,
                                                                  void* cookie);
 
     // Remove old packages from mAppStats.
-    void purgeOldDriverStats();
+    void purgeOldDriverStatsLocked();
 
     // Pull global into into global atom.
     AStatsManager_PullAtomCallbackReturn pullGlobalInfoAtom(AStatsEventList* data);
@@ -83,14 +130,26 @@ private:
     // Registers statsd callbacks if they have not already been registered
     void registerStatsdCallbacksIfNeeded();
 
+    // Reports queued by the insert calls, newest first. Pushed without a lock, and taken as a
+    // whole under mLock.
+    std::atomic<Report*> mPendingReports = nullptr;
+    std::atomic<size_t> mPendingReportCount = 0;
+
+    // Wakes the aggregator when mPendingReports becomes non-empty.
+    std::mutex mAggregatorLock;
+    std::condition_variable mAggregatorCondition;
+    bool mAggregatorStopping = false;
+    std::thread mAggregator;
+
     // GpuStats access should be guarded by mLock.
     std::mutex mLock;
     // True if statsd callbacks have been registered.
     bool mStatsdRegistered = false;
     // Key is driver version code.
     std::unordered_map<uint64_t, GpuStatsGlobalInfo> mGlobalStats;
-    // Key is <app package name>+<driver version code>.
-    std::unordered_map<std::string, GpuStatsAppInfo> mAppStats;
+    // Package names of the apps in mAppStats, each stored once.
+    std::unordered_set<std::string> mPackageNames;
+    std::unordered_map<AppKey, GpuStatsAppInfo, AppKeyHash> mAppStats;
 };
 
 } // namespace android
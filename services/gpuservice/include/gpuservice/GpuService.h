@@ -36,6 +36,7 @@ class GpuWork;
 class GpuMem;
 class GpuStats;
 class GpuMemTracer;
+class SharedBlobCache;
 
 class GpuService : public BnGpuService, public PriorityDumper {
 public:
@@ -66,6 +67,8 @@ private:
     void toggleAngleAsSystemDriver(bool enabled) override;
     void addVulkanEngineName(const std::string& appPackageName, const uint64_t driverVersionCode,
                              const char *engineName) override;
+    base::unique_fd getSharedBlobStore() override;
+    void reportBlobCacheUsage(const SharedBlobUsage& usage) override;
 
     /*
      * IBinder interface
@@ -92,6 +95,7 @@ private:
     std::shared_ptr<gpuwork::GpuWork> mGpuWork;
     std::unique_ptr<GpuStats> mGpuStats;
     std::unique_ptr<GpuMemTracer> mGpuMemTracer;
+    std::unique_ptr<SharedBlobCache> mSharedBlobCache;
     std::mutex mLock;
     std::string mDeveloperDriverPath;
     std::unique_ptr<std::thread> mGpuMemAsyncInitThread;
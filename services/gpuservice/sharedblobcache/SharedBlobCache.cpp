@@ -0,0 +1,225 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#undef LOG_TAG
+#define LOG_TAG "SharedBlobCache"
+
+#include "sharedblobcache/SharedBlobCache.h"
+
+#include <android-base/stringprintf.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+
+namespace android {
+
+using base::StringAppendF;
+
+SharedBlobCache::SharedBlobCache(const std::string& buildId, TrustedSourceFn isTrustedSource,
+                                 size_t maxStoreSize, size_t promotionQuorum)
+      : mBuildId(buildId),
+        mIsTrustedSource(std::move(isTrustedSource)),
+        mMaxStoreSize(maxStoreSize),
+        mPromotionQuorum(promotionQuorum) {}
+
+void SharedBlobCache::reportUsage(uid_t uid, const SharedBlobUsage& usage) {
+    // Finding out whether an app is trusted may take a binder call, so it is done once per app
+    // and without holding the lock.
+    bool known;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        known = mAppUsage.count(uid) != 0;
+    }
+    const bool trusted = !known && mIsTrustedSource(uid);
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto [appIt, inserted] = mAppUsage.try_emplace(uid);
+    AppUsage& appUsage = appIt->second;
+    if (inserted) {
+        appUsage.trusted = trusted;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - appUsage.windowStart >= REPORT_WINDOW) {
+        appUsage.windowStart = now;
+        appUsage.windowReports = 0;
+    }
+    if (++appUsage.windowReports > MAX_REPORTS_PER_WINDOW) {
+        appUsage.droppedReports++;
+        return;
+    }
+
+    appUsage.lookups += usage.lookups;
+    appUsage.localHits += usage.localHits;
+    appUsage.sharedHits += usage.sharedHits;
+
+    if (!appUsage.trusted) {
+        return;
+    }
+    for (const SharedBlobEntry& entry : usage.candidates) {
+        addCandidateLocked(uid, appUsage, entry);
+    }
+
+    // Drop the oldest candidates first, as entries that many apps use are reported soon after
+    // each other.
+    while (mCandidateBytes > MAX_CANDIDATE_BYTES && !mCandidateOrder.empty()) {
+        const auto it = mCandidates.find(mCandidateOrder.front());
+        mCandidateOrder.pop_front();
+        if (it != mCandidates.end()) {
+            takeCandidateLocked(it);
+        }
+    }
+}
+
+void SharedBlobCache::addCandidateLocked(uid_t uid, AppUsage& appUsage,
+                                         const SharedBlobEntry& entry) {
+    const size_t entrySize = entry.key.size() + entry.value.size();
+    if (entry.key.empty() || entry.value.empty() || entrySize > mMaxStoreSize) {
+        return;
+    }
+
+    const uint64_t keyHash = SharedBlobStore::hashBlob(entry.key.data(), entry.key.size());
+    if (mPromotedKeys.count(keyHash)) {
+        return;
+    }
+
+    const CandidateId id = {keyHash,
+                            SharedBlobStore::hashBlob(entry.value.data(), entry.value.size())};
+    auto it = mCandidates.find(id);
+    if (it == mCandidates.end()) {
+        if (appUsage.candidateBytes + entrySize > MAX_CANDIDATE_BYTES_PER_APP) {
+            return;
+        }
+        it = mCandidates.emplace(id, Candidate{entry, {}, uid}).first;
+        mCandidateOrder.push_back(id);
+        mCandidateBytes += entrySize;
+        appUsage.candidateBytes += entrySize;
+    } else if (it->second.entry.key != entry.key || it->second.entry.value != entry.value) {
+        // The hashes aren't collision resistant, so the bytes decide whether two apps reported
+        // the same entry.
+        return;
+    }
+
+    Candidate& candidate = it->second;
+    candidate.uids.insert(uid);
+    if (candidate.uids.size() < mPromotionQuorum) {
+        return;
+    }
+
+    promoteLocked(takeCandidateLocked(it));
+}
+
+SharedBlobEntry SharedBlobCache::takeCandidateLocked(
+        std::map<CandidateId, Candidate>::iterator it) {
+    Candidate& candidate = it->second;
+    const size_t entrySize = candidate.entry.key.size() + candidate.entry.value.size();
+    mCandidateBytes -= entrySize;
+    mAppUsage[candidate.owner].candidateBytes -= entrySize;
+
+    SharedBlobEntry entry = std::move(candidate.entry);
+    mCandidates.erase(it);
+    return entry;
+}
+
+void SharedBlobCache::promoteLocked(SharedBlobEntry&& entry) {
+    const size_t entrySize = entry.key.size() + entry.value.size();
+    if (mPromotedBytes + entrySize > mMaxStoreSize) {
+        ALOGV("Shared blob store is full, not promoting a %zu byte entry", entrySize);
+        return;
+    }
+
+    mPromotedKeys.insert(SharedBlobStore::hashBlob(entry.key.data(), entry.key.size()));
+    mPromotedBytes += entrySize;
+    mPromoted.push_back(std::move(entry));
+    mStoreDirty = true;
+}
+
+void SharedBlobCache::rebuildStoreLocked() {
+    base::unique_fd fd(
+            memfd_create("gpuservice_shared_blob_store", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (fd < 0) {
+        ALOGE("Failed to create shared blob store: %s", strerror(errno));
+        return;
+    }
+    if (!SharedBlobStore::write(fd.get(), mBuildId, mPromoted)) {
+        return;
+    }
+    // Apps map the store read-only, and the seals keep it from changing under their mappings.
+    if (fcntl(fd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) !=
+        0) {
+        ALOGE("Failed to seal shared blob store: %s", strerror(errno));
+        return;
+    }
+
+    mStoreFd = std::move(fd);
+    mStoreDirty = false;
+}
+
+base::unique_fd SharedBlobCache::getStore() {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mStoreDirty) {
+        rebuildStoreLocked();
+    }
+    if (mStoreFd < 0) {
+        return base::unique_fd();
+    }
+    return base::unique_fd(fcntl(mStoreFd.get(), F_DUPFD_CLOEXEC, 0));
+}
+
+void SharedBlobCache::dump(std::string* result) {
+    if (!result) return;
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    AppUsage total;
+    size_t trustedApps = 0;
+    size_t appsWithSharedHits = 0;
+    for (const auto& [uid, appUsage] : mAppUsage) {
+        total.lookups += appUsage.lookups;
+        total.localHits += appUsage.localHits;
+        total.sharedHits += appUsage.sharedHits;
+        total.droppedReports += appUsage.droppedReports;
+        if (appUsage.trusted) {
+            trustedApps++;
+        }
+        if (appUsage.sharedHits > 0) {
+            appsWithSharedHits++;
+        }
+    }
+    // Only lookups that missed the app's own cache could be served by the shared store.
+    const uint64_t localMisses = total.lookups - total.localHits;
+
+    result->append("Shared blob cache:\n");
+    StringAppendF(result, "  buildId = %s\n", mBuildId.c_str());
+    StringAppendF(result, "  promotedEntries = %zu\n", mPromoted.size());
+    StringAppendF(result, "  promotedBytes = %zu / %zu\n", mPromotedBytes, mMaxStoreSize);
+    StringAppendF(result, "  candidates = %zu\n", mCandidates.size());
+    StringAppendF(result, "  candidateBytes = %zu\n", mCandidateBytes);
+    StringAppendF(result, "  reportingApps = %zu\n", mAppUsage.size());
+    StringAppendF(result, "  trustedApps = %zu\n", trustedApps);
+    StringAppendF(result, "  droppedReports = %" PRIu64 "\n", total.droppedReports);
+    StringAppendF(result, "  appsWithSharedHits = %zu\n", appsWithSharedHits);
+    StringAppendF(result, "  lookups = %" PRIu64 "\n", total.lookups);
+    StringAppendF(result, "  localHits = %" PRIu64 "\n", total.localHits);
+    StringAppendF(result, "  sharedHits = %" PRIu64 "\n", total.sharedHits);
+    StringAppendF(result, "  crossAppHitRate = %.1f%%\n",
+                  localMisses > 0 ? 100.0 * total.sharedHits / localMisses : 0.0);
+}
+
+} // namespace android
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <graphicsenv/SharedBlobStore.h>
+#include <sys/types.h>
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace android {
+
+// SharedBlobCache hosts the blob store that GpuService shares between apps.
+//
+// Apps report the blob cache entries they read back from their own cache. Only entries reported
+// by trusted sources, such as system processes and preinstalled apps, are considered for the
+// store, and an entry is promoted once enough distinct trusted sources reported the same value
+// for its key. So no app can place a value in the caches of other apps, and a shared hit only
+// tells an app that preinstalled code uses the same shader. The store is rebuilt into a new
+// sealed memfd when it is next requested after a promotion, and apps keep using the store they
+// mapped until they restart.
+class SharedBlobCache {
+public:
+    // Returns whether the entries reported by the app with the given app id may be promoted.
+    using TrustedSourceFn = std::function<bool(uid_t)>;
+
+    SharedBlobCache(const std::string& buildId, TrustedSourceFn isTrustedSource,
+                    size_t maxStoreSize = MAX_STORE_SIZE,
+                    size_t promotionQuorum = PROMOTION_QUORUM);
+
+    // Record the usage reported by the app with the given uid, and promote the candidates it
+    // completes the quorum for.
+    void reportUsage(uid_t uid, const SharedBlobUsage& usage);
+    // Return a read-only file descriptor of the current store, or an invalid one when no entry
+    // has been promoted yet.
+    base::unique_fd getStore();
+    // dumpsys interface
+    void dump(std::string* result);
+
+    // This limits the size of the shared store, and so of each app's mapping of it.
+    static const size_t MAX_STORE_SIZE = 4 * 1024 * 1024;
+    // The number of distinct trusted apps that must report the same entry before it is promoted.
+    static const size_t PROMOTION_QUORUM = 3;
+    // This limits the memory used for candidates waiting for their quorum. The oldest ones are
+    // dropped first.
+    static const size_t MAX_CANDIDATE_BYTES = 8 * 1024 * 1024;
+    // This limits the memory used for the candidates each app first reported, so one app can't
+    // push the candidates of the others out.
+    static const size_t MAX_CANDIDATE_BYTES_PER_APP = 1024 * 1024;
+    // Each app may send this many reports per REPORT_WINDOW, and later ones are dropped.
+    static const size_t MAX_REPORTS_PER_WINDOW = 32;
+    static constexpr std::chrono::seconds REPORT_WINDOW{60};
+
+private:
+    struct Candidate {
+        SharedBlobEntry entry;
+        std::set<uid_t> uids;
+        // The app charged for the candidate, which is the first one that reported it.
+        uid_t owner;
+    };
+
+    struct AppUsage {
+        uint64_t lookups = 0;
+        uint64_t localHits = 0;
+        uint64_t sharedHits = 0;
+        uint64_t droppedReports = 0;
+        bool trusted = false;
+        size_t candidateBytes = 0;
+        std::chrono::steady_clock::time_point windowStart;
+        size_t windowReports = 0;
+    };
+
+    // Candidates are identified by the hashes of their key and value.
+    using CandidateId = std::pair<uint64_t, uint64_t>;
+
+    void addCandidateLocked(uid_t uid, AppUsage& appUsage, const SharedBlobEntry& entry)
+            REQUIRES(mLock);
+    // Removes the candidate and returns its entry.
+    SharedBlobEntry takeCandidateLocked(std::map<CandidateId, Candidate>::iterator it)
+            REQUIRES(mLock);
+    void promoteLocked(SharedBlobEntry&& entry) REQUIRES(mLock);
+    void rebuildStoreLocked() REQUIRES(mLock);
+
+    const std::string mBuildId;
+    const TrustedSourceFn mIsTrustedSource;
+    const size_t mMaxStoreSize;
+    const size_t mPromotionQuorum;
+
+    std::mutex mLock;
+    std::map<CandidateId, Candidate> mCandidates GUARDED_BY(mLock);
+    // Candidate ids in the order they were first reported. Ids of promoted candidates are skipped
+    // when they reach the front.
+    std::deque<CandidateId> mCandidateOrder GUARDED_BY(mLock);
+    size_t mCandidateBytes GUARDED_BY(mLock) = 0;
+    std::vector<SharedBlobEntry> mPromoted GUARDED_BY(mLock);
+    std::unordered_set<uint64_t> mPromotedKeys GUARDED_BY(mLock);
+    size_t mPromotedBytes GUARDED_BY(mLock) = 0;
+    base::unique_fd mStoreFd GUARDED_BY(mLock);
+    bool mStoreDirty GUARDED_BY(mLock) = false;
+    std::unordered_map<uid_t, AppUsage> mAppUsage GUARDED_BY(mLock);
+};
+
+} // namespace android
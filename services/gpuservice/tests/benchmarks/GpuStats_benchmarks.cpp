@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how long binder threads spend in GpuStats ingestion while many apps report at once.
+// Every thread replays a random mix of the reports an app sends at launch, the way the fuzzer
+// drives IGpuService.
+
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gpustats/GpuStats.h>
+#include <utils/Vector.h>
+
+namespace android {
+
+namespace {
+
+constexpr int kNumApps = 64;
+constexpr uint64_t kDriverVersionCode = 1;
+
+GpuStats& getGpuStats() {
+    static GpuStats* sGpuStats = new GpuStats();
+    return *sGpuStats;
+}
+
+const std::vector<std::string>& getAppNames() {
+    static const std::vector<std::string> sAppNames = [] {
+        std::vector<std::string> appNames;
+        for (int i = 0; i < kNumApps; i++) {
+            appNames.push_back("com.example.app" + std::to_string(i));
+        }
+        return appNames;
+    }();
+    return sAppNames;
+}
+
+void insertRandomReport(GpuStats& gpuStats, std::mt19937& random) {
+    const std::string& appName = getAppNames()[random() % kNumApps];
+    switch (random() % 4) {
+        case 0:
+            gpuStats.insertDriverStats("builtin", "1.0", kDriverVersionCode, 0, appName, 0,
+                                       GpuStatsInfo::Driver::GL, true, random() % 100000);
+            break;
+        case 1:
+            gpuStats.insertTargetStats(appName, kDriverVersionCode,
+                                       GpuStatsInfo::Stats::CREATED_VULKAN_DEVICE, 0);
+            break;
+        case 2: {
+            const uint64_t extensions[] = {random(), random()};
+            gpuStats.insertTargetStatsArray(appName, kDriverVersionCode,
+                                            GpuStatsInfo::Stats::VULKAN_DEVICE_EXTENSION,
+                                            extensions, std::size(extensions));
+            break;
+        }
+        default:
+            gpuStats.addVulkanEngineName(appName, kDriverVersionCode, "engine");
+            break;
+    }
+}
+
+void gpuStats_insert(benchmark::State& state) {
+    GpuStats& gpuStats = getGpuStats();
+    std::mt19937 random(state.thread_index());
+    for (auto _ : state) {
+        insertRandomReport(gpuStats, random);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(gpuStats_insert)->ThreadRange(1, 16)->UseRealTime();
+
+// Ingestion while dumpsys reads the stats on another thread.
+void gpuStats_insertWhileDumping(benchmark::State& state) {
+    GpuStats& gpuStats = getGpuStats();
+    std::mt19937 random(state.thread_index());
+    std::string result;
+    for (auto _ : state) {
+        if (state.thread_index() == 0) {
+            result.clear();
+            gpuStats.dump(Vector<String16>(), &result);
+            benchmark::DoNotOptimize(result);
+        } else {
+            insertRandomReport(gpuStats, random);
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(gpuStats_insertWhileDumping)->ThreadRange(2, 16)->UseRealTime();
+
+} // namespace
+} // namespace android
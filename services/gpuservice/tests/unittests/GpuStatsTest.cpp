@@ -29,6 +29,8 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <thread>
+
 #include "TestableGpuStats.h"
 
 namespace android {
@@ -462,6 +464,42 @@ TEST_F(GpuStatsTest, canInsertMoreThanMaxNumAppRecords) {
     }
 }
 
+// Verify reports inserted from many binder threads at once are all merged.
+TEST_F(GpuStatsTest, canInsertStatsFromManyThreads) {
+    constexpr int kNumThreads = 8;
+    constexpr int kAppsPerThread = 4;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kNumThreads; ++t) {
+        threads.emplace_back([this, t] {
+            for (int i = 0; i < kAppsPerThread; ++i) {
+                const std::string appName =
+                        "testapp_" + std::to_string(t) + "_" + std::to_string(i);
+                mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
+                                             BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME,
+                                             appName, VULKAN_VERSION, GpuStatsInfo::Driver::GL,
+                                             true, DRIVER_LOADING_TIME_1);
+                mGpuStats->insertTargetStats(appName, BUILTIN_DRIVER_VER_CODE,
+                                             GpuStatsInfo::Stats::CPU_VULKAN_IN_USE, 0);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::stringstream expectedResult;
+    expectedResult << "glLoadingCount = " << kNumThreads * kAppsPerThread;
+    EXPECT_THAT(inputCommand(InputCommand::DUMP_GLOBAL), HasSubstr(expectedResult.str()));
+    const std::string appDump = inputCommand(InputCommand::DUMP_APP);
+    for (int t = 0; t < kNumThreads; ++t) {
+        for (int i = 0; i < kAppsPerThread; ++i) {
+            EXPECT_THAT(appDump,
+                        HasSubstr("testapp_" + std::to_string(t) + "_" + std::to_string(i) + "\n"));
+        }
+    }
+}
+
 TEST_F(GpuStatsTest, canDumpAllBeforeClearAll) {
     mGpuStats->insertDriverStats(BUILTIN_DRIVER_PKG_NAME, BUILTIN_DRIVER_VER_NAME,
                                  BUILTIN_DRIVER_VER_CODE, BUILTIN_DRIVER_BUILD_TIME, APP_PKG_NAME_1,
@@ -0,0 +1,414 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "gpuservice_unittest"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <sharedblobcache/SharedBlobCache.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace {
+
+using testing::HasSubstr;
+
+constexpr char BUILD_ID[] = "TEST.260101.001";
+constexpr size_t SHADER_SIZE = 4 * 1024;
+// Shaders of the UI toolkit, which every app compiles, and shaders specific to each app.
+constexpr int TOOLKIT_SHADER_COUNT = 32;
+constexpr int PRIVATE_SHADER_COUNT = 16;
+constexpr int APP_COUNT = 8;
+// App ids from this one on stand in for apps that aren't preinstalled.
+constexpr uid_t FIRST_UNTRUSTED_UID = 100;
+
+using Blob = std::vector<uint8_t>;
+
+Blob makeKey(const std::string& name) {
+    return Blob(name.begin(), name.end());
+}
+
+Blob makeValue(const std::string& name) {
+    Blob value(SHADER_SIZE);
+    for (size_t i = 0; i < value.size(); i++) {
+        value[i] = static_cast<uint8_t>(name[i % name.size()] + i);
+    }
+    return value;
+}
+
+// Stands in for a driver that only reaches the blob cache through the EGL_ANDROID_blob_cache
+// hooks, and compiles a shader on each miss.
+class FakeDriver {
+public:
+    using SetBlobFunc = std::function<void(const void*, long, const void*, long)>;
+    using GetBlobFunc = std::function<long(const void*, long, void*, long)>;
+
+    FakeDriver(SetBlobFunc setBlob, GetBlobFunc getBlob)
+          : mSetBlob(std::move(setBlob)), mGetBlob(std::move(getBlob)) {}
+
+    void compileShader(const std::string& name) {
+        const Blob key = makeKey(name);
+        Blob value(SHADER_SIZE);
+        const long size = mGetBlob(key.data(), key.size(), value.data(), value.size());
+        if (size == static_cast<long>(SHADER_SIZE)) {
+            EXPECT_EQ(makeValue(name), value);
+            return;
+        }
+
+        mCompileCount++;
+        value = makeValue(name);
+        mSetBlob(key.data(), key.size(), value.data(), value.size());
+    }
+
+    int getCompileCount() const { return mCompileCount; }
+
+private:
+    const SetBlobFunc mSetBlob;
+    const GetBlobFunc mGetBlob;
+    int mCompileCount = 0;
+};
+
+// An app process, with its own blob cache that persists across launches, wired to the shared
+// store the way egl_cache_t is.
+class FakeApp {
+public:
+    FakeApp(uid_t uid, SharedBlobCache* sharedBlobCache)
+          : mUid(uid), mSharedBlobCache(sharedBlobCache) {}
+
+    // Launches the app, compiles the shaders it uses and reports its usage whenever the client
+    // asks for it and when the app exits. Returns the number of shaders compiled.
+    int launch() {
+        SharedBlobStoreClient client(
+                SharedBlobStore::map(mSharedBlobCache->getStore(), BUILD_ID));
+
+        FakeDriver driver(
+                [this](const void* key, long keySize, const void* value, long valueSize) {
+                    const uint8_t* keyBytes = static_cast<const uint8_t*>(key);
+                    const uint8_t* valueBytes = static_cast<const uint8_t*>(value);
+                    mLocalCache[Blob(keyBytes, keyBytes + keySize)] =
+                            Blob(valueBytes, valueBytes + valueSize);
+                },
+                [this, &client](const void* key, long keySize, void* value, long valueSize) {
+                    const uint8_t* keyBytes = static_cast<const uint8_t*>(key);
+                    size_t localSize = 0;
+                    auto it = mLocalCache.find(Blob(keyBytes, keyBytes + keySize));
+                    if (it != mLocalCache.end()) {
+                        localSize = it->second.size();
+                        if (localSize <= static_cast<size_t>(valueSize)) {
+                            memcpy(value, it->second.data(), localSize);
+                        }
+                    }
+                    const size_t size = client.get(key, keySize, value, valueSize, localSize);
+                    if (client.shouldReport()) {
+                        mSharedBlobCache->reportUsage(mUid, client.takeUsage());
+                    }
+                    return static_cast<long>(size);
+                });
+
+        for (int i = 0; i < TOOLKIT_SHADER_COUNT; i++) {
+            driver.compileShader("toolkit" + std::to_string(i));
+        }
+        for (int i = 0; i < PRIVATE_SHADER_COUNT; i++) {
+            driver.compileShader("app" + std::to_string(mUid) + "_" + std::to_string(i));
+        }
+
+        mSharedBlobCache->reportUsage(mUid, client.takeUsage());
+        return driver.getCompileCount();
+    }
+
+    std::map<Blob, Blob>& getLocalCache() { return mLocalCache; }
+
+private:
+    const uid_t mUid;
+    SharedBlobCache* const mSharedBlobCache;
+    std::map<Blob, Blob> mLocalCache;
+};
+
+class SharedBlobCacheTest : public testing::Test {
+public:
+    SharedBlobCacheTest() {
+        const ::testing::TestInfo* const test_info =
+                ::testing::UnitTest::GetInstance()->current_test_info();
+        ALOGD("**** Setting up for %s.%s\n", test_info->test_case_name(), test_info->name());
+    }
+
+    ~SharedBlobCacheTest() {
+        const ::testing::TestInfo* const test_info =
+                ::testing::UnitTest::GetInstance()->current_test_info();
+        ALOGD("**** Tearing down after %s.%s\n", test_info->test_case_name(), test_info->name());
+    }
+
+    std::unique_ptr<SharedBlobStore> mapStore() {
+        return SharedBlobStore::map(mSharedBlobCache.getStore(), BUILD_ID);
+    }
+
+    SharedBlobUsage makeUsage(const std::string& name, const Blob& value) {
+        SharedBlobUsage usage;
+        usage.lookups = 1;
+        usage.localHits = 1;
+        usage.candidates.push_back({makeKey(name), value});
+        return usage;
+    }
+
+    SharedBlobCache mSharedBlobCache{BUILD_ID, [](uid_t uid) { return uid < FIRST_UNTRUSTED_UID; }};
+};
+
+TEST_F(SharedBlobCacheTest, noStoreBeforePromotion) {
+    EXPECT_FALSE(mSharedBlobCache.getStore().ok());
+
+    mSharedBlobCache.reportUsage(1, makeUsage("shader", makeValue("shader")));
+    EXPECT_FALSE(mSharedBlobCache.getStore().ok());
+}
+
+TEST_F(SharedBlobCacheTest, entryIsPromotedOnceQuorumReportsIt) {
+    for (uid_t uid = 1; uid <= SharedBlobCache::PROMOTION_QUORUM; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shader", makeValue("shader")));
+    }
+
+    std::unique_ptr<SharedBlobStore> store = mapStore();
+    ASSERT_NE(nullptr, store);
+    EXPECT_EQ(1u, store->getEntryCount());
+
+    const Blob key = makeKey("shader");
+    Blob value(SHADER_SIZE);
+    EXPECT_EQ(SHADER_SIZE, store->get(key.data(), key.size(), value.data(), value.size()));
+    EXPECT_EQ(makeValue("shader"), value);
+}
+
+TEST_F(SharedBlobCacheTest, reportsOfOneAppCountOnce) {
+    for (size_t i = 0; i < 2 * SharedBlobCache::PROMOTION_QUORUM; i++) {
+        mSharedBlobCache.reportUsage(1, makeUsage("shader", makeValue("shader")));
+    }
+    EXPECT_FALSE(mSharedBlobCache.getStore().ok());
+}
+
+TEST_F(SharedBlobCacheTest, valueOfOneAppIsNotShared) {
+    // One app reports a value of its own for a key the other apps agree on.
+    mSharedBlobCache.reportUsage(1, makeUsage("shader", makeValue("poisoned")));
+    for (uid_t uid = 2; uid <= SharedBlobCache::PROMOTION_QUORUM + 1; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shader", makeValue("shader")));
+    }
+    mSharedBlobCache.reportUsage(1, makeUsage("shader", makeValue("poisoned")));
+
+    std::unique_ptr<SharedBlobStore> store = mapStore();
+    ASSERT_NE(nullptr, store);
+    const Blob key = makeKey("shader");
+    Blob value(SHADER_SIZE);
+    EXPECT_EQ(SHADER_SIZE, store->get(key.data(), key.size(), value.data(), value.size()));
+    EXPECT_EQ(makeValue("shader"), value);
+}
+
+TEST_F(SharedBlobCacheTest, untrustedAppsDontPromote) {
+    const uid_t lastUid = FIRST_UNTRUSTED_UID + 2 * SharedBlobCache::PROMOTION_QUORUM;
+    for (uid_t uid = FIRST_UNTRUSTED_UID; uid < lastUid; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shader", makeValue("shader")));
+    }
+    EXPECT_FALSE(mSharedBlobCache.getStore().ok());
+
+    // Nor do they count towards the quorum of trusted apps.
+    for (uid_t uid = 1; uid < SharedBlobCache::PROMOTION_QUORUM; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shader", makeValue("shader")));
+    }
+    EXPECT_FALSE(mSharedBlobCache.getStore().ok());
+
+    std::string result;
+    mSharedBlobCache.dump(&result);
+    EXPECT_THAT(result, HasSubstr("candidates = 1\n"));
+    EXPECT_THAT(result,
+                HasSubstr("trustedApps = " +
+                          std::to_string(SharedBlobCache::PROMOTION_QUORUM - 1) + "\n"));
+}
+
+TEST_F(SharedBlobCacheTest, candidatesOfOneAppAreBounded) {
+    SharedBlobUsage usage;
+    size_t acceptedCount = 0;
+    size_t acceptedBytes = 0;
+    for (size_t i = 0; i < 2 * SharedBlobCache::MAX_CANDIDATE_BYTES_PER_APP / SHADER_SIZE; i++) {
+        const std::string name = "shader" + std::to_string(i);
+        usage.candidates.push_back({makeKey(name), makeValue(name)});
+        if (acceptedBytes + name.size() + SHADER_SIZE <=
+            SharedBlobCache::MAX_CANDIDATE_BYTES_PER_APP) {
+            acceptedBytes += name.size() + SHADER_SIZE;
+            acceptedCount++;
+        }
+    }
+    mSharedBlobCache.reportUsage(1, usage);
+
+    std::string result;
+    mSharedBlobCache.dump(&result);
+    EXPECT_THAT(result, HasSubstr("candidates = " + std::to_string(acceptedCount) + "\n"));
+    EXPECT_THAT(result, HasSubstr("candidateBytes = " + std::to_string(acceptedBytes) + "\n"));
+
+    // The candidates of other apps are still accepted.
+    mSharedBlobCache.reportUsage(2, makeUsage("other", makeValue("other")));
+    result.clear();
+    mSharedBlobCache.dump(&result);
+    EXPECT_THAT(result, HasSubstr("candidates = " + std::to_string(acceptedCount + 1) + "\n"));
+}
+
+TEST_F(SharedBlobCacheTest, reportsOfOneAppAreRateLimited) {
+    for (size_t i = 0; i < SharedBlobCache::MAX_REPORTS_PER_WINDOW + 8; i++) {
+        mSharedBlobCache.reportUsage(FIRST_UNTRUSTED_UID, makeUsage("shader", makeValue("shader")));
+    }
+    mSharedBlobCache.reportUsage(FIRST_UNTRUSTED_UID + 1, makeUsage("shader", makeValue("shader")));
+
+    std::string result;
+    mSharedBlobCache.dump(&result);
+    EXPECT_THAT(result, HasSubstr("droppedReports = 8\n"));
+    EXPECT_THAT(result,
+                HasSubstr("lookups = " +
+                          std::to_string(SharedBlobCache::MAX_REPORTS_PER_WINDOW + 1) + "\n"));
+}
+
+TEST_F(SharedBlobCacheTest, sizeQueryIsNotCountedAsLookup) {
+    for (uid_t uid = 1; uid <= SharedBlobCache::PROMOTION_QUORUM; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shared", makeValue("shared")));
+    }
+    SharedBlobStoreClient client(mapStore());
+
+    // The driver first queries the size of each value, and then fetches it.
+    const Blob localKey = makeKey("local");
+    const Blob localValue = makeValue("local");
+    Blob value(SHADER_SIZE);
+    EXPECT_EQ(SHADER_SIZE, client.get(localKey.data(), localKey.size(), nullptr, 0, SHADER_SIZE));
+    memcpy(value.data(), localValue.data(), SHADER_SIZE);
+    EXPECT_EQ(SHADER_SIZE,
+              client.get(localKey.data(), localKey.size(), value.data(), SHADER_SIZE,
+                         SHADER_SIZE));
+
+    const Blob sharedKey = makeKey("shared");
+    EXPECT_EQ(SHADER_SIZE, client.get(sharedKey.data(), sharedKey.size(), nullptr, 0, 0));
+    EXPECT_EQ(SHADER_SIZE,
+              client.get(sharedKey.data(), sharedKey.size(), value.data(), SHADER_SIZE, 0));
+    EXPECT_EQ(makeValue("shared"), value);
+
+    const SharedBlobUsage usage = client.takeUsage();
+    EXPECT_EQ(2u, usage.lookups);
+    EXPECT_EQ(1u, usage.localHits);
+    EXPECT_EQ(1u, usage.sharedHits);
+    EXPECT_EQ(1u, usage.candidates.size());
+}
+
+TEST_F(SharedBlobCacheTest, storeIsSealed) {
+    for (uid_t uid = 1; uid <= SharedBlobCache::PROMOTION_QUORUM; uid++) {
+        mSharedBlobCache.reportUsage(uid, makeUsage("shader", makeValue("shader")));
+    }
+
+    base::unique_fd fd = mSharedBlobCache.getStore();
+    ASSERT_TRUE(fd.ok());
+    const uint8_t byte = 0;
+    EXPECT_EQ(-1, pwrite(fd.get(), &byte, sizeof(byte), 0));
+    EXPECT_EQ(-1, ftruncate(fd.get(), 0));
+    EXPECT_EQ(MAP_FAILED, mmap(nullptr, 1, PROT_WRITE, MAP_SHARED, fd.get(), 0));
+}
+
+TEST_F(SharedBlobCacheTest, storeOfOtherBuildIsRejected) {
+    base::unique_fd fd(memfd_create("store", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_TRUE(SharedBlobStore::write(fd.get(), "OTHER.260101.001",
+                                       {{makeKey("shader"), makeValue("shader")}}));
+    EXPECT_EQ(nullptr, SharedBlobStore::map(std::move(fd), BUILD_ID));
+}
+
+TEST_F(SharedBlobCacheTest, truncatedStoreIsRejected) {
+    base::unique_fd fd(memfd_create("store", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_TRUE(SharedBlobStore::write(fd.get(), BUILD_ID,
+                                       {{makeKey("shader"), makeValue("shader")}}));
+    ASSERT_EQ(0, ftruncate(fd.get(), lseek(fd.get(), 0, SEEK_END) - 1));
+    EXPECT_EQ(nullptr, SharedBlobStore::map(std::move(fd), BUILD_ID));
+}
+
+TEST_F(SharedBlobCacheTest, identicalValuesAreStoredOnce) {
+    base::unique_fd fd(memfd_create("store", MFD_CLOEXEC));
+    ASSERT_TRUE(fd.ok());
+    ASSERT_TRUE(SharedBlobStore::write(fd.get(), BUILD_ID,
+                                       {{makeKey("shader1"), makeValue("shader")},
+                                        {makeKey("shader2"), makeValue("shader")}}));
+
+    std::unique_ptr<SharedBlobStore> store = SharedBlobStore::map(std::move(fd), BUILD_ID);
+    ASSERT_NE(nullptr, store);
+    EXPECT_EQ(2u, store->getEntryCount());
+    EXPECT_LT(store->getSize(), 2 * SHADER_SIZE);
+}
+
+// Launch apps that share the toolkit shaders, and measure how many shaders their cold launches
+// compile compared to launches without the shared store.
+TEST_F(SharedBlobCacheTest, coldLaunchesReuseShadersOfOtherApps) {
+    std::vector<std::unique_ptr<FakeApp>> apps;
+    int coldLaunchCompiles = 0;
+    for (uid_t uid = 1; uid <= APP_COUNT; uid++) {
+        apps.push_back(std::make_unique<FakeApp>(uid, &mSharedBlobCache));
+        const int compiles = apps.back()->launch();
+        coldLaunchCompiles += compiles;
+
+        // Until a quorum of apps reported the toolkit shaders, cold launches compile them too.
+        if (uid > SharedBlobCache::PROMOTION_QUORUM) {
+            EXPECT_EQ(PRIVATE_SHADER_COUNT, compiles);
+        } else {
+            EXPECT_EQ(TOOLKIT_SHADER_COUNT + PRIVATE_SHADER_COUNT, compiles);
+        }
+
+        // The second launch reads the shaders back from the app's own cache, which is when they
+        // are reported.
+        EXPECT_EQ(0, apps.back()->launch());
+    }
+
+    // Apps don't copy shared entries into their own cache.
+    EXPECT_EQ(static_cast<size_t>(TOOLKIT_SHADER_COUNT + PRIVATE_SHADER_COUNT),
+              apps.front()->getLocalCache().size());
+    EXPECT_EQ(static_cast<size_t>(PRIVATE_SHADER_COUNT), apps.back()->getLocalCache().size());
+
+    std::unique_ptr<SharedBlobStore> store = mapStore();
+    ASSERT_NE(nullptr, store);
+    // Private shaders are never reported by enough apps to be shared.
+    EXPECT_EQ(static_cast<size_t>(TOOLKIT_SHADER_COUNT), store->getEntryCount());
+
+    const int baselineCompiles = APP_COUNT * (TOOLKIT_SHADER_COUNT + PRIVATE_SHADER_COUNT);
+    const int savedCompiles = baselineCompiles - coldLaunchCompiles;
+    // Every lookup of a cold launch misses the app's own cache.
+    const int coldLaunchLookups = baselineCompiles;
+    const int sharedHits = savedCompiles;
+    const double crossAppHitRate = static_cast<double>(sharedHits) / coldLaunchLookups;
+    RecordProperty("cold_launch_compiles", coldLaunchCompiles);
+    RecordProperty("cold_launch_compiles_without_sharing", baselineCompiles);
+    RecordProperty("cross_app_hit_rate_percent", static_cast<int>(crossAppHitRate * 100));
+
+    EXPECT_EQ((APP_COUNT - static_cast<int>(SharedBlobCache::PROMOTION_QUORUM)) *
+                      TOOLKIT_SHADER_COUNT,
+              savedCompiles);
+
+    std::string result;
+    mSharedBlobCache.dump(&result);
+    EXPECT_THAT(result, HasSubstr("promotedEntries = " + std::to_string(TOOLKIT_SHADER_COUNT)));
+    // Later launches keep reading the toolkit shaders from the shared store.
+    EXPECT_THAT(result, HasSubstr("sharedHits = " + std::to_string(2 * sharedHits)));
+    EXPECT_THAT(result, HasSubstr("appsWithSharedHits = " +
+                                  std::to_string(APP_COUNT - SharedBlobCache::PROMOTION_QUORUM)));
+}
+
+} // namespace
+} // namespace android
@@ -19,7 +19,10 @@
 #define LOG_TAG "ClientCache"
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <algorithm>
 #include <cinttypes>
+#include <mutex>
+#include <utility>
 
 #include <android-base/stringprintf.h>
 #include <common/trace.h>
@@ -33,32 +36,66 @@ ANDROID_SINGLETON_STATIC_INSTANCE(ClientCache);
 
 ClientCache::ClientCache() : mDeathRecipient(sp<CacheDeathRecipient>::make()) {}
 
-bool ClientCache::getBuffer(const client_cache_t& cacheId,
-                            ClientCacheBuffer** outClientCacheBuffer) {
-    auto& [processToken, id] = cacheId;
-    if (processToken == nullptr) {
-        ALOGE_AND_TRACE("ClientCache::getBuffer - invalid (nullptr) process token");
-        return false;
+ClientCache::ProcessStripe& ClientCache::getProcessStripe(const wp<IBinder>& processToken) {
+    // Binder objects are at least 16 byte aligned, so skip the low bits of the address.
+    const auto address = reinterpret_cast<uintptr_t>(processToken.unsafe_get());
+    return mProcessStripes[(address >> 4) % kProcessStripeCount];
+}
+
+bool ClientCache::addProcess(const wp<IBinder>& processToken) {
+    ProcessStripe& processStripe = getProcessStripe(processToken);
+    processStripe.mutex.lock_shared();
+    const bool found = processStripe.processes.count(processToken.unsafe_get()) != 0;
+    processStripe.mutex.unlock_shared();
+    if (found) {
+        return true;
     }
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        ALOGE_AND_TRACE("ClientCache::getBuffer - invalid process token");
+
+    sp<IBinder> token = processToken.promote();
+    if (!token) {
+        ALOGE_AND_TRACE("ClientCache::add - invalid token");
         return false;
     }
 
-    auto& processBuffers = it->second.second;
-
-    auto bufItr = processBuffers.find(id);
-    if (bufItr == processBuffers.end()) {
-        ALOGE_AND_TRACE("ClientCache::getBuffer - invalid buffer id");
-        return false;
+    std::lock_guard lock(processStripe.mutex);
+    // Another thread of the same process may have added the process in the meantime.
+    if (processStripe.processes.count(token.get()) != 0) {
+        return true;
     }
 
-    ClientCacheBuffer& buf = bufItr->second;
-    *outClientCacheBuffer = &buf;
+    // Set a death recipient for the new process token. If the client process dies, we will get a
+    // callback through binderDied. Only call linkToDeath if not a local binder.
+    if (token->localBinder() == nullptr) {
+        status_t err = token->linkToDeath(mDeathRecipient);
+        if (err != NO_ERROR) {
+            ALOGE_AND_TRACE("ClientCache::add - could not link to death");
+            return false;
+        }
+    }
+    const IBinder* key = token.get();
+    processStripe.processes.emplace(key, std::make_unique<ProcessCache>(std::move(token)));
     return true;
 }
 
+void ClientCache::addPendingErase(PendingErase& pendingErase, const client_cache_t& cacheId,
+                                  const std::set<wp<ErasedRecipient>>& recipients) {
+    for (auto& recipient : recipients) {
+        sp<ErasedRecipient> erasedRecipient = recipient.promote();
+        if (!erasedRecipient) {
+            continue;
+        }
+        auto it = std::find_if(pendingErase.begin(), pendingErase.end(),
+                               [&](const auto& pending) {
+                                   return pending.first == erasedRecipient;
+                               });
+        if (it == pendingErase.end()) {
+            it = pendingErase.emplace(pendingErase.end(), std::move(erasedRecipient),
+                                      std::vector<client_cache_t>());
+        }
+        it->second.push_back(cacheId);
+    }
+}
+
 base::expected<std::shared_ptr<renderengine::ExternalTexture>, ClientCache::AddError>
 ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer) {
     auto& [processToken, id] = cacheId;
@@ -72,148 +109,244 @@ ClientCache::add(const client_cache_t& cacheId, const sp<GraphicBuffer>& buffer)
         return base::unexpected(AddError::Unspecified);
     }
 
-    std::lock_guard lock(mMutex);
-    sp<IBinder> token;
-
-    // If this is a new process token, set a death recipient. If the client process dies, we will
-    // get a callback through binderDied.
-    auto it = mBuffers.find(processToken);
-    if (it == mBuffers.end()) {
-        token = processToken.promote();
-        if (!token) {
-            ALOGE_AND_TRACE("ClientCache::add - invalid token");
-            return base::unexpected(AddError::Unspecified);
-        }
-
-        // Only call linkToDeath if not a local binder
-        if (token->localBinder() == nullptr) {
-            status_t err = token->linkToDeath(mDeathRecipient);
-            if (err != NO_ERROR) {
-                ALOGE_AND_TRACE("ClientCache::add - could not link to death");
-                return base::unexpected(AddError::Unspecified);
-            }
-        }
-        auto [itr, success] =
-                mBuffers.emplace(processToken,
-                                 std::make_pair(token,
-                                                std::unordered_map<uint64_t, ClientCacheBuffer>()));
-        LOG_ALWAYS_FATAL_IF(!success, "failed to insert new process into client cache");
-        it = itr;
+    if (!addProcess(processToken)) {
+        return base::unexpected(AddError::Unspecified);
     }
 
-    auto& processBuffers = it->second.second;
+    LOG_ALWAYS_FATAL_IF(mRenderEngine == nullptr,
+                        "Attempted to build the ClientCache before a RenderEngine instance was "
+                        "ready!");
 
-    if (processBuffers.size() > BUFFER_CACHE_MAX_SIZE) {
+    // Reject a full cache before mapping the buffer into RenderEngine. Adds racing on other
+    // threads may overshoot the limit by a buffer each, which is fine for a limit against leaks.
+    ProcessStripe& processStripe = getProcessStripe(processToken);
+    processStripe.mutex.lock_shared();
+    auto it = processStripe.processes.find(processToken.unsafe_get());
+    const bool full = it != processStripe.processes.end() &&
+            it->second->bufferCount.load(std::memory_order_relaxed) > BUFFER_CACHE_MAX_SIZE;
+    processStripe.mutex.unlock_shared();
+    if (full) {
         ALOGE_AND_TRACE("ClientCache::add - cache is full");
         return base::unexpected(AddError::CacheFull);
     }
 
-    LOG_ALWAYS_FATAL_IF(mRenderEngine == nullptr,
-                        "Attempted to build the ClientCache before a RenderEngine instance was "
-                        "ready!");
+    // Map the buffer without the locks held, so that lookups from other threads do not wait on
+    // RenderEngine.
+    auto texture = std::make_shared<
+            renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
+                                                 renderengine::impl::ExternalTexture::Usage::
+                                                         READABLE);
+    std::shared_ptr<renderengine::ExternalTexture> replacedTexture;
+
+    processStripe.mutex.lock_shared();
+    it = processStripe.processes.find(processToken.unsafe_get());
+    if (it == processStripe.processes.end()) {
+        // The process died since it was added.
+        processStripe.mutex.unlock_shared();
+        ALOGE_AND_TRACE("ClientCache::add - invalid process token");
+        return base::unexpected(AddError::Unspecified);
+    }
+
+    ProcessCache& processCache = *it->second;
+    ProcessCache::Stripe& stripe = processCache.getStripe(id);
+    {
+        std::lock_guard lock(stripe.mutex);
+        auto [bufferIt, inserted] = stripe.buffers.try_emplace(id);
+        if (inserted) {
+            processCache.bufferCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        replacedTexture = std::exchange(bufferIt->second.buffer, texture);
+    }
+    processStripe.mutex.unlock_shared();
 
-    return (processBuffers[id].buffer = std::make_shared<
-                    renderengine::impl::ExternalTexture>(buffer, *mRenderEngine,
-                                                         renderengine::impl::ExternalTexture::
-                                                                 Usage::READABLE));
+    return texture;
 }
 
 sp<GraphicBuffer> ClientCache::erase(const client_cache_t& cacheId) {
-    sp<GraphicBuffer> buffer;
-    auto& [processToken, id] = cacheId;
-    std::vector<sp<ErasedRecipient>> pendingErase;
-    {
-        std::lock_guard lock(mMutex);
-        ClientCacheBuffer* buf = nullptr;
-        if (!getBuffer(cacheId, &buf)) {
-            ALOGE("failed to erase buffer, could not retrieve buffer");
-            return nullptr;
+    auto buffers = erase(std::vector<client_cache_t>{cacheId});
+    return buffers.empty() ? nullptr : buffers.front();
+}
+
+std::vector<sp<GraphicBuffer>> ClientCache::erase(const std::vector<client_cache_t>& cacheIds) {
+    std::vector<sp<GraphicBuffer>> erasedBuffers;
+    erasedBuffers.reserve(cacheIds.size());
+    // The textures are destroyed after the locks are released, since that unmaps the buffers from
+    // RenderEngine.
+    std::vector<std::shared_ptr<renderengine::ExternalTexture>> erasedTextures;
+    erasedTextures.reserve(cacheIds.size());
+    PendingErase pendingErase;
+
+    for (const auto& cacheId : cacheIds) {
+        auto& [processToken, id] = cacheId;
+        if (processToken == nullptr) {
+            ALOGE("failed to erase buffer, invalid (nullptr) process token");
+            continue;
         }
 
-        buffer = buf->buffer->getBuffer();
+        ProcessStripe& processStripe = getProcessStripe(processToken);
+        processStripe.mutex.lock_shared();
+        auto it = processStripe.processes.find(processToken.unsafe_get());
+        if (it == processStripe.processes.end()) {
+            processStripe.mutex.unlock_shared();
+            ALOGE("failed to erase buffer, could not find process");
+            continue;
+        }
 
-        for (auto& recipient : buf->recipients) {
-            sp<ErasedRecipient> erasedRecipient = recipient.promote();
-            if (erasedRecipient) {
-                pendingErase.push_back(erasedRecipient);
+        ProcessCache& processCache = *it->second;
+        ProcessCache::Stripe& stripe = processCache.getStripe(id);
+        decltype(stripe.buffers)::node_type node;
+        {
+            std::lock_guard lock(stripe.mutex);
+            node = stripe.buffers.extract(id);
+            if (node) {
+                processCache.bufferCount.fetch_sub(1, std::memory_order_relaxed);
             }
         }
+        processStripe.mutex.unlock_shared();
+
+        if (!node) {
+            ALOGE("failed to erase buffer, could not retrieve buffer");
+            continue;
+        }
 
-        mBuffers[processToken].second.erase(id);
+        ClientCacheBuffer& erased = node.mapped();
+        erasedBuffers.push_back(erased.buffer->getBuffer());
+        addPendingErase(pendingErase, cacheId, erased.recipients);
+        erasedTextures.push_back(std::move(erased.buffer));
     }
 
-    for (auto& recipient : pendingErase) {
-        recipient->bufferErased(cacheId);
+    for (auto& [recipient, erasedIds] : pendingErase) {
+        if (erasedIds.size() == 1) {
+            recipient->bufferErased(erasedIds.front());
+        } else {
+            recipient->buffersErased(erasedIds);
+        }
     }
-    return buffer;
+    return erasedBuffers;
 }
 
 std::shared_ptr<renderengine::ExternalTexture> ClientCache::get(const client_cache_t& cacheId) {
-    std::lock_guard lock(mMutex);
+    auto& [processToken, id] = cacheId;
+    if (processToken == nullptr) {
+        ALOGE_AND_TRACE("ClientCache::get - invalid (nullptr) process token");
+        return nullptr;
+    }
 
-    ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
-        ALOGE("failed to get buffer, could not retrieve buffer");
+    ProcessStripe& processStripe = getProcessStripe(processToken);
+    processStripe.mutex.lock_shared();
+    auto it = processStripe.processes.find(processToken.unsafe_get());
+    if (it == processStripe.processes.end()) {
+        processStripe.mutex.unlock_shared();
+        ALOGE_AND_TRACE("ClientCache::get - invalid process token");
         return nullptr;
     }
 
-    return buf->buffer;
+    ProcessCache::Stripe& stripe = it->second->getStripe(id);
+    stripe.mutex.lock_shared();
+    auto bufferIt = stripe.buffers.find(id);
+    std::shared_ptr<renderengine::ExternalTexture> buffer =
+            bufferIt != stripe.buffers.end() ? bufferIt->second.buffer : nullptr;
+    stripe.mutex.unlock_shared();
+    processStripe.mutex.unlock_shared();
+
+    if (!buffer) {
+        ALOGE_AND_TRACE("ClientCache::get - invalid buffer id");
+    }
+    return buffer;
 }
 
 bool ClientCache::registerErasedRecipient(const client_cache_t& cacheId,
                                           const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
+    auto& [processToken, id] = cacheId;
+    if (processToken == nullptr) {
+        ALOGV("failed to register erased recipient, invalid (nullptr) process token");
+        return false;
+    }
+
+    bool registered = false;
+    ProcessStripe& processStripe = getProcessStripe(processToken);
+    processStripe.mutex.lock_shared();
+    auto it = processStripe.processes.find(processToken.unsafe_get());
+    if (it != processStripe.processes.end()) {
+        ProcessCache::Stripe& stripe = it->second->getStripe(id);
+        std::lock_guard lock(stripe.mutex);
+        auto bufferIt = stripe.buffers.find(id);
+        if (bufferIt != stripe.buffers.end()) {
+            bufferIt->second.recipients.insert(recipient);
+            registered = true;
+        }
+    }
+    processStripe.mutex.unlock_shared();
 
-    ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
+    if (!registered) {
         ALOGV("failed to register erased recipient, could not retrieve buffer");
-        return false;
     }
-    buf->recipients.insert(recipient);
-    return true;
+    return registered;
 }
 
 void ClientCache::unregisterErasedRecipient(const client_cache_t& cacheId,
                                             const wp<ErasedRecipient>& recipient) {
-    std::lock_guard lock(mMutex);
-
-    ClientCacheBuffer* buf = nullptr;
-    if (!getBuffer(cacheId, &buf)) {
-        ALOGE("failed to unregister erased recipient");
+    auto& [processToken, id] = cacheId;
+    if (processToken == nullptr) {
+        ALOGE("failed to unregister erased recipient, invalid (nullptr) process token");
         return;
     }
 
-    buf->recipients.erase(recipient);
+    bool unregistered = false;
+    ProcessStripe& processStripe = getProcessStripe(processToken);
+    processStripe.mutex.lock_shared();
+    auto it = processStripe.processes.find(processToken.unsafe_get());
+    if (it != processStripe.processes.end()) {
+        ProcessCache::Stripe& stripe = it->second->getStripe(id);
+        std::lock_guard lock(stripe.mutex);
+        auto bufferIt = stripe.buffers.find(id);
+        if (bufferIt != stripe.buffers.end()) {
+            bufferIt->second.recipients.erase(recipient);
+            unregistered = true;
+        }
+    }
+    processStripe.mutex.unlock_shared();
+
+    if (!unregistered) {
+        ALOGE("failed to unregister erased recipient");
+    }
 }
 
 void ClientCache::removeProcess(const wp<IBinder>& processToken) {
-    std::vector<std::pair<sp<ErasedRecipient>, client_cache_t>> pendingErase;
+    if (processToken == nullptr) {
+        ALOGE("failed to remove process, invalid (nullptr) process token");
+        return;
+    }
+
+    std::unique_ptr<ProcessCache> processCache;
+    ProcessStripe& processStripe = getProcessStripe(processToken);
     {
-        if (processToken == nullptr) {
-            ALOGE("failed to remove process, invalid (nullptr) process token");
-            return;
-        }
-        std::lock_guard lock(mMutex);
-        auto itr = mBuffers.find(processToken);
-        if (itr == mBuffers.end()) {
-            ALOGE("failed to remove process, could not find process");
-            return;
+        std::lock_guard lock(processStripe.mutex);
+        auto it = processStripe.processes.find(processToken.unsafe_get());
+        if (it != processStripe.processes.end()) {
+            processCache = std::move(it->second);
+            processStripe.processes.erase(it);
         }
+    }
 
-        for (auto& [id, clientCacheBuffer] : itr->second.second) {
-            client_cache_t cacheId = {processToken, id};
-            for (auto& recipient : clientCacheBuffer.recipients) {
-                sp<ErasedRecipient> erasedRecipient = recipient.promote();
-                if (erasedRecipient) {
-                    pendingErase.emplace_back(erasedRecipient, cacheId);
-                }
-            }
+    if (!processCache) {
+        ALOGE("failed to remove process, could not find process");
+        return;
+    }
+
+    // No other thread can reach the process cache anymore, but the stripes are still locked to
+    // keep the thread safety analysis happy.
+    PendingErase pendingErase;
+    for (auto& stripe : processCache->stripes) {
+        stripe.mutex.lock_shared();
+        for (auto& [id, clientCacheBuffer] : stripe.buffers) {
+            addPendingErase(pendingErase, {processToken, id}, clientCacheBuffer.recipients);
         }
-        mBuffers.erase(itr);
+        stripe.mutex.unlock_shared();
     }
 
-    for (auto& [recipient, cacheId] : pendingErase) {
-        recipient->bufferErased(cacheId);
+    for (auto& [recipient, erasedIds] : pendingErase) {
+        recipient->buffersErased(erasedIds);
     }
 }
 
@@ -222,15 +355,22 @@ void ClientCache::CacheDeathRecipient::binderDied(const wp<IBinder>& who) {
 }
 
 void ClientCache::dump(std::string& result) {
-    std::lock_guard lock(mMutex);
-    for (const auto& [_, cache] : mBuffers) {
-        base::StringAppendF(&result, " Cache owner: %p\n", cache.first.get());
-
-        for (const auto& [id, entry] : cache.second) {
-            const auto& buffer = entry.buffer->getBuffer();
-            base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id, buffer->getWidth(),
-                                buffer->getHeight());
+    for (auto& processStripe : mProcessStripes) {
+        processStripe.mutex.lock_shared();
+        for (const auto& [_, processCache] : processStripe.processes) {
+            base::StringAppendF(&result, " Cache owner: %p\n", processCache->token.get());
+
+            for (auto& stripe : processCache->stripes) {
+                stripe.mutex.lock_shared();
+                for (const auto& [id, entry] : stripe.buffers) {
+                    const auto& buffer = entry.buffer->getBuffer();
+                    base::StringAppendF(&result, "\tID: %" PRIu64 ", size: %ux%u\n", id,
+                                        buffer->getWidth(), buffer->getHeight());
+                }
+                stripe.mutex.unlock_shared();
+            }
         }
+        processStripe.mutex.unlock_shared();
     }
 }
 
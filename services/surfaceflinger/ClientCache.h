@@ -18,16 +18,19 @@
 
 #include <android-base/thread_annotations.h>
 #include <binder/IBinder.h>
+#include <ftl/shared_mutex.h>
 #include <gui/LayerState.h>
 #include <renderengine/RenderEngine.h>
 #include <ui/GraphicBuffer.h>
 #include <utils/RefBase.h>
 #include <utils/Singleton.h>
 
-#include <map>
-#include <mutex>
+#include <array>
+#include <atomic>
+#include <memory>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 // 4096 is based on 64 buffers * 64 layers. Once this limit is reached, the least recently used
 // buffer is uncached before the new buffer is cached.
@@ -46,6 +49,11 @@ namespace android {
 // both the SurfaceFlinger side of this other cache, as well as Composer HAL's
 // side of the cache.
 //
+// Lookups happen on binder threads for every transaction that sets a buffer, so the cache is
+// striped instead of sitting behind a single lock. Processes are spread over stripes by the address
+// of their token, and the buffers of each process over stripes by cache id. Every stripe is guarded
+// by a shared mutex, so concurrent lookups only take shared locks.
+//
 class ClientCache : public Singleton<ClientCache> {
 public:
     ClientCache();
@@ -57,6 +65,10 @@ public:
 
     sp<GraphicBuffer> erase(const client_cache_t& cacheId);
 
+    // Erases a batch of buffers and returns the ones that were cached. Each ErasedRecipient is
+    // notified once for all of its buffers in the batch.
+    std::vector<sp<GraphicBuffer>> erase(const std::vector<client_cache_t>& cacheIds);
+
     std::shared_ptr<renderengine::ExternalTexture> get(const client_cache_t& cacheId);
 
     // Always called immediately after setup. Will be set to non-null, and then should never be
@@ -68,6 +80,13 @@ public:
     class ErasedRecipient : public virtual RefBase {
     public:
         virtual void bufferErased(const client_cache_t& clientCacheId) = 0;
+
+        // Called instead of bufferErased when several buffers are erased at once.
+        virtual void buffersErased(const std::vector<client_cache_t>& clientCacheIds) {
+            for (const auto& clientCacheId : clientCacheIds) {
+                bufferErased(clientCacheId);
+            }
+        }
     };
 
     bool registerErasedRecipient(const client_cache_t& cacheId,
@@ -78,16 +97,48 @@ public:
     void dump(std::string& result);
 
 private:
-    std::mutex mMutex;
-
     struct ClientCacheBuffer {
         std::shared_ptr<renderengine::ExternalTexture> buffer;
         std::set<wp<ErasedRecipient>> recipients;
     };
-    std::map<wp<IBinder> /*caching process*/,
-             std::pair<sp<IBinder> /*strong ref to caching process*/,
-                       std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer>>>
-            mBuffers GUARDED_BY(mMutex);
+
+    // The buffers cached by one process.
+    struct ProcessCache {
+        static constexpr size_t kStripeCount = 8;
+
+        struct Stripe {
+            ftl::SharedMutex mutex;
+            std::unordered_map<uint64_t /*cache id*/, ClientCacheBuffer> buffers GUARDED_BY(mutex);
+        };
+
+        explicit ProcessCache(sp<IBinder> token) : token(std::move(token)) {}
+
+        Stripe& getStripe(uint64_t id) { return stripes[id % kStripeCount]; }
+
+        // Strong ref to the caching process, which also keeps the address used as the key of this
+        // cache from being reused while the cache exists.
+        const sp<IBinder> token;
+        std::array<Stripe, kStripeCount> stripes;
+        std::atomic<size_t> bufferCount = 0;
+    };
+
+    static constexpr size_t kProcessStripeCount = 16;
+
+    struct ProcessStripe {
+        ftl::SharedMutex mutex;
+        std::unordered_map<const IBinder* /*caching process*/, std::unique_ptr<ProcessCache>>
+                processes GUARDED_BY(mutex);
+    };
+
+    ProcessStripe& getProcessStripe(const wp<IBinder>& processToken);
+    // Adds a cache for the process if it does not have one yet.
+    bool addProcess(const wp<IBinder>& processToken);
+
+    using PendingErase = std::vector<std::pair<sp<ErasedRecipient>, std::vector<client_cache_t>>>;
+    static void addPendingErase(PendingErase& pendingErase, const client_cache_t& cacheId,
+                                const std::set<wp<ErasedRecipient>>& recipients);
+
+    std::array<ProcessStripe, kProcessStripeCount> mProcessStripes;
 
     class CacheDeathRecipient : public IBinder::DeathRecipient {
     public:
@@ -96,9 +147,6 @@ private:
 
     sp<CacheDeathRecipient> mDeathRecipient;
     renderengine::RenderEngine* mRenderEngine = nullptr;
-
-    bool getBuffer(const client_cache_t& cacheId, ClientCacheBuffer** outClientCacheBuffer)
-            REQUIRES(mMutex);
 };
 
 }; // namespace android
@@ -891,30 +891,101 @@ void SurfaceFrame::trace(int64_t displayFrameToken, nsecs_t monoBootOffset,
 
 namespace impl {
 
-int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
-    SFTRACE_CALL();
+BlockPool::BlockPool(size_t blockSize, size_t maxFreeBlocks)
+      : mBlockSize(blockSize), mMaxFreeBlocks(maxFreeBlocks) {
+    std::scoped_lock lock(mMutex);
+    mFreeBlocks.reserve(maxFreeBlocks);
+}
+
+BlockPool::~BlockPool() {
     std::scoped_lock lock(mMutex);
-    while (mPredictions.size() >= kMaxTokens) {
-        mPredictions.erase(mPredictions.begin());
+    for (void* block : mFreeBlocks) {
+        ::operator delete(block);
+    }
+}
+
+void* BlockPool::allocate() {
+    {
+        std::scoped_lock lock(mMutex);
+        if (!mFreeBlocks.empty()) {
+            void* block = mFreeBlocks.back();
+            mFreeBlocks.pop_back();
+            return block;
+        }
+    }
+    return ::operator new(mBlockSize);
+}
+
+void BlockPool::deallocate(void* block) {
+    {
+        std::scoped_lock lock(mMutex);
+        if (mFreeBlocks.size() < mMaxFreeBlocks) {
+            mFreeBlocks.push_back(block);
+            return;
+        }
     }
-    const int64_t assignedToken = mCurrentToken++;
-    mPredictions[assignedToken] = predictions;
+    ::operator delete(block);
+}
+
+int64_t TokenManager::generateTokenForPredictions(TimelineItem&& predictions) {
+    SFTRACE_CALL();
+    const int64_t assignedToken = mCurrentToken.fetch_add(1, std::memory_order_relaxed);
+    Prediction& entry = mPredictions[static_cast<size_t>(assignedToken) % kMaxTokens];
+
+    // Tokens that share an entry are kMaxTokens apart, so only one thread writes an entry at a time.
+    const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    entry.token.store(assignedToken, std::memory_order_relaxed);
+    entry.startTime.store(predictions.startTime, std::memory_order_relaxed);
+    entry.endTime.store(predictions.endTime, std::memory_order_relaxed);
+    entry.presentTime.store(predictions.presentTime, std::memory_order_relaxed);
+    entry.desiredPresentTime.store(predictions.desiredPresentTime, std::memory_order_relaxed);
+    entry.sequence.store(sequence + 2, std::memory_order_release);
     return assignedToken;
 }
 
 std::optional<TimelineItem> TokenManager::getPredictionsForToken(int64_t token) const {
-    std::scoped_lock lock(mMutex);
-    auto predictionsIterator = mPredictions.find(token);
-    if (predictionsIterator != mPredictions.end()) {
-        return predictionsIterator->second;
+    if (token < 0) {
+        return {};
+    }
+
+    const Prediction& entry = mPredictions[static_cast<size_t>(token) % kMaxTokens];
+    while (true) {
+        const uint32_t sequence = entry.sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            continue;
+        }
+
+        const int64_t entryToken = entry.token.load(std::memory_order_relaxed);
+        const TimelineItem predictions(entry.startTime.load(std::memory_order_relaxed),
+                                       entry.endTime.load(std::memory_order_relaxed),
+                                       entry.presentTime.load(std::memory_order_relaxed),
+                                       entry.desiredPresentTime.load(std::memory_order_relaxed));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+
+        if (entryToken != token) {
+            return {};
+        }
+        return predictions;
     }
-    return {};
+}
+
+size_t TokenManager::getPredictionCount() const {
+    const int64_t generated =
+            mCurrentToken.load() - (FrameTimelineInfo::INVALID_VSYNC_ID + 1);
+    return std::min(static_cast<size_t>(generated), kMaxTokens);
 }
 
 FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surfaceFlingerPid,
                              JankClassificationThresholds thresholds, bool useBootTimeClock,
                              bool filterFramesBeforeTraceStarts)
-      : mUseBootTimeClock(useBootTimeClock),
+      : mSurfaceFramePool(
+                std::make_shared<BlockPool>(kSurfaceFrameBlockSize, kMaxPooledSurfaceFrames)),
+        mUseBootTimeClock(useBootTimeClock),
         mFilterFramesBeforeTraceStarts(
                 FlagManager::getInstance().filter_frames_before_trace_starts() &&
                 filterFramesBeforeTraceStarts),
@@ -922,8 +993,8 @@ FrameTimeline::FrameTimeline(std::shared_ptr<TimeStats> timeStats, pid_t surface
         mTimeStats(std::move(timeStats)),
         mSurfaceFlingerPid(surfaceFlingerPid),
         mJankClassificationThresholds(thresholds) {
-    mCurrentDisplayFrame =
-            std::make_shared<DisplayFrame>(mTimeStats, thresholds, &mTraceCookieCounter);
+    std::scoped_lock lock(mMutex);
+    mCurrentDisplayFrame = obtainDisplayFrame();
 }
 
 void FrameTimeline::onBootFinished() {
@@ -943,27 +1014,23 @@ std::shared_ptr<SurfaceFrame> FrameTimeline::createSurfaceFrameForToken(
         const FrameTimelineInfo& frameTimelineInfo, pid_t ownerPid, uid_t ownerUid, int32_t layerId,
         std::string layerName, std::string debugName, bool isBuffer, GameMode gameMode) {
     SFTRACE_CALL();
-    if (frameTimelineInfo.vsyncId == FrameTimelineInfo::INVALID_VSYNC_ID) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
+    PredictionState predictionState = PredictionState::None;
+    TimelineItem predictions;
+    if (frameTimelineInfo.vsyncId != FrameTimelineInfo::INVALID_VSYNC_ID) {
+        if (auto tokenPredictions =
+                    mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId)) {
+            predictionState = PredictionState::Valid;
+            predictions = *tokenPredictions;
+        } else {
+            predictionState = PredictionState::Expired;
+        }
+    }
+    return std::allocate_shared<SurfaceFrame>(PoolAllocator<SurfaceFrame>(mSurfaceFramePool),
+                                              frameTimelineInfo, ownerPid, ownerUid, layerId,
                                               std::move(layerName), std::move(debugName),
-                                              PredictionState::None, TimelineItem(), mTimeStats,
+                                              predictionState, std::move(predictions), mTimeStats,
                                               mJankClassificationThresholds, &mTraceCookieCounter,
                                               isBuffer, gameMode);
-    }
-    std::optional<TimelineItem> predictions =
-            mTokenManager.getPredictionsForToken(frameTimelineInfo.vsyncId);
-    if (predictions) {
-        return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                              std::move(layerName), std::move(debugName),
-                                              PredictionState::Valid, std::move(*predictions),
-                                              mTimeStats, mJankClassificationThresholds,
-                                              &mTraceCookieCounter, isBuffer, gameMode);
-    }
-    return std::make_shared<SurfaceFrame>(frameTimelineInfo, ownerPid, ownerUid, layerId,
-                                          std::move(layerName), std::move(debugName),
-                                          PredictionState::Expired, TimelineItem(), mTimeStats,
-                                          mJankClassificationThresholds, &mTraceCookieCounter,
-                                          isBuffer, gameMode);
 }
 
 FrameTimeline::DisplayFrame::DisplayFrame(std::shared_ptr<TimeStats> timeStats,
@@ -1012,9 +1079,7 @@ void FrameTimeline::onCommitNotComposited() {
     SFTRACE_CALL();
     std::scoped_lock lock(mMutex);
     mCurrentDisplayFrame->onCommitNotComposited();
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mCurrentDisplayFrame = obtainDisplayFrame();
 }
 
 void FrameTimeline::DisplayFrame::addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame) {
@@ -1036,6 +1101,22 @@ void FrameTimeline::DisplayFrame::onSfWakeUp(int64_t token, Fps refreshRate, Fps
     mSurfaceFlingerActuals.startTime = wakeUpTime;
 }
 
+void FrameTimeline::DisplayFrame::reset() {
+    mToken = FrameTimelineInfo::INVALID_VSYNC_ID;
+    mSurfaceFlingerPredictions = TimelineItem();
+    mSurfaceFlingerActuals = TimelineItem();
+    mSurfaceFrames.clear();
+    mPredictionState = PredictionState::None;
+    mJankType = JankType::None;
+    mJankSeverityType = JankSeverityType::None;
+    mGpuFence = FenceTime::NO_FENCE;
+    mFramePresentMetadata = FramePresentMetadata::UnknownPresent;
+    mFrameReadyMetadata = FrameReadyMetadata::UnknownFinish;
+    mFrameStartMetadata = FrameStartMetadata::UnknownStart;
+    mRefreshRate = Fps();
+    mRenderRate = Fps();
+}
+
 void FrameTimeline::DisplayFrame::setPredictions(PredictionState predictionState,
                                                  TimelineItem predictions) {
     mPredictionState = predictionState;
@@ -1517,19 +1598,21 @@ void FrameTimeline::flushPendingPresentFences() {
     // Present fences are expected to be signaled in order. Mark all the previous
     // pending fences as errors.
     for (size_t i = 0; i < firstSignaledFence.value(); i++) {
-        const auto& pendingPresentFence = *mPendingPresentFences.begin();
+        const auto& pendingPresentFence = mPendingPresentFences.front();
         const nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
         auto& displayFrame = pendingPresentFence.second;
         displayFrame->onPresent(signalTime, mPreviousActualPresentTime);
         mPreviousPredictionPresentTime =
                 displayFrame->trace(mSurfaceFlingerPid, monoBootOffset,
                                     mPreviousPredictionPresentTime, mFilterFramesBeforeTraceStarts);
-        mPendingPresentFences.erase(mPendingPresentFences.begin());
+        mPendingPresentFences.pop_front();
     }
 
+    // Classify the signaled frames in order and stop at the first pending fence, so each frame
+    // is classified exactly once, in the flush right after its fence signals.
     mPresentFrames.clear();
-    for (size_t i = 0; i < mPendingPresentFences.size(); i++) {
-        const auto& pendingPresentFence = mPendingPresentFences[i];
+    while (!mPendingPresentFences.empty()) {
+        const auto& pendingPresentFence = mPendingPresentFences.front();
         nsecs_t signalTime = Fence::SIGNAL_TIME_INVALID;
         if (pendingPresentFence.first && pendingPresentFence.first->isValid()) {
             signalTime = pendingPresentFence.first->getSignalTime();
@@ -1552,20 +1635,30 @@ void FrameTimeline::flushPendingPresentFences() {
                                     mPreviousPredictionPresentTime, mFilterFramesBeforeTraceStarts);
         mPreviousActualPresentTime = signalTime;
 
-        mPendingPresentFences.erase(mPendingPresentFences.begin() + static_cast<int>(i));
-        --i;
+        mPendingPresentFences.pop_front();
     }
 }
 
 void FrameTimeline::finalizeCurrentDisplayFrame() {
     while (mDisplayFrames.size() >= mMaxDisplayFrames) {
         // We maintain only a fixed number of frames' data. Pop older frames
+        mRecycledDisplayFrame = std::move(mDisplayFrames.front());
         mDisplayFrames.pop_front();
     }
-    mDisplayFrames.push_back(mCurrentDisplayFrame);
-    mCurrentDisplayFrame.reset();
-    mCurrentDisplayFrame = std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
-                                                          &mTraceCookieCounter);
+    mDisplayFrames.push_back(std::move(mCurrentDisplayFrame));
+    mCurrentDisplayFrame = obtainDisplayFrame();
+}
+
+std::shared_ptr<FrameTimeline::DisplayFrame> FrameTimeline::obtainDisplayFrame() {
+    // The evicted DisplayFrame may still be waiting for its present fence, or be held by a test.
+    if (mRecycledDisplayFrame && mRecycledDisplayFrame.use_count() == 1) {
+        auto displayFrame = std::move(mRecycledDisplayFrame);
+        displayFrame->reset();
+        return displayFrame;
+    }
+    mRecycledDisplayFrame.reset();
+    return std::make_shared<DisplayFrame>(mTimeStats, mJankClassificationThresholds,
+                                          &mTraceCookieCounter);
 }
 
 nsecs_t FrameTimeline::DisplayFrame::getBaseTime() const {
@@ -16,14 +16,18 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstddef>
 #include <deque>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <vector>
 
+#include <android-base/thread_annotations.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/JankInfo.h>
 #include <gui/LayerMetadata.h>
@@ -360,6 +364,84 @@ public:
 
 namespace impl {
 
+/*
+ * A free list of fixed-size memory blocks. FrameTimeline allocates its SurfaceFrames from it, since
+ * one is created for every buffer of every layer, on binder threads, and destroyed on the main
+ * thread once its DisplayFrame falls out of the history. The lock is only held to push or pop a
+ * block.
+ */
+class BlockPool {
+public:
+    BlockPool(size_t blockSize, size_t maxFreeBlocks);
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    size_t getBlockSize() const { return mBlockSize; }
+
+    void* allocate();
+    void deallocate(void* block);
+
+private:
+    const size_t mBlockSize;
+    const size_t mMaxFreeBlocks;
+    std::mutex mMutex;
+    std::vector<void*> mFreeBlocks GUARDED_BY(mMutex);
+};
+
+/*
+ * Allocator for std::allocate_shared that serves single objects that fit in a block from a
+ * BlockPool. The pool is shared with the allocator copy held by the control block of each
+ * shared_ptr, so it outlives any object allocated from it.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(std::shared_ptr<BlockPool> pool) : mPool(std::move(pool)) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : mPool(other.mPool) {}
+
+    T* allocate(size_t n) {
+        if (fitsInBlock(n)) {
+            return static_cast<T*>(mPool->allocate());
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (fitsInBlock(n)) {
+            mPool->deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const {
+        return mPool == other.mPool;
+    }
+
+private:
+    template <typename U>
+    friend class PoolAllocator;
+
+    bool fitsInBlock(size_t n) const {
+        return n == 1 && sizeof(T) <= mPool->getBlockSize() &&
+                alignof(T) <= alignof(std::max_align_t);
+    }
+
+    std::shared_ptr<BlockPool> mPool;
+};
+
+/*
+ * The predictions are kept in a ring indexed by token, so that createSurfaceFrameForToken on binder
+ * threads and generateTokenForPredictions on the vsync threads never wait for each other. Each
+ * entry is a seqlock: readers retry if they raced with a writer, and discard the entry if it holds
+ * a different token, i.e. the token expired or hasn't been generated yet.
+ */
 class TokenManager : public android::frametimeline::TokenManager {
 public:
     TokenManager() : mCurrentToken(FrameTimelineInfo::INVALID_VSYNC_ID + 1) {}
@@ -372,12 +454,23 @@ private:
     // Friend class for testing
     friend class android::frametimeline::FrameTimelineTest;
 
-    void flushTokens(nsecs_t flushTime) REQUIRES(mMutex);
-
-    std::map<int64_t, TimelineItem> mPredictions GUARDED_BY(mMutex);
-    int64_t mCurrentToken GUARDED_BY(mMutex);
-    mutable std::mutex mMutex;
     static constexpr size_t kMaxTokens = 500;
+
+    struct Prediction {
+        // Odd while the entry is being written.
+        std::atomic<uint32_t> sequence = 0;
+        std::atomic<int64_t> token = FrameTimelineInfo::INVALID_VSYNC_ID;
+        std::atomic<nsecs_t> startTime = 0;
+        std::atomic<nsecs_t> endTime = 0;
+        std::atomic<nsecs_t> presentTime = 0;
+        std::atomic<nsecs_t> desiredPresentTime = 0;
+    };
+
+    // Number of tokens whose predictions are still stored.
+    size_t getPredictionCount() const;
+
+    std::array<Prediction, kMaxTokens> mPredictions;
+    std::atomic<int64_t> mCurrentToken;
 };
 
 class FrameTimeline : public android::frametimeline::FrameTimeline {
@@ -424,6 +517,10 @@ public:
         // Adds the provided SurfaceFrame to the current display frame.
         void addSurfaceFrame(std::shared_ptr<SurfaceFrame> surfaceFrame);
 
+        // Clears the DisplayFrame so that it can be reused for a new frame, keeping the capacity of
+        // its SurfaceFrame list.
+        void reset();
+
         void setPredictions(PredictionState predictionState, TimelineItem predictions);
         void setActualStartTime(nsecs_t actualStartTime);
         void setActualEndTime(nsecs_t actualEndTime);
@@ -534,14 +631,20 @@ private:
     void flushPendingPresentFences() REQUIRES(mMutex);
     std::optional<size_t> getFirstSignalFenceIndex() const REQUIRES(mMutex);
     void finalizeCurrentDisplayFrame() REQUIRES(mMutex);
+    // Returns a DisplayFrame for the next frame, reusing an evicted one if nothing else holds it.
+    std::shared_ptr<DisplayFrame> obtainDisplayFrame() REQUIRES(mMutex);
     void dumpAll(std::string& result);
     void dumpJank(std::string& result);
 
     // Sliding window of display frames. TODO(b/168072834): compare perf with fixed size array
     std::deque<std::shared_ptr<DisplayFrame>> mDisplayFrames GUARDED_BY(mMutex);
-    std::vector<std::pair<std::shared_ptr<FenceTime>, std::shared_ptr<DisplayFrame>>>
+    std::deque<std::pair<std::shared_ptr<FenceTime>, std::shared_ptr<DisplayFrame>>>
             mPendingPresentFences GUARDED_BY(mMutex);
     std::shared_ptr<DisplayFrame> mCurrentDisplayFrame GUARDED_BY(mMutex);
+    // The most recently evicted DisplayFrame, to be reused by obtainDisplayFrame.
+    std::shared_ptr<DisplayFrame> mRecycledDisplayFrame GUARDED_BY(mMutex);
+    // Backs the allocations of the SurfaceFrames created by createSurfaceFrameForToken.
+    const std::shared_ptr<BlockPool> mSurfaceFramePool;
     TokenManager mTokenManager;
     TraceCookieCounter mTraceCookieCounter;
     mutable std::mutex mMutex;
@@ -559,6 +662,12 @@ private:
     // display frame, this is a good starting size for the vector so that we can avoid the
     // internal vector resizing that happens with push_back.
     static constexpr uint32_t kNumSurfaceFramesInitial = 10;
+    // The number of freed SurfaceFrame allocations kept for reuse, enough for the SurfaceFrames of
+    // a few display frames with many updating layers.
+    static constexpr size_t kMaxPooledSurfaceFrames = 256;
+    // Room for the shared_ptr control block that std::allocate_shared puts in front of each
+    // SurfaceFrame.
+    static constexpr size_t kSurfaceFrameBlockSize = sizeof(SurfaceFrame) + 64;
     // Presented surface frames that have been jank classified and can
     // indicate of potential buffer stuffing.
     std::vector<std::shared_ptr<frametimeline::SurfaceFrame>> mPresentFrames;
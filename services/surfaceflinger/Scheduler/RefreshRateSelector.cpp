@@ -33,6 +33,7 @@
 #include <ftl/fake_guard.h>
 #include <ftl/match.h>
 #include <ftl/unit.h>
+#include <math/HashCombine.h>
 #include <scheduler/Fps.h>
 #include <scheduler/FrameRateMode.h>
 
@@ -477,17 +478,98 @@ float RefreshRateSelector::calculateLayerScoreLocked(const LayerRequirement& lay
 auto RefreshRateSelector::getRankedFrameRates(const std::vector<LayerRequirement>& layers,
                                               GlobalSignals signals, Fps pacesetterFps) const
         -> RankedFrameRates {
-    GetRankedFrameRatesCache cache{layers, signals, pacesetterFps};
+    GetRankedFrameRatesCache cache{layers, signals, pacesetterFps,
+                                   GetRankedFrameRatesCache::computeSignature(layers, signals,
+                                                                              pacesetterFps)};
 
     std::lock_guard lock(mLock);
 
-    if (mGetRankedFrameRatesCache && mGetRankedFrameRatesCache->matches(cache)) {
-        return mGetRankedFrameRatesCache->result;
+    const auto it = std::find_if(mGetRankedFrameRatesCache.begin(),
+                                 mGetRankedFrameRatesCache.end(),
+                                 [&cache](const auto& entry) { return entry.matches(cache); });
+    if (it != mGetRankedFrameRatesCache.end()) {
+        // Keep the cache in MRU order.
+        std::rotate(mGetRankedFrameRatesCache.begin(), it, std::next(it));
+        return mGetRankedFrameRatesCache.front().result;
     }
 
     cache.result = getRankedFrameRatesLocked(layers, signals, pacesetterFps);
-    mGetRankedFrameRatesCache = std::move(cache);
-    return mGetRankedFrameRatesCache->result;
+    if (mGetRankedFrameRatesCache.size() == kGetRankedFrameRatesCacheCapacity) {
+        mGetRankedFrameRatesCache.pop_back();
+    }
+    mGetRankedFrameRatesCache.push_front(std::move(cache));
+    return mGetRankedFrameRatesCache.front().result;
+}
+
+size_t RefreshRateSelector::GetRankedFrameRatesCache::computeSignature(
+        const std::vector<LayerRequirement>& layers, GlobalSignals signals, Fps pacesetterFps) {
+    // Refresh rates are quantized to 0.1 Hz so that approximately equal votes share a signature in
+    // all but rare cases. Votes that straddle a quantization step merely miss the cache.
+    const auto quantize = [](Fps fps) {
+        return static_cast<int64_t>(std::round(fps.getValue() * 10.f));
+    };
+
+    size_t signature = hashCombine(signals.touch, signals.idle, signals.powerOnImminent,
+                                   signals.heuristicIdle, quantize(pacesetterFps), layers.size());
+    for (const auto& layer : layers) {
+        hashCombineSingle(signature, layer.vote);
+        hashCombineSingle(signature, layer.frameRateCategory);
+        hashCombineSingle(signature, layer.seamlessness);
+        hashCombineSingle(signature, layer.focused);
+        hashCombineSingle(signature, layer.weight);
+        hashCombineSingle(signature, quantize(layer.desiredRefreshRate));
+    }
+    return signature;
+}
+
+const float* RefreshRateSelector::getLayerScoresLocked(const LayerRequirement& layer) const {
+    // The score of a layer only depends on its vote, category and desired refresh rate, so votes
+    // that are drawn from a small set of values share a table. The key packs the vote type, the
+    // category and the index of the desired refresh rate in mKnownFrameRates.
+    constexpr uint32_t kNoFrameRateIndex = 0xffff;
+    uint32_t category = 0;
+    uint32_t frameRateIndex = kNoFrameRateIndex;
+
+    switch (layer.vote) {
+        case LayerVoteType::NoVote:
+        case LayerVoteType::Min:
+            return nullptr;
+        case LayerVoteType::Max:
+            break;
+        case LayerVoteType::ExplicitCategory:
+            category = static_cast<uint32_t>(layer.frameRateCategory);
+            break;
+        case LayerVoteType::Heuristic:
+        case LayerVoteType::ExplicitDefault:
+        case LayerVoteType::ExplicitExactOrMultiple:
+        case LayerVoteType::ExplicitExact:
+        case LayerVoteType::ExplicitGte: {
+            // Only tabulate exact matches, as approximately equal rates may score differently.
+            const auto it = std::lower_bound(mKnownFrameRates.begin(), mKnownFrameRates.end(),
+                                             layer.desiredRefreshRate, [](Fps lhs, Fps rhs) {
+                                                 return lhs.getValue() < rhs.getValue();
+                                             });
+            if (it == mKnownFrameRates.end() ||
+                it->getValue() != layer.desiredRefreshRate.getValue()) {
+                return nullptr;
+            }
+            frameRateIndex = static_cast<uint32_t>(std::distance(mKnownFrameRates.begin(), it));
+            break;
+        }
+    }
+
+    const uint32_t key =
+            static_cast<uint32_t>(layer.vote) << 24 | (category & 0xff) << 16 | frameRateIndex;
+    const auto [it, inserted] = mLayerScoreTables.try_emplace(key);
+    auto& scores = it->second;
+    if (inserted) {
+        scores.reserve(mAppRequestFrameRates.size() * 2);
+        for (const auto& [fps, _] : mAppRequestFrameRates) {
+            scores.push_back(calculateLayerScoreLocked(layer, fps, /*isSeamlessSwitch=*/false));
+            scores.push_back(calculateLayerScoreLocked(layer, fps, /*isSeamlessSwitch=*/true));
+        }
+    }
+    return scores.data();
 }
 
 using LayerRequirementPtrs = std::vector<const RefreshRateSelector::LayerRequirement*>;
@@ -766,8 +848,10 @@ auto RefreshRateSelector::getRankedFrameRatesLocked(const std::vector<LayerRequi
         }
 
         const auto weight = layer.weight;
+        const float* const layerScores = getLayerScoresLocked(layer);
 
-        for (auto& [mode, overallScore, fixedRateBelowThresholdLayersScore] : scores) {
+        for (size_t modeIndex = 0; modeIndex < scores.size(); modeIndex++) {
+            auto& [mode, overallScore, fixedRateBelowThresholdLayersScore] = scores[modeIndex];
             const auto& [fps, modePtr] = mode;
             const bool isSeamlessSwitch = modePtr->getGroup() == activeMode.getGroup();
 
@@ -828,8 +912,9 @@ auto RefreshRateSelector::getRankedFrameRatesLocked(const std::vector<LayerRequi
                       to_string(fps).c_str());
                 continue;
             } else {
-                layerScore =
-                    calculateLayerScoreLocked(layer, fps, isSeamlessSwitch);
+                layerScore = layerScores
+                        ? layerScores[2 * modeIndex + (isSeamlessSwitch ? 1 : 0)]
+                        : calculateLayerScoreLocked(layer, fps, isSeamlessSwitch);
             }
             const float weightedLayerScore = weight * layerScore;
 
@@ -1325,7 +1410,7 @@ void RefreshRateSelector::setActiveMode(DisplayModeId modeId, Fps renderFrameRat
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     const auto activeModeOpt = mDisplayModes.get(modeId);
     LOG_ALWAYS_FATAL_IF(!activeModeOpt);
@@ -1366,7 +1451,7 @@ void RefreshRateSelector::updateDisplayModes(DisplayModes modes, DisplayModeId a
 
     // Invalidate the cached invocation to getRankedFrameRates. This forces
     // the refresh rate to be recomputed on the next call to getRankedFrameRates.
-    mGetRankedFrameRatesCache.reset();
+    mGetRankedFrameRatesCache.clear();
 
     mDisplayModes = std::move(modes);
     const auto activeModeOpt = mDisplayModes.get(activeModeId);
@@ -1466,7 +1551,7 @@ auto RefreshRateSelector::setPolicy(const PolicyVariant& policy) -> SetPolicyRes
             return SetPolicyResult::Invalid;
         }
 
-        mGetRankedFrameRatesCache.reset();
+        mGetRankedFrameRatesCache.clear();
 
         const auto& idleScreenConfigOpt = getCurrentPolicyLocked()->idleScreenConfigOpt;
         if (idleScreenConfigOpt != oldPolicy.idleScreenConfigOpt) {
@@ -1584,6 +1669,9 @@ void RefreshRateSelector::constructAvailableRefreshRates() {
         return frameRateModes;
     };
 
+    // Scores are tabulated against mAppRequestFrameRates, which is about to change.
+    mLayerScoreTables.clear();
+
     mPrimaryFrameRates = filterRefreshRates(policy->primaryRanges, "primary");
     mAppRequestFrameRates = filterRefreshRates(policy->appRequestRanges, "app request");
     mAllFrameRates = filterRefreshRates(FpsRanges(getSupportedFrameRateRangeLocked(),
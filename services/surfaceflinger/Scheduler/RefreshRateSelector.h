@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <deque>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 
@@ -507,6 +509,12 @@ private:
     float calculateNonExactMatchingLayerScoreLocked(const LayerRequirement&, Fps refreshRate) const
             REQUIRES(mLock);
 
+    // Returns the precomputed scores of the layer for every mode in mAppRequestFrameRates, or
+    // nullptr if the vote cannot be tabulated (e.g. an arbitrary desired refresh rate). The score
+    // for mAppRequestFrameRates[i] is at index 2 * i, or 2 * i + 1 for a seamless switch. Scores
+    // are identical to those of calculateLayerScoreLocked.
+    const float* getLayerScoresLocked(const LayerRequirement&) const REQUIRES(mLock);
+
     // Calculates the score for non-exact matching layer that has LayerVoteType::ExplicitDefault.
     float calculateNonExactMatchingDefaultLayerScoreLocked(nsecs_t displayPeriod,
                                                            nsecs_t layerPeriod) const
@@ -586,14 +594,30 @@ private:
         GlobalSignals signals;
         Fps pacesetterFps;
 
+        // Hash of the quantized votes and signals above. Entries with different signatures never
+        // match, so most misses are detected without comparing every layer.
+        size_t signature = 0;
+
         RankedFrameRates result;
 
+        static size_t computeSignature(const std::vector<LayerRequirement>&, GlobalSignals,
+                                       Fps pacesetterFps);
+
         bool matches(const GetRankedFrameRatesCache& other) const {
-            return layers == other.layers && signals == other.signals &&
-                    isApproxEqual(pacesetterFps, other.pacesetterFps);
+            return signature == other.signature && layers == other.layers &&
+                    signals == other.signals && isApproxEqual(pacesetterFps, other.pacesetterFps);
         }
     };
-    mutable std::optional<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+
+    // Most recently used invocations of getRankedFrameRates, in MRU order. Several entries are kept
+    // so that layers toggling between a few vote configurations (e.g. during animations) keep
+    // hitting the cache.
+    static constexpr size_t kGetRankedFrameRatesCacheCapacity = 8;
+    mutable std::deque<GetRankedFrameRatesCache> mGetRankedFrameRatesCache GUARDED_BY(mLock);
+
+    // Layer scores for mAppRequestFrameRates, filled lazily by getLayerScoresLocked and cleared
+    // whenever the available refresh rates are reconstructed. Keyed by LayerScoreKey.
+    mutable std::unordered_map<uint32_t, std::vector<float>> mLayerScoreTables GUARDED_BY(mLock);
 
     // Declare mIdleTimer last to ensure its thread joins before the mutex/callbacks are destroyed.
     std::mutex mIdleTimerCallbacksMutex;
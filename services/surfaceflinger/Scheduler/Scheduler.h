@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <future>
@@ -88,7 +89,7 @@ class Scheduler : public IEventThreadCallback, android::impl::MessageQueue {
 
 public:
     Scheduler(ICompositor&, ISchedulerCallback&, FeatureFlags, surfaceflinger::Factory&,
-              Fps activeRefreshRate, TimeStats&);
+              Fps activeRefreshRate, TimeStats&, std::chrono::nanoseconds vsyncGroupDispatchWithin);
     virtual ~Scheduler();
 
     void startTimers();
@@ -481,6 +482,9 @@ private:
 
     const FeatureFlags mFeatures;
 
+    // Passed to the VsyncSchedule of each display.
+    const std::chrono::nanoseconds mVsyncGroupDispatchWithin;
+
     // Stores phase offsets configured per refresh rate.
     const std::unique_ptr<VsyncConfiguration> mVsyncConfiguration;
 
@@ -16,6 +16,7 @@
 
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
+#include <cinttypes>
 #include <vector>
 
 #include <android-base/stringprintf.h>
@@ -367,6 +368,7 @@ void VSyncDispatchTimerQueue::timerCallback() {
         }
         auto const now = mTimeKeeper->now();
         mLastTimerCallback = now;
+        mWakeupStats.wakeups++;
         for (auto it = mCallbacks.begin(); it != mCallbacks.end(); it++) {
             auto& callback = it->second;
             auto const wakeupTime = callback->wakeupTime();
@@ -382,9 +384,22 @@ void VSyncDispatchTimerQueue::timerCallback() {
                 callback->executing();
                 invocations.emplace_back(Invocation{callback, *callback->lastExecutedVsyncTarget(),
                                                     *wakeupTime, *readyTime});
+
+                mWakeupStats.dispatches++;
+                if (*wakeupTime > now) {
+                    mWakeupStats.groupedDispatches++;
+                } else {
+                    const nsecs_t lateness = now - *wakeupTime;
+                    mWakeupStats.totalLateness += lateness;
+                    mWakeupStats.maxLateness = std::max(mWakeupStats.maxLateness, lateness);
+                }
             }
         }
 
+        if (invocations.empty()) {
+            mWakeupStats.emptyWakeups++;
+        }
+
         mIntendedWakeupTime = kInvalidTime;
         rearmTimer(mTimeKeeper->now());
     }
@@ -446,10 +461,17 @@ std::optional<ScheduleResult> VSyncDispatchTimerQueue::scheduleLocked(
         return callback->addPendingWorkloadUpdate(*mTracker, now, scheduleTiming);
     }
 
+    const auto previousWakeupTime = callback->wakeupTime();
     const auto result = callback->schedule(scheduleTiming, *mTracker, now);
 
     if (callback->wakeupTime() < mIntendedWakeupTime - mTimerSlack) {
         rearmTimerSkippingUpdateFor(now, it);
+    } else if (previousWakeupTime == mIntendedWakeupTime &&
+               callback->wakeupTime() > mIntendedWakeupTime + mTimerSlack) {
+        // The timer was armed for this callback, which now wakes up too late to be grouped into
+        // that wakeup. Rearm for the next callback instead of waking up with nothing to dispatch.
+        mIntendedWakeupTime = kInvalidTime;
+        rearmTimerSkippingUpdateFor(now, it);
     }
 
     return result;
@@ -504,12 +526,28 @@ void VSyncDispatchTimerQueue::dump(std::string& result) const {
     StringAppendF(&result, "\tmLastTimerCallback: %.2fms ago mLastTimerSchedule: %.2fms ago\n",
                   (mTimeKeeper->now() - mLastTimerCallback) / 1e6f,
                   (mTimeKeeper->now() - mLastTimerSchedule) / 1e6f);
+    const auto& stats = mWakeupStats;
+    StringAppendF(&result,
+                  "\tWakeups: %" PRIu64 " (%" PRIu64 " empty) dispatches: %" PRIu64
+                  " (%" PRIu64 " grouped) lateness avg: %.2fms max: %.2fms\n",
+                  stats.wakeups, stats.emptyWakeups, stats.dispatches, stats.groupedDispatches,
+                  stats.dispatches == stats.groupedDispatches
+                          ? 0.f
+                          : stats.totalLateness /
+                                  static_cast<float>(stats.dispatches - stats.groupedDispatches) /
+                                  1e6f,
+                  stats.maxLateness / 1e6f);
     StringAppendF(&result, "\tCallbacks:\n");
     for (const auto& [token, entry] : mCallbacks) {
         entry->dump(result);
     }
 }
 
+VSyncDispatchTimerQueue::WakeupStats VSyncDispatchTimerQueue::getWakeupStats() const {
+    std::lock_guard lock(mMutex);
+    return mWakeupStats;
+}
+
 VSyncCallbackRegistration::VSyncCallbackRegistration(std::shared_ptr<VSyncDispatch> dispatch,
                                                      VSyncDispatch::Callback callback,
                                                      std::string callbackName)
@@ -134,6 +134,23 @@ public:
     CancelResult cancel(CallbackToken) final;
     void dump(std::string&) const final;
 
+    // Counters describing how well timer wakeups are shared between callbacks.
+    struct WakeupStats {
+        // Number of times the timer fired.
+        uint64_t wakeups = 0;
+        // Number of times the timer fired without any callback to dispatch.
+        uint64_t emptyWakeups = 0;
+        // Number of callbacks dispatched.
+        uint64_t dispatches = 0;
+        // Number of callbacks dispatched ahead of their wakeup time, grouped into an earlier
+        // wakeup that was within mTimerSlack.
+        uint64_t groupedDispatches = 0;
+        // Sum and maximum of the delay between a callback's wakeup time and its dispatch.
+        nsecs_t totalLateness = 0;
+        nsecs_t maxLateness = 0;
+    };
+    WakeupStats getWakeupStats() const;
+
 private:
     VSyncDispatchTimerQueue(const VSyncDispatchTimerQueue&) = delete;
     VSyncDispatchTimerQueue& operator=(const VSyncDispatchTimerQueue&) = delete;
@@ -170,6 +187,7 @@ private:
     // For debugging purposes
     nsecs_t mLastTimerCallback GUARDED_BY(mMutex) = kInvalidTime;
     nsecs_t mLastTimerSchedule GUARDED_BY(mMutex) = kInvalidTime;
+    WakeupStats mWakeupStats GUARDED_BY(mMutex);
 };
 
 } // namespace android::scheduler
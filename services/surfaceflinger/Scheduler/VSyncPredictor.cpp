@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <sstream>
 
 #include <android-base/logging.h>
@@ -44,6 +45,9 @@ namespace android::scheduler {
 using base::StringAppendF;
 
 static auto constexpr kMaxPercent = 100u;
+// Ordinals are assigned again once the drift of the period since they were assigned moves the
+// newest timestamp by this percentage of a period.
+static constexpr int64_t kOrdinalDriftPercent = 5;
 
 namespace {
 int numVsyncsPerFrame(const ftl::NonNull<DisplayModePtr>& displayModePtr) {
@@ -145,7 +149,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
 
     std::lock_guard lock(mMutex);
 
-    if (!validate(timestamp)) {
+    if (!validate(timestamp) || !fitsModel(timestamp)) {
         // VSR could elect to ignore the incongruent timestamp or resetModel(). If ts is ignored,
         // don't insert this ts into mTimestamps ringbuffer. If we are still
         // in the learning phase we should just clear all timestamps and start
@@ -169,14 +173,12 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         return false;
     }
 
-    if (mTimestamps.size() != kHistorySize) {
-        mTimestamps.push_back(timestamp);
-        mLastTimestampIndex = next(mLastTimestampIndex);
-    } else {
-        mLastTimestampIndex = next(mLastTimestampIndex);
-        mTimestamps[mLastTimestampIndex] = timestamp;
+    if (mTimestamps.size() >= kMinimumSamplesForPrediction) {
+        recordPredictionError(predictionError(timestamp));
     }
 
+    insertTimestamp(timestamp);
+
     traceInt64If("VSP-ts", timestamp);
 
     const size_t numSamples = mTimestamps.size();
@@ -185,6 +187,160 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         return true;
     }
 
+    auto it = mRateMap.find(idealPeriod());
+    bool accepted = true;
+    auto modelOpt = leastSquaresModel();
+    if (!modelOpt) {
+        // A few samples that do not fit the others can skew the regression enough to reject it.
+        // Drop them and fit the remaining samples rather than learning the model from scratch.
+        if (const auto newestAcceptedOpt = rejectOutliers()) {
+            accepted = *newestAcceptedOpt;
+            if (mTimestamps.size() < kMinimumSamplesForPrediction) {
+                it->second = {idealPeriod(), 0};
+                return accepted;
+            }
+            modelOpt = leastSquaresModel();
+        }
+    }
+
+    if (!modelOpt) {
+        it->second = {idealPeriod(), 0};
+        clearTimestamps(/* clearTimelines */ true);
+        return false;
+    }
+
+    const auto [anticipatedPeriod, intercept] = *modelOpt;
+    traceInt64If("VSP-period", anticipatedPeriod);
+    traceInt64If("VSP-intercept", intercept);
+
+    it->second = *modelOpt;
+
+    ALOGV("model update ts %" PRIu64 ": %" PRId64 " slope: %" PRId64 " intercept: %" PRId64,
+          mId.value, timestamp, anticipatedPeriod, intercept);
+    return accepted;
+}
+
+void VSyncPredictor::insertTimestamp(nsecs_t timestamp) {
+    const auto currentPeriod = mRateMap.find(idealPeriod())->second.slope;
+
+    if (mTimestamps.empty()) {
+        mTimestamps.push_back(timestamp);
+        mOrdinals.push_back(0);
+        mLastTimestampIndex = 0;
+        mOrdinalPeriod = currentPeriod;
+        rebuildRegression();
+        return;
+    }
+
+    const int64_t ordinalSpan = mOrdinals[mLastTimestampIndex] - mOrdinals[mOriginIndex];
+
+    if (mTimestamps.size() != kHistorySize) {
+        mTimestamps.push_back(timestamp);
+        mOrdinals.push_back(0);
+        mLastTimestampIndex = mTimestamps.size() - 1;
+    } else {
+        mLastTimestampIndex = next(mLastTimestampIndex);
+        accumulateSample(mLastTimestampIndex, -1);
+
+        if (mLastTimestampIndex == mOriginIndex) {
+            mOriginIndex = next(mLastTimestampIndex);
+            for (size_t i = 0; i < mTimestamps.size(); i++) {
+                if (i != mLastTimestampIndex && mTimestamps[i] < mTimestamps[mOriginIndex]) {
+                    mOriginIndex = i;
+                }
+            }
+        }
+    }
+
+    // Ordinals are assigned with the period modelled when their timestamp is added. Once the
+    // period has drifted far enough that it could round the older timestamps to other ordinals,
+    // assign them all again. The period settles quickly, so this rarely happens.
+    const nsecs_t drift = std::abs(currentPeriod - mOrdinalPeriod) * std::abs(ordinalSpan);
+    const bool reassignOrdinals = drift * kMaxPercent >= kOrdinalDriftPercent * currentPeriod;
+    if (reassignOrdinals) {
+        for (size_t i = 0; i < mTimestamps.size(); i++) {
+            if (i != mLastTimestampIndex) {
+                mOrdinals[i] = ordinalOf(mTimestamps[i], currentPeriod);
+            }
+        }
+        mOrdinalPeriod = currentPeriod;
+    }
+
+    mTimestamps[mLastTimestampIndex] = timestamp;
+    mOrdinals[mLastTimestampIndex] = ordinalOf(timestamp, currentPeriod);
+    if (timestamp < mTimestamps[mOriginIndex]) {
+        mOriginIndex = mLastTimestampIndex;
+    }
+
+    if (reassignOrdinals) {
+        rebuildRegression();
+    } else {
+        accumulateSample(mLastTimestampIndex, 1);
+        centerRegression();
+    }
+}
+
+// The ordinal is the number of vsyncs between the oldest timestamp and this one, assuming the
+// given vsync period.
+int64_t VSyncPredictor::ordinalOf(nsecs_t timestamp, nsecs_t period) const {
+    const nsecs_t originTimestamp = mTimestamps[mOriginIndex];
+    const int64_t originOrdinal = mOrdinals[mOriginIndex];
+    const nsecs_t distance = std::abs(timestamp - originTimestamp);
+    const int64_t ordinalDistance = period == 0 ? 0 : (distance + period / 2) / period;
+    return timestamp < originTimestamp ? originOrdinal - ordinalDistance
+                                       : originOrdinal + ordinalDistance;
+}
+
+void VSyncPredictor::accumulateSample(size_t index, int64_t sign) {
+    auto& sums = mRegressionSums;
+    const nsecs_t timestamp = mTimestamps[index] - sums.originTimestamp;
+    const int64_t ordinal = mOrdinals[index] - sums.originOrdinal;
+
+    sums.count += sign;
+    sums.timestamps += sign * timestamp;
+    sums.ordinals += sign * ordinal;
+    sums.timestampOrdinalProducts += sign * timestamp * ordinal;
+    sums.squaredOrdinals += sign * ordinal * ordinal;
+}
+
+void VSyncPredictor::centerRegression() {
+    auto& sums = mRegressionSums;
+    if (sums.count == 0) {
+        return;
+    }
+
+    // Move the origin to the mean of the samples:
+    // Sigma_i((Y_i - dt) * (X_i - dk)) = Sigma_i(Y_i * X_i) - dk * Sigma_i(Y_i)
+    //                                    - dt * Sigma_i(X_i) + n * dt * dk
+    const nsecs_t dt = sums.timestamps / sums.count;
+    const int64_t dk = sums.ordinals / sums.count;
+    sums.timestampOrdinalProducts +=
+            -dk * sums.timestamps - dt * sums.ordinals + sums.count * dt * dk;
+    sums.squaredOrdinals += -2 * dk * sums.ordinals + sums.count * dk * dk;
+    sums.timestamps -= sums.count * dt;
+    sums.ordinals -= sums.count * dk;
+    sums.originTimestamp += dt;
+    sums.originOrdinal += dk;
+}
+
+void VSyncPredictor::rebuildRegression() {
+    mRegressionSums = {};
+    if (mTimestamps.empty()) {
+        return;
+    }
+
+    mOriginIndex = static_cast<size_t>(
+            std::distance(mTimestamps.begin(),
+                          std::min_element(mTimestamps.begin(), mTimestamps.end())));
+    mRegressionSums.originTimestamp = mTimestamps[mOriginIndex];
+    mRegressionSums.originOrdinal = mOrdinals[mOriginIndex];
+    for (size_t i = 0; i < mTimestamps.size(); i++) {
+        accumulateSample(i, 1);
+    }
+    centerRegression();
+}
+
+std::optional<VSyncPredictor::Model> VSyncPredictor::leastSquaresModel() const {
     // This is a 'simple linear regression' calculation of Y over X, with Y being the
     // vsync timestamps, and X being the ordinal of vsync count.
     // The calculated slope is the vsync period.
@@ -200,74 +356,177 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(numSamples);
-    std::vector<nsecs_t> ordinals(numSamples);
-
-    // Normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    const auto oldestTS = *std::min_element(mTimestamps.begin(), mTimestamps.end());
-    auto it = mRateMap.find(idealPeriod());
-    auto const currentPeriod = it->second.slope;
+    // Both sums are expanded so that they can be computed from the running sums in
+    // mRegressionSums, which are kept up to date as timestamps are added and evicted:
+    //
+    // Sigma_i((X_i - mean(X)) * (Y_i - mean(Y)))
+    //     = Sigma_i(X_i * Y_i) - mean(X) * Sigma_i(Y_i) - mean(Y) * Sigma_i(X_i)
+    //       + n * mean(X) * mean(Y)
+    // Sigma_i((X_i - mean(X)) ^ 2) = Sigma_i(X_i ^ 2) - 2 * mean(X) * Sigma_i(X_i) + n * mean(X) ^ 2
+    //
+    const auto& sums = mRegressionSums;
 
     // The mean of the ordinals must be precise for the intercept calculation, so scale them up for
     // fixed-point arithmetic.
     constexpr int64_t kScalingFactor = 1000;
 
-    nsecs_t meanTS = 0;
-    nsecs_t meanOrdinal = 0;
+    const nsecs_t meanTS = sums.timestamps / sums.count;
+    const nsecs_t meanOrdinal = sums.ordinals * kScalingFactor / sums.count;
 
-    for (size_t i = 0; i < numSamples; i++) {
-        const auto timestamp = mTimestamps[i] - oldestTS;
-        vsyncTS[i] = timestamp;
-        meanTS += timestamp;
+    const nsecs_t top = sums.timestampOrdinalProducts * kScalingFactor -
+            meanOrdinal * sums.timestamps - meanTS * sums.ordinals * kScalingFactor +
+            sums.count * meanTS * meanOrdinal;
+    const nsecs_t bottom = sums.squaredOrdinals * kScalingFactor * kScalingFactor -
+            2 * meanOrdinal * sums.ordinals * kScalingFactor +
+            sums.count * meanOrdinal * meanOrdinal;
 
-        const auto ordinal = currentPeriod == 0
-                ? 0
-                : (vsyncTS[i] + currentPeriod / 2) / currentPeriod * kScalingFactor;
-        ordinals[i] = ordinal;
-        meanOrdinal += ordinal;
+    if (CC_UNLIKELY(bottom == 0)) {
+        return {};
     }
 
-    meanTS /= numSamples;
-    meanOrdinal /= numSamples;
+    // The intercept is relative to the oldest timestamp, rather than to the origin of the sums.
+    nsecs_t const anticipatedPeriod = top * kScalingFactor / bottom;
+    nsecs_t const meanTSFromOldest = sums.originTimestamp - mTimestamps[mOriginIndex] + meanTS;
+    int64_t const meanOrdinalFromOldest =
+            (sums.originOrdinal - mOrdinals[mOriginIndex]) * kScalingFactor + meanOrdinal;
+    nsecs_t const intercept =
+            meanTSFromOldest - (anticipatedPeriod * meanOrdinalFromOldest / kScalingFactor);
 
-    for (size_t i = 0; i < numSamples; i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
+    auto const percent = std::abs(anticipatedPeriod - idealPeriod()) * kMaxPercent / idealPeriod();
+    if (percent >= kOutlierTolerancePercent) {
+        return {};
+    }
+
+    return Model{anticipatedPeriod, intercept};
+}
+
+// Estimates the model with the Theil-Sen estimator, i.e. the median of the slopes between all pairs
+// of samples, which is not skewed by a minority of outliers. Samples that are too far from that
+// estimate are removed from the history. Returns whether the newest sample was kept, or nullopt if
+// the samples do not agree on a valid period.
+std::optional<bool> VSyncPredictor::rejectOutliers() {
+    SFTRACE_CALL();
+
+    const size_t numSamples = mTimestamps.size();
+    if (numSamples < 2) {
+        return {};
     }
 
-    nsecs_t top = 0;
-    nsecs_t bottom = 0;
+    const auto median = [](std::vector<nsecs_t>& values) {
+        const auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    };
+
+    std::vector<nsecs_t> estimates;
+    estimates.reserve(numSamples * (numSamples - 1) / 2);
     for (size_t i = 0; i < numSamples; i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
+        for (size_t j = i + 1; j < numSamples; j++) {
+            if (mOrdinals[i] != mOrdinals[j]) {
+                estimates.push_back((mTimestamps[j] - mTimestamps[i]) /
+                                    (mOrdinals[j] - mOrdinals[i]));
+            }
+        }
     }
 
-    if (CC_UNLIKELY(bottom == 0)) {
-        it->second = {idealPeriod(), 0};
-        clearTimestamps(/* clearTimelines */ true);
-        return false;
+    if (estimates.empty()) {
+        return {};
     }
 
-    nsecs_t const anticipatedPeriod = top * kScalingFactor / bottom;
-    nsecs_t const intercept = meanTS - (anticipatedPeriod * meanOrdinal / kScalingFactor);
+    const nsecs_t slope = median(estimates);
+    if (std::abs(slope - idealPeriod()) * kMaxPercent / idealPeriod() >= kOutlierTolerancePercent) {
+        return {};
+    }
 
-    auto const percent = std::abs(anticipatedPeriod - idealPeriod()) * kMaxPercent / idealPeriod();
-    if (percent >= kOutlierTolerancePercent) {
-        it->second = {idealPeriod(), 0};
-        clearTimestamps(/* clearTimelines */ true);
-        return false;
+    const auto residual = [&](size_t i) {
+        return mTimestamps[i] - mTimestamps[mOriginIndex] -
+                slope * (mOrdinals[i] - mOrdinals[mOriginIndex]);
+    };
+
+    estimates.clear();
+    for (size_t i = 0; i < numSamples; i++) {
+        estimates.push_back(residual(i));
+    }
+    const nsecs_t intercept = median(estimates);
+
+    // Keep the samples ordered from oldest to newest, so that the newest is at mLastTimestampIndex.
+    std::vector<nsecs_t> timestamps;
+    std::vector<int64_t> ordinals;
+    timestamps.reserve(numSamples);
+    ordinals.reserve(numSamples);
+    bool newestKept = false;
+    for (size_t n = 1; n <= numSamples; n++) {
+        const size_t i = (mLastTimestampIndex + n) % numSamples;
+        if (std::abs(residual(i) - intercept) * kMaxPercent >=
+            static_cast<nsecs_t>(kOutlierTolerancePercent) * slope) {
+            SFTRACE_FORMAT_INSTANT("outlier timestamp %.2fms ago",
+                                   (mClock->now() - mTimestamps[i]) / 1e6f);
+            continue;
+        }
+        timestamps.push_back(mTimestamps[i]);
+        ordinals.push_back(mOrdinals[i]);
+        newestKept = i == mLastTimestampIndex;
     }
 
-    traceInt64If("VSP-period", anticipatedPeriod);
-    traceInt64If("VSP-intercept", intercept);
+    if (timestamps.empty()) {
+        return {};
+    }
 
-    it->second = {anticipatedPeriod, intercept};
+    mTimestamps = std::move(timestamps);
+    mOrdinals = std::move(ordinals);
+    mLastTimestampIndex = mTimestamps.size() - 1;
+    rebuildRegression();
+    return newestKept;
+}
 
-    ALOGV("model update ts %" PRIu64 ": %" PRId64 " slope: %" PRId64 " intercept: %" PRId64,
-          mId.value, timestamp, anticipatedPeriod, intercept);
+nsecs_t VSyncPredictor::predictionError(nsecs_t timestamp) const {
+    const auto [slope, intercept] = getVSyncPredictionModelLocked();
+
+    // Distance from the timestamp to the closest vsync predicted by the model.
+    const auto zeroPoint = mTimestamps[mOriginIndex] + intercept;
+    nsecs_t error = (timestamp - zeroPoint) % slope;
+    if (error > slope / 2) {
+        error -= slope;
+    } else if (error < -slope / 2) {
+        error += slope;
+    }
+    return error;
+}
+
+bool VSyncPredictor::fitsModel(nsecs_t timestamp) const {
+    if (mTimestamps.size() < kMinimumSamplesForPrediction) {
+        return true;
+    }
+
+    // validate() only compares against the last timestamp, which lets a timestamp that is out of
+    // phase with the others through if it is older than the last one. Compare against the model
+    // instead, so that such an outlier does not skew the regression.
+    const auto slope = getVSyncPredictionModelLocked().slope;
+    const auto error = predictionError(timestamp);
+    if (std::abs(error) * kMaxPercent >= static_cast<nsecs_t>(kOutlierTolerancePercent) * slope) {
+        SFTRACE_FORMAT_INSTANT("timestamp not aligned with model. error=%.2fms", error / 1e6f);
+        return false;
+    }
     return true;
 }
 
+void VSyncPredictor::recordPredictionError(nsecs_t error) {
+    constexpr double kWeight = 1.0 / 16;
+    const double squaredError = static_cast<double>(error) * static_cast<double>(error);
+    mPredictionErrorVariance = mPredictionErrorSamples == 0
+            ? squaredError
+            : mPredictionErrorVariance + kWeight * (squaredError - mPredictionErrorVariance);
+    mPredictionErrorSamples++;
+}
+
+Duration VSyncPredictor::predictionConfidenceInterval() const {
+    std::lock_guard lock(mMutex);
+    if (mPredictionErrorSamples == 0) {
+        return Duration::fromNs(0);
+    }
+    return Duration::fromNs(static_cast<nsecs_t>(2 * std::sqrt(mPredictionErrorVariance)));
+}
+
 nsecs_t VSyncPredictor::snapToVsync(nsecs_t timePoint) const {
     auto const [slope, intercept] = getVSyncPredictionModelLocked();
 
@@ -278,7 +537,7 @@ nsecs_t VSyncPredictor::snapToVsync(nsecs_t timePoint) const {
         return knownTimestamp + numPeriodsOut * idealPeriod();
     }
 
-    auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest = mTimestamps[mOriginIndex];
 
     // See b/145667109, the ordinal calculation must take into account the intercept.
     auto const zeroPoint = oldest + intercept;
@@ -581,9 +840,15 @@ void VSyncPredictor::clearTimestamps(bool clearTimelines) {
         }
 
         mTimestamps.clear();
+        mOrdinals.clear();
         mLastTimestampIndex = 0;
+        mOriginIndex = 0;
+        mRegressionSums = {};
     }
 
+    mPredictionErrorVariance = 0;
+    mPredictionErrorSamples = 0;
+
     mIdealPeriod = Period::fromNs(idealPeriod());
     if (mTimelines.empty()) {
         mLastCommittedVsync = TimePoint::fromNs(0);
@@ -626,6 +891,8 @@ void VSyncPredictor::dump(std::string& result) const {
                       periodInterceptTuple.intercept);
     }
     StringAppendF(&result, "\tmTimelines.size()=%zu\n", mTimelines.size());
+    StringAppendF(&result, "\tPrediction error: %.2fms (2 sigma over %zu samples)\n",
+                  2 * std::sqrt(mPredictionErrorVariance) / 1e6, mPredictionErrorSamples);
 }
 
 void VSyncPredictor::purgeTimelines(android::TimePoint now) {
@@ -58,6 +58,8 @@ public:
      */
     bool needsMoreSamples() const final EXCLUDES(mMutex);
 
+    Duration predictionConfidenceInterval() const final EXCLUDES(mMutex);
+
     struct Model {
         nsecs_t slope;
         nsecs_t intercept;
@@ -125,9 +127,32 @@ private:
         std::optional<VsyncSequence> mLastVsyncSequence;
     };
 
+    // Running sums of the least-squares fit of timestamps over vsync ordinals. Both are relative
+    // to an origin that is moved to the mean of the samples after each update, so the sums stay
+    // centered and keep their headroom against overflow.
+    struct RegressionSums {
+        nsecs_t originTimestamp = 0;
+        int64_t originOrdinal = 0;
+        int64_t count = 0;
+        nsecs_t timestamps = 0;
+        int64_t ordinals = 0;
+        int64_t timestampOrdinalProducts = 0;
+        int64_t squaredOrdinals = 0;
+    };
+
     VSyncPredictor(VSyncPredictor const&) = delete;
     VSyncPredictor& operator=(VSyncPredictor const&) = delete;
     void clearTimestamps(bool clearTimelines) REQUIRES(mMutex);
+    void insertTimestamp(nsecs_t timestamp) REQUIRES(mMutex);
+    int64_t ordinalOf(nsecs_t timestamp, nsecs_t period) const REQUIRES(mMutex);
+    void accumulateSample(size_t index, int64_t sign) REQUIRES(mMutex);
+    void centerRegression() REQUIRES(mMutex);
+    void rebuildRegression() REQUIRES(mMutex);
+    std::optional<Model> leastSquaresModel() const REQUIRES(mMutex);
+    std::optional<bool> rejectOutliers() REQUIRES(mMutex);
+    nsecs_t predictionError(nsecs_t timestamp) const REQUIRES(mMutex);
+    bool fitsModel(nsecs_t timestamp) const REQUIRES(mMutex);
+    void recordPredictionError(nsecs_t error) REQUIRES(mMutex);
 
     const std::unique_ptr<Clock> mClock;
     const PhysicalDisplayId mId;
@@ -159,6 +184,18 @@ private:
     size_t mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
 
+    // The vsync ordinal of each entry in mTimestamps, assigned when the timestamp is added. They
+    // are all assigned again once the modelled period drifts away from mOrdinalPeriod.
+    std::vector<int64_t> mOrdinals GUARDED_BY(mMutex);
+    nsecs_t mOrdinalPeriod GUARDED_BY(mMutex) = 0;
+    // The index of the oldest timestamp in mTimestamps.
+    size_t mOriginIndex GUARDED_BY(mMutex) = 0;
+    RegressionSums mRegressionSums GUARDED_BY(mMutex);
+
+    // Exponentially weighted mean of the squared error of predictions against new timestamps.
+    double mPredictionErrorVariance GUARDED_BY(mMutex) = 0;
+    size_t mPredictionErrorSamples GUARDED_BY(mMutex) = 0;
+
     ftl::NonNull<DisplayModePtr> mDisplayModePtr GUARDED_BY(mMutex);
     int mNumVsyncsForFrame GUARDED_BY(mMutex);
 
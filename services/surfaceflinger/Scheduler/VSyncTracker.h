@@ -82,6 +82,14 @@ public:
 
     virtual bool needsMoreSamples() const = 0;
 
+    /*
+     * The half-width of the interval around predicted vsyncs that recent vsync timestamps fell
+     * within, i.e. two standard deviations of the prediction error.
+     *
+     * \return  The confidence interval, or zero if the model has not been built yet.
+     */
+    virtual Duration predictionConfidenceInterval() const = 0;
+
     /*
      * Checks if a vsync timestamp is in phase for a frame rate
      *
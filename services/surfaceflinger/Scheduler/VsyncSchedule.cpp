@@ -57,11 +57,12 @@ private:
 };
 
 VsyncSchedule::VsyncSchedule(ftl::NonNull<DisplayModePtr> modePtr, FeatureFlags features,
+                             std::chrono::nanoseconds groupDispatchWithin,
                              RequestHardwareVsync requestHardwareVsync)
       : mId(modePtr->getPhysicalDisplayId()),
         mRequestHardwareVsync(std::move(requestHardwareVsync)),
         mTracker(createTracker(modePtr)),
-        mDispatch(createDispatch(mTracker)),
+        mDispatch(createDispatch(mTracker, groupDispatchWithin)),
         mController(createController(modePtr->getPhysicalDisplayId(), *mTracker, features)),
         mTracer(features.test(Feature::kTracePredictedVsync)
                         ? std::make_unique<PredictedVsyncTracer>(mDispatch)
@@ -88,6 +89,10 @@ Period VsyncSchedule::minFramePeriod() const {
     return period();
 }
 
+Duration VsyncSchedule::predictionConfidenceInterval() const {
+    return mTracker->predictionConfidenceInterval();
+}
+
 TimePoint VsyncSchedule::vsyncDeadlineAfter(TimePoint timePoint,
                                             ftl::Optional<TimePoint> lastVsyncOpt) const {
     return TimePoint::fromNs(
@@ -107,6 +112,9 @@ void VsyncSchedule::dump(std::string& out) const {
         dumper.eol();
     }
 
+    dumper.dump("predictionConfidenceInterval",
+                std::to_string(predictionConfidenceInterval().ns()) + "ns");
+
     out.append("VsyncController:\n");
     mController->dump(out);
 
@@ -124,15 +132,15 @@ VsyncSchedule::TrackerPtr VsyncSchedule::createTracker(ftl::NonNull<DisplayModeP
                                             kMinSamplesForPrediction, kDiscardOutlierPercent);
 }
 
-VsyncSchedule::DispatchPtr VsyncSchedule::createDispatch(TrackerPtr tracker) {
+VsyncSchedule::DispatchPtr VsyncSchedule::createDispatch(
+        TrackerPtr tracker, std::chrono::nanoseconds groupDispatchWithin) {
     using namespace std::chrono_literals;
 
     // TODO(b/144707443): Tune constants.
-    constexpr std::chrono::nanoseconds kGroupDispatchWithin = 500us;
     constexpr std::chrono::nanoseconds kSnapToSameVsyncWithin = 3ms;
 
     return std::make_unique<VSyncDispatchTimerQueue>(std::make_unique<Timer>(), std::move(tracker),
-                                                     kGroupDispatchWithin.count(),
+                                                     groupDispatchWithin.count(),
                                                      kSnapToSameVsyncWithin.count());
 }
 
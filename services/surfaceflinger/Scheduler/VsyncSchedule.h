@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
@@ -57,7 +58,9 @@ class VsyncSchedule final : public IVsyncSource {
 public:
     using RequestHardwareVsync = std::function<void(PhysicalDisplayId, bool enabled)>;
 
-    VsyncSchedule(ftl::NonNull<DisplayModePtr> modePtr, FeatureFlags, RequestHardwareVsync);
+    // groupDispatchWithin is how close together callbacks have to be to share a timer wakeup.
+    VsyncSchedule(ftl::NonNull<DisplayModePtr> modePtr, FeatureFlags,
+                  std::chrono::nanoseconds groupDispatchWithin, RequestHardwareVsync);
     ~VsyncSchedule();
 
     // IVsyncSource overrides:
@@ -80,6 +83,10 @@ public:
     // hardware VSYNCs depending on whether more samples are needed.
     bool addResyncSample(TimePoint timestamp, ftl::Optional<Period> hwcVsyncPeriod);
 
+    // The half-width of the interval around predicted VSYNCs that hardware VSYNCs have recently
+    // fallen within, or zero if the tracker has not built its model yet.
+    Duration predictionConfidenceInterval() const;
+
     // TODO(b/185535769): Hide behind API.
     VsyncTracker& getTracker() const { return *mTracker; }
     VsyncTracker& getTracker() { return *mTracker; }
@@ -130,7 +137,7 @@ private:
     friend class android::fuzz::SchedulerFuzzer;
 
     static TrackerPtr createTracker(ftl::NonNull<DisplayModePtr> modePtr);
-    static DispatchPtr createDispatch(TrackerPtr);
+    static DispatchPtr createDispatch(TrackerPtr, std::chrono::nanoseconds groupDispatchWithin);
     static ControllerPtr createController(PhysicalDisplayId, VsyncTracker&, FeatureFlags);
 
     void enableHardwareVsyncLocked() REQUIRES(mHwVsyncLock);
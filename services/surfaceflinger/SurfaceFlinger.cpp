@@ -259,6 +259,13 @@ std::chrono::milliseconds getIdleTimerTimeout(PhysicalDisplayId displayId) {
     return std::chrono::milliseconds(millis);
 }
 
+std::chrono::microseconds getVsyncGroupDispatchWithin() {
+    constexpr int32_t kDefaultUs = 500;
+    const int32_t debugUs = base::GetIntProperty("debug.sf.vsync_group_dispatch_within_us"s, -1);
+    return std::chrono::microseconds(
+            debugUs >= 0 ? debugUs : sysprop::vsync_group_dispatch_within_us(kDefaultUs));
+}
+
 bool getKernelIdleTimerSyspropConfig(PhysicalDisplayId displayId) {
     const bool displaySupportKernelIdleTimer =
             base::GetBoolProperty("debug.sf.support_kernel_idle_timer_"s +
@@ -4498,7 +4505,8 @@ void SurfaceFlinger::initScheduler(const sp<const DisplayDevice>& display) {
 
     mScheduler = std::make_unique<Scheduler>(static_cast<ICompositor&>(*this),
                                              static_cast<ISchedulerCallback&>(*this), features,
-                                             getFactory(), activeRefreshRate, *mTimeStats);
+                                             getFactory(), activeRefreshRate, *mTimeStats,
+                                             getVsyncGroupDispatchWithin());
 
     // The pacesetter must be registered before EventThread creation below.
     mScheduler->registerDisplay(display->getPhysicalId(), display->holdRefreshRateSelector(),
@@ -4912,9 +4920,8 @@ status_t SurfaceFlinger::setTransactionState(
 
     std::vector<uint64_t> uncacheBufferIds;
     uncacheBufferIds.reserve(uncacheBuffers.size());
-    for (const auto& uncacheBuffer : uncacheBuffers) {
-        sp<GraphicBuffer> buffer = ClientCache::getInstance().erase(uncacheBuffer);
-        if (buffer != nullptr) {
+    if (!uncacheBuffers.empty()) {
+        for (const auto& buffer : ClientCache::getInstance().erase(uncacheBuffers)) {
             uncacheBufferIds.push_back(buffer->getId());
         }
     }
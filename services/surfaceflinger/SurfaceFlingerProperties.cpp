@@ -375,5 +375,9 @@ int32_t game_default_frame_rate_override(int32_t defaultValue) {
     return SurfaceFlingerProperties::game_default_frame_rate_override().value_or(defaultValue);
 }
 
+int32_t vsync_group_dispatch_within_us(int32_t defaultValue) {
+    return SurfaceFlingerProperties::vsync_group_dispatch_within_us().value_or(defaultValue);
+}
+
 } // namespace sysprop
 } // namespace android
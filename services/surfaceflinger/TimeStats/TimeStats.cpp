@@ -21,6 +21,7 @@
 #include <android-base/stringprintf.h>
 #include <common/trace.h>
 #include <log/log.h>
+#include <pthread.h>
 #include <timestatsatomsproto/TimeStatsAtomsProtoHeader.h>
 #include <utils/String8.h>
 #include <utils/Timers.h>
@@ -29,6 +30,7 @@
 #include <chrono>
 #include <cmath>
 #include <unordered_map>
+#include <utility>
 
 #include "TimeStats.h"
 #include "timestatsproto/TimeStatsHelper.h"
@@ -92,26 +94,51 @@ SurfaceflingerStatsLayerInfo_SetFrameRateVote frameRateVoteToProto(
 } // namespace
 
 bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    // The global stats without the layer stats, taken so that the atoms are built unlocked.
+    TimeStatsHelper::TimeStatsGlobal globalStats;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        aggregatePendingStatsLocked();
 
-    if (mTimeStats.statsStartLegacy == 0) {
-        return false;
+        if (mTimeStats.statsStartLegacy == 0) {
+            return false;
+        }
+        flushPowerTimeLocked();
+
+        // clearGlobalLocked() resets everything that is moved out.
+        globalStats.totalFramesLegacy = mTimeStats.totalFramesLegacy;
+        globalStats.missedFramesLegacy = mTimeStats.missedFramesLegacy;
+        globalStats.clientCompositionFramesLegacy = mTimeStats.clientCompositionFramesLegacy;
+        globalStats.displayOnTimeLegacy = mTimeStats.displayOnTimeLegacy;
+        globalStats.presentToPresentLegacy = std::move(mTimeStats.presentToPresentLegacy);
+        globalStats.frameDurationLegacy = std::move(mTimeStats.frameDurationLegacy);
+        globalStats.renderEngineTimingLegacy = std::move(mTimeStats.renderEngineTimingLegacy);
+        for (auto& [key, timelineStats] : mTimeStats.stats) {
+            TimeStatsHelper::TimelineStats& stats = globalStats.stats[key];
+            stats.key = key;
+            stats.jankPayload = timelineStats.jankPayload;
+            stats.displayDeadlineDeltas = std::move(timelineStats.displayDeadlineDeltas);
+            stats.displayPresentDeltas = std::move(timelineStats.displayPresentDeltas);
+        }
+
+        // Always clear data.
+        clearGlobalLocked();
     }
-    flushPowerTimeLocked();
+
     SurfaceflingerStatsGlobalInfoWrapper atomList;
-    for (const auto& globalSlice : mTimeStats.stats) {
+    for (const auto& globalSlice : globalStats.stats) {
         SurfaceflingerStatsGlobalInfo* atom = atomList.add_atom();
-        atom->set_total_frames(mTimeStats.totalFramesLegacy);
-        atom->set_missed_frames(mTimeStats.missedFramesLegacy);
-        atom->set_client_composition_frames(mTimeStats.clientCompositionFramesLegacy);
-        atom->set_display_on_millis(mTimeStats.displayOnTimeLegacy);
-        atom->set_animation_millis(mTimeStats.presentToPresentLegacy.totalTime());
+        atom->set_total_frames(globalStats.totalFramesLegacy);
+        atom->set_missed_frames(globalStats.missedFramesLegacy);
+        atom->set_client_composition_frames(globalStats.clientCompositionFramesLegacy);
+        atom->set_display_on_millis(globalStats.displayOnTimeLegacy);
+        atom->set_animation_millis(globalStats.presentToPresentLegacy.totalTime());
         // Deprecated
         atom->set_event_connection_count(0);
         *atom->mutable_frame_duration() =
-                histogramToProto(mTimeStats.frameDurationLegacy.hist, mMaxPulledHistogramBuckets);
+                histogramToProto(globalStats.frameDurationLegacy.hist, mMaxPulledHistogramBuckets);
         *atom->mutable_render_engine_timing() =
-                histogramToProto(mTimeStats.renderEngineTimingLegacy.hist,
+                histogramToProto(globalStats.renderEngineTimingLegacy.hist,
                                  mMaxPulledHistogramBuckets);
         atom->set_total_timeline_frames(globalSlice.second.jankPayload.totalFrames);
         atom->set_total_janky_frames(globalSlice.second.jankPayload.totalJankyFrames);
@@ -137,107 +164,114 @@ bool TimeStats::populateGlobalAtom(std::vector<uint8_t>* pulledData) {
         atom->set_render_rate_bucket(globalSlice.first.renderRateBucket);
     }
 
-    // Always clear data.
-    clearGlobalLocked();
-
     pulledData->resize(atomList.ByteSizeLong());
     return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
 }
 
 bool TimeStats::populateLayerAtom(std::vector<uint8_t>* pulledData) {
-    std::lock_guard<std::mutex> lock(mMutex);
+    // The pulled layers, moved out so that the atoms are built unlocked.
+    std::vector<TimeStatsHelper::TimeStatsLayer> layerStats;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        aggregatePendingStatsLocked();
 
-    std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
-    uint32_t numLayers = 0;
-    for (const auto& globalSlice : mTimeStats.stats) {
-        numLayers += globalSlice.second.stats.size();
-    }
+        std::vector<TimeStatsHelper::TimeStatsLayer*> dumpStats;
+        uint32_t numLayers = 0;
+        for (const auto& globalSlice : mTimeStats.stats) {
+            numLayers += globalSlice.second.stats.size();
+        }
 
-    dumpStats.reserve(numLayers);
+        dumpStats.reserve(numLayers);
 
-    for (auto& globalSlice : mTimeStats.stats) {
-        for (auto& layerSlice : globalSlice.second.stats) {
-            dumpStats.push_back(&layerSlice.second);
+        for (auto& globalSlice : mTimeStats.stats) {
+            for (auto& layerSlice : globalSlice.second.stats) {
+                dumpStats.push_back(&layerSlice.second);
+            }
         }
-    }
 
-    std::sort(dumpStats.begin(), dumpStats.end(),
-              [](TimeStatsHelper::TimeStatsLayer const* l,
-                 TimeStatsHelper::TimeStatsLayer const* r) {
-                  return l->totalFrames > r->totalFrames;
-              });
+        std::sort(dumpStats.begin(), dumpStats.end(),
+                  [](TimeStatsHelper::TimeStatsLayer const* l,
+                     TimeStatsHelper::TimeStatsLayer const* r) {
+                      return l->totalFrames > r->totalFrames;
+                  });
 
-    if (mMaxPulledLayers < dumpStats.size()) {
-        dumpStats.resize(mMaxPulledLayers);
+        if (mMaxPulledLayers < dumpStats.size()) {
+            dumpStats.resize(mMaxPulledLayers);
+        }
+
+        layerStats.reserve(dumpStats.size());
+        for (TimeStatsHelper::TimeStatsLayer* layer : dumpStats) {
+            layerStats.push_back(std::move(*layer));
+        }
+
+        // Always clear data.
+        clearLayersLocked();
     }
 
     SurfaceflingerStatsLayerInfoWrapper atomList;
-    for (auto& layer : dumpStats) {
+    for (auto& layer : layerStats) {
         SurfaceflingerStatsLayerInfo* atom = atomList.add_atom();
-        atom->set_layer_name(layer->layerName);
-        atom->set_total_frames(layer->totalFrames);
-        atom->set_dropped_frames(layer->droppedFrames);
-        const auto& present2PresentHist = layer->deltas.find("present2present");
-        if (present2PresentHist != layer->deltas.cend()) {
+        atom->set_layer_name(layer.layerName);
+        atom->set_total_frames(layer.totalFrames);
+        atom->set_dropped_frames(layer.droppedFrames);
+        const auto& present2PresentHist = layer.deltas.find("present2present");
+        if (present2PresentHist != layer.deltas.cend()) {
             *atom->mutable_present_to_present() =
                     histogramToProto(present2PresentHist->second.hist, mMaxPulledHistogramBuckets);
         }
-        const auto& present2PresentDeltaHist = layer->deltas.find("present2presentDelta");
-        if (present2PresentDeltaHist != layer->deltas.cend()) {
+        const auto& present2PresentDeltaHist = layer.deltas.find("present2presentDelta");
+        if (present2PresentDeltaHist != layer.deltas.cend()) {
             *atom->mutable_present_to_present_delta() =
                     histogramToProto(present2PresentDeltaHist->second.hist,
                                      mMaxPulledHistogramBuckets);
         }
-        const auto& post2presentHist = layer->deltas.find("post2present");
-        if (post2presentHist != layer->deltas.cend()) {
+        const auto& post2presentHist = layer.deltas.find("post2present");
+        if (post2presentHist != layer.deltas.cend()) {
             *atom->mutable_post_to_present() =
                     histogramToProto(post2presentHist->second.hist, mMaxPulledHistogramBuckets);
         }
-        const auto& acquire2presentHist = layer->deltas.find("acquire2present");
-        if (acquire2presentHist != layer->deltas.cend()) {
+        const auto& acquire2presentHist = layer.deltas.find("acquire2present");
+        if (acquire2presentHist != layer.deltas.cend()) {
             *atom->mutable_acquire_to_present() =
                     histogramToProto(acquire2presentHist->second.hist, mMaxPulledHistogramBuckets);
         }
-        const auto& latch2presentHist = layer->deltas.find("latch2present");
-        if (latch2presentHist != layer->deltas.cend()) {
+        const auto& latch2presentHist = layer.deltas.find("latch2present");
+        if (latch2presentHist != layer.deltas.cend()) {
             *atom->mutable_latch_to_present() =
                     histogramToProto(latch2presentHist->second.hist, mMaxPulledHistogramBuckets);
         }
-        const auto& desired2presentHist = layer->deltas.find("desired2present");
-        if (desired2presentHist != layer->deltas.cend()) {
+        const auto& desired2presentHist = layer.deltas.find("desired2present");
+        if (desired2presentHist != layer.deltas.cend()) {
             *atom->mutable_desired_to_present() =
                     histogramToProto(desired2presentHist->second.hist, mMaxPulledHistogramBuckets);
         }
-        const auto& post2acquireHist = layer->deltas.find("post2acquire");
-        if (post2acquireHist != layer->deltas.cend()) {
+        const auto& post2acquireHist = layer.deltas.find("post2acquire");
+        if (post2acquireHist != layer.deltas.cend()) {
             *atom->mutable_post_to_acquire() =
                     histogramToProto(post2acquireHist->second.hist, mMaxPulledHistogramBuckets);
         }
 
-        atom->set_late_acquire_frames(layer->lateAcquireFrames);
-        atom->set_bad_desired_present_frames(layer->badDesiredPresentFrames);
-        atom->set_uid(layer->uid);
-        atom->set_total_timeline_frames(layer->jankPayload.totalFrames);
-        atom->set_total_janky_frames(layer->jankPayload.totalJankyFrames);
-        atom->set_total_janky_frames_with_long_cpu(layer->jankPayload.totalSFLongCpu);
-        atom->set_total_janky_frames_with_long_gpu(layer->jankPayload.totalSFLongGpu);
-        atom->set_total_janky_frames_sf_unattributed(layer->jankPayload.totalSFUnattributed);
-        atom->set_total_janky_frames_app_unattributed(layer->jankPayload.totalAppUnattributed);
-        atom->set_total_janky_frames_sf_scheduling(layer->jankPayload.totalSFScheduling);
-        atom->set_total_jank_frames_sf_prediction_error(layer->jankPayload.totalSFPredictionError);
-        atom->set_total_jank_frames_app_buffer_stuffing(layer->jankPayload.totalAppBufferStuffing);
-        atom->set_display_refresh_rate_bucket(layer->displayRefreshRateBucket);
-        atom->set_render_rate_bucket(layer->renderRateBucket);
-        *atom->mutable_set_frame_rate_vote() = frameRateVoteToProto(layer->setFrameRateVote);
+        atom->set_late_acquire_frames(layer.lateAcquireFrames);
+        atom->set_bad_desired_present_frames(layer.badDesiredPresentFrames);
+        atom->set_uid(layer.uid);
+        atom->set_total_timeline_frames(layer.jankPayload.totalFrames);
+        atom->set_total_janky_frames(layer.jankPayload.totalJankyFrames);
+        atom->set_total_janky_frames_with_long_cpu(layer.jankPayload.totalSFLongCpu);
+        atom->set_total_janky_frames_with_long_gpu(layer.jankPayload.totalSFLongGpu);
+        atom->set_total_janky_frames_sf_unattributed(layer.jankPayload.totalSFUnattributed);
+        atom->set_total_janky_frames_app_unattributed(layer.jankPayload.totalAppUnattributed);
+        atom->set_total_janky_frames_sf_scheduling(layer.jankPayload.totalSFScheduling);
+        atom->set_total_jank_frames_sf_prediction_error(layer.jankPayload.totalSFPredictionError);
+        atom->set_total_jank_frames_app_buffer_stuffing(layer.jankPayload.totalAppBufferStuffing);
+        atom->set_display_refresh_rate_bucket(layer.displayRefreshRateBucket);
+        atom->set_render_rate_bucket(layer.renderRateBucket);
+        *atom->mutable_set_frame_rate_vote() = frameRateVoteToProto(layer.setFrameRateVote);
         *atom->mutable_app_deadline_misses() =
-                histogramToProto(layer->deltas["appDeadlineDeltas"].hist,
+                histogramToProto(layer.deltas["appDeadlineDeltas"].hist,
                                  mMaxPulledHistogramBuckets);
-        atom->set_game_mode(gameModeToProto(layer->gameMode));
+        atom->set_game_mode(gameModeToProto(layer.gameMode));
     }
 
-    // Always clear data.
-    clearLayersLocked();
-
     pulledData->resize(atomList.ByteSizeLong());
     return atomList.SerializeToArray(pulledData->data(), atomList.ByteSizeLong());
 }
@@ -253,6 +287,81 @@ TimeStats::TimeStats(std::optional<size_t> maxPulledLayers,
     if (maxPulledHistogramBuckets) {
         mMaxPulledHistogramBuckets = *maxPulledHistogramBuckets;
     }
+
+    mAggregationThread = std::thread(&TimeStats::runAggregationThread, this);
+    pthread_setname_np(mAggregationThread.native_handle(), "TimeStatsAggr");
+}
+
+TimeStats::~TimeStats() {
+    {
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        mStopAggregation = true;
+        mPendingCondition.notify_all();
+    }
+    if (mAggregationThread.joinable()) {
+        mAggregationThread.join();
+    }
+}
+
+void TimeStats::runAggregationThread() {
+    std::unique_lock<std::mutex> lock(mPendingMutex);
+    while (!mStopAggregation) {
+        mPendingCondition.wait_for(lock, kAggregationInterval, [this] {
+            return mStopAggregation || mPendingStats.size() >= kAggregationBatchSize;
+        });
+        if (mStopAggregation || mPendingStats.empty()) continue;
+
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> aggregateLock(mMutex);
+            aggregatePendingStatsLocked();
+        }
+        lock.lock();
+    }
+}
+
+void TimeStats::queuePendingStat(PendingStat&& stat) {
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPendingStats.push_back(std::move(stat));
+    if (mPendingStats.size() == kAggregationBatchSize) {
+        mPendingCondition.notify_one();
+    }
+}
+
+void TimeStats::aggregatePendingStatsLocked() {
+    SFTRACE_CALL();
+
+    PendingCounters counters;
+    {
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        std::swap(mPendingStats, mAggregatingStats);
+        counters = std::exchange(mPendingCounters, {});
+    }
+
+    mTimeStats.totalFramesLegacy += counters.totalFrames;
+    mTimeStats.missedFramesLegacy += counters.missedFrames;
+    mTimeStats.clientCompositionFramesLegacy += counters.clientCompositionFrames;
+    mTimeStats.clientCompositionReusedFramesLegacy += counters.clientCompositionReusedFrames;
+    mTimeStats.compositionStrategyChangesLegacy += counters.compositionStrategyChanges;
+    mTimeStats.compositionStrategyPredictedLegacy += counters.compositionStrategyPredicted;
+    mTimeStats.compositionStrategyPredictionSucceededLegacy +=
+            counters.compositionStrategyPredictionSucceeded;
+    mTimeStats.refreshRateSwitchesLegacy += counters.refreshRateSwitches;
+
+    for (const PendingStat& stat : mAggregatingStats) {
+        if (const auto* sample = std::get_if<LayerSample>(&stat)) {
+            aggregateLayerSampleLocked(*sample);
+        } else if (const auto* info = std::get_if<JankyFramesInfo>(&stat)) {
+            aggregateJankyFramesLocked(*info);
+        } else if (const auto* frameDuration = std::get_if<FrameDurationSample>(&stat)) {
+            mTimeStats.frameDurationLegacy.insert(frameDuration->durationMs);
+        } else if (const auto* renderEngineDuration = std::get_if<RenderEngineDuration>(&stat)) {
+            addRenderEngineDurationLocked(*renderEngineDuration);
+        } else {
+            addGlobalPresentFenceLocked(std::get<GlobalPresentFence>(stat));
+        }
+    }
+    mAggregatingStats.clear();
 }
 
 bool TimeStats::onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) {
@@ -308,8 +417,9 @@ std::string TimeStats::miniDump() {
 
     std::string result = "TimeStats miniDump:\n";
     std::lock_guard<std::mutex> lock(mMutex);
+    aggregatePendingStatsLocked();
     android::base::StringAppendF(&result, "Number of layers currently being tracked is %zu\n",
-                                 mTimeStatsTracker.size());
+                                 mNumLayerRecords.load());
     android::base::StringAppendF(&result, "Number of layers in the stats pool is %zu\n",
                                  mTimeStats.stats.size());
     return result;
@@ -320,8 +430,8 @@ void TimeStats::incrementTotalFrames() {
 
     SFTRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.totalFramesLegacy++;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPendingCounters.totalFrames++;
 }
 
 void TimeStats::incrementMissedFrames() {
@@ -329,8 +439,8 @@ void TimeStats::incrementMissedFrames() {
 
     SFTRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.missedFramesLegacy++;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPendingCounters.missedFrames++;
 }
 
 void TimeStats::pushCompositionStrategyState(const TimeStats::ClientCompositionRecord& record) {
@@ -340,12 +450,12 @@ void TimeStats::pushCompositionStrategyState(const TimeStats::ClientCompositionR
 
     SFTRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (record.changed) mTimeStats.compositionStrategyChangesLegacy++;
-    if (record.hadClientComposition) mTimeStats.clientCompositionFramesLegacy++;
-    if (record.reused) mTimeStats.clientCompositionReusedFramesLegacy++;
-    if (record.predicted) mTimeStats.compositionStrategyPredictedLegacy++;
-    if (record.predictionSucceeded) mTimeStats.compositionStrategyPredictionSucceededLegacy++;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    if (record.changed) mPendingCounters.compositionStrategyChanges++;
+    if (record.hadClientComposition) mPendingCounters.clientCompositionFrames++;
+    if (record.reused) mPendingCounters.clientCompositionReusedFrames++;
+    if (record.predicted) mPendingCounters.compositionStrategyPredicted++;
+    if (record.predictionSucceeded) mPendingCounters.compositionStrategyPredictionSucceeded++;
 }
 
 void TimeStats::incrementRefreshRateSwitches() {
@@ -353,8 +463,8 @@ void TimeStats::incrementRefreshRateSwitches() {
 
     SFTRACE_CALL();
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStats.refreshRateSwitchesLegacy++;
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    mPendingCounters.refreshRateSwitches++;
 }
 
 static int32_t toMs(nsecs_t nanos) {
@@ -372,33 +482,30 @@ static int32_t msBetween(nsecs_t start, nsecs_t end) {
 void TimeStats::recordFrameDuration(nsecs_t startTime, nsecs_t endTime) {
     if (!mEnabled.load()) return;
 
-    std::lock_guard<std::mutex> lock(mMutex);
     if (mPowerTime.powerMode == PowerMode::ON) {
-        mTimeStats.frameDurationLegacy.insert(msBetween(startTime, endTime));
+        queuePendingStat(FrameDurationSample{.durationMs = msBetween(startTime, endTime)});
     }
 }
 
 void TimeStats::recordRenderEngineDuration(nsecs_t startTime, nsecs_t endTime) {
     if (!mEnabled.load()) return;
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (mGlobalRecord.renderEngineDurations.size() == MAX_NUM_TIME_RECORDS) {
-        ALOGE("RenderEngineTimes are already at its maximum size[%zu]", MAX_NUM_TIME_RECORDS);
-        mGlobalRecord.renderEngineDurations.pop_front();
-    }
-    mGlobalRecord.renderEngineDurations.push_back({startTime, endTime});
+    queuePendingStat(RenderEngineDuration{startTime, endTime});
 }
 
 void TimeStats::recordRenderEngineDuration(nsecs_t startTime,
                                            const std::shared_ptr<FenceTime>& endTime) {
     if (!mEnabled.load()) return;
 
-    std::lock_guard<std::mutex> lock(mMutex);
+    queuePendingStat(RenderEngineDuration{startTime, endTime});
+}
+
+void TimeStats::addRenderEngineDurationLocked(const RenderEngineDuration& duration) {
     if (mGlobalRecord.renderEngineDurations.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("RenderEngineTimes are already at its maximum size[%zu]", MAX_NUM_TIME_RECORDS);
         mGlobalRecord.renderEngineDurations.pop_front();
     }
-    mGlobalRecord.renderEngineDurations.push_back({startTime, endTime});
+    mGlobalRecord.renderEngineDurations.push_back(duration);
 }
 
 bool TimeStats::recordReadyLocked(int32_t layerId, TimeRecord* timeRecord) {
@@ -441,14 +548,12 @@ static int32_t clampToNearestBucket(Fps fps, size_t bucketWidth) {
     return std::round(fps.getValue() / bucketWidth) * bucketWidth;
 }
 
-void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
-                                                   std::optional<Fps> renderRate,
-                                                   SetFrameRateVote frameRateVote,
-                                                   GameMode gameMode) {
+void TimeStats::flushAvailableRecordsLocked(int32_t layerId, LayerRecord& layerRecord,
+                                            Fps displayRefreshRate, std::optional<Fps> renderRate,
+                                            SetFrameRateVote frameRateVote, GameMode gameMode) {
     SFTRACE_CALL();
-    ALOGV("[%d]-flushAvailableRecordsToStatsLocked", layerId);
+    ALOGV("[%d]-flushAvailableRecordsLocked", layerId);
 
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
     TimeRecord& prevTimeRecord = layerRecord.prevTimeRecord;
     std::optional<int32_t>& prevPresentToPresentMs = layerRecord.prevPresentToPresentMs;
     std::deque<TimeRecord>& timeRecords = layerRecord.timeRecords;
@@ -463,77 +568,37 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayR
               timeRecords[0].frameTime.frameNumber, timeRecords[0].frameTime.presentTime);
 
         if (prevTimeRecord.ready) {
-            uid_t uid = layerRecord.uid;
-            const std::string& layerName = layerRecord.layerName;
-            TimeStatsHelper::TimelineStatsKey timelineKey = {refreshRateBucket, renderRateBucket};
-            if (!mTimeStats.stats.count(timelineKey)) {
-                mTimeStats.stats[timelineKey].key = timelineKey;
-            }
-
-            TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
-
-            TimeStatsHelper::LayerStatsKey layerKey = {uid, layerName, gameMode};
-            if (!displayStats.stats.count(layerKey)) {
-                displayStats.stats[layerKey].displayRefreshRateBucket = refreshRateBucket;
-                displayStats.stats[layerKey].renderRateBucket = renderRateBucket;
-                displayStats.stats[layerKey].uid = uid;
-                displayStats.stats[layerKey].layerName = layerName;
-                displayStats.stats[layerKey].gameMode = gameMode;
-            }
-            if (frameRateVote.frameRate > 0.0f) {
-                displayStats.stats[layerKey].setFrameRateVote = frameRateVote;
-            }
-            TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
-            timeStatsLayer.totalFrames++;
-            timeStatsLayer.droppedFrames += layerRecord.droppedFrames;
-            timeStatsLayer.lateAcquireFrames += layerRecord.lateAcquireFrames;
-            timeStatsLayer.badDesiredPresentFrames += layerRecord.badDesiredPresentFrames;
-
-            layerRecord.droppedFrames = 0;
-            layerRecord.lateAcquireFrames = 0;
-            layerRecord.badDesiredPresentFrames = 0;
-
-            const int32_t postToAcquireMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.acquireTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToAcquireMs);
-            timeStatsLayer.deltas["post2acquire"].insert(postToAcquireMs);
-
-            const int32_t postToPresentMs = msBetween(timeRecords[0].frameTime.postTime,
-                                                      timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-post2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, postToPresentMs);
-            timeStatsLayer.deltas["post2present"].insert(postToPresentMs);
-
-            const int32_t acquireToPresentMs = msBetween(timeRecords[0].frameTime.acquireTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-acquire2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, acquireToPresentMs);
-            timeStatsLayer.deltas["acquire2present"].insert(acquireToPresentMs);
-
-            const int32_t latchToPresentMs = msBetween(timeRecords[0].frameTime.latchTime,
-                                                       timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-latch2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, latchToPresentMs);
-            timeStatsLayer.deltas["latch2present"].insert(latchToPresentMs);
-
-            const int32_t desiredToPresentMs = msBetween(timeRecords[0].frameTime.desiredTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-desired2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, desiredToPresentMs);
-            timeStatsLayer.deltas["desired2present"].insert(desiredToPresentMs);
-
-            const int32_t presentToPresentMs = msBetween(prevTimeRecord.frameTime.presentTime,
-                                                         timeRecords[0].frameTime.presentTime);
-            ALOGV("[%d]-[%" PRIu64 "]-present2present[%d]", layerId,
-                  timeRecords[0].frameTime.frameNumber, presentToPresentMs);
-            timeStatsLayer.deltas["present2present"].insert(presentToPresentMs);
+            const FrameTime& frameTime = timeRecords[0].frameTime;
+            LayerSample sample = {
+                    .uid = layerRecord.uid,
+                    .layerName = layerRecord.layerName,
+                    .gameMode = gameMode,
+                    .refreshRateBucket = refreshRateBucket,
+                    .renderRateBucket = renderRateBucket,
+                    .frameRateVote = frameRateVote,
+                    .droppedFrames = std::exchange(layerRecord.droppedFrames, 0),
+                    .lateAcquireFrames = std::exchange(layerRecord.lateAcquireFrames, 0),
+                    .badDesiredPresentFrames =
+                            std::exchange(layerRecord.badDesiredPresentFrames, 0),
+                    .postToAcquireMs = msBetween(frameTime.postTime, frameTime.acquireTime),
+                    .postToPresentMs = msBetween(frameTime.postTime, frameTime.presentTime),
+                    .acquireToPresentMs = msBetween(frameTime.acquireTime, frameTime.presentTime),
+                    .latchToPresentMs = msBetween(frameTime.latchTime, frameTime.presentTime),
+                    .desiredToPresentMs = msBetween(frameTime.desiredTime, frameTime.presentTime),
+                    .presentToPresentMs =
+                            msBetween(prevTimeRecord.frameTime.presentTime, frameTime.presentTime),
+            };
+            ALOGV("[%d]-[%" PRIu64 "]-post2acquire[%d]-post2present[%d]-acquire2present[%d]"
+                  "-latch2present[%d]-desired2present[%d]-present2present[%d]",
+                  layerId, frameTime.frameNumber, sample.postToAcquireMs, sample.postToPresentMs,
+                  sample.acquireToPresentMs, sample.latchToPresentMs, sample.desiredToPresentMs,
+                  sample.presentToPresentMs);
             if (prevPresentToPresentMs) {
-                const int32_t presentToPresentDeltaMs =
-                        std::abs(presentToPresentMs - *prevPresentToPresentMs);
-                timeStatsLayer.deltas["present2presentDelta"].insert(presentToPresentDeltaMs);
+                sample.presentToPresentDeltaMs =
+                        std::abs(sample.presentToPresentMs - *prevPresentToPresentMs);
             }
-            prevPresentToPresentMs = presentToPresentMs;
+            prevPresentToPresentMs = sample.presentToPresentMs;
+            queuePendingStat(std::move(sample));
         }
         prevTimeRecord = timeRecords[0];
         timeRecords.pop_front();
@@ -541,6 +606,48 @@ void TimeStats::flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayR
     }
 }
 
+void TimeStats::aggregateLayerSampleLocked(const LayerSample& sample) {
+    const std::string& layerName = *sample.layerName;
+    if (!canAddNewAggregatedStatsLocked(sample.uid, layerName, sample.gameMode)) {
+        return;
+    }
+
+    TimeStatsHelper::TimelineStatsKey timelineKey = {sample.refreshRateBucket,
+                                                     sample.renderRateBucket};
+    if (!mTimeStats.stats.count(timelineKey)) {
+        mTimeStats.stats[timelineKey].key = timelineKey;
+    }
+
+    TimeStatsHelper::TimelineStats& displayStats = mTimeStats.stats[timelineKey];
+
+    TimeStatsHelper::LayerStatsKey layerKey = {sample.uid, layerName, sample.gameMode};
+    if (!displayStats.stats.count(layerKey)) {
+        displayStats.stats[layerKey].displayRefreshRateBucket = sample.refreshRateBucket;
+        displayStats.stats[layerKey].renderRateBucket = sample.renderRateBucket;
+        displayStats.stats[layerKey].uid = sample.uid;
+        displayStats.stats[layerKey].layerName = layerName;
+        displayStats.stats[layerKey].gameMode = sample.gameMode;
+    }
+    if (sample.frameRateVote.frameRate > 0.0f) {
+        displayStats.stats[layerKey].setFrameRateVote = sample.frameRateVote;
+    }
+    TimeStatsHelper::TimeStatsLayer& timeStatsLayer = displayStats.stats[layerKey];
+    timeStatsLayer.totalFrames++;
+    timeStatsLayer.droppedFrames += sample.droppedFrames;
+    timeStatsLayer.lateAcquireFrames += sample.lateAcquireFrames;
+    timeStatsLayer.badDesiredPresentFrames += sample.badDesiredPresentFrames;
+
+    timeStatsLayer.deltas["post2acquire"].insert(sample.postToAcquireMs);
+    timeStatsLayer.deltas["post2present"].insert(sample.postToPresentMs);
+    timeStatsLayer.deltas["acquire2present"].insert(sample.acquireToPresentMs);
+    timeStatsLayer.deltas["latch2present"].insert(sample.latchToPresentMs);
+    timeStatsLayer.deltas["desired2present"].insert(sample.desiredToPresentMs);
+    timeStatsLayer.deltas["present2present"].insert(sample.presentToPresentMs);
+    if (sample.presentToPresentDeltaMs) {
+        timeStatsLayer.deltas["present2presentDelta"].insert(*sample.presentToPresentDeltaMs);
+    }
+}
+
 static constexpr const char* kPopupWindowPrefix = "PopupWindow";
 static const size_t kMinLenLayerName = std::strlen(kPopupWindowPrefix);
 
@@ -550,8 +657,8 @@ static bool layerNameIsValid(const std::string& layerName) {
             layerName.compare(0, kMinLenLayerName, kPopupWindowPrefix) != 0;
 }
 
-bool TimeStats::canAddNewAggregatedStats(uid_t uid, const std::string& layerName,
-                                         GameMode gameMode) {
+bool TimeStats::canAddNewAggregatedStatsLocked(uid_t uid, const std::string& layerName,
+                                               GameMode gameMode) {
     uint32_t layerRecords = 0;
     for (const auto& record : mTimeStats.stats) {
         if (record.second.stats.count({uid, layerName, gameMode}) > 0) {
@@ -572,22 +679,23 @@ void TimeStats::setPostTime(int32_t layerId, uint64_t frameNumber, const std::st
     ALOGV("[%d]-[%" PRIu64 "]-[%s]-PostTime[%" PRId64 "]", layerId, frameNumber, layerName.c_str(),
           postTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!canAddNewAggregatedStats(uid, layerName, gameMode)) {
-        return;
-    }
-    if (!mTimeStatsTracker.count(layerId) && mTimeStatsTracker.size() < MAX_NUM_LAYER_RECORDS &&
-        layerNameIsValid(layerName)) {
-        mTimeStatsTracker[layerId].uid = uid;
-        mTimeStatsTracker[layerId].layerName = layerName;
-        mTimeStatsTracker[layerId].gameMode = gameMode;
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) {
+        if (mNumLayerRecords.load() >= MAX_NUM_LAYER_RECORDS || !layerNameIsValid(layerName)) {
+            return;
+        }
+        shard.layers[layerId].uid = uid;
+        shard.layers[layerId].layerName = std::make_shared<const std::string>(layerName);
+        shard.layers[layerId].gameMode = gameMode;
+        mNumLayerRecords++;
     }
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.timeRecords.size() == MAX_NUM_TIME_RECORDS) {
         ALOGE("[%d]-[%s]-timeRecords is at its maximum size[%zu]. Ignore this when unittesting.",
-              layerId, layerRecord.layerName.c_str(), MAX_NUM_TIME_RECORDS);
-        mTimeStatsTracker.erase(layerId);
+              layerId, layerRecord.layerName->c_str(), MAX_NUM_TIME_RECORDS);
+        shard.layers.erase(layerId);
+        mNumLayerRecords--;
         return;
     }
     // For most media content, the acquireFence is invalid because the buffer is
@@ -615,9 +723,10 @@ void TimeStats::setLatchTime(int32_t layerId, uint64_t frameNumber, nsecs_t latc
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-LatchTime[%" PRId64 "]", layerId, frameNumber, latchTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -634,9 +743,10 @@ void TimeStats::incrementLatchSkipped(int32_t layerId, LatchSkipReason reason) {
     ALOGV("[%d]-LatchSkipped-Reason[%d]", layerId,
           static_cast<std::underlying_type<LatchSkipReason>::type>(reason));
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
 
     switch (reason) {
         case LatchSkipReason::LateAcquire:
@@ -651,9 +761,10 @@ void TimeStats::incrementBadDesiredPresent(int32_t layerId) {
     SFTRACE_CALL();
     ALOGV("[%d]-BadDesiredPresent", layerId);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     layerRecord.badDesiredPresentFrames++;
 }
 
@@ -663,9 +774,10 @@ void TimeStats::setDesiredTime(int32_t layerId, uint64_t frameNumber, nsecs_t de
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-DesiredTime[%" PRId64 "]", layerId, frameNumber, desiredTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -681,9 +793,10 @@ void TimeStats::setAcquireTime(int32_t layerId, uint64_t frameNumber, nsecs_t ac
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-AcquireTime[%" PRId64 "]", layerId, frameNumber, acquireTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -701,9 +814,10 @@ void TimeStats::setAcquireFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-AcquireFenceTime[%" PRId64 "]", layerId, frameNumber,
           acquireFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -721,9 +835,10 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-PresentTime[%" PRId64 "]", layerId, frameNumber, presentTime);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -734,8 +849,8 @@ void TimeStats::setPresentTime(int32_t layerId, uint64_t frameNumber, nsecs_t pr
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    flushAvailableRecordsLocked(layerId, layerRecord, displayRefreshRate, renderRate,
+                                frameRateVote, gameMode);
 }
 
 void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
@@ -748,9 +863,10 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
     ALOGV("[%d]-[%" PRIu64 "]-PresentFenceTime[%" PRId64 "]", layerId, frameNumber,
           presentFence->getSignalTime());
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     if (layerRecord.waitData < 0 ||
         layerRecord.waitData >= static_cast<int32_t>(layerRecord.timeRecords.size()))
         return;
@@ -761,8 +877,8 @@ void TimeStats::setPresentFence(int32_t layerId, uint64_t frameNumber,
         layerRecord.waitData++;
     }
 
-    flushAvailableRecordsToStatsLocked(layerId, displayRefreshRate, renderRate, frameRateVote,
-                                       gameMode);
+    flushAvailableRecordsLocked(layerId, layerRecord, displayRefreshRate, renderRate,
+                                frameRateVote, gameMode);
 }
 
 static const constexpr int32_t kValidJankyReason = JankType::DisplayHAL |
@@ -806,8 +922,10 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
     if (!mEnabled.load()) return;
 
     SFTRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
+    queuePendingStat(info);
+}
 
+void TimeStats::aggregateJankyFramesLocked(const JankyFramesInfo& info) {
     // Only update layer stats if we're already tracking the layer in TimeStats.
     // Otherwise, continue tracking the statistic but use a default layer name instead.
     // As an implementation detail, we do this because this method is expected to be
@@ -863,8 +981,11 @@ void TimeStats::incrementJankyFrames(const JankyFramesInfo& info) {
 void TimeStats::onDestroy(int32_t layerId) {
     SFTRACE_CALL();
     ALOGV("[%d]-onDestroy", layerId);
-    std::lock_guard<std::mutex> lock(mMutex);
-    mTimeStatsTracker.erase(layerId);
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.layers.erase(layerId)) {
+        mNumLayerRecords--;
+    }
 }
 
 void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
@@ -873,9 +994,10 @@ void TimeStats::removeTimeRecord(int32_t layerId, uint64_t frameNumber) {
     SFTRACE_CALL();
     ALOGV("[%d]-[%" PRIu64 "]-removeTimeRecord", layerId, frameNumber);
 
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (!mTimeStatsTracker.count(layerId)) return;
-    LayerRecord& layerRecord = mTimeStatsTracker[layerId];
+    LayerShard& shard = getLayerShard(layerId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (!shard.layers.count(layerId)) return;
+    LayerRecord& layerRecord = shard.layers[layerId];
     size_t removeAt = 0;
     for (const TimeRecord& record : layerRecord.timeRecords) {
         if (record.frameTime.frameNumber == frameNumber) break;
@@ -993,13 +1115,18 @@ void TimeStats::setPresentFenceGlobal(const std::shared_ptr<FenceTime>& presentF
     if (!mEnabled.load()) return;
 
     SFTRACE_CALL();
-    std::lock_guard<std::mutex> lock(mMutex);
-    if (presentFence == nullptr || !presentFence->isValid()) {
+    const bool valid = presentFence != nullptr && presentFence->isValid();
+    queuePendingStat(GlobalPresentFence{.fence = valid ? presentFence : nullptr,
+                                        .displayOn = mPowerTime.powerMode == PowerMode::ON});
+}
+
+void TimeStats::addGlobalPresentFenceLocked(const GlobalPresentFence& presentFence) {
+    if (presentFence.fence == nullptr) {
         mGlobalRecord.prevPresentTime = 0;
         return;
     }
 
-    if (mPowerTime.powerMode != PowerMode::ON) {
+    if (!presentFence.displayOn) {
         // Try flushing the last present fence on PowerMode::ON.
         flushAvailableGlobalRecordsToStatsLocked();
         mGlobalRecord.presentFences.clear();
@@ -1015,7 +1142,7 @@ void TimeStats::setPresentFenceGlobal(const std::shared_ptr<FenceTime>& presentF
         mGlobalRecord.presentFences.pop_front();
     }
 
-    mGlobalRecord.presentFences.emplace_back(presentFence);
+    mGlobalRecord.presentFences.emplace_back(presentFence.fence);
     flushAvailableGlobalRecordsToStatsLocked();
 }
 
@@ -1045,6 +1172,7 @@ void TimeStats::disable() {
 
 void TimeStats::clearAll() {
     std::lock_guard<std::mutex> lock(mMutex);
+    aggregatePendingStatsLocked();
     mTimeStats.stats.clear();
     clearGlobalLocked();
     clearLayersLocked();
@@ -1080,7 +1208,11 @@ void TimeStats::clearGlobalLocked() {
 void TimeStats::clearLayersLocked() {
     SFTRACE_CALL();
 
-    mTimeStatsTracker.clear();
+    for (LayerShard& shard : mLayerShards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        mNumLayerRecords -= shard.layers.size();
+        shard.layers.clear();
+    }
 
     for (auto& globalRecord : mTimeStats.stats) {
         globalRecord.second.stats.clear();
@@ -1096,6 +1228,7 @@ void TimeStats::dump(bool asProto, std::optional<uint32_t> maxLayers, std::strin
     SFTRACE_CALL();
 
     std::lock_guard<std::mutex> lock(mMutex);
+    aggregatePendingStatsLocked();
     if (mTimeStats.statsStartLegacy == 0) {
         return;
     }
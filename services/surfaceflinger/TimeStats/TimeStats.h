@@ -16,12 +16,19 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <thread>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 #include <android/hardware/graphics/composer/2.4/IComposerClient.h>
 #include <gui/JankInfo.h>
@@ -206,7 +213,9 @@ class TimeStats : public android::TimeStats {
 
     struct LayerRecord {
         uid_t uid;
-        std::string layerName;
+        // Shared with the LayerSamples of the layer so that queueing a sample does not copy the
+        // name.
+        std::shared_ptr<const std::string> layerName;
         GameMode gameMode = GameMode::Unsupported;
         // This is the index in timeRecords, at which the timestamps for that
         // specific frame are still not fully received. This is not waiting for
@@ -221,7 +230,8 @@ class TimeStats : public android::TimeStats {
     };
 
     struct PowerTime {
-        PowerMode powerMode = PowerMode::OFF;
+        // Written with mMutex held, and read without it when recording a frame.
+        std::atomic<PowerMode> powerMode = PowerMode::OFF;
         nsecs_t prevTime = 0;
     };
 
@@ -236,11 +246,69 @@ class TimeStats : public android::TimeStats {
         std::deque<RenderEngineDuration> renderEngineDurations;
     };
 
+    // A presented frame of a layer, with the deltas between its timestamps already computed,
+    // waiting to be aggregated into the layer's histograms.
+    struct LayerSample {
+        uid_t uid;
+        std::shared_ptr<const std::string> layerName;
+        GameMode gameMode = GameMode::Unsupported;
+        int32_t refreshRateBucket = 0;
+        int32_t renderRateBucket = 0;
+        SetFrameRateVote frameRateVote;
+        uint32_t droppedFrames = 0;
+        uint32_t lateAcquireFrames = 0;
+        uint32_t badDesiredPresentFrames = 0;
+        int32_t postToAcquireMs = 0;
+        int32_t postToPresentMs = 0;
+        int32_t acquireToPresentMs = 0;
+        int32_t latchToPresentMs = 0;
+        int32_t desiredToPresentMs = 0;
+        int32_t presentToPresentMs = 0;
+        std::optional<int32_t> presentToPresentDeltaMs;
+    };
+
+    // Global counters incremented since the last aggregation.
+    struct PendingCounters {
+        int32_t totalFrames = 0;
+        int32_t missedFrames = 0;
+        int32_t clientCompositionFrames = 0;
+        int32_t clientCompositionReusedFrames = 0;
+        int32_t compositionStrategyChanges = 0;
+        int32_t compositionStrategyPredicted = 0;
+        int32_t compositionStrategyPredictionSucceeded = 0;
+        int32_t refreshRateSwitches = 0;
+    };
+
+    // The duration of a frame composited while the display was on.
+    struct FrameDurationSample {
+        int32_t durationMs = 0;
+    };
+
+    // A display present fence, or nullptr if the fence was invalid.
+    struct GlobalPresentFence {
+        std::shared_ptr<FenceTime> fence;
+        bool displayOn = false;
+    };
+
+    // Pending stats are aggregated in the order they were recorded, as jank is only attributed to
+    // layers that already have stats, and render engine durations are only flushed by a later
+    // present fence.
+    using PendingStat = std::variant<LayerSample, JankyFramesInfo, FrameDurationSample,
+                                     RenderEngineDuration, GlobalPresentFence>;
+
+    // The LayerRecords of a subset of the layers, so that recording the timestamps of a layer only
+    // locks the records of its shard.
+    struct LayerShard {
+        std::mutex mutex;
+        std::unordered_map<int32_t, LayerRecord> layers;
+    };
+
 public:
     TimeStats();
     // For testing only for injecting custom dependencies.
     TimeStats(std::optional<size_t> maxPulledLayers,
               std::optional<size_t> maxPulledHistogramBuckets);
+    ~TimeStats() override;
 
     bool onPullAtom(const int atomId, std::vector<uint8_t>* pulledData) override;
     void parseArgs(bool asProto, const Vector<String16>& args, std::string& result) override;
@@ -292,12 +360,27 @@ private:
     bool populateGlobalAtom(std::vector<uint8_t>* pulledData);
     bool populateLayerAtom(std::vector<uint8_t>* pulledData);
     bool recordReadyLocked(int32_t layerId, TimeRecord* timeRecord);
-    void flushAvailableRecordsToStatsLocked(int32_t layerId, Fps displayRefreshRate,
-                                            std::optional<Fps> renderRate, SetFrameRateVote,
-                                            GameMode);
+    // Queues the presented frames of the layer for aggregation. Requires the lock of the layer's
+    // shard.
+    void flushAvailableRecordsLocked(int32_t layerId, LayerRecord&, Fps displayRefreshRate,
+                                     std::optional<Fps> renderRate, SetFrameRateVote, GameMode);
+    void queuePendingStat(PendingStat&&);
     void flushPowerTimeLocked();
     void flushAvailableGlobalRecordsToStatsLocked();
-    bool canAddNewAggregatedStats(uid_t uid, const std::string& layerName, GameMode);
+    void addRenderEngineDurationLocked(const RenderEngineDuration&);
+    void addGlobalPresentFenceLocked(const GlobalPresentFence&);
+    bool canAddNewAggregatedStatsLocked(uid_t uid, const std::string& layerName, GameMode);
+
+    // Moves the stats recorded since the last aggregation into mTimeStats. Must be called with
+    // mMutex held before reading mTimeStats.
+    void aggregatePendingStatsLocked();
+    void aggregateLayerSampleLocked(const LayerSample&);
+    void aggregateJankyFramesLocked(const JankyFramesInfo&);
+    void runAggregationThread();
+
+    LayerShard& getLayerShard(int32_t layerId) {
+        return mLayerShards[static_cast<uint32_t>(layerId) % kLayerShardCount];
+    }
 
     void enable();
     void disable();
@@ -307,12 +390,32 @@ private:
     void dump(bool asProto, std::optional<uint32_t> maxLayers, std::string& result);
 
     std::atomic<bool> mEnabled = false;
+    // Guards the aggregated stats and the global records. Nothing recorded per frame takes it, so
+    // that a pull from statsd or a dump never blocks the main thread.
     std::mutex mMutex;
     TimeStatsHelper::TimeStatsGlobal mTimeStats;
-    // Hashmap for LayerRecord with layerId as the hash key
-    std::unordered_map<int32_t, LayerRecord> mTimeStatsTracker;
     PowerTime mPowerTime;
     GlobalRecord mGlobalRecord;
+    // The stats being aggregated, swapped with mPendingStats to reuse both buffers.
+    std::vector<PendingStat> mAggregatingStats;
+
+    // LayerRecords sharded by layerId.
+    static constexpr size_t kLayerShardCount = 8;
+    std::array<LayerShard, kLayerShardCount> mLayerShards;
+    std::atomic<size_t> mNumLayerRecords = 0;
+
+    // Stats recorded since the last aggregation. mPendingMutex is only held to queue a stat, and
+    // is taken after mMutex or the lock of a shard.
+    std::mutex mPendingMutex;
+    std::vector<PendingStat> mPendingStats;
+    PendingCounters mPendingCounters;
+    std::condition_variable mPendingCondition;
+    bool mStopAggregation = false;
+    // Aggregates the pending stats once kAggregationBatchSize of them are queued, or every
+    // kAggregationInterval, so that they are not all aggregated at once when statsd pulls.
+    std::thread mAggregationThread;
+    static constexpr size_t kAggregationBatchSize = 256;
+    static constexpr std::chrono::milliseconds kAggregationInterval{500};
 
     static const size_t MAX_NUM_LAYER_RECORDS = 200;
 
@@ -40,6 +40,10 @@ LayerTracing::LayerTracing(std::ostream& outStream) : LayerTracing() {
     mOutStream = std::ref(outStream);
 }
 
+LayerTracing::LayerTracing(OnLayersSnapshotCallback&& onLayersSnapshot) : LayerTracing() {
+    mOnLayersSnapshot = std::move(onLayersSnapshot);
+}
+
 LayerTracing::~LayerTracing() {
     LayerDataSource::UnregisterLayerTracing();
 }
@@ -153,7 +157,9 @@ void LayerTracing::onStop(Mode mode, uint32_t flags, std::function<void()>&& def
 void LayerTracing::addProtoSnapshotToOstream(perfetto::protos::LayersSnapshotProto&& snapshot,
                                              Mode mode) {
     SFTRACE_CALL();
-    if (mOutStream) {
+    if (mOnLayersSnapshot) {
+        mOnLayersSnapshot(std::move(snapshot));
+    } else if (mOutStream) {
         writeSnapshotToStream(std::move(snapshot));
     } else {
         writeSnapshotToPerfetto(snapshot, mode);
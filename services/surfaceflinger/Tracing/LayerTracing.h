@@ -101,6 +101,9 @@ public:
 
     LayerTracing();
     LayerTracing(std::ostream&);
+    // Hands the snapshots to a callback instead of perfetto, e.g. for tools that write them in
+    // another format.
+    explicit LayerTracing(OnLayersSnapshotCallback&&);
     ~LayerTracing();
     void setTakeLayersSnapshotProtoFunction(
             const std::function<void(uint32_t, const OnLayersSnapshotCallback&)>&);
@@ -131,6 +134,7 @@ private:
     std::atomic<uint32_t> mActiveTracingFlags{0};
     std::atomic<std::int64_t> mLastVsyncIdWrittenToPerfetto{-1};
     std::optional<std::reference_wrapper<std::ostream>> mOutStream;
+    OnLayersSnapshotCallback mOnLayersSnapshot;
 };
 
 } // namespace android
@@ -51,6 +51,50 @@ public:
     ~FakeExternalTexture() = default;
 };
 
+TransactionState TransactionProtoParser::copyForTracing(const TransactionState& t) {
+    TransactionState copy;
+    copy.frameTimelineInfo = t.frameTimelineInfo;
+    copy.displays = t.displays;
+    copy.postTime = t.postTime;
+    copy.originPid = t.originPid;
+    copy.originUid = t.originUid;
+    copy.id = t.id;
+    copy.mergedTransactionIds = t.mergedTransactionIds;
+
+    copy.states.reserve(t.states.size());
+    for (const ResolvedComposerState& resolvedState : t.states) {
+        ResolvedComposerState& tracedState = copy.states.emplace_back(resolvedState);
+        const layer_state_t& layer = resolvedState.state;
+
+        // Only keep the buffer properties so that the copy does not hold on to the buffer, its
+        // acquire fence or its release listener until the tracing thread catches up.
+        tracedState.externalTexture = nullptr;
+        tracedState.state.bufferData = nullptr;
+        if ((layer.what & layer_state_t::eBufferChanged) && layer.bufferData) {
+            if (const auto& texture = resolvedState.externalTexture) {
+                tracedState.externalTexture =
+                        std::make_shared<FakeExternalTexture>(texture->getWidth(),
+                                                              texture->getHeight(),
+                                                              texture->getId(),
+                                                              texture->getPixelFormat(),
+                                                              texture->getUsage());
+            }
+            auto bufferData = std::make_shared<BufferData>();
+            bufferData->frameNumber = layer.bufferData->frameNumber;
+            bufferData->flags = layer.bufferData->flags;
+            bufferData->cachedBuffer.id = layer.bufferData->cachedBuffer.id;
+            tracedState.state.bufferData = std::move(bufferData);
+        }
+
+        // The main thread may still edit the window info of the requested state.
+        if ((layer.what & layer_state_t::eInputInfoChanged) && layer.windowInfoHandle) {
+            tracedState.state.windowInfoHandle =
+                    sp<gui::WindowInfoHandle>::make(*layer.windowInfoHandle->getInfo());
+        }
+    }
+    return copy;
+}
+
 perfetto::protos::TransactionState TransactionProtoParser::toProto(const TransactionState& t) {
     perfetto::protos::TransactionState proto;
     proto.set_pid(t.originPid);
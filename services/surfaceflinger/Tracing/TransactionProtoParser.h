@@ -44,6 +44,10 @@ public:
     TransactionProtoParser(std::unique_ptr<FlingerDataMapper> provider)
           : mMapper(std::move(provider)) {}
 
+    // Copies the parts of the transaction that toProto reads, without the buffers and callbacks,
+    // so that the conversion can be deferred to the tracing thread.
+    static TransactionState copyForTracing(const TransactionState&);
+
     perfetto::protos::TransactionState toProto(const TransactionState&);
     perfetto::protos::TransactionState toProto(
             const std::map<uint32_t /* layerId */, TracingLayerState>&);
@@ -23,35 +23,55 @@
 #include <log/log.h>
 #include <utils/Errors.h>
 #include <utils/Timers.h>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <string_view>
 
 namespace android {
 
 class SurfaceFlinger;
 
+// Stores serialized entries back to back in a fixed-size byte arena. Entries are never split
+// across the end of the arena; an entry that does not fit before the end is written at the start
+// and the unused tail is skipped. Evicting the oldest entries only advances the front of the ring,
+// and evicted bytes are handed to the caller in place before they are overwritten.
+//
+// The ring is not thread safe. TransactionTracing only writes to it from the tracing thread.
 template <typename FileProto, typename EntryProto>
 class TransactionRingBuffer {
 public:
     size_t size() const { return mSizeInBytes; }
     size_t used() const { return mUsedInBytes; }
-    size_t frameCount() const { return mStorage.size(); }
-    void setSize(size_t newSize) { mSizeInBytes = newSize; }
-    const std::string& front() const { return mStorage.front(); }
-    const std::string& back() const { return mStorage.back(); }
+    size_t frameCount() const { return mEntries.size(); }
+    void setSize(size_t newSize) {
+        mSizeInBytes = newSize;
+        if (mEntries.empty()) {
+            // The arena is allocated on the next emplace.
+            releaseArena();
+        } else {
+            resizeArena(std::max(newSize, mUsedInBytes + mEntries.size()));
+        }
+    }
+    std::string_view front() const { return view(mEntries.front()); }
+    std::string_view back() const { return view(mEntries.back()); }
 
     void reset() {
         // use the swap trick to make sure memory is released
-        std::deque<std::string>().swap(mStorage);
+        std::deque<Entry>().swap(mEntries);
+        releaseArena();
         mUsedInBytes = 0U;
     }
 
     void writeToProto(FileProto& fileProto) const {
-        fileProto.mutable_entry()->Reserve(static_cast<int>(mStorage.size()) +
+        fileProto.mutable_entry()->Reserve(static_cast<int>(mEntries.size()) +
                                            fileProto.entry().size());
-        for (const std::string& entry : mStorage) {
+        for (const Entry& entry : mEntries) {
             EntryProto* entryProto = fileProto.add_entry();
-            entryProto->ParseFromString(entry);
+            entryProto->ParseFromArray(mArena.get() + entry.offset, static_cast<int>(entry.size));
         }
     }
 
@@ -68,33 +88,34 @@ public:
         return NO_ERROR;
     }
 
-    std::vector<std::string> emplace(std::string&& serializedProto) {
-        std::vector<std::string> replacedEntries;
-        size_t protoSize = static_cast<size_t>(serializedProto.size());
-        while (mUsedInBytes + protoSize > mSizeInBytes) {
-            if (mStorage.empty()) {
-                return {};
-            }
-            mUsedInBytes -= static_cast<size_t>(mStorage.front().size());
-            replacedEntries.emplace_back(mStorage.front());
-            mStorage.pop_front();
+    // Copies the serialized entry into the ring. Invokes `void(std::string_view)` visitor for each
+    // entry evicted to make room, oldest first. The view is only valid during the call.
+    template <typename Visitor>
+    void emplace(std::string_view serializedProto, Visitor&& onEvicted) {
+        if (char* destination = allocate(serializedProto.size(), onEvicted)) {
+            std::memcpy(destination, serializedProto.data(), serializedProto.size());
         }
-        mUsedInBytes += protoSize;
-        mStorage.emplace_back(serializedProto);
-        return replacedEntries;
     }
 
-    std::vector<std::string> emplace(EntryProto&& proto) {
-        std::string serializedProto;
-        proto.SerializeToString(&serializedProto);
-        return emplace(std::move(serializedProto));
+    // Serializes the entry directly into the ring and returns the stored bytes, which are valid
+    // until the next call to emplace, or an empty view if the entry is larger than the ring.
+    template <typename Visitor>
+    std::string_view emplace(const EntryProto& proto, Visitor&& onEvicted) {
+        const size_t protoSize = proto.ByteSizeLong();
+        char* destination = allocate(protoSize, onEvicted);
+        if (!destination) {
+            return {};
+        }
+        proto.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(destination));
+        return {destination, protoSize};
     }
 
     void dump(std::string& result) const {
         std::chrono::milliseconds duration(0);
         if (frameCount() > 0) {
             EntryProto entry;
-            entry.ParseFromString(mStorage.front());
+            const std::string_view bytes = front();
+            entry.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()));
             duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::nanoseconds(systemTime() - entry.elapsed_realtime_nanos()));
         }
@@ -106,9 +127,89 @@ public:
     }
 
 private:
+    struct Entry {
+        size_t offset;
+        size_t size;
+    };
+
+    std::string_view view(const Entry& entry) const {
+        return {mArena.get() + entry.offset, entry.size};
+    }
+
+    // Empty entries still take up a byte of the arena so that they keep their place in the ring.
+    static size_t span(size_t size) { return std::max(size, size_t{1}); }
+
+    bool overlapsFront(size_t offset, size_t size) const {
+        const Entry& front = mEntries.front();
+        return front.offset < offset + size && offset < front.offset + span(front.size);
+    }
+
+    // Returns where to write `size` bytes after evicting the entries in the way, or nullptr if
+    // the entry can never fit.
+    template <typename Visitor>
+    char* allocate(size_t size, Visitor& onEvicted) {
+        if (mArenaSize < mSizeInBytes) {
+            resizeArena(mSizeInBytes);
+        }
+
+        const auto evictFront = [&] {
+            onEvicted(view(mEntries.front()));
+            mUsedInBytes -= mEntries.front().size;
+            mEntries.pop_front();
+        };
+
+        const size_t entrySpan = span(size);
+        if (entrySpan > mSizeInBytes) {
+            while (!mEntries.empty()) {
+                evictFront();
+            }
+            return nullptr;
+        }
+
+        const size_t end =
+                mEntries.empty() ? 0 : mEntries.back().offset + span(mEntries.back().size);
+        size_t offset = end;
+        if (offset + entrySpan > mArenaSize) {
+            // Skip the tail of the arena, evicting the entries that live there.
+            while (!mEntries.empty() && overlapsFront(end, mArenaSize - end)) {
+                evictFront();
+            }
+            offset = 0;
+        }
+        while (!mEntries.empty() &&
+               (mUsedInBytes + size > mSizeInBytes || overlapsFront(offset, entrySpan))) {
+            evictFront();
+        }
+
+        mUsedInBytes += size;
+        mEntries.push_back({offset, size});
+        return mArena.get() + offset;
+    }
+
+    // Moves the live entries to the start of a new arena of the given capacity. The arena is left
+    // uninitialized so that pages are only committed once entries are written to them.
+    void resizeArena(size_t capacity) {
+        std::unique_ptr<char[]> arena(new char[capacity]);
+        size_t offset = 0;
+        for (Entry& entry : mEntries) {
+            std::memcpy(arena.get() + offset, mArena.get() + entry.offset, entry.size);
+            entry.offset = offset;
+            offset += span(entry.size);
+        }
+        mArena = std::move(arena);
+        mArenaSize = capacity;
+    }
+
+    void releaseArena() {
+        mArena.reset();
+        mArenaSize = 0U;
+    }
+
     size_t mUsedInBytes = 0U;
     size_t mSizeInBytes = 0U;
-    std::deque<std::string> mStorage;
+    std::deque<Entry> mEntries;
+    std::unique_ptr<char[]> mArena;
+    size_t mArenaSize = 0U;
 };
 
 } // namespace android
@@ -167,9 +167,8 @@ void TransactionTracing::dump(std::string& result) const {
 }
 
 void TransactionTracing::addQueuedTransaction(const TransactionState& transaction) {
-    perfetto::protos::TransactionState* state =
-            new perfetto::protos::TransactionState(mProtoParser.toProto(transaction));
-    mTransactionQueue.push(state);
+    // Proto conversion is deferred to the tracing thread, off the binder thread.
+    mTransactionQueue.push(new TransactionState(TransactionProtoParser::copyForTracing(transaction)));
 }
 
 void TransactionTracing::addCommittedTransactions(int64_t vsyncId, nsecs_t commitTime,
@@ -229,12 +228,19 @@ void TransactionTracing::loop() {
 void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committedUpdates,
                                   const std::vector<uint32_t>& destroyedLayers) {
     std::scoped_lock lock(mTraceLock);
-    std::vector<std::string> removedEntries;
     perfetto::protos::TransactionTraceEntry entryProto;
+    perfetto::protos::TransactionTraceEntry removedEntryProto;
+    const auto onEntryRemoved = [&](std::string_view removedEntry) {
+        base::ScopedLockAssertion assumeLocked(mTraceLock);
+        removedEntryProto.ParseFromArray(removedEntry.data(),
+                                         static_cast<int>(removedEntry.size()));
+        updateStartingStateLocked(removedEntryProto);
+        removedEntryProto.Clear();
+    };
 
     while (auto incomingTransaction = mTransactionQueue.pop()) {
-        auto transaction = *incomingTransaction;
-        mQueuedTransactions[incomingTransaction->transaction_id()] = transaction;
+        const uint64_t id = incomingTransaction->id;
+        mQueuedTransactions[id] = std::move(*incomingTransaction);
         delete incomingTransaction;
     }
     for (const CommittedUpdates& update : committedUpdates) {
@@ -257,7 +263,7 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
         for (const uint64_t& id : update.transactionIds) {
             auto it = mQueuedTransactions.find(id);
             if (it != mQueuedTransactions.end()) {
-                entryProto.mutable_transactions()->Add(std::move(it->second));
+                entryProto.mutable_transactions()->Add(mProtoParser.toProto(it->second));
                 mQueuedTransactions.erase(it);
             } else {
                 ALOGW("Could not find transaction id %" PRIu64, id);
@@ -280,8 +286,13 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
             }
         }
 
-        std::string serializedProto;
-        entryProto.SerializeToString(&serializedProto);
+        std::string_view serializedProto = mBuffer.emplace(entryProto, onEntryRemoved);
+        std::string oversizedProto;
+        if (serializedProto.empty()) {
+            // The entry does not fit in the ring but active tracing sessions still get it.
+            oversizedProto = entryProto.SerializeAsString();
+            serializedProto = oversizedProto;
+        }
 
         TransactionDataSource::Trace([&](TransactionDataSource::TraceContext context) {
             // In "active" mode write each committed transaction to perfetto.
@@ -304,20 +315,8 @@ void TransactionTracing::addEntry(const std::vector<CommittedUpdates>& committed
             }
         });
 
-        std::vector<std::string> entries = mBuffer.emplace(std::move(serializedProto));
-        removedEntries.reserve(removedEntries.size() + entries.size());
-        removedEntries.insert(removedEntries.end(), std::make_move_iterator(entries.begin()),
-                              std::make_move_iterator(entries.end()));
-
         entryProto.Clear();
     }
-
-    perfetto::protos::TransactionTraceEntry removedEntryProto;
-    for (const std::string& removedEntry : removedEntries) {
-        removedEntryProto.ParseFromString(removedEntry);
-        updateStartingStateLocked(removedEntryProto);
-        removedEntryProto.Clear();
-    }
     mTransactionsAddedToBufferCv.notify_one();
 }
 
@@ -339,7 +338,10 @@ void TransactionTracing::flush() {
                                           [&]() REQUIRES(mTraceLock) {
                                               perfetto::protos::TransactionTraceEntry entry;
                                               if (mBuffer.used() > 0) {
-                                                  entry.ParseFromString(mBuffer.back());
+                                                  const std::string_view back = mBuffer.back();
+                                                  entry.ParseFromArray(back.data(),
+                                                                       static_cast<int>(
+                                                                               back.size()));
                                               }
                                               return mBuffer.used() > 0 &&
                                                       entry.vsync_id() >= mLastUpdatedVsyncId;
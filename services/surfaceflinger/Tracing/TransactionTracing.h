@@ -44,11 +44,12 @@ class TransactionTracingTest;
 /*
  * Records all committed transactions into a ring buffer.
  *
- * Transactions come in via the binder thread. They are serialized to proto
- * and stored in a map using the transaction id as key. Main thread will
- * pass the list of transaction ids that are committed every vsync and notify
- * the tracing thread. The tracing thread will then wake up and add the
- * committed transactions to the ring buffer.
+ * Transactions come in via the binder thread. A copy of the traced fields is
+ * pushed to a lockless stack and later stored in a map using the transaction id
+ * as key. Main thread will pass the list of transaction ids that are committed
+ * every vsync and notify the tracing thread. The tracing thread will then wake
+ * up, convert the committed transactions to proto and serialize them into the
+ * ring buffer.
  *
  * The traced data can then be collected via:
  * - Perfetto (preferred).
@@ -167,9 +168,8 @@ private:
     TransactionRingBuffer<perfetto::protos::TransactionTraceFile,
                           perfetto::protos::TransactionTraceEntry>
             mBuffer GUARDED_BY(mTraceLock);
-    std::unordered_map<uint64_t, perfetto::protos::TransactionState> mQueuedTransactions
-            GUARDED_BY(mTraceLock);
-    LocklessStack<perfetto::protos::TransactionState> mTransactionQueue;
+    std::unordered_map<uint64_t, TransactionState> mQueuedTransactions GUARDED_BY(mTraceLock);
+    LocklessStack<TransactionState> mTransactionQueue;
     nsecs_t mStartingTimestamp GUARDED_BY(mTraceLock);
     std::unordered_map<int, perfetto::protos::LayerCreationArgs> mCreatedLayers
             GUARDED_BY(mTraceLock);
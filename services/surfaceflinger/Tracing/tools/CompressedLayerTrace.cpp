@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "CompressedLayerTrace"
+
+#include "CompressedLayerTrace.h"
+
+#include <log/log.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <iterator>
+#include <string_view>
+
+namespace android {
+
+namespace {
+
+constexpr std::string_view kMagic = "SFLTRCZ1";
+
+// deflate can't compress data more than 1032:1.
+constexpr uint64_t kMaxCompressionRatio = 1032;
+
+enum RecordType : uint64_t {
+    KEYFRAME = 1,
+    DIFF = 2,
+};
+
+class RecordParser {
+public:
+    explicit RecordParser(std::string_view data) : mData(data) {}
+
+    bool done() const { return mPos == mData.size(); }
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (mPos == mData.size()) return false;
+            const auto byte = static_cast<uint8_t>(mData[mPos++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return true;
+        }
+        return false;
+    }
+
+    bool readId(int32_t& id) {
+        uint64_t value;
+        if (!readVarint(value)) return false;
+        id = static_cast<int32_t>(static_cast<uint32_t>(value));
+        return true;
+    }
+
+    bool readBytes(std::string_view& bytes) {
+        uint64_t size;
+        if (!readVarint(size) || size > mData.size() - mPos) return false;
+        bytes = mData.substr(mPos, size);
+        mPos += size;
+        return true;
+    }
+
+private:
+    const std::string_view mData;
+    size_t mPos = 0;
+};
+
+} // namespace
+
+CompressedLayerTraceWriter::CompressedLayerTraceWriter(
+        std::ostream& outStream, const perfetto::protos::LayersTraceFileProto& fileProto,
+        size_t keyframeInterval, size_t chunkSize)
+      : mOutStream(outStream),
+        mKeyframeInterval(std::max<size_t>(keyframeInterval, 1)),
+        mChunkSize(chunkSize) {
+    perfetto::protos::LayersTraceFileProto header = fileProto;
+    header.clear_entry();
+    mFileProto = header.SerializeAsString();
+}
+
+CompressedLayerTraceWriter::~CompressedLayerTraceWriter() {
+    flush();
+}
+
+void CompressedLayerTraceWriter::writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void CompressedLayerTraceWriter::writeBytes(std::string& out, const std::string& bytes) {
+    writeVarint(out, bytes.size());
+    out.append(bytes);
+}
+
+void CompressedLayerTraceWriter::writeFileHeader() {
+    std::string header(kMagic);
+    writeBytes(header, mFileProto);
+    mOutStream.write(header.data(), static_cast<std::streamsize>(header.size()));
+    mBytesWritten += header.size();
+    mWroteFileHeader = true;
+}
+
+void CompressedLayerTraceWriter::addSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot) {
+    // Split the layers from the rest of the snapshot, which changes with every entry anyway.
+    perfetto::protos::LayersProto layers;
+    layers.Swap(snapshot.mutable_layers());
+    snapshot.clear_layers();
+
+    // Every chunk starts with a keyframe so that it can be decoded on its own.
+    const bool keyframe = mChunk.empty() || mSnapshotsSinceKeyframe >= mKeyframeInterval;
+    writeVarint(mChunk, keyframe ? RecordType::KEYFRAME : RecordType::DIFF);
+    writeBytes(mChunk, snapshot.SerializeAsString());
+
+    mLayerOrder.clear();
+    std::unordered_map<int32_t, std::string> currLayers;
+    currLayers.reserve(static_cast<size_t>(layers.layers_size()));
+    std::string changedLayers;
+    size_t changedLayerCount = 0;
+    for (const auto& layer : layers.layers()) {
+        std::string bytes = layer.SerializeAsString();
+        mLayerOrder.push_back(layer.id());
+        const auto prev = mPrevLayers.find(layer.id());
+        if (keyframe || prev == mPrevLayers.end() || prev->second != bytes) {
+            writeVarint(changedLayers, static_cast<uint32_t>(layer.id()));
+            writeBytes(changedLayers, bytes);
+            changedLayerCount++;
+        }
+        currLayers.emplace(layer.id(), std::move(bytes));
+    }
+
+    writeVarint(mChunk, changedLayerCount);
+    mChunk.append(changedLayers);
+
+    if (!keyframe) {
+        std::string removedLayers;
+        size_t removedLayerCount = 0;
+        for (const auto& [id, _] : mPrevLayers) {
+            if (!currLayers.count(id)) {
+                writeVarint(removedLayers, static_cast<uint32_t>(id));
+                removedLayerCount++;
+            }
+        }
+        writeVarint(mChunk, removedLayerCount);
+        mChunk.append(removedLayers);
+
+        // The layers of a keyframe are written in order. Diffs only carry the order when it
+        // changed.
+        const bool orderChanged = mLayerOrder != mPrevLayerOrder;
+        writeVarint(mChunk, orderChanged ? 1 : 0);
+        if (orderChanged) {
+            writeVarint(mChunk, mLayerOrder.size());
+            for (int32_t id : mLayerOrder) {
+                writeVarint(mChunk, static_cast<uint32_t>(id));
+            }
+        }
+    }
+
+    mPrevLayers = std::move(currLayers);
+    std::swap(mPrevLayerOrder, mLayerOrder);
+    mSnapshotsSinceKeyframe = keyframe ? 1 : mSnapshotsSinceKeyframe + 1;
+
+    if (mChunk.size() >= mChunkSize) {
+        flush();
+    }
+}
+
+void CompressedLayerTraceWriter::flush() {
+    if (!mWroteFileHeader) {
+        writeFileHeader();
+    }
+    if (mChunk.empty()) {
+        return;
+    }
+
+    uLongf compressedSize = compressBound(mChunk.size());
+    mCompressedChunk.resize(compressedSize);
+    const int result =
+            compress2(reinterpret_cast<Bytef*>(mCompressedChunk.data()), &compressedSize,
+                      reinterpret_cast<const Bytef*>(mChunk.data()), mChunk.size(), Z_BEST_SPEED);
+    if (result != Z_OK) {
+        ALOGE("Failed to compress layers trace chunk (%d), dropping %zu bytes", result,
+              mChunk.size());
+        mChunk.clear();
+        return;
+    }
+
+    std::string chunkHeader;
+    writeVarint(chunkHeader, mChunk.size());
+    writeVarint(chunkHeader, compressedSize);
+    mOutStream.write(chunkHeader.data(), static_cast<std::streamsize>(chunkHeader.size()));
+    mOutStream.write(mCompressedChunk.data(), static_cast<std::streamsize>(compressedSize));
+    mBytesWritten += chunkHeader.size() + compressedSize;
+    mChunk.clear();
+}
+
+bool CompressedLayerTraceReader::isCompressedTrace(std::istream& inStream) {
+    char magic[kMagic.size()];
+    const auto start = inStream.tellg();
+    inStream.read(magic, static_cast<std::streamsize>(kMagic.size()));
+    const bool isCompressed = inStream.gcount() == static_cast<std::streamsize>(kMagic.size()) &&
+            std::string_view(magic, kMagic.size()) == kMagic;
+    inStream.clear();
+    inStream.seekg(start);
+    return isCompressed;
+}
+
+bool CompressedLayerTraceReader::read(std::istream& inStream,
+                                      perfetto::protos::LayersTraceFileProto& outProto) {
+    const std::string data{std::istreambuf_iterator<char>(inStream),
+                           std::istreambuf_iterator<char>()};
+    if (!std::string_view(data).starts_with(kMagic)) {
+        ALOGE("Not a compressed layers trace");
+        return false;
+    }
+
+    RecordParser file(std::string_view(data).substr(kMagic.size()));
+    std::string_view header;
+    if (!file.readBytes(header) || !outProto.ParseFromArray(header.data(), header.size())) {
+        ALOGE("Failed to parse compressed layers trace header");
+        return false;
+    }
+
+    std::unordered_map<int32_t, std::string> layers;
+    std::vector<int32_t> layerOrder;
+    std::string chunk;
+    while (!file.done()) {
+        uint64_t chunkSize;
+        std::string_view compressedChunk;
+        if (!file.readVarint(chunkSize) || !file.readBytes(compressedChunk)) {
+            ALOGE("Truncated compressed layers trace");
+            return false;
+        }
+        if (chunkSize > kMaxChunkSize ||
+            chunkSize > compressedChunk.size() * kMaxCompressionRatio) {
+            ALOGE("Invalid layers trace chunk size %" PRIu64, chunkSize);
+            return false;
+        }
+        chunk.resize(chunkSize);
+        uLongf uncompressedSize = chunkSize;
+        if (uncompress(reinterpret_cast<Bytef*>(chunk.data()), &uncompressedSize,
+                       reinterpret_cast<const Bytef*>(compressedChunk.data()),
+                       compressedChunk.size()) != Z_OK ||
+            uncompressedSize != chunkSize) {
+            ALOGE("Failed to uncompress layers trace chunk");
+            return false;
+        }
+
+        RecordParser records(chunk);
+        while (!records.done()) {
+            uint64_t type;
+            std::string_view snapshotBytes;
+            uint64_t changedLayerCount;
+            if (!records.readVarint(type) || !records.readBytes(snapshotBytes) ||
+                !records.readVarint(changedLayerCount)) {
+                return false;
+            }
+            if (type == RecordType::KEYFRAME) {
+                layers.clear();
+                layerOrder.clear();
+            } else if (type != RecordType::DIFF) {
+                ALOGE("Unknown layers trace record type %" PRIu64, type);
+                return false;
+            }
+
+            for (uint64_t i = 0; i < changedLayerCount; i++) {
+                int32_t id;
+                std::string_view layerBytes;
+                if (!records.readId(id) || !records.readBytes(layerBytes)) return false;
+                layers[id] = layerBytes;
+                if (type == RecordType::KEYFRAME) {
+                    layerOrder.push_back(id);
+                }
+            }
+
+            if (type == RecordType::DIFF) {
+                uint64_t removedLayerCount;
+                if (!records.readVarint(removedLayerCount)) return false;
+                for (uint64_t i = 0; i < removedLayerCount; i++) {
+                    int32_t id;
+                    if (!records.readId(id)) return false;
+                    layers.erase(id);
+                }
+
+                uint64_t orderChanged;
+                if (!records.readVarint(orderChanged)) return false;
+                if (orderChanged) {
+                    uint64_t layerCount;
+                    if (!records.readVarint(layerCount)) return false;
+                    layerOrder.clear();
+                    for (uint64_t i = 0; i < layerCount; i++) {
+                        int32_t id;
+                        if (!records.readId(id)) return false;
+                        layerOrder.push_back(id);
+                    }
+                }
+            }
+
+            auto* snapshot = outProto.add_entry();
+            if (!snapshot->ParseFromArray(snapshotBytes.data(), snapshotBytes.size())) {
+                return false;
+            }
+            for (int32_t id : layerOrder) {
+                const auto layer = layers.find(id);
+                if (layer == layers.end() ||
+                    !snapshot->mutable_layers()->add_layers()->ParseFromString(layer->second)) {
+                    ALOGE("Missing layer %d in layers trace entry", id);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace android
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <perfetto/trace/android/surfaceflinger_layers.pb.h>
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+/*
+ * Compact on-disk format for layers traces.
+ *
+ * Most layer properties do not change from one snapshot to the next, so instead of a full
+ * LayersSnapshotProto per entry, CompressedLayerTraceWriter writes keyframes holding every layer
+ * and, in between, diffs holding only the layers whose proto changed, the ids of the removed
+ * layers and the layer order when it changed. The records are grouped in chunks that are
+ * compressed with zlib. Every chunk starts with a keyframe, so a chunk can be decoded without the
+ * chunks before it.
+ *
+ * File layout:
+ *   magic "SFLTRCZ1"
+ *   varint length, LayersTraceFileProto without entries
+ *   chunks: varint uncompressed size, varint compressed size, zlib data
+ *
+ * CompressedLayerTraceReader reconstructs the full snapshots, e.g. to convert the file back into
+ * a LayersTraceFileProto that Winscope can open.
+ *
+ * The format is only written by the offline tools, so it lives outside of libsurfaceflinger.
+ * Layers traces recorded on device through perfetto still hold a full LayersSnapshotProto per
+ * entry.
+ */
+class CompressedLayerTraceWriter {
+public:
+    static constexpr size_t kDefaultKeyframeInterval = 100;
+    static constexpr size_t kDefaultChunkSize = 256 * 1024;
+
+    // fileProto holds the trace metadata, see LayerTracing::createTraceFileProto(). Its entries
+    // are ignored.
+    CompressedLayerTraceWriter(std::ostream&,
+                               const perfetto::protos::LayersTraceFileProto& fileProto,
+                               size_t keyframeInterval = kDefaultKeyframeInterval,
+                               size_t chunkSize = kDefaultChunkSize);
+    // Writes the records that are not written yet.
+    ~CompressedLayerTraceWriter();
+
+    void addSnapshot(perfetto::protos::LayersSnapshotProto&& snapshot);
+    // Compresses and writes the current chunk.
+    void flush();
+
+    // Bytes written to the stream so far, including the file header.
+    size_t getBytesWritten() const { return mBytesWritten; }
+
+private:
+    void writeFileHeader();
+    static void writeVarint(std::string& out, uint64_t value);
+    static void writeBytes(std::string& out, const std::string& bytes);
+
+    std::ostream& mOutStream;
+    std::string mFileProto;
+    const size_t mKeyframeInterval;
+    const size_t mChunkSize;
+    bool mWroteFileHeader = false;
+    size_t mBytesWritten = 0;
+    size_t mSnapshotsSinceKeyframe = 0;
+
+    // Uncompressed records of the current chunk.
+    std::string mChunk;
+    std::string mCompressedChunk;
+
+    // Serialized LayerProto of each layer in the previous snapshot, and the layer order.
+    std::unordered_map<int32_t, std::string> mPrevLayers;
+    std::vector<int32_t> mPrevLayerOrder;
+    std::vector<int32_t> mLayerOrder;
+};
+
+class CompressedLayerTraceReader {
+public:
+    // Upper bound of the uncompressed size of a chunk, so that a corrupt header can't make the
+    // reader allocate arbitrary amounts of memory.
+    static constexpr uint64_t kMaxChunkSize = 64 * 1024 * 1024;
+
+    // Returns true if the stream starts with the magic of the compressed format.
+    static bool isCompressedTrace(std::istream&);
+
+    // Reconstructs the snapshots of a trace written by CompressedLayerTraceWriter.
+    static bool read(std::istream&, perfetto::protos::LayersTraceFileProto& outProto);
+};
+
+} // namespace android
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LayerTraceDecompressor"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iostream>
+
+#include "CompressedLayerTrace.h"
+
+using namespace android;
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cout << "Usage: " << argv[0]
+                  << " <compressed-layers-trace-path> <output-layers-trace-path>\n";
+        return -1;
+    }
+
+    const char* inputPath = argv[1];
+    std::ifstream input(inputPath, std::ios::in | std::ios::binary);
+    if (!input) {
+        std::cout << "Error: Could not open " << inputPath << "\n";
+        return -1;
+    }
+    if (!CompressedLayerTraceReader::isCompressedTrace(input)) {
+        std::cout << "Error: " << inputPath << " is not a compressed layers trace\n";
+        return -1;
+    }
+
+    perfetto::protos::LayersTraceFileProto layersTrace;
+    if (!CompressedLayerTraceReader::read(input, layersTrace)) {
+        std::cout << "Error: Failed to read " << inputPath << "\n";
+        return -1;
+    }
+
+    const char* outputPath = argv[2];
+    {
+        std::ofstream output(outputPath, std::ios::binary | std::ios::out);
+        if (!layersTrace.SerializeToOstream(&output)) {
+            std::cout << "Error: Failed to write " << outputPath << "\n";
+            return -1;
+        }
+    }
+    std::cout << "Wrote " << layersTrace.entry_size() << " entries to " << outputPath << "\n";
+
+    // Set output file permissions (-rw-r--r--)
+    const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    if (chmod(outputPath, mode) != 0) {
+        std::cout << "Error: Failed to set permissions of " << outputPath << "\n";
+        return -1;
+    }
+    return 0;
+}
@@ -19,17 +19,20 @@
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include <Tracing/LayerTracing.h>
+#include "CompressedLayerTrace.h"
 #include "LayerTraceGenerator.h"
 
 using namespace android;
 
 int main(int argc, char** argv) {
-    if (argc > 4) {
+    if (argc > 5) {
         std::cout << "Usage: " << argv[0]
-                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]\n";
+                  << " [transaction-trace-path] [output-layers-trace-path] [--last-entry-only]"
+                     " [--compressed]\n";
         return -1;
     }
 
@@ -49,25 +52,45 @@ int main(int argc, char** argv) {
     }
 
     const auto* outputLayersTracePath =
-            (argc == 3) ? argv[2] : "/data/misc/wmtrace/layers_trace.winscope";
+            (argc >= 3) ? argv[2] : "/data/misc/wmtrace/layers_trace.winscope";
     auto outStream = std::ofstream{outputLayersTracePath, std::ios::binary | std::ios::out};
 
-    auto layerTracing = LayerTracing{outStream};
+    bool generateLastEntryOnly = false;
+    bool compressed = false;
+    for (int i = 3; i < argc; i++) {
+        generateLastEntryOnly |= std::string_view(argv[i]) == "--last-entry-only";
+        compressed |= std::string_view(argv[i]) == "--compressed";
+    }
 
-    const bool generateLastEntryOnly =
-            argc >= 4 && std::string_view(argv[3]) == "--last-entry-only";
+    std::unique_ptr<CompressedLayerTraceWriter> compressedWriter;
+    std::unique_ptr<LayerTracing> layerTracing;
+    if (compressed) {
+        compressedWriter =
+                std::make_unique<CompressedLayerTraceWriter>(outStream,
+                                                             LayerTracing::createTraceFileProto());
+        layerTracing = std::make_unique<LayerTracing>(
+                [&](perfetto::protos::LayersSnapshotProto&& snapshot) {
+                    compressedWriter->addSnapshot(std::move(snapshot));
+                });
+    } else {
+        layerTracing = std::make_unique<LayerTracing>(outStream);
+    }
 
     auto traceFlags = LayerTracing::Flag::TRACE_INPUT | LayerTracing::Flag::TRACE_BUFFERS;
 
     ALOGD("Generating %s...", outputLayersTracePath);
     std::cout << "Generating " << outputLayersTracePath << "\n";
 
-    if (!LayerTraceGenerator().generate(transactionTraceFile, traceFlags, layerTracing,
+    if (!LayerTraceGenerator().generate(transactionTraceFile, traceFlags, *layerTracing,
                                         generateLastEntryOnly)) {
         std::cout << "Error: Failed to generate layers trace " << outputLayersTracePath << "\n";
         return -1;
     }
 
+    if (compressedWriter) {
+        compressedWriter->flush();
+    }
+
     // Set output file permissions (-rw-r--r--)
     outStream.close();
     const mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
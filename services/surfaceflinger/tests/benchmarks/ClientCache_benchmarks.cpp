@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures ClientCache lookups from several binder threads at once, with every thread caching
+// buffers for its own client process and with all the threads sharing one client process.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include "ClientCache.h"
+
+namespace android {
+
+namespace {
+
+constexpr uint64_t kBuffersPerClient = 64;
+
+ClientCache& getClientCache() {
+    static renderengine::mock::RenderEngine* sRenderEngine = [] {
+        auto* renderEngine = new testing::NiceMock<renderengine::mock::RenderEngine>();
+        ClientCache::getInstance().setRenderEngine(renderEngine);
+        return renderEngine;
+    }();
+    (void)sRenderEngine;
+    return ClientCache::getInstance();
+}
+
+void addBuffers(const sp<IBinder>& processToken, uint64_t firstId) {
+    for (uint64_t id = firstId; id < firstId + kBuffersPerClient; id++) {
+        getClientCache().add({processToken, id}, sp<GraphicBuffer>::make());
+    }
+}
+
+void lookUpBuffers(benchmark::State& state, const sp<IBinder>& processToken, uint64_t firstId) {
+    uint64_t i = 0;
+    for (auto _ : state) {
+        const client_cache_t cacheId{processToken, firstId + (i++ % kBuffersPerClient)};
+        benchmark::DoNotOptimize(getClientCache().get(cacheId));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void clientCache_get_clientPerThread(benchmark::State& state) {
+    const sp<IBinder> processToken = sp<BBinder>::make();
+    addBuffers(processToken, 0);
+    lookUpBuffers(state, processToken, 0);
+    getClientCache().removeProcess(processToken);
+}
+BENCHMARK(clientCache_get_clientPerThread)->ThreadRange(1, 16)->UseRealTime();
+
+void clientCache_get_sharedClient(benchmark::State& state) {
+    static sp<IBinder> sProcessToken;
+    if (state.thread_index() == 0) {
+        sProcessToken = sp<BBinder>::make();
+        for (int thread = 0; thread < state.threads(); thread++) {
+            addBuffers(sProcessToken, static_cast<uint64_t>(thread) * kBuffersPerClient);
+        }
+    }
+    // The first iteration waits for every thread, so the buffers are cached by then.
+    lookUpBuffers(state, sProcessToken,
+                  static_cast<uint64_t>(state.thread_index()) * kBuffersPerClient);
+    if (state.thread_index() == 0) {
+        getClientCache().removeProcess(sProcessToken);
+        sProcessToken.clear();
+    }
+}
+BENCHMARK(clientCache_get_sharedClient)->ThreadRange(1, 16)->UseRealTime();
+
+} // namespace
+} // namespace android
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the FrameTimeline work SurfaceFlinger does per display frame at 120Hz with 50 layers
+// updating every frame, the same setup FrameTimelineTest uses, and the cost of creating
+// SurfaceFrames from several binder threads at once.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+#include <ui/FenceTime.h>
+
+#include "FrameTimeline/FrameTimeline.h"
+#include "mock/MockTimeStats.h"
+
+namespace android::frametimeline {
+
+namespace {
+
+constexpr Fps kRefreshRate = 120_Hz;
+constexpr size_t kLayerCount = 50;
+constexpr pid_t kSurfaceFlingerPid = 666;
+
+std::unique_ptr<impl::FrameTimeline> createFrameTimeline() {
+    constexpr bool kUseBootTimeClock = true;
+    constexpr bool kFilterFramesBeforeTraceStarts = false;
+    return std::make_unique<impl::FrameTimeline>(std::make_shared<
+                                                         testing::NiceMock<mock::TimeStats>>(),
+                                                 kSurfaceFlingerPid, JankClassificationThresholds{},
+                                                 !kUseBootTimeClock,
+                                                 kFilterFramesBeforeTraceStarts);
+}
+
+std::vector<std::string> createLayerNames() {
+    std::vector<std::string> names;
+    names.reserve(kLayerCount);
+    for (size_t i = 0; i < kLayerCount; i++) {
+        names.push_back("com.example.app/com.example.app.MainActivity#" + std::to_string(i));
+    }
+    return names;
+}
+
+// One display frame in which every layer presents a buffer on time.
+void frameTimeline_120Hz_50Layers(benchmark::State& state) {
+    const auto frameTimeline = createFrameTimeline();
+    auto* tokenManager = frameTimeline->getTokenManager();
+    const auto layerNames = createLayerNames();
+    FenceToFenceTimeMap fenceFactory;
+
+    const nsecs_t period = kRefreshRate.getPeriodNsecs();
+    nsecs_t vsync = 0;
+    for (auto _ : state) {
+        vsync += period;
+        const int64_t appToken =
+                tokenManager->generateTokenForPredictions({vsync - 2 * period, vsync - period,
+                                                           vsync + period});
+        const int64_t sfToken =
+                tokenManager->generateTokenForPredictions({vsync - period / 2, vsync,
+                                                           vsync + period});
+        FrameTimelineInfo info;
+        info.vsyncId = appToken;
+
+        // Binder threads create a SurfaceFrame for each buffer as the transactions come in.
+        std::vector<std::shared_ptr<SurfaceFrame>> surfaceFrames;
+        surfaceFrames.reserve(kLayerCount);
+        for (size_t i = 0; i < kLayerCount; i++) {
+            auto surfaceFrame =
+                    frameTimeline->createSurfaceFrameForToken(info, 10, 10000,
+                                                              static_cast<int32_t>(i),
+                                                              layerNames[i], layerNames[i],
+                                                              /*isBuffer*/ true,
+                                                              GameMode::Unsupported);
+            surfaceFrame->setActualQueueTime(vsync - period);
+            surfaceFrame->setAcquireFenceTime(vsync - period / 2);
+            surfaceFrames.push_back(std::move(surfaceFrame));
+        }
+
+        // The main thread latches the buffers and presents.
+        frameTimeline->setSfWakeUp(sfToken, vsync - period / 2, kRefreshRate, kRefreshRate);
+        for (auto& surfaceFrame : surfaceFrames) {
+            surfaceFrame->setPresentState(SurfaceFrame::PresentState::Presented);
+            frameTimeline->addSurfaceFrame(std::move(surfaceFrame));
+        }
+        auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+        presentFence->signalForTest(vsync + period);
+        frameTimeline->setSfPresent(vsync, presentFence);
+        benchmark::DoNotOptimize(frameTimeline->getPresentFrames().data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(kLayerCount));
+}
+BENCHMARK(frameTimeline_120Hz_50Layers);
+
+// Binder threads creating SurfaceFrames while the vsync thread generates tokens.
+void createSurfaceFrameForToken_contended(benchmark::State& state) {
+    static impl::FrameTimeline* frameTimeline = nullptr;
+    if (state.thread_index() == 0) {
+        frameTimeline = createFrameTimeline().release();
+    }
+    const auto layerNames = createLayerNames();
+    const nsecs_t period = kRefreshRate.getPeriodNsecs();
+
+    size_t iteration = 0;
+    for (auto _ : state) {
+        auto* tokenManager = frameTimeline->getTokenManager();
+        FrameTimelineInfo info;
+        if (state.thread_index() == 0) {
+            const auto vsync = static_cast<nsecs_t>(iteration) * period;
+            info.vsyncId = tokenManager->generateTokenForPredictions({vsync, vsync + period,
+                                                                      vsync + 2 * period});
+        } else {
+            // A token generated a few frames ago, as binder threads usually see.
+            info.vsyncId = static_cast<int64_t>(iteration % 8);
+        }
+        benchmark::DoNotOptimize(
+                frameTimeline->createSurfaceFrameForToken(info, 10, 10000, 0,
+                                                          layerNames[iteration % kLayerCount],
+                                                          layerNames[iteration % kLayerCount],
+                                                          /*isBuffer*/ true,
+                                                          GameMode::Unsupported));
+        iteration++;
+    }
+
+    if (state.thread_index() == 0) {
+        delete frameTimeline;
+        frameTimeline = nullptr;
+    }
+}
+BENCHMARK(createSurfaceFrameForToken_contended)->ThreadRange(1, 8);
+
+} // namespace
+} // namespace android::frametimeline
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost of parceling the layer states of a transaction across binder, as done by
+// ISurfaceComposer::setTransactionState, and reports the parcel size in bytes.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <binder/Parcel.h>
+#include <gui/LayerState.h>
+
+namespace android {
+
+namespace {
+
+// A frame of a window animation: every layer moves, scales and fades, and the window being
+// animated also updates its crop and rounded corners.
+std::vector<ComposerState> createAnimationStates(size_t layerCount) {
+    std::vector<ComposerState> states(layerCount);
+    for (size_t i = 0; i < layerCount; i++) {
+        layer_state_t& state = states[i].state;
+        state.layerId = static_cast<int32_t>(i);
+        state.what = layer_state_t::ePositionChanged | layer_state_t::eMatrixChanged |
+                layer_state_t::eAlphaChanged;
+        state.x = static_cast<float>(i) * 10.f;
+        state.y = static_cast<float>(i) * 20.f;
+        state.matrix = {.dsdx = 0.9f, .dtdx = 0.f, .dtdy = 0.f, .dsdy = 0.9f};
+        state.color.a = 0.8f;
+        if (i == 0) {
+            state.what |= layer_state_t::eCropChanged | layer_state_t::eCornerRadiusChanged;
+            state.crop = FloatRect(0.f, 0.f, 1080.f, 2400.f);
+            state.cornerRadius = 24.f;
+        }
+    }
+    return states;
+}
+
+void writeStates(const std::vector<ComposerState>& states, Parcel& parcel) {
+    parcel.writeUint32(static_cast<uint32_t>(states.size()));
+    for (const ComposerState& state : states) {
+        state.write(parcel);
+    }
+}
+
+void writeLayerStates_animation(benchmark::State& benchState) {
+    const auto states = createAnimationStates(static_cast<size_t>(benchState.range(0)));
+    size_t bytes = 0;
+    for (auto _ : benchState) {
+        Parcel parcel;
+        writeStates(states, parcel);
+        bytes = parcel.dataSize();
+        benchmark::DoNotOptimize(parcel.data());
+    }
+    benchState.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(writeLayerStates_animation)->Arg(1)->Arg(10)->Arg(50);
+
+void readLayerStates_animation(benchmark::State& benchState) {
+    const auto states = createAnimationStates(static_cast<size_t>(benchState.range(0)));
+    Parcel parcel;
+    writeStates(states, parcel);
+
+    for (auto _ : benchState) {
+        parcel.setDataPosition(0);
+        const uint32_t count = parcel.readUint32();
+        for (uint32_t i = 0; i < count; i++) {
+            ComposerState state;
+            state.read(parcel);
+            benchmark::DoNotOptimize(state);
+        }
+    }
+    benchState.counters["bytes"] = static_cast<double>(parcel.dataSize());
+}
+BENCHMARK(readLayerStates_animation)->Arg(1)->Arg(10)->Arg(50);
+
+} // namespace
+} // namespace android
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays the layers snapshots generated from a recorded transaction trace through LayerTracing,
+// and reports the time and the trace bytes per snapshot for the full and the compressed stream
+// formats.
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+#include "Tracing/LayerTracing.h"
+#include "Tracing/tools/CompressedLayerTrace.h"
+#include "Tracing/tools/LayerTraceGenerator.h"
+
+namespace android {
+
+namespace {
+
+const std::vector<perfetto::protos::LayersSnapshotProto>& getRecordedSnapshots() {
+    static const std::vector<perfetto::protos::LayersSnapshotProto> sSnapshots = [] {
+        const std::string path = android::base::GetExecutableDirectory() +
+                "/testdata/transactions_trace_boot.winscope";
+        std::ifstream input(path, std::ios::in | std::ios::binary);
+        perfetto::protos::TransactionTraceFile transactionTrace;
+        if (!transactionTrace.ParseFromIstream(&input)) {
+            return std::vector<perfetto::protos::LayersSnapshotProto>{};
+        }
+
+        std::ostringstream outStream;
+        {
+            LayerTracing layerTracing{outStream};
+            LayerTraceGenerator().generate(transactionTrace,
+                                           LayerTracing::TRACE_INPUT | LayerTracing::TRACE_BUFFERS,
+                                           layerTracing, /*onlyLastEntry=*/false);
+        }
+        perfetto::protos::LayersTraceFileProto layersTrace;
+        layersTrace.ParseFromString(outStream.str());
+        return std::vector<perfetto::protos::LayersSnapshotProto>(layersTrace.entry().begin(),
+                                                                  layersTrace.entry().end());
+    }();
+    return sSnapshots;
+}
+
+void writeRecordedSnapshots(benchmark::State& state, bool compressed) {
+    const auto& recordedSnapshots = getRecordedSnapshots();
+    if (recordedSnapshots.empty()) {
+        state.SkipWithError("Failed to load testdata/transactions_trace_boot.winscope");
+        return;
+    }
+
+    std::ostringstream outStream;
+    std::unique_ptr<CompressedLayerTraceWriter> compressedWriter;
+    std::unique_ptr<LayerTracing> layerTracing;
+    if (compressed) {
+        compressedWriter =
+                std::make_unique<CompressedLayerTraceWriter>(outStream,
+                                                             LayerTracing::createTraceFileProto());
+        layerTracing = std::make_unique<LayerTracing>(
+                [&](perfetto::protos::LayersSnapshotProto&& snapshot) {
+                    compressedWriter->addSnapshot(std::move(snapshot));
+                });
+    } else {
+        layerTracing = std::make_unique<LayerTracing>(outStream);
+    }
+    size_t bytesWritten = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto snapshots = recordedSnapshots;
+        outStream.str({});
+        state.ResumeTiming();
+
+        for (auto& snapshot : snapshots) {
+            layerTracing->addProtoSnapshotToOstream(std::move(snapshot),
+                                                    LayerTracing::Mode::MODE_GENERATED);
+        }
+        if (compressedWriter) {
+            compressedWriter->flush();
+        }
+        bytesWritten += static_cast<size_t>(outStream.tellp());
+    }
+
+    const auto snapshotCount = static_cast<int64_t>(recordedSnapshots.size());
+    state.SetItemsProcessed(state.iterations() * snapshotCount);
+    state.SetBytesProcessed(static_cast<int64_t>(bytesWritten));
+    state.counters["bytes_per_snapshot"] = static_cast<double>(bytesWritten) /
+            static_cast<double>(state.iterations() * snapshotCount);
+}
+
+void layerTracing_recordedWorkload_proto(benchmark::State& state) {
+    writeRecordedSnapshots(state, /*compressed=*/false);
+}
+BENCHMARK(layerTracing_recordedWorkload_proto);
+
+void layerTracing_recordedWorkload_compressed(benchmark::State& state) {
+    writeRecordedSnapshots(state, /*compressed=*/true);
+}
+BENCHMARK(layerTracing_recordedWorkload_compressed);
+
+} // namespace
+} // namespace android
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Scheduler/RefreshRateSelector.h"
+#include "mock/DisplayHardware/MockDisplayMode.h"
+
+namespace android::scheduler {
+
+namespace {
+
+using LayerRequirement = RefreshRateSelector::LayerRequirement;
+using LayerVoteType = RefreshRateSelector::LayerVoteType;
+
+constexpr size_t kLayerCount = 50;
+
+// A VRR panel exposing many vsync rates, each of which can be divided into render rates. With frame
+// rate override enabled this yields well over 100 distinct render rates.
+std::unique_ptr<RefreshRateSelector> createVrrSelector() {
+    DisplayModes modes;
+    for (int32_t i = 0; i < 19; i++) {
+        const auto modeId = DisplayModeId(i);
+        const Fps vsyncRate = Fps::fromValue(60.f + 10.f * static_cast<float>(i));
+        const hal::VrrConfig vrrConfig{.minFrameIntervalNs = vsyncRate.getPeriodNsecs()};
+        modes.try_emplace(modeId, mock::createVrrDisplayMode(modeId, vsyncRate, vrrConfig));
+    }
+
+    return std::make_unique<RefreshRateSelector>(
+            std::move(modes), DisplayModeId(0),
+            RefreshRateSelector::Config{.enableFrameRateOverride = RefreshRateSelector::Config::
+                                                FrameRateOverride::Enabled});
+}
+
+// A mix of the votes seen while an app animates: mostly heuristic and category votes, with a few
+// explicit votes from video and games.
+std::vector<LayerRequirement> createLayers() {
+    std::vector<LayerRequirement> layers;
+    layers.reserve(kLayerCount);
+    for (size_t i = 0; i < kLayerCount; i++) {
+        LayerRequirement layer = {.name = "Layer" + std::to_string(i),
+                                  .ownerUid = static_cast<uid_t>(i % 5),
+                                  .weight = 1.f};
+        switch (i % 5) {
+            case 0:
+                layer.vote = LayerVoteType::Heuristic;
+                layer.desiredRefreshRate = 60_Hz;
+                break;
+            case 1:
+                layer.vote = LayerVoteType::Heuristic;
+                layer.desiredRefreshRate = 30_Hz;
+                break;
+            case 2:
+                layer.vote = LayerVoteType::ExplicitCategory;
+                layer.frameRateCategory = FrameRateCategory::Normal;
+                break;
+            case 3:
+                layer.vote = LayerVoteType::ExplicitExactOrMultiple;
+                layer.desiredRefreshRate = 24_Hz;
+                break;
+            case 4:
+                layer.vote = LayerVoteType::ExplicitDefault;
+                layer.desiredRefreshRate = 90_Hz;
+                break;
+        }
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+// Every call has a different vote signature, so the result is always recomputed.
+void getRankedFrameRates_uncached(benchmark::State& state) {
+    const auto selector = createVrrSelector();
+    auto layers = createLayers();
+
+    size_t iteration = 0;
+    for (auto _ : state) {
+        const float weight = 0.5f + static_cast<float>(iteration % 64) / 128.f;
+        layers[iteration++ % kLayerCount].weight = weight;
+        benchmark::DoNotOptimize(selector->getRankedFrameRates(layers, {}, 120_Hz));
+    }
+}
+BENCHMARK(getRankedFrameRates_uncached);
+
+// Layers alternate between a few vote configurations, as happens during animations, so every call
+// after the first few is served by the cache.
+void getRankedFrameRates_alternatingVotes(benchmark::State& state) {
+    const auto selector = createVrrSelector();
+    std::vector<std::vector<LayerRequirement>> configurations;
+    for (const Fps fps : {60_Hz, 120_Hz, 90_Hz, 30_Hz}) {
+        auto layers = createLayers();
+        layers[0].desiredRefreshRate = fps;
+        configurations.push_back(std::move(layers));
+    }
+
+    size_t iteration = 0;
+    for (auto _ : state) {
+        const auto& layers = configurations[iteration++ % configurations.size()];
+        benchmark::DoNotOptimize(selector->getRankedFrameRates(layers, {}, 120_Hz));
+    }
+}
+BENCHMARK(getRankedFrameRates_alternatingVotes);
+
+} // namespace
+} // namespace android::scheduler
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the TimeStats calls the main thread makes per frame with 100 layers updating every
+// frame, on their own and while statsd pulls the layer atom in a loop.
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <ui/FenceTime.h>
+
+#include "TimeStats/TimeStats.h"
+
+namespace android {
+
+namespace {
+
+constexpr Fps kRefreshRate = 120_Hz;
+constexpr int32_t kLayerCount = 100;
+constexpr uid_t kUid = 10000;
+constexpr int kLayerAtomId = 10063; // SURFACEFLINGER_STATS_LAYER_INFO
+
+std::vector<std::string> createLayerNames() {
+    std::vector<std::string> names;
+    names.reserve(kLayerCount);
+    for (int32_t i = 0; i < kLayerCount; i++) {
+        names.push_back("com.example.app/com.example.app.MainActivity#" + std::to_string(i));
+    }
+    return names;
+}
+
+// Records one frame of every layer, from queueBuffer to present.
+void recordFrame(impl::TimeStats& timeStats, const std::vector<std::string>& layerNames,
+                 uint64_t frameNumber) {
+    const nsecs_t period = kRefreshRate.getPeriodNsecs();
+    const nsecs_t vsync = static_cast<nsecs_t>(frameNumber) * period;
+    for (int32_t layerId = 0; layerId < kLayerCount; layerId++) {
+        timeStats.setPostTime(layerId, frameNumber, layerNames[layerId], kUid, vsync - 2 * period,
+                              GameMode::Unsupported);
+        timeStats.setAcquireFence(layerId, frameNumber,
+                                  std::make_shared<FenceTime>(vsync - period));
+        timeStats.setLatchTime(layerId, frameNumber, vsync - period / 2);
+        timeStats.setDesiredTime(layerId, frameNumber, vsync - period);
+        timeStats.setPresentFence(layerId, frameNumber, std::make_shared<FenceTime>(vsync),
+                                  kRefreshRate, kRefreshRate, {}, GameMode::Unsupported);
+    }
+    timeStats.incrementTotalFrames();
+}
+
+void timeStats_100Layers(benchmark::State& state) {
+    impl::TimeStats timeStats;
+    std::vector<uint8_t> pulledData;
+    // The first pull enables TimeStats.
+    timeStats.onPullAtom(kLayerAtomId, &pulledData);
+    const auto layerNames = createLayerNames();
+
+    uint64_t frameNumber = 0;
+    for (auto _ : state) {
+        recordFrame(timeStats, layerNames, ++frameNumber);
+    }
+    state.SetItemsProcessed(state.iterations() * kLayerCount);
+}
+BENCHMARK(timeStats_100Layers);
+
+void timeStats_100Layers_whilePulling(benchmark::State& state) {
+    impl::TimeStats timeStats;
+    std::vector<uint8_t> pulledData;
+    timeStats.onPullAtom(kLayerAtomId, &pulledData);
+    const auto layerNames = createLayerNames();
+
+    std::atomic<bool> done = false;
+    std::thread pullThread([&] {
+        std::vector<uint8_t> data;
+        while (!done) {
+            timeStats.onPullAtom(kLayerAtomId, &data);
+        }
+    });
+
+    uint64_t frameNumber = 0;
+    for (auto _ : state) {
+        recordFrame(timeStats, layerNames, ++frameNumber);
+    }
+    state.SetItemsProcessed(state.iterations() * kLayerCount);
+
+    done = true;
+    pullThread.join();
+}
+BENCHMARK(timeStats_100Layers_whilePulling);
+
+} // namespace
+} // namespace android
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the cost that transaction tracing adds to each transaction on the binder thread. The
+// tracing off case only builds the transaction, which SurfaceFlinger does regardless of tracing.
+
+#include <memory>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "FrontEnd/Update.h"
+#include "Tracing/TransactionTracing.h"
+
+namespace android {
+
+namespace {
+
+constexpr size_t kLayerCount = 10;
+// Transactions are committed in batches, like once per frame, so that the queue stays bounded.
+constexpr size_t kTransactionsPerCommit = 64;
+
+// A transaction that moves, crops and sets a buffer on several layers.
+TransactionState createTransaction(uint64_t id) {
+    TransactionState transaction;
+    transaction.id = id;
+    transaction.originPid = 1;
+    transaction.originUid = 2;
+    transaction.postTime = static_cast<int64_t>(id);
+    transaction.states.reserve(kLayerCount);
+    for (uint32_t i = 0; i < kLayerCount; i++) {
+        ResolvedComposerState state;
+        state.layerId = i + 1;
+        state.state.what = layer_state_t::ePositionChanged | layer_state_t::eCropChanged |
+                layer_state_t::eAlphaChanged | layer_state_t::eBufferChanged;
+        state.state.x = static_cast<float>(i);
+        state.state.y = static_cast<float>(id);
+        state.state.crop = FloatRect(0.f, 0.f, 100.f, 100.f);
+        state.state.color.a = 0.5f;
+        state.state.bufferData = std::make_shared<BufferData>();
+        state.state.bufferData->frameNumber = id;
+        transaction.states.push_back(std::move(state));
+    }
+    return transaction;
+}
+
+void commit(TransactionTracing& tracing, int64_t vsyncId, std::vector<TransactionState>& batch) {
+    frontend::Update update;
+    update.transactions = std::move(batch);
+    batch.clear();
+    tracing.addCommittedTransactions(vsyncId, 0, update, {}, false);
+    tracing.flush();
+}
+
+void addQueuedTransaction_tracingOff(benchmark::State& state) {
+    uint64_t id = 0;
+    for (auto _ : state) {
+        TransactionState transaction = createTransaction(++id);
+        benchmark::DoNotOptimize(transaction);
+    }
+}
+BENCHMARK(addQueuedTransaction_tracingOff);
+
+void addQueuedTransaction_tracingOn(benchmark::State& state) {
+    TransactionTracing tracing;
+    std::vector<TransactionState> batch;
+    batch.reserve(kTransactionsPerCommit);
+    uint64_t id = 0;
+    int64_t vsyncId = 0;
+    for (auto _ : state) {
+        TransactionState transaction = createTransaction(++id);
+        tracing.addQueuedTransaction(transaction);
+
+        state.PauseTiming();
+        TransactionState committed;
+        committed.id = transaction.id;
+        batch.push_back(std::move(committed));
+        if (batch.size() == kTransactionsPerCommit) {
+            commit(tracing, ++vsyncId, batch);
+        }
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(addQueuedTransaction_tracingOn);
+
+// The proto conversion that addQueuedTransaction used to do on the binder thread, for comparison
+// with addQueuedTransaction_tracingOn.
+void addQueuedTransaction_eagerProto(benchmark::State& state) {
+    TransactionProtoParser parser(std::make_unique<TransactionProtoParser::FlingerDataMapper>());
+    uint64_t id = 0;
+    for (auto _ : state) {
+        TransactionState transaction = createTransaction(++id);
+        benchmark::DoNotOptimize(parser.toProto(transaction));
+    }
+}
+BENCHMARK(addQueuedTransaction_eagerProto);
+
+} // namespace
+} // namespace android
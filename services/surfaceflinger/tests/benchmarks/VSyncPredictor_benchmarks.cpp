@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a hardware vsync trace through VSyncPredictor. Set VSYNC_TRACE to a file with one vsync
+// timestamp in nanoseconds per line, e.g. extracted from the HW_VSYNC counter of a Perfetto trace,
+// and VSYNC_TRACE_PERIOD_NS to the ideal period of the display. A synthetic 60Hz trace with jitter,
+// gaps and late timestamps is replayed otherwise.
+//
+// The time per iteration is the CPU cost of one sample, and the counters report the error of the
+// prediction made before each sample against the sample itself.
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Scheduler/VSyncPredictor.h"
+#include "mock/DisplayHardware/MockDisplayMode.h"
+
+namespace android::scheduler {
+
+namespace {
+
+constexpr size_t kHistorySize = 20;
+constexpr size_t kMinSamplesForPrediction = 6;
+constexpr uint32_t kDiscardOutlierPercent = 20;
+
+class ReplayClock : public Clock {
+public:
+    explicit ReplayClock(const nsecs_t& now) : mNow(now) {}
+    nsecs_t now() const override { return mNow; }
+
+private:
+    const nsecs_t& mNow;
+};
+
+struct Trace {
+    nsecs_t idealPeriod;
+    std::vector<nsecs_t> timestamps;
+};
+
+Trace createSyntheticTrace() {
+    constexpr nsecs_t kIdealPeriod = 16'666'666;
+    constexpr nsecs_t kActualPeriod = 16'683'000;
+    constexpr size_t kSamples = 10'000;
+
+    std::mt19937 random(42);
+    std::normal_distribution<double> jitter(0, 150'000);
+    std::uniform_real_distribution<double> chance(0, 1);
+
+    Trace trace{kIdealPeriod, {}};
+    trace.timestamps.reserve(kSamples);
+    nsecs_t vsync = 1'000'000'000;
+    while (trace.timestamps.size() < kSamples) {
+        // Hardware vsync is turned off for a while once the model has enough samples.
+        vsync += chance(random) < 0.01 ? kActualPeriod * 30 : kActualPeriod;
+
+        nsecs_t timestamp = vsync + static_cast<nsecs_t>(jitter(random));
+        if (chance(random) < 0.005) {
+            // A timestamp that was reported late.
+            timestamp += kActualPeriod * 2 / 5;
+        }
+        trace.timestamps.push_back(timestamp);
+    }
+    return trace;
+}
+
+const Trace& getTrace() {
+    static const Trace trace = [] {
+        const char* path = std::getenv("VSYNC_TRACE");
+        if (!path) {
+            return createSyntheticTrace();
+        }
+
+        const char* period = std::getenv("VSYNC_TRACE_PERIOD_NS");
+        Trace trace{period ? std::atoll(period) : 16'666'666, {}};
+        std::ifstream file(path);
+        for (nsecs_t timestamp; file >> timestamp;) {
+            trace.timestamps.push_back(timestamp);
+        }
+        return trace;
+    }();
+    return trace;
+}
+
+std::unique_ptr<VSyncPredictor> createPredictor(const nsecs_t& now, nsecs_t idealPeriod) {
+    const auto mode = ftl::as_non_null(
+            mock::createDisplayMode(DisplayModeId(0), Fps::fromPeriodNsecs(idealPeriod)));
+    return std::make_unique<VSyncPredictor>(std::make_unique<ReplayClock>(now), mode, kHistorySize,
+                                            kMinSamplesForPrediction, kDiscardOutlierPercent);
+}
+
+void reportPredictionError(benchmark::State& state, const Trace& trace) {
+    nsecs_t now = 0;
+    const auto predictor = createPredictor(now, trace.idealPeriod);
+
+    std::vector<nsecs_t> errors;
+    size_t rejected = 0;
+    for (const nsecs_t timestamp : trace.timestamps) {
+        if (!predictor->needsMoreSamples()) {
+            now = timestamp - trace.idealPeriod / 2;
+            const nsecs_t prediction = predictor->nextAnticipatedVSyncTimeFrom(now);
+            errors.push_back(std::abs(prediction - timestamp));
+        }
+        now = timestamp;
+        rejected += predictor->addVsyncTimestamp(timestamp) ? 0 : 1;
+    }
+
+    if (errors.empty()) {
+        return;
+    }
+
+    std::sort(errors.begin(), errors.end());
+    double total = 0;
+    for (const nsecs_t error : errors) {
+        total += static_cast<double>(error);
+    }
+    state.counters["meanErrorUs"] = total / static_cast<double>(errors.size()) / 1e3;
+    state.counters["p99ErrorUs"] = static_cast<double>(errors[errors.size() * 99 / 100]) / 1e3;
+    state.counters["confidenceIntervalUs"] =
+            static_cast<double>(predictor->predictionConfidenceInterval().ns()) / 1e3;
+    state.counters["rejected"] = static_cast<double>(rejected);
+}
+
+void addVsyncTimestamp_replay(benchmark::State& state) {
+    const auto& trace = getTrace();
+    if (trace.timestamps.empty()) {
+        state.SkipWithError("empty vsync trace");
+        return;
+    }
+
+    nsecs_t now = 0;
+    auto predictor = createPredictor(now, trace.idealPeriod);
+    size_t index = 0;
+    for (auto _ : state) {
+        if (index == trace.timestamps.size()) {
+            state.PauseTiming();
+            predictor = createPredictor(now, trace.idealPeriod);
+            index = 0;
+            state.ResumeTiming();
+        }
+        now = trace.timestamps[index++];
+        benchmark::DoNotOptimize(predictor->addVsyncTimestamp(now));
+    }
+
+    reportPredictionError(state, trace);
+}
+BENCHMARK(addVsyncTimestamp_replay);
+
+// The least-squares fit as VSyncPredictor computed it before the fit was made incremental, which
+// recomputed the regression over the whole history for every sample. This is a baseline for the
+// cost per sample of addVsyncTimestamp_replay.
+void fullRecomputeFit_replay(benchmark::State& state) {
+    const auto& trace = getTrace();
+    if (trace.timestamps.empty()) {
+        state.SkipWithError("empty vsync trace");
+        return;
+    }
+
+    std::vector<nsecs_t> history;
+    history.reserve(kHistorySize);
+    size_t index = 0;
+    size_t next = 0;
+    nsecs_t period = trace.idealPeriod;
+    for (auto _ : state) {
+        const nsecs_t timestamp = trace.timestamps[index];
+        index = (index + 1) % trace.timestamps.size();
+        if (history.size() < kHistorySize) {
+            history.push_back(timestamp);
+        } else {
+            history[next] = timestamp;
+            next = (next + 1) % kHistorySize;
+        }
+        if (history.size() < kMinSamplesForPrediction) {
+            continue;
+        }
+
+        constexpr int64_t kScalingFactor = 1000;
+        const size_t numSamples = history.size();
+        std::vector<nsecs_t> vsyncTS(numSamples);
+        std::vector<nsecs_t> ordinals(numSamples);
+        const auto oldestTS = *std::min_element(history.begin(), history.end());
+
+        nsecs_t meanTS = 0;
+        nsecs_t meanOrdinal = 0;
+        for (size_t i = 0; i < numSamples; i++) {
+            vsyncTS[i] = history[i] - oldestTS;
+            meanTS += vsyncTS[i];
+            ordinals[i] = (vsyncTS[i] + period / 2) / period * kScalingFactor;
+            meanOrdinal += ordinals[i];
+        }
+        meanTS /= static_cast<nsecs_t>(numSamples);
+        meanOrdinal /= static_cast<nsecs_t>(numSamples);
+
+        nsecs_t top = 0;
+        nsecs_t bottom = 0;
+        for (size_t i = 0; i < numSamples; i++) {
+            top += (vsyncTS[i] - meanTS) * (ordinals[i] - meanOrdinal);
+            bottom += (ordinals[i] - meanOrdinal) * (ordinals[i] - meanOrdinal);
+        }
+
+        if (bottom != 0) {
+            const nsecs_t anticipatedPeriod = top * kScalingFactor / bottom;
+            if (std::abs(anticipatedPeriod - trace.idealPeriod) * 100 <
+                trace.idealPeriod * kDiscardOutlierPercent) {
+                period = anticipatedPeriod;
+            }
+        }
+        benchmark::DoNotOptimize(period);
+    }
+}
+BENCHMARK(fullRecomputeFit_replay);
+
+} // namespace
+} // namespace android::scheduler
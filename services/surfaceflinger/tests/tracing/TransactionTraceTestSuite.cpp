@@ -19,10 +19,12 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 
 #include <LayerProtoHelper.h>
+#include <Tracing/tools/CompressedLayerTrace.h>
 #include <Tracing/LayerTracing.h>
 #include <Tracing/TransactionProtoParser.h>
 #include <Tracing/tools/LayerTraceGenerator.h>
@@ -248,6 +250,43 @@ std::string PrintToStringParamName(const ::testing::TestParamInfo<std::filesyste
     return filename.substr(prefix.length(), filename.length() - prefix.length() - postfix.length());
 }
 
+TEST_P(TransactionTraceTestSuite, compressedTraceMatchesFullTrace) {
+    const auto traceFlags = LayerTracing::TRACE_INPUT | LayerTracing::TRACE_BUFFERS;
+    std::ostringstream fullStream;
+    {
+        LayerTracing layerTracing{fullStream};
+        EXPECT_TRUE(LayerTraceGenerator().generate(mTransactionTrace, traceFlags, layerTracing,
+                                                   /*onlyLastEntry=*/false));
+    }
+    std::ostringstream compressedOutStream;
+    {
+        CompressedLayerTraceWriter writer(compressedOutStream,
+                                          LayerTracing::createTraceFileProto());
+        LayerTracing layerTracing{[&](perfetto::protos::LayersSnapshotProto&& snapshot) {
+            writer.addSnapshot(std::move(snapshot));
+        }};
+        EXPECT_TRUE(LayerTraceGenerator().generate(mTransactionTrace, traceFlags, layerTracing,
+                                                   /*onlyLastEntry=*/false));
+    }
+    const std::string fullTrace = fullStream.str();
+    const std::string compressedTrace = compressedOutStream.str();
+
+    perfetto::protos::LayersTraceFileProto fullTraceProto;
+    ASSERT_TRUE(fullTraceProto.ParseFromString(fullTrace));
+    std::istringstream compressedStream(compressedTrace);
+    ASSERT_TRUE(CompressedLayerTraceReader::isCompressedTrace(compressedStream));
+    perfetto::protos::LayersTraceFileProto compressedTraceProto;
+    ASSERT_TRUE(CompressedLayerTraceReader::read(compressedStream, compressedTraceProto));
+
+    ASSERT_EQ(fullTraceProto.entry_size(), compressedTraceProto.entry_size());
+    for (int i = 0; i < fullTraceProto.entry_size(); i++) {
+        EXPECT_EQ(fullTraceProto.entry(i).SerializeAsString(),
+                  compressedTraceProto.entry(i).SerializeAsString())
+                << "entry " << i;
+    }
+    EXPECT_LT(compressedTrace.size(), fullTrace.size() / 2);
+}
+
 INSTANTIATE_TEST_CASE_P(TransactionTraceTestSuites, TransactionTraceTestSuite,
                         testing::ValuesIn(TransactionTraceTestSuite::sTransactionTraces),
                         PrintToStringParamName);
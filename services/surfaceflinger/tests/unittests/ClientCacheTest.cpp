@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "ClientCacheTest"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <binder/Binder.h>
+#include <renderengine/mock/RenderEngine.h>
+
+#include "ClientCache.h"
+
+namespace android {
+namespace {
+
+using testing::ElementsAre;
+
+class TestErasedRecipient : public ClientCache::ErasedRecipient {
+public:
+    void bufferErased(const client_cache_t& clientCacheId) override {
+        erasedBatches.push_back({clientCacheId.id});
+    }
+
+    void buffersErased(const std::vector<client_cache_t>& clientCacheIds) override {
+        std::vector<uint64_t> ids;
+        for (const auto& clientCacheId : clientCacheIds) {
+            ids.push_back(clientCacheId.id);
+        }
+        erasedBatches.push_back(std::move(ids));
+    }
+
+    std::vector<std::vector<uint64_t>> erasedBatches;
+};
+
+class ClientCacheTest : public testing::Test {
+protected:
+    ClientCacheTest() { mCache.setRenderEngine(&mRenderEngine); }
+
+    ~ClientCacheTest() override {
+        mCache.removeProcess(mProcessToken);
+        mCache.setRenderEngine(nullptr);
+    }
+
+    void addBuffers(std::initializer_list<uint64_t> ids) {
+        for (uint64_t id : ids) {
+            ASSERT_TRUE(mCache.add({mProcessToken, id}, sp<GraphicBuffer>::make()).has_value());
+            ASSERT_TRUE(mCache.registerErasedRecipient({mProcessToken, id}, mRecipient));
+        }
+    }
+
+    testing::NiceMock<renderengine::mock::RenderEngine> mRenderEngine;
+    ClientCache& mCache = ClientCache::getInstance();
+    const sp<IBinder> mProcessToken = sp<BBinder>::make();
+    const sp<TestErasedRecipient> mRecipient = sp<TestErasedRecipient>::make();
+};
+
+TEST_F(ClientCacheTest, getReturnsAddedBuffer) {
+    auto texture = mCache.add({mProcessToken, 1}, sp<GraphicBuffer>::make());
+    ASSERT_TRUE(texture.has_value());
+    EXPECT_EQ(*texture, mCache.get({mProcessToken, 1}));
+    EXPECT_EQ(nullptr, mCache.get({mProcessToken, 2}));
+    EXPECT_EQ(nullptr, mCache.get({sp<BBinder>::make(), 1}));
+}
+
+TEST_F(ClientCacheTest, batchedEraseNotifiesRecipientOnce) {
+    addBuffers({1, 2, 3, 20});
+
+    const auto erased = mCache.erase(std::vector<client_cache_t>{{mProcessToken, 1},
+                                                                 {mProcessToken, 20},
+                                                                 {mProcessToken, 4}});
+    EXPECT_EQ(2u, erased.size());
+    EXPECT_THAT(mRecipient->erasedBatches, ElementsAre(ElementsAre(1, 20)));
+    EXPECT_EQ(nullptr, mCache.get({mProcessToken, 1}));
+    EXPECT_NE(nullptr, mCache.get({mProcessToken, 2}));
+}
+
+TEST_F(ClientCacheTest, removeProcessNotifiesRecipientOnce) {
+    addBuffers({1, 2, 3});
+
+    mCache.removeProcess(mProcessToken);
+    ASSERT_EQ(1u, mRecipient->erasedBatches.size());
+    EXPECT_THAT(mRecipient->erasedBatches[0], testing::UnorderedElementsAre(1, 2, 3));
+    EXPECT_EQ(nullptr, mCache.get({mProcessToken, 1}));
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "CompressedLayerTraceTest"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Tracing/LayerTracing.h"
+#include "Tracing/tools/CompressedLayerTrace.h"
+
+namespace android {
+namespace {
+
+using perfetto::protos::LayersSnapshotProto;
+using perfetto::protos::LayersTraceFileProto;
+
+struct TestLayer {
+    int32_t id;
+    int32_t z;
+};
+
+LayersSnapshotProto createSnapshot(int64_t vsyncId, const std::vector<TestLayer>& layers) {
+    LayersSnapshotProto snapshot;
+    snapshot.set_vsync_id(vsyncId);
+    snapshot.set_elapsed_realtime_nanos(vsyncId * 16'666'666);
+    for (const auto& layer : layers) {
+        auto* layerProto = snapshot.mutable_layers()->add_layers();
+        layerProto->set_id(layer.id);
+        layerProto->set_name("layer#" + std::to_string(layer.id));
+        layerProto->set_z(layer.z);
+    }
+    return snapshot;
+}
+
+class CompressedLayerTraceTest : public testing::Test {
+protected:
+    // Writes the snapshots and checks that reading them back gives the same snapshots.
+    void writeAndVerify(const std::vector<LayersSnapshotProto>& snapshots,
+                        size_t keyframeInterval, size_t chunkSize) {
+        std::ostringstream outStream;
+        {
+            CompressedLayerTraceWriter writer(outStream, LayerTracing::createTraceFileProto(),
+                                              keyframeInterval, chunkSize);
+            for (auto snapshot : snapshots) {
+                writer.addSnapshot(std::move(snapshot));
+            }
+        }
+
+        std::istringstream inStream(outStream.str());
+        ASSERT_TRUE(CompressedLayerTraceReader::isCompressedTrace(inStream));
+        LayersTraceFileProto trace;
+        ASSERT_TRUE(CompressedLayerTraceReader::read(inStream, trace));
+        ASSERT_EQ(static_cast<int>(snapshots.size()), trace.entry_size());
+        for (size_t i = 0; i < snapshots.size(); i++) {
+            EXPECT_EQ(snapshots[i].SerializeAsString(),
+                      trace.entry(static_cast<int>(i)).SerializeAsString())
+                    << "entry " << i;
+        }
+        EXPECT_TRUE(trace.has_magic_number());
+    }
+};
+
+TEST_F(CompressedLayerTraceTest, roundTripsChangedAddedAndRemovedLayers) {
+    std::vector<LayersSnapshotProto> snapshots;
+    snapshots.push_back(createSnapshot(1, {{1, 0}, {2, 1}, {3, 2}}));
+    // Layer 2 changes.
+    snapshots.push_back(createSnapshot(2, {{1, 0}, {2, 5}, {3, 2}}));
+    // Nothing changes.
+    snapshots.push_back(createSnapshot(3, {{1, 0}, {2, 5}, {3, 2}}));
+    // Layer 3 is removed and layer 4 is added.
+    snapshots.push_back(createSnapshot(4, {{1, 0}, {2, 5}, {4, 3}}));
+    // The layers are reordered.
+    snapshots.push_back(createSnapshot(5, {{4, 3}, {1, 0}, {2, 5}}));
+    // All the layers are removed.
+    snapshots.push_back(createSnapshot(6, {}));
+    snapshots.push_back(createSnapshot(7, {{1, 0}}));
+
+    writeAndVerify(snapshots, CompressedLayerTraceWriter::kDefaultKeyframeInterval,
+                   CompressedLayerTraceWriter::kDefaultChunkSize);
+}
+
+TEST_F(CompressedLayerTraceTest, roundTripsAcrossKeyframesAndChunks) {
+    std::vector<LayersSnapshotProto> snapshots;
+    std::vector<TestLayer> layers;
+    for (int32_t id = 0; id < 50; id++) {
+        layers.push_back({id, id});
+    }
+    for (int64_t vsyncId = 1; vsyncId <= 200; vsyncId++) {
+        layers[static_cast<size_t>(vsyncId) % layers.size()].z++;
+        snapshots.push_back(createSnapshot(vsyncId, layers));
+    }
+
+    // A keyframe every 7 snapshots, and a new chunk every few snapshots.
+    writeAndVerify(snapshots, 7, 4096);
+}
+
+TEST_F(CompressedLayerTraceTest, diffsAreSmallerThanSnapshots) {
+    std::vector<TestLayer> layers;
+    for (int32_t id = 0; id < 100; id++) {
+        layers.push_back({id, id});
+    }
+
+    std::ostringstream outStream;
+    size_t fullSize = 0;
+    {
+        CompressedLayerTraceWriter writer(outStream, LayerTracing::createTraceFileProto());
+        for (int64_t vsyncId = 1; vsyncId <= 100; vsyncId++) {
+            layers[0].z++;
+            auto snapshot = createSnapshot(vsyncId, layers);
+            fullSize += snapshot.ByteSizeLong();
+            writer.addSnapshot(std::move(snapshot));
+        }
+        writer.flush();
+        EXPECT_EQ(outStream.str().size(), writer.getBytesWritten());
+    }
+    EXPECT_LT(outStream.str().size() * 10, fullSize);
+}
+
+TEST_F(CompressedLayerTraceTest, rejectsOtherTraces) {
+    LayersTraceFileProto trace;
+    *trace.add_entry() = createSnapshot(1, {{1, 0}});
+    std::istringstream inStream(trace.SerializeAsString());
+    EXPECT_FALSE(CompressedLayerTraceReader::isCompressedTrace(inStream));
+
+    LayersTraceFileProto outTrace;
+    EXPECT_FALSE(CompressedLayerTraceReader::read(inStream, outTrace));
+}
+
+TEST_F(CompressedLayerTraceTest, rejectsOversizedChunks) {
+    // A chunk claiming more uncompressed bytes than its compressed bytes can hold.
+    const auto readChunk = [](std::initializer_list<uint8_t> chunkSizeVarint) {
+        std::string data = "SFLTRCZ1";
+        data.push_back(0); // empty LayersTraceFileProto
+        data.append(chunkSizeVarint.begin(), chunkSizeVarint.end());
+        data.push_back(1); // compressed size
+        data.push_back('x');
+        std::istringstream inStream(data);
+        LayersTraceFileProto outTrace;
+        return CompressedLayerTraceReader::read(inStream, outTrace);
+    };
+    EXPECT_FALSE(readChunk({0xd0, 0x0f}));                         // 2000 bytes
+    EXPECT_FALSE(readChunk({0x80, 0x80, 0x80, 0x80, 0x80, 0x20})); // 1 TiB
+}
+
+} // namespace
+} // namespace android
@@ -28,6 +28,7 @@
 #include <log/log.h>
 #include <perfetto/trace/trace.pb.h>
 #include <cinttypes>
+#include <thread>
 
 using namespace std::chrono_literals;
 using testing::_;
@@ -147,7 +148,7 @@ public:
         for (size_t i = 0; i < maxTokens; i++) {
             mTokenManager->generateTokenForPredictions({});
         }
-        EXPECT_EQ(getPredictions().size(), maxTokens);
+        EXPECT_EQ(getPredictionCount(), maxTokens);
     }
 
     SurfaceFrame& getSurfaceFrame(size_t displayFrameIdx, size_t surfaceFrameIdx) {
@@ -166,10 +167,7 @@ public:
                 a.presentTime == b.presentTime;
     }
 
-    NO_THREAD_SAFETY_ANALYSIS
-    const std::map<int64_t, TimelineItem>& getPredictions() const {
-        return mTokenManager->mPredictions;
-    }
+    size_t getPredictionCount() const { return mTokenManager->getPredictionCount(); }
 
     uint32_t getNumberOfDisplayFrames() const {
         std::lock_guard<std::mutex> lock(mFrameTimeline->mMutex);
@@ -212,7 +210,7 @@ public:
 
 TEST_F(FrameTimelineTest, tokenManagerRemovesStalePredictions) {
     int64_t token1 = mTokenManager->generateTokenForPredictions({0, 0, 0});
-    EXPECT_EQ(getPredictions().size(), 1u);
+    EXPECT_EQ(getPredictionCount(), 1u);
     flushTokens();
     int64_t token2 = mTokenManager->generateTokenForPredictions({10, 20, 30});
     std::optional<TimelineItem> predictions = mTokenManager->getPredictionsForToken(token1);
@@ -555,6 +553,59 @@ TEST_F(FrameTimelineTest, setMaxDisplayFramesSetsSizeProperly) {
     EXPECT_EQ(getNumberOfDisplayFrames(), *maxDisplayFrames);
 }
 
+TEST_F(FrameTimelineTest, evictedDisplayFrameIsRecycled) {
+    auto presentFence = fenceFactory.createFenceTimeForTest(Fence::NO_FENCE);
+    presentFence->signalForTest(2);
+    mFrameTimeline->setMaxDisplayFrames(2);
+
+    auto addDisplayFrame = [&](nsecs_t wakeUpTime) {
+        auto surfaceFrame =
+                mFrameTimeline->createSurfaceFrameForToken({}, sPidOne, sUidOne, sLayerIdOne,
+                                                           sLayerNameOne, sLayerNameOne,
+                                                           /*isBuffer*/ true, sGameMode);
+        int64_t sfToken = mTokenManager->generateTokenForPredictions({22, 26, 30});
+        mFrameTimeline->setSfWakeUp(sfToken, wakeUpTime, RR_11, RR_11);
+        surfaceFrame->setPresentState(SurfaceFrame::PresentState::Presented);
+        mFrameTimeline->addSurfaceFrame(surfaceFrame);
+        mFrameTimeline->setSfPresent(27, presentFence);
+    };
+
+    addDisplayFrame(20);
+    addDisplayFrame(21);
+    const impl::FrameTimeline::DisplayFrame* oldest = getDisplayFrame(0).get();
+
+    // Evicts the oldest DisplayFrame, which is then reused for the next one.
+    addDisplayFrame(22);
+    addDisplayFrame(23);
+    ASSERT_EQ(getNumberOfDisplayFrames(), 2u);
+    const auto newest = getDisplayFrame(1);
+    EXPECT_EQ(newest.get(), oldest);
+    EXPECT_EQ(newest->getActuals().startTime, 23);
+    EXPECT_TRUE(compareTimelineItems(newest->getPredictions(), TimelineItem(22, 26, 30)));
+    EXPECT_EQ(newest->getSurfaceFrames().size(), 1u);
+}
+
+TEST_F(FrameTimelineTest, tokenManagerConcurrentReadsAndWrites) {
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        for (nsecs_t i = 0; i < 10'000; i++) {
+            mTokenManager->generateTokenForPredictions({i, i, i, i});
+        }
+        done = true;
+    });
+
+    // Every prediction read must be the one written for its token, never a mix of two.
+    while (!done) {
+        for (int64_t token = 0; token < 10'000; token += 7) {
+            if (auto predictions = mTokenManager->getPredictionsForToken(token)) {
+                EXPECT_EQ(predictions->startTime, token);
+                EXPECT_EQ(predictions->desiredPresentTime, token);
+            }
+        }
+    }
+    writer.join();
+}
+
 TEST_F(FrameTimelineTest, presentFenceSignaled_invalidSignalTime) {
     Fps refreshRate = RR_11;
 
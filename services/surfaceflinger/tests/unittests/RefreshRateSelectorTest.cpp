@@ -100,10 +100,29 @@ struct TestableRefreshRateSelector : RefreshRateSelector {
     const std::vector<Fps>& knownFrameRates() const { return mKnownFrameRates; }
 
     using RefreshRateSelector::GetRankedFrameRatesCache;
+    using RefreshRateSelector::kGetRankedFrameRatesCacheCapacity;
     auto& mutableGetRankedRefreshRatesCache() NO_THREAD_SAFETY_ANALYSIS {
         return mGetRankedFrameRatesCache;
     }
 
+    std::vector<FrameRateMode> appRequestFrameRates() const {
+        std::lock_guard lock(mLock);
+        return mAppRequestFrameRates;
+    }
+
+    float calculateLayerScore(const LayerRequirement& layer, Fps refreshRate,
+                              bool isSeamlessSwitch) const {
+        std::lock_guard lock(mLock);
+        return calculateLayerScoreLocked(layer, refreshRate, isSeamlessSwitch);
+    }
+
+    std::vector<float> getLayerScores(const LayerRequirement& layer) const {
+        std::lock_guard lock(mLock);
+        const float* scores = getLayerScoresLocked(layer);
+        if (!scores) return {};
+        return {scores, scores + mAppRequestFrameRates.size() * 2};
+    }
+
     auto getRankedFrameRates(const std::vector<LayerRequirement>& layers,
                              GlobalSignals signals = {}, Fps pacesetterFps = {}) const {
         const auto result =
@@ -3300,19 +3319,114 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsCache) {
                                                                   {90_Hz, kMode90}}},
                                                           GlobalSignals{.touch = true}};
 
-    selector.mutableGetRankedRefreshRatesCache() = {.layers = std::vector<LayerRequirement>{},
-                                                    .signals = GlobalSignals{.touch = true,
-                                                                             .idle = true},
-                                                    .result = result};
+    const std::vector<LayerRequirement> layers;
+    const GlobalSignals signals{.touch = true, .idle = true};
+    selector.mutableGetRankedRefreshRatesCache().push_front(
+            {.layers = layers,
+             .signals = signals,
+             .signature = TestableRefreshRateSelector::GetRankedFrameRatesCache::
+                     computeSignature(layers, signals, Fps()),
+             .result = result});
 
-    const auto& cache = *selector.mutableGetRankedRefreshRatesCache();
-    EXPECT_EQ(result, selector.getRankedFrameRates(cache.layers, cache.signals));
+    EXPECT_EQ(result, selector.getRankedFrameRates(layers, signals));
+}
+
+TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ReadsOlderCacheEntries) {
+    auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
+
+    std::vector<LayerRequirement> layers = {{.weight = 1.f}};
+    auto& layer = layers[0];
+    layer.vote = LayerVoteType::ExplicitDefault;
+    layer.name = "ExplicitDefault";
+
+    layer.desiredRefreshRate = 30_Hz;
+    const auto result30 = selector.getRankedFrameRates(layers);
+    layer.desiredRefreshRate = 90_Hz;
+    const auto result90 = selector.getRankedFrameRates(layers);
+
+    auto& cache = selector.mutableGetRankedRefreshRatesCache();
+    ASSERT_EQ(2u, cache.size());
+    EXPECT_EQ(result90, cache.front().result);
+
+    // Alternating between the two votes should hit the cache and move the entry to the front.
+    layer.desiredRefreshRate = 30_Hz;
+    EXPECT_EQ(result30, selector.getRankedFrameRates(layers));
+    ASSERT_EQ(2u, cache.size());
+    EXPECT_EQ(result30, cache.front().result);
+    EXPECT_EQ(layers, cache.front().layers);
+}
+
+TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_CacheEvictsLeastRecentlyUsed) {
+    auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
+
+    std::vector<LayerRequirement> layers = {{.weight = 1.f}};
+    auto& layer = layers[0];
+    layer.vote = LayerVoteType::ExplicitDefault;
+    layer.name = "ExplicitDefault";
+
+    constexpr size_t kCapacity = TestableRefreshRateSelector::kGetRankedFrameRatesCacheCapacity;
+    for (size_t i = 0; i <= kCapacity; i++) {
+        layer.desiredRefreshRate = Fps::fromValue(30.f + static_cast<float>(i));
+        selector.getRankedFrameRates(layers);
+    }
+
+    const auto& cache = selector.mutableGetRankedRefreshRatesCache();
+    ASSERT_EQ(kCapacity, cache.size());
+    EXPECT_EQ(layers, cache.front().layers);
+    // The first vote (30 Hz) was evicted.
+    EXPECT_TRUE(std::none_of(cache.begin(), cache.end(), [](const auto& entry) {
+        return isApproxEqual(entry.layers[0].desiredRefreshRate, 30_Hz);
+    }));
+}
+
+TEST_P(RefreshRateSelectorTest, tabulatedLayerScoresMatchCalculatedScores) {
+    auto selector = createSelector(kModes_24_25_30_50_60_Frac, kModeId60);
+    const auto appRequestFrameRates = selector.appRequestFrameRates();
+
+    LayerRequirement layer = {.name = "Layer", .weight = 1.f};
+    const auto expectScoresMatch = [&] {
+        const auto scores = selector.getLayerScores(layer);
+        ASSERT_EQ(appRequestFrameRates.size() * 2, scores.size());
+        for (size_t i = 0; i < appRequestFrameRates.size(); i++) {
+            const Fps fps = appRequestFrameRates[i].fps;
+            EXPECT_EQ(selector.calculateLayerScore(layer, fps, /*isSeamlessSwitch=*/false),
+                      scores[2 * i])
+                    << ftl::enum_string(layer.vote) << " " << to_string(fps);
+            EXPECT_EQ(selector.calculateLayerScore(layer, fps, /*isSeamlessSwitch=*/true),
+                      scores[2 * i + 1])
+                    << ftl::enum_string(layer.vote) << " " << to_string(fps);
+        }
+    };
+
+    for (const auto vote : {LayerVoteType::Heuristic, LayerVoteType::ExplicitDefault,
+                            LayerVoteType::ExplicitExactOrMultiple, LayerVoteType::ExplicitExact,
+                            LayerVoteType::ExplicitGte}) {
+        layer.vote = vote;
+        for (const Fps knownFrameRate : selector.knownFrameRates()) {
+            layer.desiredRefreshRate = knownFrameRate;
+            expectScoresMatch();
+        }
+
+        // Rates that are not known frame rates are always calculated.
+        layer.desiredRefreshRate = 61_Hz;
+        EXPECT_TRUE(selector.getLayerScores(layer).empty());
+    }
+
+    layer.vote = LayerVoteType::Max;
+    expectScoresMatch();
+
+    layer.vote = LayerVoteType::ExplicitCategory;
+    for (const auto category : {FrameRateCategory::HighHint, FrameRateCategory::High,
+                                FrameRateCategory::Normal, FrameRateCategory::Low}) {
+        layer.frameRateCategory = category;
+        expectScoresMatch();
+    }
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     auto selector = createSelector(kModes_30_60_72_90_120, kModeId60);
 
-    EXPECT_FALSE(selector.mutableGetRankedRefreshRatesCache());
+    EXPECT_TRUE(selector.mutableGetRankedRefreshRatesCache().empty());
 
     const std::vector<LayerRequirement> layers = {{.weight = 1.f}, {.weight = 0.5f}};
     const RefreshRateSelector::GlobalSignals globalSignals{.touch = true, .idle = true};
@@ -3321,12 +3435,12 @@ TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_WritesCache) {
     const auto result = selector.getRankedFrameRates(layers, globalSignals, pacesetterFps);
 
     const auto& cache = selector.mutableGetRankedRefreshRatesCache();
-    ASSERT_TRUE(cache);
+    ASSERT_EQ(1u, cache.size());
 
-    EXPECT_EQ(cache->layers, layers);
-    EXPECT_EQ(cache->signals, globalSignals);
-    EXPECT_EQ(cache->pacesetterFps, pacesetterFps);
-    EXPECT_EQ(cache->result, result);
+    EXPECT_EQ(cache.front().layers, layers);
+    EXPECT_EQ(cache.front().signals, globalSignals);
+    EXPECT_EQ(cache.front().pacesetterFps, pacesetterFps);
+    EXPECT_EQ(cache.front().result, result);
 }
 
 TEST_P(RefreshRateSelectorTest, getBestFrameRateMode_ExplicitExactTouchBoost) {
@@ -30,8 +30,10 @@
 #include <utils/String16.h>
 #include <utils/Vector.h>
 
+#include <atomic>
 #include <chrono>
 #include <random>
+#include <thread>
 #include <unordered_set>
 
 #include "libsurfaceflinger_unittest_main.h"
@@ -742,6 +744,40 @@ TEST_F(TimeStatsTest, canInsertMultipleLayersTimeStats) {
     EXPECT_EQ(2, globalProto.stats_size());
 }
 
+TEST_F(TimeStatsTest, canInsertLayerTimeStatsWhileDumping) {
+    constexpr int32_t kNumLayers = 20;
+    constexpr uint64_t kNumFrames = 50;
+    EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
+
+    std::atomic<bool> done = false;
+    std::thread dumpThread([&] {
+        Vector<String16> args;
+        args.push_back(String16("-dump"));
+        while (!done) {
+            std::string result;
+            mTimeStats->parseArgs(FMT_PROTO, args, result);
+        }
+    });
+
+    for (uint64_t frameNumber = 1; frameNumber <= kNumFrames; frameNumber++) {
+        for (int32_t layerId = 0; layerId < kNumLayers; layerId++) {
+            insertTimeRecord(NORMAL_SEQUENCE, layerId, frameNumber,
+                             static_cast<nsecs_t>(frameNumber) * 1000000);
+        }
+    }
+    done = true;
+    dumpThread.join();
+
+    SFTimeStatsGlobalProto globalProto;
+    ASSERT_TRUE(globalProto.ParseFromString(inputCommand(InputCommand::DUMP_ALL, FMT_PROTO)));
+
+    ASSERT_EQ(kNumLayers, globalProto.stats_size());
+    for (const SFTimeStatsLayerProto& layerProto : globalProto.stats()) {
+        EXPECT_EQ(static_cast<int32_t>(kNumFrames - 1), layerProto.total_frames())
+                << layerProto.layer_name();
+    }
+}
+
 TEST_F(TimeStatsTest, canInsertUnorderedLayerTimeStats) {
     EXPECT_TRUE(inputCommand(InputCommand::ENABLE, FMT_STRING).empty());
 
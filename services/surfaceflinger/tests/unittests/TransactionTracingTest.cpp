@@ -43,7 +43,8 @@ protected:
     perfetto::protos::TransactionTraceEntry bufferFront() {
         std::scoped_lock<std::mutex> lock(mTracing.mTraceLock);
         perfetto::protos::TransactionTraceEntry entry;
-        entry.ParseFromString(mTracing.mBuffer.front());
+        const std::string_view front = mTracing.mBuffer.front();
+        entry.ParseFromArray(front.data(), static_cast<int>(front.size()));
         return entry;
     }
 
@@ -124,6 +125,53 @@ TEST_F(TransactionTracingTest, addTransactions) {
     verifyEntry(proto.entry(1), secondUpdate.transactions, secondTransactionSetVsyncId);
 }
 
+TEST_F(TransactionTracingTest, queuedTransactionDoesNotHoldBuffer) {
+    std::weak_ptr<BufferData> weakBufferData;
+    {
+        auto bufferData = std::make_shared<BufferData>();
+        bufferData->frameNumber = 7;
+        weakBufferData = bufferData;
+
+        TransactionState transaction;
+        transaction.id = 1;
+        ResolvedComposerState layerState;
+        layerState.layerId = 1;
+        layerState.state.what = layer_state_t::eBufferChanged;
+        layerState.state.bufferData = std::move(bufferData);
+        transaction.states.emplace_back(layerState);
+        mTracing.addQueuedTransaction(transaction);
+    }
+    EXPECT_TRUE(weakBufferData.expired());
+
+    frontend::Update update;
+    TransactionState transaction;
+    transaction.id = 1;
+    update.transactions.emplace_back(transaction);
+    mTracing.addCommittedTransactions(/*vsyncId=*/1, 0, update, {}, false);
+    flush();
+
+    perfetto::protos::TransactionTraceFile proto = writeToProto();
+    ASSERT_EQ(proto.entry().size(), 1);
+    ASSERT_EQ(proto.entry(0).transactions().size(), 1);
+    ASSERT_EQ(proto.entry(0).transactions(0).layer_changes().size(), 1);
+    EXPECT_EQ(proto.entry(0).transactions(0).layer_changes(0).buffer_data().frame_number(), 7u);
+}
+
+TEST_F(TransactionTracingTest, ringKeepsMostRecentEntries) {
+    mTracing.setBufferSize(SMALL_BUFFER_SIZE);
+    constexpr int64_t kEntries = 200;
+    for (int64_t vsyncId = 1; vsyncId <= kEntries; vsyncId++) {
+        queueAndCommitTransaction(vsyncId);
+    }
+
+    perfetto::protos::TransactionTraceFile proto = writeToProto();
+    ASSERT_GT(proto.entry().size(), 0);
+    ASSERT_LT(proto.entry().size(), kEntries);
+    for (int i = 0; i < proto.entry().size(); i++) {
+        EXPECT_EQ(proto.entry(i).vsync_id(), kEntries - proto.entry().size() + 1 + i);
+    }
+}
+
 class TransactionTracingLayerHandlingTest : public TransactionTracingTest {
 protected:
     void SetUp() override {
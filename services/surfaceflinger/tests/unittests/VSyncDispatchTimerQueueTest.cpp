@@ -223,6 +223,10 @@ protected:
 
     void advanceToNextCallback() { mMockClock.advanceToNextCallback(); }
 
+    VSyncDispatchTimerQueue::WakeupStats getWakeupStats() const {
+        return static_cast<const VSyncDispatchTimerQueue&>(*mDispatch).getWakeupStats();
+    }
+
     NiceMock<ControllableClock> mMockClock;
     static nsecs_t constexpr mDispatchGroupThreshold = 5;
     nsecs_t const mPeriod = 1000;
@@ -1220,6 +1224,72 @@ TEST_F(VSyncDispatchTimerQueueTest, dontskipAVsyc) {
     EXPECT_THAT(cb.mReadyTime[0], Eq(1000));
 }
 
+TEST_F(VSyncDispatchTimerQueueTest, rearmsWhenArmedCallbackMovesLater) {
+    Sequence seq;
+    EXPECT_CALL(mMockClock, alarmAt(_, 600)).InSequence(seq);
+    EXPECT_CALL(mMockClock, alarmAt(_, 610)).InSequence(seq);
+
+    CountingCallback cb(mDispatch);
+
+    mDispatch->schedule(cb, {.workDuration = 400, .readyDuration = 0, .lastVsync = 1000});
+    mDispatch->schedule(cb, {.workDuration = 390, .readyDuration = 0, .lastVsync = 1000});
+
+    advanceToNextCallback();
+    ASSERT_THAT(cb.mCalls.size(), Eq(1));
+    EXPECT_THAT(cb.mCalls[0], Eq(mPeriod));
+
+    const auto stats = getWakeupStats();
+    EXPECT_EQ(stats.wakeups, 1u);
+    EXPECT_EQ(stats.emptyWakeups, 0u);
+    EXPECT_EQ(stats.dispatches, 1u);
+}
+
+TEST_F(VSyncDispatchTimerQueueTest, groupsCallbacksIntoOneWakeupPerFrame) {
+    constexpr size_t kFrames = 60;
+
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+    CountingCallback cb2(mDispatch);
+
+    for (size_t frame = 1; frame <= kFrames; frame++) {
+        const nsecs_t vsync = static_cast<nsecs_t>(frame) * mPeriod;
+        mDispatch->schedule(cb0, {.workDuration = 400, .readyDuration = 0, .lastVsync = vsync});
+        mDispatch->schedule(cb1, {.workDuration = 398, .readyDuration = 0, .lastVsync = vsync});
+        mDispatch->schedule(cb2, {.workDuration = 396, .readyDuration = 0, .lastVsync = vsync});
+        advanceToNextCallback();
+    }
+
+    EXPECT_THAT(cb0.mCalls.size(), Eq(kFrames));
+    EXPECT_THAT(cb1.mCalls.size(), Eq(kFrames));
+    EXPECT_THAT(cb2.mCalls.size(), Eq(kFrames));
+
+    const auto stats = getWakeupStats();
+    EXPECT_EQ(stats.wakeups, kFrames);
+    EXPECT_EQ(stats.emptyWakeups, 0u);
+    EXPECT_EQ(stats.dispatches, 3 * kFrames);
+    EXPECT_EQ(stats.groupedDispatches, 2 * kFrames);
+    EXPECT_EQ(stats.maxLateness, 0);
+}
+
+TEST_F(VSyncDispatchTimerQueueTest, reportsDispatchLateness) {
+    CountingCallback cb0(mDispatch);
+    CountingCallback cb1(mDispatch);
+
+    mDispatch->schedule(cb0, {.workDuration = 400, .readyDuration = 0, .lastVsync = 1000});
+    mDispatch->schedule(cb1, {.workDuration = 398, .readyDuration = 0, .lastVsync = 1000});
+
+    mMockClock.setLag(50);
+    mMockClock.advanceBy(650);
+    ASSERT_THAT(cb0.mCalls.size(), Eq(1));
+    ASSERT_THAT(cb1.mCalls.size(), Eq(1));
+
+    const auto stats = getWakeupStats();
+    EXPECT_EQ(stats.wakeups, 1u);
+    EXPECT_EQ(stats.groupedDispatches, 0u);
+    EXPECT_EQ(stats.totalLateness, 50 + 48);
+    EXPECT_EQ(stats.maxLateness, 50);
+}
+
 class VSyncDispatchTimerQueueEntryTest : public testing::Test {
 protected:
     nsecs_t const mPeriod = 1000;
@@ -506,6 +506,41 @@ TEST_F(VSyncPredictorTest, aPhoneThatHasBeenAroundAWhileCanStillComputePeriod) {
     EXPECT_THAT(intercept, Eq(0));
 }
 
+TEST_F(VSyncPredictorTest, rejectsOutOfPhaseTimestampOlderThanLast) {
+    for (auto i = 0u; i < kMinimumSamplesForPrediction + 1; i++) {
+        EXPECT_TRUE(tracker.addVsyncTimestamp(mNow += mPeriod));
+    }
+
+    // Half a period out of phase, but older than the last timestamp, so the phase check against
+    // the last timestamp does not catch it.
+    EXPECT_FALSE(tracker.addVsyncTimestamp(mPeriod - 29 * mPeriod - mPeriod / 2));
+
+    for (auto i = 0u; i < kMinimumSamplesForPrediction; i++) {
+        EXPECT_TRUE(tracker.addVsyncTimestamp(mNow += mPeriod));
+    }
+
+    auto [slope, intercept] = tracker.getVSyncPredictionModel();
+    EXPECT_THAT(slope, Eq(mPeriod));
+    EXPECT_THAT(intercept, Eq(0));
+}
+
+TEST_F(VSyncPredictorTest, reportsPredictionConfidenceInterval) {
+    EXPECT_THAT(tracker.predictionConfidenceInterval().ns(), Eq(0));
+
+    constexpr nsecs_t kJitter = 50;
+    for (auto i = 0u; i < kHistorySize * 2; i++) {
+        mNow += mPeriod;
+        tracker.addVsyncTimestamp(i % 2 ? mNow + kJitter : mNow - kJitter);
+    }
+
+    const auto interval = tracker.predictionConfidenceInterval().ns();
+    EXPECT_GT(interval, 0);
+    EXPECT_LE(interval, 4 * kJitter);
+
+    tracker.resetModel();
+    EXPECT_THAT(tracker.predictionConfidenceInterval().ns(), Eq(0));
+}
+
 TEST_F(VSyncPredictorTest, isVSyncInPhase) {
     auto last = mNow;
     auto const bias = 10;
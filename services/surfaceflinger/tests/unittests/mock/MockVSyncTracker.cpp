@@ -24,6 +24,7 @@ VSyncTracker::~VSyncTracker() = default;
 
 VSyncTracker::VSyncTracker() {
     ON_CALL(*this, minFramePeriod()).WillByDefault(Return(Period::fromNs(0)));
+    ON_CALL(*this, predictionConfidenceInterval()).WillByDefault(Return(Duration::fromNs(0)));
 }
 
 } // namespace android::mock
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "layer_cache.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/file.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+namespace vulkan {
+namespace api {
+
+bool GetFileStamp(const std::string& path, FileStamp& stamp) {
+    size_t zip_pos = path.find("!/");
+    struct stat st;
+    if (stat(path.substr(0, zip_pos).c_str(), &st) != 0)
+        return false;
+    stamp.size = st.st_size;
+    stamp.mtime_ns = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+constexpr uint32_t kLayerCacheMagic = 0x4c43'6b56;  // "VkCL"
+constexpr uint32_t kLayerCacheVersion = 1;
+
+// Bounds-checked reads from the cache file. Any read past the end fails all
+// the following ones, so callers only check ok() once they are done.
+class LayerCache::Reader {
+   public:
+    explicit Reader(const std::string& data)
+        : data_(data), offset_(0), ok_(true) {}
+
+    bool ok() const { return ok_; }
+    bool AtEnd() const { return offset_ == data_.size(); }
+
+    template <typename T>
+    T Read() {
+        T value{};
+        ReadBytes(&value, sizeof(value));
+        return value;
+    }
+
+    void ReadBytes(void* dst, size_t size) {
+        if (size == 0)
+            return;
+        if (!ok_ || size > data_.size() - offset_) {
+            ok_ = false;
+            return;
+        }
+        memcpy(dst, data_.data() + offset_, size);
+        offset_ += size;
+    }
+
+    std::string ReadString() {
+        uint32_t size = Read<uint32_t>();
+        std::string value;
+        if (ok_ && size <= data_.size() - offset_) {
+            value.assign(data_, offset_, size);
+            offset_ += size;
+        } else {
+            ok_ = false;
+        }
+        return value;
+    }
+
+    template <typename T>
+    void ReadArray(std::vector<T>& values) {
+        uint32_t count = Read<uint32_t>();
+        if (!ok_ || count > (data_.size() - offset_) / sizeof(T)) {
+            ok_ = false;
+            return;
+        }
+        values.resize(count);
+        ReadBytes(values.data(), count * sizeof(T));
+    }
+
+   private:
+    const std::string& data_;
+    size_t offset_;
+    bool ok_;
+};
+
+namespace {
+
+template <typename T>
+void Append(std::string& data, const T& value) {
+    data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendString(std::string& data, const std::string& value) {
+    Append(data, static_cast<uint32_t>(value.size()));
+    data.append(value);
+}
+
+template <typename T>
+void AppendArray(std::string& data, const std::vector<T>& values) {
+    Append(data, static_cast<uint32_t>(values.size()));
+    data.append(reinterpret_cast<const char*>(values.data()),
+                values.size() * sizeof(T));
+}
+
+}  // anonymous namespace
+
+void LayerCache::Load() {
+    ATRACE_CALL();
+
+    std::string data;
+    if (!android::base::ReadFileToString(filename_, &data))
+        return;
+
+    Reader reader(data);
+    if (reader.Read<uint32_t>() != kLayerCacheMagic ||
+        reader.Read<uint32_t>() != kLayerCacheVersion) {
+        ALOGW("ignoring layer cache '%s' of another version",
+              filename_.c_str());
+        return;
+    }
+
+    std::unordered_map<std::string, Library> libraries;
+    for (uint32_t i = 0, n = reader.Read<uint32_t>(); reader.ok() && i < n;
+         i++) {
+        std::string path = reader.ReadString();
+        Library& library = libraries[path];
+        library.stamp = reader.Read<FileStamp>();
+        library.layers.resize(std::min<size_t>(
+            reader.Read<uint32_t>(), data.size() / sizeof(VkLayerProperties)));
+        for (Layer& layer : library.layers) {
+            layer.properties = reader.Read<VkLayerProperties>();
+            // names read back must stay NUL-terminated
+            layer.properties.layerName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+            layer.properties.description[VK_MAX_DESCRIPTION_SIZE - 1] = '\0';
+            layer.library_idx = 0;
+            layer.is_global = reader.Read<uint8_t>() != 0;
+            reader.ReadArray(layer.instance_extensions);
+            reader.ReadArray(layer.device_extensions);
+            for (auto& ext : layer.instance_extensions)
+                ext.extensionName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+            for (auto& ext : layer.device_extensions)
+                ext.extensionName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+            if (!reader.ok())
+                break;
+        }
+    }
+
+    std::unordered_map<std::string, ZipDir> zip_dirs;
+    for (uint32_t i = 0, n = reader.Read<uint32_t>(); reader.ok() && i < n;
+         i++) {
+        std::string path = reader.ReadString();
+        ZipDir& zip_dir = zip_dirs[path];
+        zip_dir.stamp = reader.Read<FileStamp>();
+        for (uint32_t j = 0, m = reader.Read<uint32_t>();
+             reader.ok() && j < m; j++) {
+            zip_dir.filenames.push_back(reader.ReadString());
+        }
+    }
+
+    if (!reader.ok() || !reader.AtEnd()) {
+        ALOGW("ignoring corrupt layer cache '%s'", filename_.c_str());
+        return;
+    }
+    loaded_libraries_ = std::move(libraries);
+    loaded_zip_dirs_ = std::move(zip_dirs);
+}
+
+void LayerCache::Save() {
+    if (!dirty_ && libraries_.size() == loaded_libraries_.size() &&
+        zip_dirs_.size() == loaded_zip_dirs_.size())
+        return;
+
+    ATRACE_CALL();
+
+    std::string data;
+    Append(data, kLayerCacheMagic);
+    Append(data, kLayerCacheVersion);
+    Append(data, static_cast<uint32_t>(libraries_.size()));
+    for (const auto& [path, library] : libraries_) {
+        AppendString(data, path);
+        Append(data, library.stamp);
+        Append(data, static_cast<uint32_t>(library.layers.size()));
+        for (const Layer& layer : library.layers) {
+            Append(data, layer.properties);
+            Append(data, static_cast<uint8_t>(layer.is_global));
+            AppendArray(data, layer.instance_extensions);
+            AppendArray(data, layer.device_extensions);
+        }
+    }
+    Append(data, static_cast<uint32_t>(zip_dirs_.size()));
+    for (const auto& [path, zip_dir] : zip_dirs_) {
+        AppendString(data, path);
+        Append(data, zip_dir.stamp);
+        Append(data, static_cast<uint32_t>(zip_dir.filenames.size()));
+        for (const std::string& filename : zip_dir.filenames)
+            AppendString(data, filename);
+    }
+
+    // Other processes of the app may be reading the file, so replace it
+    // rather than rewrite it in place.
+    std::string tmp_filename = filename_ + ".tmp";
+    if (!android::base::WriteStringToFile(data, tmp_filename) ||
+        rename(tmp_filename.c_str(), filename_.c_str()) != 0) {
+        ALOGW("failed to write layer cache '%s': %s", filename_.c_str(),
+              strerror(errno));
+        unlink(tmp_filename.c_str());
+    }
+}
+
+bool LayerCache::FindLibrary(const std::string& path,
+                             const FileStamp& stamp,
+                             size_t library_idx,
+                             std::vector<Layer>& instance_layers) {
+    auto it = loaded_libraries_.find(path);
+    if (it == loaded_libraries_.end() || !(it->second.stamp == stamp)) {
+        misses_++;
+        return false;
+    }
+
+    hits_++;
+    for (Layer layer : it->second.layers) {
+        layer.library_idx = library_idx;
+        ALOGD("added cached %s layer '%s' from library '%s'",
+              (layer.is_global) ? "global" : "instance",
+              layer.properties.layerName, path.c_str());
+        instance_layers.push_back(std::move(layer));
+    }
+    libraries_.insert(*it);
+    return true;
+}
+
+void LayerCache::AddLibrary(const std::string& path,
+                            const FileStamp& stamp,
+                            const Layer* layers,
+                            size_t layer_count) {
+    libraries_[path] = {stamp, std::vector<Layer>(layers, layers + layer_count)};
+    dirty_ = true;
+}
+
+const std::vector<std::string>* LayerCache::FindZipDir(
+    const std::string& path,
+    const FileStamp& stamp) {
+    auto it = loaded_zip_dirs_.find(path);
+    if (it == loaded_zip_dirs_.end() || !(it->second.stamp == stamp))
+        return nullptr;
+    return &zip_dirs_.insert(*it).first->second.filenames;
+}
+
+void LayerCache::AddZipDir(const std::string& path,
+                           const FileStamp& stamp,
+                           std::vector<std::string> filenames) {
+    zip_dirs_[path] = {stamp, std::move(filenames)};
+    dirty_ = true;
+}
+
+}  // namespace api
+}  // namespace vulkan
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBVULKAN_LAYER_CACHE_H
+#define LIBVULKAN_LAYER_CACHE_H 1
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vulkan {
+namespace api {
+
+struct Layer {
+    VkLayerProperties properties;
+    size_t library_idx;
+
+    // true if the layer intercepts vkCreateDevice and device commands
+    bool is_global;
+
+    std::vector<VkExtensionProperties> instance_extensions;
+    std::vector<VkExtensionProperties> device_extensions;
+};
+
+// The size and modification time of a layer library, or of the APK holding
+// it. A cached entry is only used while the file keeps both.
+struct FileStamp {
+    int64_t size;
+    int64_t mtime_ns;
+
+    bool operator==(const FileStamp& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+};
+
+// Returns the stamp of a library path, which may point into an APK.
+bool GetFileStamp(const std::string& path, FileStamp& stamp);
+
+// LayerCache persists what discovery learns about each layer library across
+// processes: the layers and extensions it provides, and the candidate
+// libraries in each APK directory of the search path. With it, discovery only
+// stats the libraries, and a library is only opened once one of its layers is
+// enabled.
+//
+// The cache file is rewritten with the entries used by the last discovery, so
+// entries of libraries that left the search path are dropped.
+class LayerCache {
+   public:
+    explicit LayerCache(const std::string& filename)
+        : filename_(filename), dirty_(false), hits_(0), misses_(0) {}
+
+    void Load();
+    void Save();
+
+    // Appends the cached layers of the library to instance_layers. Returns
+    // false if the library isn't cached or changed since.
+    bool FindLibrary(const std::string& path,
+                     const FileStamp& stamp,
+                     size_t library_idx,
+                     std::vector<Layer>& instance_layers);
+    void AddLibrary(const std::string& path,
+                    const FileStamp& stamp,
+                    const Layer* layers,
+                    size_t layer_count);
+
+    // Returns the cached candidate libraries of a directory in an APK.
+    const std::vector<std::string>* FindZipDir(const std::string& path,
+                                               const FileStamp& stamp);
+    void AddZipDir(const std::string& path,
+                   const FileStamp& stamp,
+                   std::vector<std::string> filenames);
+
+    size_t GetHitCount() const { return hits_; }
+    size_t GetMissCount() const { return misses_; }
+
+   private:
+    struct Library {
+        FileStamp stamp;
+        std::vector<Layer> layers;
+    };
+
+    struct ZipDir {
+        FileStamp stamp;
+        std::vector<std::string> filenames;
+    };
+
+    class Reader;
+
+    const std::string filename_;
+    std::unordered_map<std::string, Library> loaded_libraries_;
+    std::unordered_map<std::string, ZipDir> loaded_zip_dirs_;
+    std::unordered_map<std::string, Library> libraries_;
+    std::unordered_map<std::string, ZipDir> zip_dirs_;
+    bool dirty_;
+    size_t hits_;
+    size_t misses_;
+};
+
+}  // namespace api
+}  // namespace vulkan
+
+#endif  // LIBVULKAN_LAYER_CACHE_H
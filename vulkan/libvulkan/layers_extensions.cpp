@@ -17,6 +17,7 @@
 #define ATRACE_TAG ATRACE_TAG_GRAPHICS
 
 #include "layers_extensions.h"
+#include "layer_cache.h"
 
 #include <alloca.h>
 #include <dirent.h>
@@ -25,6 +26,8 @@
 #include <sys/prctl.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -51,17 +54,6 @@
 namespace vulkan {
 namespace api {
 
-struct Layer {
-    VkLayerProperties properties;
-    size_t library_idx;
-
-    // true if the layer intercepts vkCreateDevice and device commands
-    bool is_global;
-
-    std::vector<VkExtensionProperties> instance_extensions;
-    std::vector<VkExtensionProperties> device_extensions;
-};
-
 namespace {
 
 const char kSystemLayerLibraryDir[] = "/data/local/debug/vulkan";
@@ -341,19 +333,40 @@ void* LayerLibrary::GetGPA(const Layer& layer, const std::string_view gpa_name)
 std::vector<LayerLibrary> g_layer_libraries;
 std::vector<Layer> g_instance_layers;
 
-void AddLayerLibrary(const std::string& path, const std::string& filename) {
-    LayerLibrary library(path + "/" + filename, filename);
-    if (!library.Open())
+void AddLayerLibrary(const std::string& path,
+                     const std::string& filename,
+                     LayerCache* cache) {
+    const std::string library_path = path + "/" + filename;
+    LayerLibrary library(library_path, filename);
+    const size_t prev_num_instance_layers = g_instance_layers.size();
+
+    FileStamp stamp;
+    const bool cacheable = cache && GetFileStamp(library_path, stamp);
+    if (cacheable && cache->FindLibrary(library_path, stamp,
+                                        g_layer_libraries.size(),
+                                        g_instance_layers)) {
+        // The library is opened by GetLayerRef once one of its layers is
+        // enabled.
+        if (g_instance_layers.size() > prev_num_instance_layers)
+            g_layer_libraries.emplace_back(std::move(library));
         return;
+    }
 
-    if (!library.EnumerateLayers(g_layer_libraries.size(), g_instance_layers)) {
-        library.Close();
+    if (!library.Open())
         return;
-    }
 
+    const bool has_layers =
+        library.EnumerateLayers(g_layer_libraries.size(), g_instance_layers);
     library.Close();
 
-    g_layer_libraries.emplace_back(std::move(library));
+    // Libraries without layers are cached too, so they aren't opened again.
+    if (cacheable) {
+        cache->AddLibrary(library_path, stamp,
+                          g_instance_layers.data() + prev_num_instance_layers,
+                          g_instance_layers.size() - prev_num_instance_layers);
+    }
+    if (has_layers)
+        g_layer_libraries.emplace_back(std::move(library));
 }
 
 template <typename Functor>
@@ -378,8 +391,20 @@ void ForEachFileInDir(const std::string& dirname, Functor functor) {
 template <typename Functor>
 void ForEachFileInZip(const std::string& zipname,
                       const std::string& dir_in_zip,
+                      LayerCache* cache,
                       Functor functor) {
     static const size_t kPageSize = getpagesize();
+    const std::string zip_path = zipname + "!/" + dir_in_zip;
+    FileStamp stamp;
+    const bool cacheable = cache && GetFileStamp(zipname, stamp);
+    if (cacheable) {
+        if (const auto* filenames = cache->FindZipDir(zip_path, stamp)) {
+            for (const std::string& filename : *filenames)
+                functor(filename);
+            return;
+        }
+    }
+
     int32_t err;
     ZipArchiveHandle zip = nullptr;
     if ((err = OpenArchive(zipname.c_str(), &zip)) != 0) {
@@ -398,6 +423,7 @@ void ForEachFileInZip(const std::string& zipname,
           dir_in_zip.c_str());
     ZipEntry entry;
     std::string name;
+    std::vector<std::string> filenames;
     while (Next(iter_cookie, &entry, &name) == 0) {
         std::string filename(name.substr(prefix.length()));
         // only enumerate direct entries of the directory, not subdirectories
@@ -409,29 +435,36 @@ void ForEachFileInZip(const std::string& zipname,
         // compressed and/or unaligned libraries.
         if (entry.method != kCompressStored || entry.offset % kPageSize != 0)
             continue;
-        functor(filename);
+        filenames.push_back(filename);
     }
     EndIteration(iter_cookie);
     CloseArchive(zip);
+
+    for (const std::string& filename : filenames)
+        functor(filename);
+    if (cacheable)
+        cache->AddZipDir(zip_path, stamp, std::move(filenames));
 }
 
 template <typename Functor>
-void ForEachFileInPath(const std::string& path, Functor functor) {
+void ForEachFileInPath(const std::string& path,
+                       LayerCache* cache,
+                       Functor functor) {
     size_t zip_pos = path.find("!/");
     if (zip_pos == std::string::npos) {
         ForEachFileInDir(path, functor);
     } else {
         ForEachFileInZip(path.substr(0, zip_pos), path.substr(zip_pos + 2),
-                         functor);
+                         cache, functor);
     }
 }
 
-void DiscoverLayersInPathList(const std::string& pathstr) {
+void DiscoverLayersInPathList(const std::string& pathstr, LayerCache* cache) {
     ATRACE_CALL();
 
     std::vector<std::string> paths = android::base::Split(pathstr, ":");
     for (const auto& path : paths) {
-        ForEachFileInPath(path, [&](const std::string& filename) {
+        ForEachFileInPath(path, cache, [&](const std::string& filename) {
             if (android::base::StartsWith(filename, "libVkLayer") &&
                 android::base::EndsWith(filename, ".so")) {
 
@@ -452,7 +485,7 @@ void DiscoverLayersInPathList(const std::string& pathstr) {
                 }
 
                 if (!duplicate)
-                    AddLayerLibrary(path, filename);
+                    AddLayerLibrary(path, filename, cache);
             }
         });
     }
@@ -479,11 +512,23 @@ void* GetLayerGetProcAddr(const Layer& layer,
 void DiscoverLayers() {
     ATRACE_CALL();
 
+    std::unique_ptr<LayerCache> cache;
+    const std::string& cache_filename =
+        android::GraphicsEnv::getInstance().getLayerCacheFilename();
+    if (!cache_filename.empty()) {
+        cache = std::make_unique<LayerCache>(cache_filename);
+        cache->Load();
+    }
+
     if (android::GraphicsEnv::getInstance().isDebuggable()) {
-        DiscoverLayersInPathList(kSystemLayerLibraryDir);
+        DiscoverLayersInPathList(kSystemLayerLibraryDir, cache.get());
     }
     if (!android::GraphicsEnv::getInstance().getLayerPaths().empty())
-        DiscoverLayersInPathList(android::GraphicsEnv::getInstance().getLayerPaths());
+        DiscoverLayersInPathList(android::GraphicsEnv::getInstance().getLayerPaths(),
+                                 cache.get());
+
+    if (cache)
+        cache->Save();
 }
 
 uint32_t GetLayerCount() {
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "present_pacer.h"
+
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+
+namespace vulkan {
+namespace driver {
+
+namespace {
+
+// Frames whose timestamps never arrive are dropped from the prediction
+// after this many newer frames were queued.
+constexpr size_t kMaxPendingFrames = 8;
+// Upper bound on a single wait, so a bad prediction can't stall the app.
+constexpr int64_t kMaxWait = 100'000'000;
+
+int64_t MovingAverage(int64_t average, int64_t sample) {
+    return average + (sample - average) / 8;
+}
+
+}  // anonymous namespace
+
+PresentPacer::Mode PresentPacer::ParseMode(const std::string& value) {
+    if (value == "throttle")
+        return Mode::kThrottle;
+    if (value == "low_latency")
+        return Mode::kLowLatency;
+    if (!value.empty() && value != "off")
+        ALOGW("Unknown present pacing mode '%s'", value.c_str());
+    return Mode::kOff;
+}
+
+PresentPacer::PresentPacer(Mode mode, int64_t refresh_duration)
+    : mode_(mode),
+      refresh_duration_(refresh_duration),
+      acquire_time_(0),
+      last_present_(0),
+      latch_to_present_(refresh_duration),
+      render_duration_(0),
+      stats_() {}
+
+void PresentPacer::SetRefreshDuration(int64_t refresh_duration) {
+    if (refresh_duration > 0)
+        refresh_duration_ = refresh_duration;
+}
+
+void PresentPacer::Update(const QueryFn& query) {
+    while (!pending_.empty()) {
+        const PendingFrame& frame = pending_.front();
+        FrameTimestamps timestamps;
+        if (!query(frame.frame_id, &timestamps)) {
+            pending_.pop_front();
+            continue;
+        }
+        if (timestamps.present == kTimestampPending)
+            break;
+        // Frames that were dropped by the compositor have no present time.
+        if (timestamps.present > 0) {
+            last_present_ = std::max(last_present_, timestamps.present);
+            if (timestamps.latch > 0 && timestamps.latch <= timestamps.present) {
+                latch_to_present_ = MovingAverage(
+                    latch_to_present_, timestamps.present - timestamps.latch);
+            }
+            int64_t render_end =
+                std::max(frame.queue_time, timestamps.render_complete);
+            if (frame.acquire_time > 0 && render_end >= frame.acquire_time) {
+                render_duration_ = MovingAverage(
+                    render_duration_, render_end - frame.acquire_time);
+            }
+            if (frame.acquire_time > 0) {
+                stats_.presented_frames++;
+                stats_.latency_sum += timestamps.present - frame.acquire_time;
+            }
+        }
+        pending_.pop_front();
+    }
+}
+
+int64_t PresentPacer::NextVsync(int64_t time) const {
+    if (time <= last_present_)
+        return last_present_;
+    int64_t vsyncs =
+        (time - last_present_ + refresh_duration_ - 1) / refresh_duration_;
+    return last_present_ + vsyncs * refresh_duration_;
+}
+
+int64_t PresentPacer::PredictPresent(size_t index) const {
+    // Each frame is presented at the first vsync after it is latched, and
+    // no earlier than one vsync after the frame before it.
+    int64_t present = last_present_;
+    for (size_t i = 0; i <= index; i++) {
+        present = std::max(present + refresh_duration_,
+                           NextVsync(pending_[i].queue_time + latch_to_present_));
+    }
+    return present;
+}
+
+int64_t PresentPacer::GetAcquireTime(int64_t now) const {
+    // Without a present to anchor the vsync grid there is nothing to predict.
+    if (mode_ == Mode::kOff || refresh_duration_ <= 0 || last_present_ == 0)
+        return 0;
+
+    const size_t max_depth = mode_ == Mode::kLowLatency ? 1 : 2;
+    if (pending_.size() < max_depth)
+        return 0;
+
+    // The frame that has to be latched before the next one may start.
+    const int64_t present = PredictPresent(pending_.size() - max_depth);
+    int64_t acquire_time = present - latch_to_present_;
+    if (mode_ == Mode::kLowLatency) {
+        // Aim for the vsync after the last queued frame, and leave a quarter
+        // of a refresh for the render time to vary.
+        acquire_time += refresh_duration_ - render_duration_ -
+                        refresh_duration_ / 4;
+    }
+    if (acquire_time <= now)
+        return 0;
+    return std::min(acquire_time, now + kMaxWait);
+}
+
+void PresentPacer::OnAcquire(int64_t now, int64_t waited) {
+    acquire_time_ = now;
+    if (waited > 0) {
+        stats_.throttled_acquires++;
+        stats_.throttled_time += waited;
+    }
+}
+
+void PresentPacer::OnQueue(uint64_t frame_id, int64_t now) {
+    pending_.push_back({frame_id, acquire_time_, now});
+    acquire_time_ = 0;
+    if (pending_.size() > kMaxPendingFrames)
+        pending_.pop_front();
+
+    const uint64_t depth = pending_.size();
+    stats_.queued_frames++;
+    stats_.queue_depth_sum += depth;
+    stats_.max_queue_depth = std::max(stats_.max_queue_depth, depth);
+    ATRACE_INT("PresentQueueDepth", static_cast<int32_t>(depth));
+}
+
+}  // namespace driver
+}  // namespace vulkan
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBVULKAN_PRESENT_PACER_H
+#define LIBVULKAN_PRESENT_PACER_H 1
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+namespace vulkan {
+namespace driver {
+
+// Paces a FIFO swapchain so the app doesn't queue more frames than the
+// display can consume. The pacer predicts when each queued frame will be
+// presented from the frame timestamps reported by the window, and tells
+// AcquireNextImageKHR how long to wait before dequeueing the next buffer.
+//
+// All times are CLOCK_MONOTONIC nanoseconds. The swapchain is externally
+// synchronized, so the pacer isn't thread-safe.
+class PresentPacer {
+   public:
+    enum class Mode {
+        kOff,
+        // Keep at most two frames queued ahead of the display.
+        kThrottle,
+        // Start each frame just in time to be presented at the vsync after
+        // the last queued frame.
+        kLowLatency,
+    };
+
+    struct FrameTimestamps {
+        int64_t render_complete;
+        int64_t latch;
+        int64_t present;
+    };
+
+    // Timestamps the window hasn't reported yet. Matches
+    // NATIVE_WINDOW_TIMESTAMP_PENDING.
+    static constexpr int64_t kTimestampPending = -2;
+
+    // Returns false if the window no longer has timestamps for frame_id.
+    using QueryFn = std::function<bool(uint64_t frame_id, FrameTimestamps*)>;
+
+    struct Stats {
+        uint64_t queued_frames;
+        uint64_t presented_frames;
+        uint64_t throttled_acquires;
+        int64_t throttled_time;
+        uint64_t queue_depth_sum;
+        uint64_t max_queue_depth;
+        // Sum of acquire to present time of the presented frames.
+        int64_t latency_sum;
+    };
+
+    // Parses the value of debug.vulkan.present_pacing.
+    static Mode ParseMode(const std::string& value);
+
+    PresentPacer(Mode mode, int64_t refresh_duration);
+
+    // Follows changes of the display refresh rate. Ignores durations that
+    // aren't positive.
+    void SetRefreshDuration(int64_t refresh_duration);
+
+    // Polls the timestamps of the frames still queued.
+    void Update(const QueryFn& query);
+
+    // Returns the time the next acquire should wait until, or 0 if it
+    // shouldn't wait.
+    int64_t GetAcquireTime(int64_t now) const;
+
+    void OnAcquire(int64_t now, int64_t waited);
+    void OnQueue(uint64_t frame_id, int64_t now);
+
+    const Stats& GetStats() const { return stats_; }
+
+   private:
+    struct PendingFrame {
+        uint64_t frame_id;
+        int64_t acquire_time;
+        int64_t queue_time;
+    };
+
+    // Returns the first vsync at or after time.
+    int64_t NextVsync(int64_t time) const;
+    // Returns the predicted present time of pending_[index].
+    int64_t PredictPresent(size_t index) const;
+
+    const Mode mode_;
+    int64_t refresh_duration_;
+
+    std::deque<PendingFrame> pending_;
+    int64_t acquire_time_;
+    // The most recent present, which anchors the vsync grid.
+    int64_t last_present_;
+    // Moving averages of latch to present, and of acquire to render complete.
+    int64_t latch_to_present_;
+    int64_t render_duration_;
+
+    Stats stats_;
+};
+
+}  // namespace driver
+}  // namespace vulkan
+
+#endif  // LIBVULKAN_PRESENT_PACER_H
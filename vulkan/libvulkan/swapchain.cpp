@@ -19,6 +19,7 @@
 
 #include <aidl/android/hardware/graphics/common/Dataspace.h>
 #include <aidl/android/hardware/graphics/common/PixelFormat.h>
+#include <android-base/properties.h>
 #include <android/hardware/graphics/common/1.0/types.h>
 #include <android/hardware_buffer.h>
 #include <grallocusage/GrallocUsageConversion.h>
@@ -33,11 +34,15 @@
 #include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <time.h>
+
 #include <algorithm>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
 #include "driver.h"
+#include "present_pacer.h"
 
 using PixelFormat = aidl::android::hardware::graphics::common::PixelFormat;
 using DataSpace = aidl::android::hardware::graphics::common::Dataspace;
@@ -270,6 +275,9 @@ enum { MAX_TIMING_INFOS = 10 };
 // syncronous requests to Surface Flinger):
 enum { MIN_NUM_FRAMES_AGO = 5 };
 
+static_assert(PresentPacer::kTimestampPending == NATIVE_WINDOW_TIMESTAMP_PENDING,
+              "PresentPacer expects the native pending timestamp");
+
 bool IsSharedPresentMode(VkPresentModeKHR mode) {
     return mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
         mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR;
@@ -339,6 +347,9 @@ struct Swapchain {
     } images[android::BufferQueueDefs::NUM_BUFFER_SLOTS];
 
     std::vector<TimingInfo> timing;
+
+    // Set when debug.vulkan.present_pacing enables pacing for this swapchain.
+    std::unique_ptr<PresentPacer> pacer;
 };
 
 VkSwapchainKHR HandleFromSwapchain(Swapchain* swapchain) {
@@ -2150,6 +2161,20 @@ VkResult CreateSwapchainKHR(VkDevice device,
     android::GraphicsEnv::getInstance().setTargetStats(
         android::GpuStatsInfo::Stats::CREATED_VULKAN_SWAPCHAIN);
 
+    // Present pacing predicts the display deadlines from the frame
+    // timestamps, and only applies to the queued present modes.
+    if (create_info->presentMode == VK_PRESENT_MODE_FIFO_KHR ||
+        create_info->presentMode == VK_PRESENT_MODE_FIFO_RELAXED_KHR) {
+        const PresentPacer::Mode pacing_mode = PresentPacer::ParseMode(
+            android::base::GetProperty("debug.vulkan.present_pacing", ""));
+        if (pacing_mode != PresentPacer::Mode::kOff) {
+            native_window_enable_frame_timestamps(window, true);
+            swapchain->frame_timestamps_enabled = true;
+            swapchain->pacer =
+                std::make_unique<PresentPacer>(pacing_mode, refresh_duration);
+        }
+    }
+
     surface.used_by_swapchain = true;
     surface.swapchain_handle = HandleFromSwapchain(swapchain);
     *swapchain_handle = surface.swapchain_handle;
@@ -2193,6 +2218,53 @@ VkResult GetSwapchainImagesKHR(VkDevice,
     return result;
 }
 
+// Waits until the pacer predicts the next frame may start. Returns how long
+// it waited.
+static nsecs_t PaceAcquire(Swapchain& swapchain, uint64_t timeout) {
+    if (!swapchain.pacer)
+        return 0;
+
+    ANativeWindow* window = swapchain.surface.window.get();
+    swapchain.pacer->Update(
+        [window](uint64_t frame_id, PresentPacer::FrameTimestamps* timestamps) {
+            return native_window_get_frame_timestamps(
+                       window, frame_id,
+                       nullptr,  //&desired_present_time,
+                       &timestamps->render_complete, &timestamps->latch,
+                       nullptr,  //&first_composition_start_time,
+                       nullptr,  //&last_composition_start_time,
+                       nullptr,  //&composition_finish_time,
+                       &timestamps->present,
+                       nullptr,  //&dequeue_ready_time,
+                       nullptr /*&reads_done_time*/) == android::OK;
+        });
+    // The compositor interval comes with the frame timestamps, so unlike
+    // getDisplayRefreshCycleDuration it doesn't cost a binder call.
+    nsecs_t refresh_duration;
+    if (native_window_get_compositor_timing(window, nullptr, &refresh_duration,
+                                            nullptr) == android::OK) {
+        swapchain.pacer->SetRefreshDuration(refresh_duration);
+    }
+
+    const nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t wake_time = swapchain.pacer->GetAcquireTime(now);
+    if (wake_time == 0)
+        return 0;
+    // The wait counts against the timeout of the acquire.
+    if (timeout < static_cast<uint64_t>(wake_time - now))
+        wake_time = now + static_cast<nsecs_t>(timeout);
+
+    ATRACE_NAME("PaceAcquire");
+    const struct timespec wake = {
+        .tv_sec = static_cast<time_t>(wake_time / 1000000000),
+        .tv_nsec = static_cast<long>(wake_time % 1000000000),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) ==
+           EINTR) {
+    }
+    return systemTime(SYSTEM_TIME_MONOTONIC) - now;
+}
+
 VKAPI_ATTR
 VkResult AcquireNextImageKHR(VkDevice device,
                              VkSwapchainKHR swapchain_handle,
@@ -2220,8 +2292,16 @@ VkResult AcquireNextImageKHR(VkDevice device,
         return result;
     }
 
-    const nsecs_t acquire_next_image_timeout =
+    // A zero timeout asks for a non-blocking acquire, which isn't paced.
+    const nsecs_t paced_time = timeout ? PaceAcquire(swapchain, timeout) : 0;
+
+    nsecs_t acquire_next_image_timeout =
         timeout > (uint64_t)std::numeric_limits<nsecs_t>::max() ? -1 : timeout;
+    // dequeueBuffer only gets what the pacing wait left of the timeout.
+    if (acquire_next_image_timeout > 0 && paced_time > 0) {
+        acquire_next_image_timeout =
+            std::max<nsecs_t>(acquire_next_image_timeout - paced_time, 0);
+    }
     if (acquire_next_image_timeout != swapchain.acquire_next_image_timeout) {
         // Cache the timeout to avoid the duplicate binder cost.
         err = window->perform(window, NATIVE_WINDOW_SET_DEQUEUE_TIMEOUT,
@@ -2245,6 +2325,11 @@ VkResult AcquireNextImageKHR(VkDevice device,
         return VK_ERROR_SURFACE_LOST_KHR;
     }
 
+    if (swapchain.pacer) {
+        swapchain.pacer->OnAcquire(systemTime(SYSTEM_TIME_MONOTONIC),
+                                   paced_time);
+    }
+
     uint32_t idx;
     for (idx = 0; idx < swapchain.num_images; idx++) {
         if (swapchain.images[idx].buffer.get() == buffer) {
@@ -2525,6 +2610,13 @@ static VkResult PresentOneSwapchain(
                         VK_ERROR_SURFACE_LOST_KHR);
             }
 
+            uint64_t pacer_frame_id = 0;
+            if (swapchain.pacer &&
+                native_window_get_next_frame_id(window, &pacer_frame_id) !=
+                    android::OK) {
+                ALOGE("Failed to get next native frame ID.");
+            }
+
             err = window->queueBuffer(window, img.buffer.get(), fence);
             // queueBuffer always closes fence, even on error
             if (err != android::OK) {
@@ -2532,6 +2624,10 @@ static VkResult PresentOneSwapchain(
                 swapchain_result = WorstPresentResult(
                     swapchain_result, VK_ERROR_SURFACE_LOST_KHR);
             } else {
+                if (swapchain.pacer) {
+                    swapchain.pacer->OnQueue(pacer_frame_id,
+                                             systemTime(SYSTEM_TIME_MONOTONIC));
+                }
                 if (img.dequeue_fence >= 0) {
                     close(img.dequeue_fence);
                     img.dequeue_fence = -1;
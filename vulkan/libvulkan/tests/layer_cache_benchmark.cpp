@@ -0,0 +1,96 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures loading the layer cache, and looking up every library in it, which
+// is what discovery does instead of opening the libraries.
+
+#include "layer_cache.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <benchmark/benchmark.h>
+
+namespace vulkan {
+namespace api {
+namespace {
+
+constexpr FileStamp kStamp = {4096, 1234567890};
+
+std::string LibraryPath(int64_t i) {
+    return "/data/app/layers/libVkLayer_" + std::to_string(i) + ".so";
+}
+
+// Writes a cache file of the given number of libraries of one layer each.
+void SaveCache(const std::string& filename, int64_t library_count) {
+    LayerCache cache(filename);
+    for (int64_t i = 0; i < library_count; i++) {
+        Layer layer = {};
+        snprintf(layer.properties.layerName,
+                 sizeof(layer.properties.layerName), "VK_LAYER_test_%ld",
+                 static_cast<long>(i));
+        layer.instance_extensions.resize(2);
+        layer.device_extensions.resize(2);
+        cache.AddLibrary(LibraryPath(i), kStamp, &layer, 1);
+    }
+    cache.Save();
+}
+
+void BM_LayerCache_Load(benchmark::State& state) {
+    TemporaryDir dir;
+    const std::string filename = std::string(dir.path) + "/layer_cache";
+    SaveCache(filename, state.range(0));
+
+    for (auto _ : state) {
+        LayerCache cache(filename);
+        cache.Load();
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_LayerCache_Load)->Arg(1)->Arg(10)->Arg(50);
+
+void BM_LayerCache_LoadAndFindAll(benchmark::State& state) {
+    TemporaryDir dir;
+    const std::string filename = std::string(dir.path) + "/layer_cache";
+    SaveCache(filename, state.range(0));
+
+    std::vector<std::string> paths;
+    for (int64_t i = 0; i < state.range(0); i++)
+        paths.push_back(LibraryPath(i));
+
+    std::vector<Layer> layers;
+    for (auto _ : state) {
+        LayerCache cache(filename);
+        cache.Load();
+        layers.clear();
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!cache.FindLibrary(paths[i], kStamp, i, layers))
+                state.SkipWithError("cached library not found");
+        }
+        cache.Save();
+        benchmark::DoNotOptimize(layers.data());
+    }
+}
+BENCHMARK(BM_LayerCache_LoadAndFindAll)->Arg(1)->Arg(10)->Arg(50);
+
+}  // namespace
+}  // namespace api
+}  // namespace vulkan
+
+BENCHMARK_MAIN();
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "layer_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+namespace vulkan {
+namespace api {
+namespace {
+
+constexpr FileStamp kStamp = {4096, 1234567890};
+constexpr char kLibraryPath[] = "/data/app/layers/libVkLayer_test.so";
+constexpr char kZipDirPath[] = "/data/app/base.apk!/lib/arm64-v8a";
+
+Layer MakeLayer(const char* name, bool is_global) {
+    Layer layer = {};
+    snprintf(layer.properties.layerName, sizeof(layer.properties.layerName),
+             "%s", name);
+    snprintf(layer.properties.description,
+             sizeof(layer.properties.description), "%s description", name);
+    layer.properties.specVersion = VK_API_VERSION_1_1;
+    layer.properties.implementationVersion = 2;
+    layer.is_global = is_global;
+
+    VkExtensionProperties extension = {};
+    snprintf(extension.extensionName, sizeof(extension.extensionName),
+             "VK_EXT_%s_instance", name);
+    extension.specVersion = 3;
+    layer.instance_extensions.push_back(extension);
+    if (is_global) {
+        snprintf(extension.extensionName, sizeof(extension.extensionName),
+                 "VK_EXT_%s_device", name);
+        layer.device_extensions.push_back(extension);
+    }
+    return layer;
+}
+
+class LayerCacheTest : public testing::Test {
+   protected:
+    void SetUp() override {
+        filename_ = std::string(dir_.path) + "/layer_cache";
+        layers_ = {MakeLayer("VK_LAYER_test_a", true),
+                   MakeLayer("VK_LAYER_test_b", false)};
+    }
+
+    // Writes a cache file with one library and one directory in an APK.
+    std::string SaveCache() {
+        LayerCache cache(filename_);
+        cache.AddLibrary(kLibraryPath, kStamp, layers_.data(), layers_.size());
+        cache.AddZipDir(kZipDirPath, kStamp,
+                        {"libVkLayer_a.so", "libVkLayer_b.so"});
+        cache.Save();
+
+        std::string data;
+        EXPECT_TRUE(android::base::ReadFileToString(filename_, &data));
+        return data;
+    }
+
+    // Loads a cache file with the given contents, and returns whether it
+    // provided the library saved by SaveCache.
+    bool LoadsLibrary(const std::string& data) {
+        EXPECT_TRUE(android::base::WriteStringToFile(data, filename_));
+        LayerCache cache(filename_);
+        cache.Load();
+        std::vector<Layer> layers;
+        return cache.FindLibrary(kLibraryPath, kStamp, 0, layers);
+    }
+
+    TemporaryDir dir_;
+    std::string filename_;
+    std::vector<Layer> layers_;
+};
+
+void ExpectSameExtensions(const std::vector<VkExtensionProperties>& expected,
+                          const std::vector<VkExtensionProperties>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_STREQ(expected[i].extensionName, actual[i].extensionName);
+        EXPECT_EQ(expected[i].specVersion, actual[i].specVersion);
+    }
+}
+
+TEST_F(LayerCacheTest, LoadsSavedEntries) {
+    SaveCache();
+
+    LayerCache cache(filename_);
+    cache.Load();
+
+    std::vector<Layer> layers;
+    ASSERT_TRUE(cache.FindLibrary(kLibraryPath, kStamp, 7, layers));
+    ASSERT_EQ(layers_.size(), layers.size());
+    for (size_t i = 0; i < layers.size(); i++) {
+        EXPECT_STREQ(layers_[i].properties.layerName,
+                     layers[i].properties.layerName);
+        EXPECT_STREQ(layers_[i].properties.description,
+                     layers[i].properties.description);
+        EXPECT_EQ(layers_[i].properties.specVersion,
+                  layers[i].properties.specVersion);
+        EXPECT_EQ(layers_[i].is_global, layers[i].is_global);
+        EXPECT_EQ(7u, layers[i].library_idx);
+        ExpectSameExtensions(layers_[i].instance_extensions,
+                             layers[i].instance_extensions);
+        ExpectSameExtensions(layers_[i].device_extensions,
+                             layers[i].device_extensions);
+    }
+
+    const std::vector<std::string>* filenames =
+        cache.FindZipDir(kZipDirPath, kStamp);
+    ASSERT_NE(nullptr, filenames);
+    EXPECT_EQ((std::vector<std::string>{"libVkLayer_a.so", "libVkLayer_b.so"}),
+              *filenames);
+
+    EXPECT_EQ(1u, cache.GetHitCount());
+    EXPECT_EQ(0u, cache.GetMissCount());
+}
+
+TEST_F(LayerCacheTest, ChangedFilesMiss) {
+    SaveCache();
+
+    LayerCache cache(filename_);
+    cache.Load();
+
+    std::vector<Layer> layers;
+    EXPECT_FALSE(cache.FindLibrary(kLibraryPath,
+                                   {kStamp.size + 1, kStamp.mtime_ns}, 0,
+                                   layers));
+    EXPECT_FALSE(cache.FindLibrary(kLibraryPath,
+                                   {kStamp.size, kStamp.mtime_ns + 1}, 0,
+                                   layers));
+    EXPECT_FALSE(cache.FindLibrary("/data/app/layers/libVkLayer_other.so",
+                                   kStamp, 0, layers));
+    EXPECT_TRUE(layers.empty());
+    EXPECT_EQ(nullptr,
+              cache.FindZipDir(kZipDirPath, {kStamp.size, kStamp.mtime_ns + 1}));
+    EXPECT_EQ(3u, cache.GetMissCount());
+}
+
+TEST_F(LayerCacheTest, MissingFileIsEmpty) {
+    LayerCache cache(filename_);
+    cache.Load();
+
+    std::vector<Layer> layers;
+    EXPECT_FALSE(cache.FindLibrary(kLibraryPath, kStamp, 0, layers));
+    EXPECT_EQ(nullptr, cache.FindZipDir(kZipDirPath, kStamp));
+}
+
+TEST_F(LayerCacheTest, IgnoresTruncatedFile) {
+    const std::string data = SaveCache();
+    ASSERT_TRUE(LoadsLibrary(data));
+
+    for (size_t size = 0; size < data.size(); size++) {
+        EXPECT_FALSE(LoadsLibrary(data.substr(0, size))) << "size " << size;
+    }
+}
+
+TEST_F(LayerCacheTest, IgnoresTrailingData) {
+    const std::string data = SaveCache();
+    EXPECT_FALSE(LoadsLibrary(data + '\0'));
+    EXPECT_FALSE(LoadsLibrary(data + data));
+}
+
+TEST_F(LayerCacheTest, IgnoresOtherVersion) {
+    std::string data = SaveCache();
+    data[4]++;
+    EXPECT_FALSE(LoadsLibrary(data));
+}
+
+TEST_F(LayerCacheTest, IgnoresHugeCounts) {
+    const std::string data = SaveCache();
+
+    // The library count follows the magic and the version.
+    std::string corrupt = data;
+    memset(corrupt.data() + 8, 0xff, sizeof(uint32_t));
+    EXPECT_FALSE(LoadsLibrary(corrupt));
+
+    // Every other count and size fails the bounds checks too, rather than
+    // allocating or reading past the end.
+    for (size_t offset = 12; offset + sizeof(uint32_t) <= data.size();
+         offset++) {
+        corrupt = data;
+        memset(corrupt.data() + offset, 0xff, sizeof(uint32_t));
+        LoadsLibrary(corrupt);
+    }
+}
+
+TEST_F(LayerCacheTest, LoadedNamesAreTerminated) {
+    std::string data = SaveCache();
+
+    // Overwrite the name and description of the first layer, which follow the
+    // library count, path and stamp, and the layer count.
+    const size_t layer_offset = 12 + sizeof(uint32_t) + strlen(kLibraryPath) +
+                                sizeof(FileStamp) + sizeof(uint32_t);
+    memset(data.data() + layer_offset, 'x', VK_MAX_EXTENSION_NAME_SIZE);
+    ASSERT_TRUE(LoadsLibrary(data));
+
+    LayerCache cache(filename_);
+    cache.Load();
+    std::vector<Layer> layers;
+    ASSERT_TRUE(cache.FindLibrary(kLibraryPath, kStamp, 0, layers));
+    EXPECT_EQ(VK_MAX_EXTENSION_NAME_SIZE - 1,
+              strlen(layers[0].properties.layerName));
+}
+
+TEST_F(LayerCacheTest, SavesOnlyWhenEntriesChange) {
+    SaveCache();
+
+    LayerCache cache(filename_);
+    cache.Load();
+    std::vector<Layer> layers;
+    ASSERT_TRUE(cache.FindLibrary(kLibraryPath, kStamp, 0, layers));
+    ASSERT_NE(nullptr, cache.FindZipDir(kZipDirPath, kStamp));
+
+    // Every loaded entry was used, so the file is left alone.
+    ASSERT_TRUE(android::base::WriteStringToFile("unchanged", filename_));
+    cache.Save();
+    std::string data;
+    ASSERT_TRUE(android::base::ReadFileToString(filename_, &data));
+    EXPECT_EQ("unchanged", data);
+
+    // A new library is written out.
+    cache.AddLibrary("/data/app/layers/libVkLayer_other.so", kStamp, nullptr,
+                     0);
+    cache.Save();
+    LayerCache reloaded(filename_);
+    reloaded.Load();
+    EXPECT_TRUE(reloaded.FindLibrary("/data/app/layers/libVkLayer_other.so",
+                                     kStamp, 0, layers));
+    EXPECT_TRUE(reloaded.FindLibrary(kLibraryPath, kStamp, 0, layers));
+}
+
+}  // namespace
+}  // namespace api
+}  // namespace vulkan
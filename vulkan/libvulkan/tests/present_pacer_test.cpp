@@ -0,0 +1,180 @@
+/*
+ * Copyright 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "present_pacer.h"
+
+#include <map>
+
+#include <gtest/gtest.h>
+
+namespace vulkan {
+namespace driver {
+namespace {
+
+constexpr int64_t kMs = 1'000'000;
+constexpr int64_t kRefreshDuration = 16 * kMs;
+constexpr PresentPacer::FrameTimestamps kPending = {
+    PresentPacer::kTimestampPending, PresentPacer::kTimestampPending,
+    PresentPacer::kTimestampPending};
+
+class PresentPacerTest : public ::testing::Test {
+   protected:
+    void Update(PresentPacer& pacer) {
+        pacer.Update([this](uint64_t frame_id,
+                            PresentPacer::FrameTimestamps* timestamps) {
+            auto it = timestamps_.find(frame_id);
+            if (it == timestamps_.end())
+                return false;
+            *timestamps = it->second;
+            return true;
+        });
+    }
+
+    // Presents frame 1 at 26ms, which anchors the vsync grid and measures a
+    // latch to present time of one refresh.
+    void Anchor(PresentPacer& pacer) {
+        pacer.OnAcquire(1 * kMs, 0);
+        pacer.OnQueue(1, 5 * kMs);
+        timestamps_[1] = {4 * kMs, 10 * kMs, 26 * kMs};
+        Update(pacer);
+    }
+
+    void QueuePending(PresentPacer& pacer, uint64_t frame_id, int64_t now) {
+        pacer.OnQueue(frame_id, now);
+        timestamps_[frame_id] = kPending;
+    }
+
+    std::map<uint64_t, PresentPacer::FrameTimestamps> timestamps_;
+};
+
+TEST_F(PresentPacerTest, ParseMode) {
+    EXPECT_EQ(PresentPacer::Mode::kOff, PresentPacer::ParseMode(""));
+    EXPECT_EQ(PresentPacer::Mode::kOff, PresentPacer::ParseMode("off"));
+    EXPECT_EQ(PresentPacer::Mode::kThrottle,
+              PresentPacer::ParseMode("throttle"));
+    EXPECT_EQ(PresentPacer::Mode::kLowLatency,
+              PresentPacer::ParseMode("low_latency"));
+    EXPECT_EQ(PresentPacer::Mode::kOff, PresentPacer::ParseMode("fast"));
+}
+
+TEST_F(PresentPacerTest, OffNeverWaits) {
+    PresentPacer pacer(PresentPacer::Mode::kOff, kRefreshDuration);
+    Anchor(pacer);
+    QueuePending(pacer, 2, 30 * kMs);
+    QueuePending(pacer, 3, 31 * kMs);
+    Update(pacer);
+    EXPECT_EQ(0, pacer.GetAcquireTime(32 * kMs));
+}
+
+TEST_F(PresentPacerTest, NoWaitWithoutPresent) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    QueuePending(pacer, 1, 5 * kMs);
+    QueuePending(pacer, 2, 6 * kMs);
+    QueuePending(pacer, 3, 7 * kMs);
+    Update(pacer);
+    EXPECT_EQ(0, pacer.GetAcquireTime(8 * kMs));
+}
+
+TEST_F(PresentPacerTest, ThrottleWaitsForTwoQueuedFrames) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    Anchor(pacer);
+
+    QueuePending(pacer, 2, 30 * kMs);
+    Update(pacer);
+    EXPECT_EQ(0, pacer.GetAcquireTime(31 * kMs));
+
+    // Frame 2 is latched after 30ms and presented at the 58ms vsync, so the
+    // next acquire waits until it is latched.
+    QueuePending(pacer, 3, 31 * kMs);
+    Update(pacer);
+    EXPECT_EQ(42 * kMs, pacer.GetAcquireTime(32 * kMs));
+    EXPECT_EQ(0, pacer.GetAcquireTime(42 * kMs));
+}
+
+TEST_F(PresentPacerTest, LowLatencyLeavesRoomForRender) {
+    PresentPacer pacer(PresentPacer::Mode::kLowLatency, kRefreshDuration);
+    Anchor(pacer);
+
+    // Frame 1 rendered for 4ms, which the average weighs in by an eighth.
+    QueuePending(pacer, 2, 30 * kMs);
+    Update(pacer);
+    const int64_t render_duration = 4 * kMs / 8;
+    EXPECT_EQ(42 * kMs + kRefreshDuration - render_duration -
+                      kRefreshDuration / 4,
+              pacer.GetAcquireTime(32 * kMs));
+}
+
+TEST_F(PresentPacerTest, DropsFramesWithoutTimestamps) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    Anchor(pacer);
+    pacer.OnQueue(2, 30 * kMs);
+    pacer.OnQueue(3, 31 * kMs);
+    Update(pacer);
+    EXPECT_EQ(0, pacer.GetAcquireTime(32 * kMs));
+}
+
+TEST_F(PresentPacerTest, FollowsRefreshDuration) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    Anchor(pacer);
+    QueuePending(pacer, 2, 30 * kMs);
+    QueuePending(pacer, 3, 31 * kMs);
+    Update(pacer);
+
+    // At 8ms frame 2 makes the 50ms vsync instead.
+    pacer.SetRefreshDuration(8 * kMs);
+    EXPECT_EQ(34 * kMs, pacer.GetAcquireTime(32 * kMs));
+    pacer.SetRefreshDuration(0);
+    EXPECT_EQ(34 * kMs, pacer.GetAcquireTime(32 * kMs));
+}
+
+TEST_F(PresentPacerTest, ClampsWait) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    Anchor(pacer);
+    QueuePending(pacer, 2, 30 * kMs);
+    QueuePending(pacer, 3, 31 * kMs);
+    Update(pacer);
+
+    pacer.SetRefreshDuration(1000 * kMs);
+    EXPECT_EQ(132 * kMs, pacer.GetAcquireTime(32 * kMs));
+}
+
+TEST_F(PresentPacerTest, Stats) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    Anchor(pacer);
+    QueuePending(pacer, 2, 30 * kMs);
+    QueuePending(pacer, 3, 31 * kMs);
+    pacer.OnAcquire(42 * kMs, 10 * kMs);
+    pacer.OnAcquire(43 * kMs, 0);
+
+    const PresentPacer::Stats& stats = pacer.GetStats();
+    EXPECT_EQ(3u, stats.queued_frames);
+    EXPECT_EQ(1u, stats.presented_frames);
+    EXPECT_EQ(1u, stats.throttled_acquires);
+    EXPECT_EQ(10 * kMs, stats.throttled_time);
+    EXPECT_EQ(2u, stats.max_queue_depth);
+    EXPECT_EQ(25 * kMs, stats.latency_sum);
+}
+
+TEST_F(PresentPacerTest, BoundsPendingFrames) {
+    PresentPacer pacer(PresentPacer::Mode::kThrottle, kRefreshDuration);
+    for (uint64_t frame_id = 1; frame_id <= 20; frame_id++)
+        QueuePending(pacer, frame_id, static_cast<int64_t>(frame_id) * kMs);
+    EXPECT_EQ(8u, pacer.GetStats().max_queue_depth);
+}
+
+}  // namespace
+}  // namespace driver
+}  // namespace vulkan
@@ -29,6 +29,63 @@ _INTERCEPTED_COMMANDS = [
     'vkEnumerateDeviceLayerProperties',
 ]
 
+# Device dispatch table entries that are placed first, in this order. They are
+# the commands recorded for every draw or pass, or called for every frame, so
+# the commands of a draw are next to each other in the table.
+_HOT_DEVICE_COMMANDS = [
+    # called for every draw
+    'vkCmdDrawIndexed',
+    'vkCmdDraw',
+    'vkCmdBindDescriptorSets',
+    'vkCmdBindPipeline',
+    'vkCmdBindVertexBuffers',
+    'vkCmdBindIndexBuffer',
+    'vkCmdPushConstants',
+    'vkCmdDrawIndexedIndirect',
+    # dynamic state and compute
+    'vkCmdSetViewport',
+    'vkCmdSetScissor',
+    'vkCmdSetStencilReference',
+    'vkCmdSetDepthBias',
+    'vkCmdSetCullMode',
+    'vkCmdSetPrimitiveTopology',
+    'vkCmdDispatch',
+    'vkCmdDrawIndirect',
+    # called for every pass
+    'vkCmdPipelineBarrier',
+    'vkCmdPipelineBarrier2',
+    'vkCmdBeginRendering',
+    'vkCmdEndRendering',
+    'vkCmdBeginRenderPass',
+    'vkCmdEndRenderPass',
+    'vkCmdNextSubpass',
+    'vkCmdCopyBuffer',
+    # called for every frame
+    'vkUpdateDescriptorSets',
+    'vkAllocateDescriptorSets',
+    'vkBeginCommandBuffer',
+    'vkEndCommandBuffer',
+    'vkQueueSubmit',
+    'vkQueueSubmit2',
+    'vkAcquireNextImageKHR',
+    'vkQueuePresentKHR',
+]
+
+# Alignment of DeviceDispatchTable, so that its first entries start a cache
+# line.
+_CACHE_LINE_SIZE = 64
+
+
+def _hot_order(cmd):
+  """Returns the sort key that moves _HOT_DEVICE_COMMANDS to the front.
+
+  Args:
+    cmd: Vulkan function name.
+  """
+  if cmd in _HOT_DEVICE_COMMANDS:
+    return _HOT_DEVICE_COMMANDS.index(cmd)
+  return len(_HOT_DEVICE_COMMANDS)
+
 
 def gen_h():
   """Generates the api_gen.h file.
@@ -39,6 +96,7 @@ def gen_h():
   with open(genfile, 'w') as f:
     instance_dispatch_table_entries = []
     device_dispatch_table_entries = []
+    device_commands = []
 
     for cmd in gencom.command_list:
       if cmd not in gencom.alias_dict:
@@ -46,8 +104,12 @@ def gen_h():
           instance_dispatch_table_entries.append(
               'PFN_' + cmd + ' ' + gencom.base_name(cmd) + ';')
         elif gencom.is_device_dispatch_table_entry(cmd):
-          device_dispatch_table_entries.append(
-              'PFN_' + cmd + ' ' + gencom.base_name(cmd) + ';')
+          device_commands.append(cmd)
+
+    # sorted() is stable, so the other commands keep the registry order.
+    for cmd in sorted(device_commands, key=_hot_order):
+      device_dispatch_table_entries.append(
+          'PFN_' + cmd + ' ' + gencom.base_name(cmd) + ';')
 
     f.write(gencom.copyright_and_warning(2016))
 
@@ -77,7 +139,9 @@ struct InstanceDispatchTable {
     // clang-format on
 };
 
-struct DeviceDispatchTable {
+// The commands of draws, passes and frames come first, see
+// _HOT_DEVICE_COMMANDS in api_generator.py.
+struct alignas(""" + str(_CACHE_LINE_SIZE) + """) DeviceDispatchTable {
     // clang-format off\n""")
 
     for entry in device_dispatch_table_entries:
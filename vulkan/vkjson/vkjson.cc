@@ -21,8 +21,10 @@
 #include "vkjson.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <json/json.h>
 
@@ -1280,106 +1282,356 @@ template <typename T>
 using EnableForEnum =
     typename std::enable_if<std::is_enum<T>::value, void>::type;
 
+// Buffers the output of the writers below, and appends it to a string or
+// writes it to a file descriptor.
+class OutputStream {
+ public:
+  explicit OutputStream(std::string* out)
+      : out_(out), fd_(-1), size_(0), ok_(true) {}
+  explicit OutputStream(int fd) : out_(nullptr), fd_(fd), size_(0), ok_(true) {}
+
+  ~OutputStream() { Flush(); }
+
+  void Write(const char* data, size_t size) {
+    if (size > sizeof(buffer_) - size_) {
+      Flush();
+      if (size > sizeof(buffer_)) {
+        WriteOut(data, size);
+        return;
+      }
+    }
+    memcpy(buffer_ + size_, data, size);
+    size_ += size;
+  }
+
+  void Write(const char* string) { Write(string, strlen(string)); }
+
+  bool Flush() {
+    WriteOut(buffer_, size_);
+    size_ = 0;
+    return ok_;
+  }
+
+ private:
+  void WriteOut(const char* data, size_t size) {
+    if (out_) {
+      out_->append(data, size);
+      return;
+    }
+    while (ok_ && size > 0) {
+      ssize_t written = write(fd_, data, size);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        ok_ = false;
+        break;
+      }
+      data += written;
+      size -= static_cast<size_t>(written);
+    }
+  }
+
+  std::string* out_;
+  int fd_;
+  size_t size_;
+  bool ok_;
+  char buffer_[4096];
+};
+
+// The most members any of the objects above has.
+constexpr size_t kMaxObjectMembers = 128;
+
+// Collects the keys of an object in the order they are visited.
+class KeyCollectorVisitor {
+ public:
+  KeyCollectorVisitor() : count_(0) {}
+
+  template <typename T> bool Visit(const char* key, const T*) {
+    Add(key);
+    return true;
+  }
+
+  template <typename T, uint32_t N>
+  bool VisitArray(const char* key, uint32_t, const T (*)[N]) {
+    Add(key);
+    return true;
+  }
+
+  template <typename T>
+  bool VisitArray(const char* key, uint32_t, const T*) {
+    Add(key);
+    return true;
+  }
+
+  const char* const* keys() const { return keys_; }
+  size_t count() const { return count_; }
+
+  void Sort() {
+    std::sort(keys_, keys_ + count_, [](const char* a, const char* b) {
+      return strcmp(a, b) < 0;
+    });
+  }
+
+ private:
+  void Add(const char* key) {
+    assert(count_ < kMaxObjectMembers);
+    if (count_ < kMaxObjectMembers)
+      keys_[count_++] = key;
+  }
+
+  const char* keys_[kMaxObjectMembers];
+  size_t count_;
+};
+
+class JsonStreamWriter;
+
 template <typename T, typename = EnableForStruct<T>, typename = void>
-Json::Value ToJsonValue(const T& value);
+void WriteJson(JsonStreamWriter* writer, const T& value);
 
 template <typename T, typename = EnableForArithmetic<T>>
-inline Json::Value ToJsonValue(const T& value) {
-  return Json::Value(
-      std::clamp(static_cast<double>(value), SAFE_DOUBLE_MIN, SAFE_DOUBLE_MAX));
-}
+void WriteJson(JsonStreamWriter* writer, const T& value);
 
-inline Json::Value ToJsonValue(const uint64_t& value) {
-  char string[19] = {0};  // "0x" + 16 digits + terminal \0
-  snprintf(string, sizeof(string), "0x%016" PRIx64, value);
-  return Json::Value(string);
-}
+inline void WriteJson(JsonStreamWriter* writer, const uint64_t& value);
 
 template <typename T, typename = EnableForEnum<T>, typename = void,
           typename = void>
-inline Json::Value ToJsonValue(const T& value) {
-  return Json::Value(static_cast<double>(value));
-}
-
-template <typename T>
-inline Json::Value ArrayToJsonValue(uint32_t count, const T* values) {
-  Json::Value array(Json::arrayValue);
-  for (unsigned int i = 0; i < count; ++i) array.append(ToJsonValue(values[i]));
-  return array;
-}
+void WriteJson(JsonStreamWriter* writer, const T& value);
 
 template <typename T, size_t N>
-inline Json::Value ToJsonValue(const T (&value)[N]) {
-  return ArrayToJsonValue(N, value);
-}
+void WriteJson(JsonStreamWriter* writer, const T (&value)[N]);
 
 template <size_t N>
-inline Json::Value ToJsonValue(const char (&value)[N]) {
-  assert(strlen(value) < N);
-  return Json::Value(value);
-}
+void WriteJson(JsonStreamWriter* writer, const char (&value)[N]);
 
 template <typename T>
-inline Json::Value ToJsonValue(const std::vector<T>& value) {
-  assert(value.size() <= std::numeric_limits<uint32_t>::max());
-  return ArrayToJsonValue(static_cast<uint32_t>(value.size()), value.data());
-}
+void WriteJson(JsonStreamWriter* writer, const std::vector<T>& value);
 
 template <typename F, typename S>
-inline Json::Value ToJsonValue(const std::pair<F, S>& value) {
-  Json::Value array(Json::arrayValue);
-  array.append(ToJsonValue(value.first));
-  array.append(ToJsonValue(value.second));
-  return array;
-}
+void WriteJson(JsonStreamWriter* writer, const std::pair<F, S>& value);
 
 template <typename F, typename S>
-inline Json::Value ToJsonValue(const std::map<F, S>& value) {
-  Json::Value array(Json::arrayValue);
-  for (auto& kv : value) array.append(ToJsonValue(kv));
-  return array;
-}
+void WriteJson(JsonStreamWriter* writer, const std::map<F, S>& value);
 
-class JsonWriterVisitor {
- public:
-  JsonWriterVisitor() : object_(Json::objectValue) {}
+template <typename T>
+void WriteJsonArray(JsonStreamWriter* writer, uint32_t count, const T* values);
 
-  ~JsonWriterVisitor() {}
+// Writes JSON in the format of Json::Value::toStyledString() without building
+// a Json::Value tree. jsoncpp sorts the members of an object by key, so each
+// object is iterated once to collect its keys, and then once per member to
+// write them in order.
+class JsonStreamWriter {
+ public:
+  explicit JsonStreamWriter(OutputStream* out)
+      : out_(out), depth_(0), indented_(true), key_(nullptr) {}
 
   template <typename T> bool Visit(const char* key, const T* value) {
-    object_[key] = ToJsonValue(*value);
+    if (key == key_) {
+      WriteKey(key);
+      WriteJson(this, *value);
+    }
     return true;
   }
 
   template <typename T, uint32_t N>
   bool VisitArray(const char* key, uint32_t count, const T (*value)[N]) {
     assert(count <= N);
-    object_[key] = ArrayToJsonValue(count, *value);
+    if (key == key_) {
+      WriteKey(key);
+      WriteJsonArray(this, count, *value);
+    }
     return true;
   }
 
   template <typename T>
   bool VisitArray(const char* key, uint32_t count, const T *value) {
-    object_[key] = ArrayToJsonValue(count, *value);
+    if (key == key_) {
+      WriteKey(key);
+      WriteJsonArray(this, *value ? count : 0, *value);
+    }
     return true;
   }
 
-  Json::Value get_object() const { return object_; }
+  template <typename T> void WriteObject(const T& value) {
+    T* object = const_cast<T*>(&value);
+    KeyCollectorVisitor collector;
+    Iterate(&collector, object);
+    if (collector.count() == 0) {
+      Write("{}");
+      return;
+    }
+    collector.Sort();
+
+    const char* parent_key = key_;
+    WriteWithIndent("{");
+    ++depth_;
+    for (size_t i = 0; i < collector.count(); ++i) {
+      if (i > 0)
+        Write(",");
+      key_ = collector.keys()[i];
+      Iterate(this, object);
+    }
+    key_ = parent_key;
+    --depth_;
+    WriteWithIndent("}");
+  }
+
+  // Writes count elements, calling write_element with the index of each.
+  template <typename F> void WriteArray(uint32_t count, F write_element) {
+    if (count == 0) {
+      Write("[]");
+      return;
+    }
+    WriteWithIndent("[");
+    ++depth_;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (i > 0)
+        Write(",");
+      if (!indented_)
+        WriteIndent();
+      indented_ = true;
+      write_element(i);
+      indented_ = false;
+    }
+    --depth_;
+    WriteWithIndent("]");
+  }
+
+  // Formats value like jsoncpp's valueToString(double).
+  void WriteNumber(double value) {
+    if (!std::isfinite(value)) {
+      Write(std::isnan(value) ? "null" : value < 0 ? "-1e+9999" : "1e+9999");
+      return;
+    }
+    char string[32];
+    // Nearly every value is a count or a flag, and "%.17g" prints whole
+    // numbers below 1e17 as plain digits, so format those directly.
+    if (!std::signbit(value) && value < 1e17 && std::floor(value) == value) {
+      uint64_t integer = static_cast<uint64_t>(value);
+      char* end = string + sizeof(string);
+      char* begin = end;
+      do {
+        *--begin = static_cast<char>('0' + integer % 10);
+        integer /= 10;
+      } while (integer);
+      out_->Write(begin, end - begin);
+      Write(".0");
+      return;
+    }
+    int length = snprintf(string, sizeof(string), "%.17g", value);
+    assert(length > 0 && length < static_cast<int>(sizeof(string)));
+    // Undo the decimal comma of some locales.
+    std::replace(string, string + length, ',', '.');
+    out_->Write(string, length);
+    if (!memchr(string, '.', length) && !memchr(string, 'e', length))
+      Write(".0");
+  }
+
+  void WriteString(const char* value) {
+    for (const char* c = value; *c; ++c) {
+      unsigned char ch = static_cast<unsigned char>(*c);
+      if (ch == '"' || ch == '\\' || ch < 0x20 || ch > 0x7f) {
+        Write(Json::valueToQuotedString(value).c_str());
+        return;
+      }
+    }
+    Write("\"");
+    Write(value);
+    Write("\"");
+  }
 
  private:
-  Json::Value object_;
+  void Write(const char* string) { out_->Write(string); }
+
+  void WriteIndent() {
+    Write("\n");
+    for (size_t i = 0; i < depth_; ++i)
+      Write("\t");
+  }
+
+  void WriteWithIndent(const char* string) {
+    if (!indented_)
+      WriteIndent();
+    Write(string);
+    indented_ = false;
+  }
+
+  void WriteKey(const char* key) {
+    WriteWithIndent("\"");
+    Write(key);
+    Write("\" : ");
+  }
+
+  OutputStream* out_;
+  size_t depth_;
+  // Whether the line was already broken and indented for the next value.
+  bool indented_;
+  // The key of the member being written by Visit.
+  const char* key_;
 };
 
-template <typename Visitor, typename T>
-inline void VisitForWrite(Visitor* visitor, const T& t) {
-  Iterate(visitor, const_cast<T*>(&t));
+template <typename T, typename /*= EnableForStruct<T>*/, typename /*= void*/>
+inline void WriteJson(JsonStreamWriter* writer, const T& value) {
+  writer->WriteObject(value);
 }
 
-template <typename T, typename /*= EnableForStruct<T>*/, typename /*= void*/>
-Json::Value ToJsonValue(const T& value) {
-  JsonWriterVisitor visitor;
-  VisitForWrite(&visitor, value);
-  return visitor.get_object();
+template <typename T, typename /*= EnableForArithmetic<T>*/>
+inline void WriteJson(JsonStreamWriter* writer, const T& value) {
+  writer->WriteNumber(
+      std::clamp(static_cast<double>(value), SAFE_DOUBLE_MIN, SAFE_DOUBLE_MAX));
+}
+
+inline void WriteJson(JsonStreamWriter* writer, const uint64_t& value) {
+  char string[19] = {0};  // "0x" + 16 digits + terminal \0
+  snprintf(string, sizeof(string), "0x%016" PRIx64, value);
+  writer->WriteString(string);
+}
+
+template <typename T, typename /*= EnableForEnum<T>*/, typename /*= void*/,
+          typename /*= void*/>
+inline void WriteJson(JsonStreamWriter* writer, const T& value) {
+  writer->WriteNumber(static_cast<double>(value));
+}
+
+template <typename T>
+inline void WriteJsonArray(JsonStreamWriter* writer, uint32_t count,
+                           const T* values) {
+  writer->WriteArray(count,
+                     [&](uint32_t i) { WriteJson(writer, values[i]); });
+}
+
+template <typename T, size_t N>
+inline void WriteJson(JsonStreamWriter* writer, const T (&value)[N]) {
+  WriteJsonArray(writer, N, value);
+}
+
+template <size_t N>
+inline void WriteJson(JsonStreamWriter* writer, const char (&value)[N]) {
+  assert(strlen(value) < N);
+  writer->WriteString(value);
+}
+
+template <typename T>
+inline void WriteJson(JsonStreamWriter* writer, const std::vector<T>& value) {
+  assert(value.size() <= std::numeric_limits<uint32_t>::max());
+  WriteJsonArray(writer, static_cast<uint32_t>(value.size()), value.data());
+}
+
+template <typename F, typename S>
+inline void WriteJson(JsonStreamWriter* writer, const std::pair<F, S>& value) {
+  writer->WriteArray(2, [&](uint32_t i) {
+    if (i == 0)
+      WriteJson(writer, value.first);
+    else
+      WriteJson(writer, value.second);
+  });
+}
+
+template <typename F, typename S>
+inline void WriteJson(JsonStreamWriter* writer, const std::map<F, S>& value) {
+  assert(value.size() <= std::numeric_limits<uint32_t>::max());
+  auto it = value.begin();
+  writer->WriteArray(static_cast<uint32_t>(value.size()),
+                     [&](uint32_t) { WriteJson(writer, *it++); });
 }
 
 template <typename T, typename = EnableForStruct<T>>
@@ -1575,10 +1827,24 @@ bool AsValue(Json::Value* json_value, T* t) {
 }
 
 
+template <typename T> void VkTypeWriteJson(const T& t, OutputStream* out) {
+  JsonStreamWriter writer(out);
+  writer.WriteObject(t);
+  out->Write("\n");
+}
+
 template <typename T> std::string VkTypeToJson(const T& t) {
-  JsonWriterVisitor visitor;
-  VisitForWrite(&visitor, t);
-  return visitor.get_object().toStyledString();
+  std::string json;
+  OutputStream out(&json);
+  VkTypeWriteJson(t, &out);
+  out.Flush();
+  return json;
+}
+
+template <typename T> bool VkTypeWriteJson(const T& t, int fd) {
+  OutputStream out(fd);
+  VkTypeWriteJson(t, &out);
+  return out.Flush();
 }
 
 template <typename T> bool VkTypeFromJson(const std::string& json,
@@ -1595,6 +1861,294 @@ template <typename T> bool VkTypeFromJson(const std::string& json,
   return AsValue(&object, t);
 }
 
+// The compact binary encoding. Values are written in the order Iterate visits
+// them, in host byte order: scalars as their raw bytes, strings and
+// std::vector or std::map values prefixed with their uint32_t size, and fixed
+// size arrays without a size. The members an object's Iterate switches on are
+// written ahead of it, so that the reader visits the same members.
+constexpr uint32_t kBinaryMagic = 0x424a4b56;  // "VKJB"
+constexpr uint32_t kBinaryVersion = 1;
+
+template <typename Visitor, typename T>
+inline bool VisitSelectors(Visitor*, T*) {
+  return true;
+}
+
+template <typename Visitor>
+inline bool VisitSelectors(Visitor* visitor, VkJsonDevice* device) {
+  return visitor->Visit("apiVersion", &device->properties.apiVersion) &&
+         visitor->Visit("VK_KHR_driver_properties",
+                        &device->ext_driver_properties.reported) &&
+         visitor->Visit("VK_KHR_variable_pointers",
+                        &device->ext_variable_pointer_features.reported) &&
+         visitor->Visit("VK_KHR_shader_float16_int8",
+                        &device->ext_shader_float16_int8_features.reported);
+}
+
+template <typename Visitor>
+inline bool VisitSelectors(Visitor* visitor, VkJsonInstance* instance) {
+  return visitor->Visit("apiVersion", &instance->api_version);
+}
+
+class BinaryWriterVisitor {
+ public:
+  explicit BinaryWriterVisitor(std::string* out) : out_(out) {}
+
+  template <typename T> bool Visit(const char*, const T* value) {
+    WriteValue(*value);
+    return true;
+  }
+
+  template <typename T, uint32_t N>
+  bool VisitArray(const char*, uint32_t count, const T (*value)[N]) {
+    assert(count <= N);
+    for (uint32_t i = 0; i < count; ++i)
+      WriteValue((*value)[i]);
+    return true;
+  }
+
+  template <typename T>
+  bool VisitArray(const char*, uint32_t count, const T* value) {
+    if (!*value)
+      count = 0;
+    WriteRaw(&count, sizeof(count));
+    for (uint32_t i = 0; i < count; ++i)
+      WriteValue((*value)[i]);
+    return true;
+  }
+
+  template <typename T, typename = EnableForStruct<T>, typename = void>
+  void WriteValue(const T& value) {
+    T* object = const_cast<T*>(&value);
+    VisitSelectors(this, object);
+    Iterate(this, object);
+  }
+
+  template <typename T, typename = typename std::enable_if<
+                            std::is_arithmetic<T>::value ||
+                            std::is_enum<T>::value>::type>
+  void WriteValue(const T& value) {
+    WriteRaw(&value, sizeof(value));
+  }
+
+  template <typename T, size_t N> void WriteValue(const T (&value)[N]) {
+    for (size_t i = 0; i < N; ++i)
+      WriteValue(value[i]);
+  }
+
+  template <size_t N> void WriteValue(const char (&value)[N]) {
+    uint32_t length = static_cast<uint32_t>(strnlen(value, N));
+    WriteRaw(&length, sizeof(length));
+    WriteRaw(value, length);
+  }
+
+  template <typename T> void WriteValue(const std::vector<T>& value) {
+    WriteSize(value.size());
+    for (const T& element : value)
+      WriteValue(element);
+  }
+
+  template <typename F, typename S>
+  void WriteValue(const std::pair<F, S>& value) {
+    WriteValue(value.first);
+    WriteValue(value.second);
+  }
+
+  template <typename F, typename S>
+  void WriteValue(const std::map<F, S>& value) {
+    WriteSize(value.size());
+    for (const auto& kv : value)
+      WriteValue(kv);
+  }
+
+  void WriteRaw(const void* data, size_t size) {
+    out_->append(static_cast<const char*>(data), size);
+  }
+
+ private:
+  void WriteSize(size_t size) {
+    assert(size <= std::numeric_limits<uint32_t>::max());
+    uint32_t size32 = static_cast<uint32_t>(size);
+    WriteRaw(&size32, sizeof(size32));
+  }
+
+  std::string* out_;
+};
+
+class BinaryReaderVisitor {
+ public:
+  BinaryReaderVisitor(const char* data, size_t size, std::string* errors)
+      : data_(data), end_(data + size), errors_(errors) {}
+
+  template <typename T> bool Visit(const char* key, T* value) {
+    return Check(ReadValue(value), key);
+  }
+
+  template <typename T, uint32_t N>
+  bool VisitArray(const char* key, uint32_t count, T (*value)[N]) {
+    if (count > N)
+      return Check(false, key);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (!ReadValue(&(*value)[i]))
+        return Check(false, key);
+    }
+    return true;
+  }
+
+  // The elements of arrays the structure only points to have nowhere to go,
+  // so they are skipped and the pointer is cleared.
+  template <typename T>
+  bool VisitArray(const char* key, uint32_t, T** value) {
+    uint32_t count = 0;
+    *value = nullptr;
+    return Check(ReadRaw(&count, sizeof(count)) &&
+                     Skip(static_cast<size_t>(count) * sizeof(T)),
+                 key);
+  }
+
+  template <typename T, typename = EnableForStruct<T>, typename = void>
+  bool ReadValue(T* value) {
+    return VisitSelectors(this, value) && Iterate(this, value);
+  }
+
+  template <typename T, typename = EnableForArithmetic<T>>
+  bool ReadValue(T* value) {
+    return ReadRaw(value, sizeof(*value));
+  }
+
+  // Rejects the values the JSON reader rejects, so that a corrupt binary
+  // can't smuggle in enums the rest of vkjson doesn't know.
+  template <typename T, typename = EnableForEnum<T>, typename = void,
+            typename = void>
+  bool ReadValue(T* value) {
+    static_assert(sizeof(T) == sizeof(uint32_t), "Unexpected enum size");
+    uint32_t raw = 0;
+    if (!ReadRaw(&raw, sizeof(raw)) || !EnumTraits<T>::exist(raw))
+      return false;
+    *value = static_cast<T>(raw);
+    return true;
+  }
+
+  bool ReadValue(bool* value) {
+    uint8_t byte = 0;
+    if (!ReadRaw(&byte, sizeof(byte)) || byte > 1)
+      return false;
+    *value = byte;
+    return true;
+  }
+
+  template <typename T, size_t N> bool ReadValue(T (*value)[N]) {
+    for (size_t i = 0; i < N; ++i) {
+      if (!ReadValue(&(*value)[i]))
+        return false;
+    }
+    return true;
+  }
+
+  template <size_t N> bool ReadValue(char (*value)[N]) {
+    uint32_t length = 0;
+    if (!ReadRaw(&length, sizeof(length)) || length >= N)
+      return false;
+    memset(*value, 0, N);
+    return ReadRaw(*value, length);
+  }
+
+  template <typename T> bool ReadValue(std::vector<T>* value) {
+    uint32_t size = 0;
+    // Every element takes at least a byte, so a corrupt size can't make the
+    // vector larger than the input.
+    if (!ReadRaw(&size, sizeof(size)) ||
+        size > static_cast<size_t>(end_ - data_))
+      return false;
+    value->resize(size);
+    for (T& element : *value) {
+      if (!ReadValue(&element))
+        return false;
+    }
+    return true;
+  }
+
+  template <typename F, typename S> bool ReadValue(std::pair<F, S>* value) {
+    return ReadValue(&value->first) && ReadValue(&value->second);
+  }
+
+  template <typename F, typename S> bool ReadValue(std::map<F, S>* value) {
+    uint32_t size = 0;
+    if (!ReadRaw(&size, sizeof(size)))
+      return false;
+    for (uint32_t i = 0; i < size; ++i) {
+      std::pair<F, S> elem;
+      if (!ReadValue(&elem) || !value->insert(elem).second)
+        return false;
+    }
+    return true;
+  }
+
+  bool ReadRaw(void* data, size_t size) {
+    if (size > static_cast<size_t>(end_ - data_))
+      return false;
+    memcpy(data, data_, size);
+    data_ += size;
+    return true;
+  }
+
+  bool at_end() const { return data_ == end_; }
+
+ private:
+  bool Skip(size_t size) {
+    if (size > static_cast<size_t>(end_ - data_))
+      return false;
+    data_ += size;
+    return true;
+  }
+
+  // Reports the innermost key that failed to read.
+  bool Check(bool ok, const char* key) {
+    if (!ok && errors_ && errors_->empty())
+      *errors_ = std::string("Truncated or invalid ") + key + ".";
+    return ok;
+  }
+
+  const char* data_;
+  const char* end_;
+  std::string* errors_;
+};
+
+template <typename T> std::string VkTypeToBinary(const T& t) {
+  std::string binary;
+  BinaryWriterVisitor writer(&binary);
+  writer.WriteRaw(&kBinaryMagic, sizeof(kBinaryMagic));
+  writer.WriteRaw(&kBinaryVersion, sizeof(kBinaryVersion));
+  writer.WriteValue(t);
+  return binary;
+}
+
+template <typename T> bool VkTypeFromBinary(const std::string& binary,
+                                            T* t,
+                                            std::string* errors) {
+  *t = T();
+  if (errors)
+    errors->clear();
+  BinaryReaderVisitor reader(binary.data(), binary.size(), errors);
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  if (!reader.ReadRaw(&magic, sizeof(magic)) ||
+      !reader.ReadRaw(&version, sizeof(version)) || magic != kBinaryMagic ||
+      version != kBinaryVersion) {
+    if (errors)
+      *errors = "Not a vkjson binary.";
+    return false;
+  }
+  if (!reader.ReadValue(t))
+    return false;
+  if (!reader.at_end()) {
+    if (errors)
+      *errors = "Trailing data.";
+    return false;
+  }
+  return true;
+}
+
 }  // anonymous namespace
 
 std::string VkJsonInstanceToJson(const VkJsonInstance& instance) {
@@ -1607,6 +2161,20 @@ bool VkJsonInstanceFromJson(const std::string& json,
   return VkTypeFromJson(json, instance, errors);
 }
 
+bool VkJsonInstanceWriteJson(const VkJsonInstance& instance, int fd) {
+  return VkTypeWriteJson(instance, fd);
+}
+
+std::string VkJsonInstanceToBinary(const VkJsonInstance& instance) {
+  return VkTypeToBinary(instance);
+}
+
+bool VkJsonInstanceFromBinary(const std::string& binary,
+                              VkJsonInstance* instance,
+                              std::string* errors) {
+  return VkTypeFromBinary(binary, instance, errors);
+}
+
 std::string VkJsonDeviceToJson(const VkJsonDevice& device) {
   return VkTypeToJson(device);
 }
@@ -1617,6 +2185,20 @@ bool VkJsonDeviceFromJson(const std::string& json,
   return VkTypeFromJson(json, device, errors);
 };
 
+bool VkJsonDeviceWriteJson(const VkJsonDevice& device, int fd) {
+  return VkTypeWriteJson(device, fd);
+}
+
+std::string VkJsonDeviceToBinary(const VkJsonDevice& device) {
+  return VkTypeToBinary(device);
+}
+
+bool VkJsonDeviceFromBinary(const std::string& binary,
+                            VkJsonDevice* device,
+                            std::string* errors) {
+  return VkTypeFromBinary(binary, device, errors);
+}
+
 std::string VkJsonImageFormatPropertiesToJson(
     const VkImageFormatProperties& properties) {
   return VkTypeToJson(properties);
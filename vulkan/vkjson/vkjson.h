@@ -170,12 +170,30 @@ std::string VkJsonInstanceToJson(const VkJsonInstance& instance);
 bool VkJsonInstanceFromJson(const std::string& json,
                             VkJsonInstance* instance,
                             std::string* errors);
+/*
+ * Writes the JSON of VkJsonInstanceToJson to the file descriptor fd as it is
+ * generated. Returns false if the write fails.
+ */
+bool VkJsonInstanceWriteJson(const VkJsonInstance& instance, int fd);
+/*
+ * A compact binary encoding that is much cheaper to parse than the JSON. It is
+ * in host byte order, and only meant to be read by the same version of vkjson.
+ */
+std::string VkJsonInstanceToBinary(const VkJsonInstance& instance);
+bool VkJsonInstanceFromBinary(const std::string& binary,
+                              VkJsonInstance* instance,
+                              std::string* errors);
 
 VkJsonDevice VkJsonGetDevice(VkPhysicalDevice device);
 std::string VkJsonDeviceToJson(const VkJsonDevice& device);
 bool VkJsonDeviceFromJson(const std::string& json,
                           VkJsonDevice* device,
                           std::string* errors);
+bool VkJsonDeviceWriteJson(const VkJsonDevice& device, int fd);
+std::string VkJsonDeviceToBinary(const VkJsonDevice& device);
+bool VkJsonDeviceFromBinary(const std::string& binary,
+                            VkJsonDevice* device,
+                            std::string* errors);
 
 std::string VkJsonImageFormatPropertiesToJson(
     const VkImageFormatProperties& properties);
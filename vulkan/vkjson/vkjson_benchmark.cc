@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2026 Google, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+// Measures the time and peak heap use of serializing the instance of the
+// installed Vulkan driver, which is the null driver (vulkan.default) on builds
+// without a vendor driver.
+
+#include "vkjson.h"
+
+#include <fcntl.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+std::atomic<size_t> g_heap_bytes(0);
+std::atomic<size_t> g_peak_heap_bytes(0);
+
+void* Allocate(size_t size) {
+  void* ptr = malloc(size);
+  if (!ptr)
+    abort();
+  size_t bytes = g_heap_bytes += malloc_usable_size(ptr);
+  size_t peak = g_peak_heap_bytes;
+  while (bytes > peak &&
+         !g_peak_heap_bytes.compare_exchange_weak(peak, bytes)) {
+  }
+  return ptr;
+}
+
+void Deallocate(void* ptr) {
+  if (!ptr)
+    return;
+  g_heap_bytes -= malloc_usable_size(ptr);
+  free(ptr);
+}
+
+const VkJsonInstance& GetInstance() {
+  static const VkJsonInstance* instance =
+      new VkJsonInstance(VkJsonGetInstance());
+  return *instance;
+}
+
+// Runs serialize once per iteration, and reports the most heap it had in use
+// on top of what was allocated before it started.
+template <typename F>
+void RunWithPeakHeap(benchmark::State& state, F serialize) {
+  size_t peak = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    size_t base = g_heap_bytes;
+    g_peak_heap_bytes = base;
+    bytes += serialize();
+    peak = std::max(peak, g_peak_heap_bytes - base);
+  }
+  state.SetBytesProcessed(bytes);
+  state.counters["peak_heap_bytes"] = peak;
+}
+
+void BM_vkjson_ToJson(benchmark::State& state) {
+  const VkJsonInstance& instance = GetInstance();
+  RunWithPeakHeap(state, [&] {
+    std::string json = VkJsonInstanceToJson(instance);
+    benchmark::DoNotOptimize(json.data());
+    return json.size();
+  });
+}
+BENCHMARK(BM_vkjson_ToJson);
+
+void BM_vkjson_WriteJson(benchmark::State& state) {
+  const VkJsonInstance& instance = GetInstance();
+  int fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    state.SkipWithError("failed to open /dev/null");
+    return;
+  }
+  size_t size = VkJsonInstanceToJson(instance).size();
+  RunWithPeakHeap(state, [&] {
+    if (!VkJsonInstanceWriteJson(instance, fd))
+      state.SkipWithError("write failed");
+    return size;
+  });
+  close(fd);
+}
+BENCHMARK(BM_vkjson_WriteJson);
+
+void BM_vkjson_FromJson(benchmark::State& state) {
+  std::string json = VkJsonInstanceToJson(GetInstance());
+  RunWithPeakHeap(state, [&] {
+    VkJsonInstance instance;
+    if (!VkJsonInstanceFromJson(json, &instance, nullptr))
+      state.SkipWithError("parse failed");
+    return json.size();
+  });
+}
+BENCHMARK(BM_vkjson_FromJson);
+
+void BM_vkjson_ToBinary(benchmark::State& state) {
+  const VkJsonInstance& instance = GetInstance();
+  RunWithPeakHeap(state, [&] {
+    std::string binary = VkJsonInstanceToBinary(instance);
+    benchmark::DoNotOptimize(binary.data());
+    return binary.size();
+  });
+}
+BENCHMARK(BM_vkjson_ToBinary);
+
+void BM_vkjson_FromBinary(benchmark::State& state) {
+  std::string binary = VkJsonInstanceToBinary(GetInstance());
+  RunWithPeakHeap(state, [&] {
+    VkJsonInstance instance;
+    if (!VkJsonInstanceFromBinary(binary, &instance, nullptr))
+      state.SkipWithError("parse failed");
+    return binary.size();
+  });
+}
+BENCHMARK(BM_vkjson_FromBinary);
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return Allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return Allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  Deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  Deallocate(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  Deallocate(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  Deallocate(ptr);
+}
+
+BENCHMARK_MAIN();
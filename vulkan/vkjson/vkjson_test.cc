@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Copyright (c) 2026 Google, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "vkjson.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+namespace {
+
+const VkImageLayout kCopySrcLayouts[] = {VK_IMAGE_LAYOUT_GENERAL,
+                                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+
+// An instance with a device that exercises every kind of value the writers
+// handle: strings that need escaping, floats that aren't finite, maps, and
+// arrays the structures only point to.
+VkJsonInstance MakeInstance() {
+  VkJsonInstance instance;
+  instance.api_version = VK_API_VERSION_1_4;
+
+  VkJsonLayer layer = {};
+  snprintf(layer.properties.layerName, sizeof(layer.properties.layerName),
+           "VK_LAYER_test");
+  snprintf(layer.properties.description, sizeof(layer.properties.description),
+           "quote \" backslash \\ tab \t newline \n e-acute \xc3\xa9");
+  layer.properties.specVersion = VK_API_VERSION_1_4;
+  VkExtensionProperties extension = {};
+  snprintf(extension.extensionName, sizeof(extension.extensionName),
+           "VK_EXT_debug_utils");
+  extension.specVersion = 2;
+  layer.extensions.push_back(extension);
+  instance.layers.push_back(layer);
+  instance.extensions.push_back(extension);
+
+  VkJsonDevice device;
+  device.properties.apiVersion = VK_API_VERSION_1_4;
+  device.properties.deviceType = VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU;
+  snprintf(device.properties.deviceName, sizeof(device.properties.deviceName),
+           "GPU \"1\"\\\x01");
+  device.properties.limits.maxImageDimension2D = 16384;
+  device.properties.limits.bufferImageGranularity = 0x10000;
+  device.properties.limits.maxSamplerAnisotropy =
+      std::numeric_limits<float>::quiet_NaN();
+  device.properties.limits.pointSizeRange[1] =
+      std::numeric_limits<float>::infinity();
+  device.properties.limits.lineWidthRange[0] =
+      -std::numeric_limits<float>::infinity();
+  device.properties.limits.lineWidthGranularity = 0.125f;
+  device.properties.limits.pointSizeGranularity = 0.1f;
+  device.features.robustBufferAccess = VK_TRUE;
+  device.memory.memoryTypeCount = 2;
+  device.memory.memoryTypes[0].propertyFlags =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  device.memory.memoryTypes[1].propertyFlags =
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  device.memory.memoryTypes[1].heapIndex = 1;
+  device.memory.memoryHeapCount = 2;
+  device.memory.memoryHeaps[0].size = 1ull << 32;
+  device.memory.memoryHeaps[1].size = 1ull << 30;
+  VkQueueFamilyProperties queue = {};
+  queue.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+  queue.queueCount = 4;
+  device.queues.push_back(queue);
+  device.extensions.push_back(extension);
+  device.formats[VK_FORMAT_R8G8B8A8_UNORM].optimalTilingFeatures =
+      VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+  device.formats[VK_FORMAT_D32_SFLOAT].optimalTilingFeatures =
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+  device.point_clipping_properties.pointClippingBehavior =
+      VK_POINT_CLIPPING_BEHAVIOR_USER_CLIP_PLANES_ONLY;
+  device.ext_driver_properties.driver_properties_khr.driverID =
+      VK_DRIVER_ID_GOOGLE_SWIFTSHADER;
+  device.core12.properties.driverID = VK_DRIVER_ID_GOOGLE_SWIFTSHADER;
+  snprintf(device.core12.properties.driverName,
+           sizeof(device.core12.properties.driverName), "SwiftShader");
+  device.core14.properties.copySrcLayoutCount = 2;
+  device.core14.properties.pCopySrcLayouts =
+      const_cast<VkImageLayout*>(kCopySrcLayouts);
+  // A count without an array is written as an empty array.
+  device.core14.properties.copyDstLayoutCount = 3;
+  device.core14.properties.pCopyDstLayouts = nullptr;
+  instance.devices.push_back(device);
+
+  VkJsonDeviceGroup device_group;
+  device_group.properties.physicalDeviceCount = 1;
+  device_group.device_inds.push_back(0);
+  instance.device_groups.push_back(device_group);
+  return instance;
+}
+
+std::string ReadFile(FILE* file) {
+  std::string contents;
+  char buffer[4096];
+  rewind(file);
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    contents.append(buffer, size);
+  return contents;
+}
+
+TEST(VkJsonTest, JsonMatchesJsoncpp) {
+  const std::string json = VkJsonInstanceToJson(MakeInstance());
+
+  Json::Value root;
+  std::string errors;
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  ASSERT_TRUE(reader->parse(json.data(), json.data() + json.size(), &root,
+                            &errors))
+      << errors;
+  EXPECT_EQ(root.toStyledString(), json);
+
+  const Json::Value& device = root["devices"][0];
+  EXPECT_EQ("GPU \"1\"\\\x01",
+            device["properties"]["deviceName"].asString());
+  EXPECT_TRUE(device["properties"]["limits"]["maxSamplerAnisotropy"].isNull());
+  const Json::Value& core14 = device["core14"]["properties"];
+  ASSERT_EQ(2u, core14["pCopySrcLayouts"].size());
+  EXPECT_EQ(static_cast<uint32_t>(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL),
+            core14["pCopySrcLayouts"][1].asUInt());
+  EXPECT_EQ(0u, core14["pCopyDstLayouts"].size());
+}
+
+TEST(VkJsonTest, WriteJsonMatchesToJson) {
+  const VkJsonInstance instance = MakeInstance();
+  FILE* file = tmpfile();
+  ASSERT_NE(nullptr, file);
+  EXPECT_TRUE(VkJsonInstanceWriteJson(instance, fileno(file)));
+  EXPECT_EQ(VkJsonInstanceToJson(instance), ReadFile(file));
+  fclose(file);
+}
+
+TEST(VkJsonTest, BinaryRoundTrip) {
+  const VkJsonInstance instance = MakeInstance();
+  const std::string binary = VkJsonInstanceToBinary(instance);
+
+  VkJsonInstance decoded;
+  std::string errors;
+  ASSERT_TRUE(VkJsonInstanceFromBinary(binary, &decoded, &errors)) << errors;
+  EXPECT_TRUE(errors.empty());
+
+  // The binary has nowhere to put the arrays the structures point to.
+  const VkPhysicalDeviceVulkan14Properties& core14 =
+      decoded.devices[0].core14.properties;
+  EXPECT_EQ(nullptr, core14.pCopySrcLayouts);
+  EXPECT_EQ(2u, core14.copySrcLayoutCount);
+  VkJsonInstance expected = instance;
+  expected.devices[0].core14.properties.pCopySrcLayouts = nullptr;
+  EXPECT_EQ(VkJsonInstanceToJson(expected), VkJsonInstanceToJson(decoded));
+  EXPECT_EQ(VkJsonInstanceToBinary(expected), VkJsonInstanceToBinary(decoded));
+}
+
+TEST(VkJsonTest, BinaryRejectsTruncatedInput) {
+  const std::string binary = VkJsonInstanceToBinary(MakeInstance());
+  // Every prefix near the start, where the header and the sizes are, and a
+  // spread of the rest.
+  const size_t step = std::max<size_t>(1, binary.size() / 1000);
+  for (size_t size = 0; size < binary.size();
+       size += size < 256 ? 1 : step) {
+    VkJsonInstance decoded;
+    std::string errors;
+    EXPECT_FALSE(
+        VkJsonInstanceFromBinary(binary.substr(0, size), &decoded, &errors))
+        << "size " << size;
+    EXPECT_FALSE(errors.empty()) << "size " << size;
+  }
+}
+
+TEST(VkJsonTest, BinaryRejectsTrailingInput) {
+  VkJsonInstance decoded;
+  std::string errors;
+  EXPECT_FALSE(VkJsonInstanceFromBinary(
+      VkJsonInstanceToBinary(MakeInstance()) + '\0', &decoded, &errors));
+  EXPECT_EQ("Trailing data.", errors);
+}
+
+TEST(VkJsonTest, BinaryRejectsUnknownEnums) {
+  VkJsonInstance instance = MakeInstance();
+  std::string binary = VkJsonInstanceToBinary(instance);
+  instance.devices[0].properties.deviceType =
+      VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+  const std::string other = VkJsonInstanceToBinary(instance);
+  ASSERT_EQ(binary.size(), other.size());
+
+  // The only difference is the device type.
+  const size_t offset =
+      std::mismatch(binary.begin(), binary.end(), other.begin()).first -
+      binary.begin();
+  ASSERT_LE(offset + sizeof(uint32_t), binary.size());
+  const uint32_t unknown = 0x7fffffff;
+  memcpy(&binary[offset], &unknown, sizeof(unknown));
+
+  VkJsonInstance decoded;
+  std::string errors;
+  EXPECT_FALSE(VkJsonInstanceFromBinary(binary, &decoded, &errors));
+  EXPECT_FALSE(errors.empty());
+}
+
+}  // namespace